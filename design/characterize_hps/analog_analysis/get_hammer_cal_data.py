@@ -21,6 +21,11 @@
 # To run this code, install Python.
 # Open a command prompt or terminal (depending on OS).k
 # Type: python get_hammer_cal_data.py
+#
+# Uses the raw ADC count streaming mode of the production hammer firmware.
+# In hammer_settings.cpp set raw_stream_enable = true, set UDP, and set
+# raw_stream_channel[] true for four channels, with the channel under test
+# as the lowest index. Each count arrives as 3 bytes, least significant first.
 
 import socket
 import time
@@ -48,6 +48,7 @@ void AutoMute::Setup(int maximum_midi_velocity) {
   // Set mute velocity to a non-zero value so that the condition is audible
   // which alerts to user that something did try to play.
   mute_velocity_ = 16;
+  activated_ = false;
 
   // Increase this value if more than one person is playing the piano.
   // For example, a duet performance.
@@ -94,6 +95,7 @@ int AutoMute::AutomaticallyDecreaseVolume(int velocity, int debug_level) {
     if (millis() - last_loud_note_time_ < loud_note_interval_) {
       if (simultaneous_note_count_ >= max_simultaneous_notes_) {
         return_velocity = mute_velocity_;
+        activated_ = true;
         if (debug_level >= DEBUG_INFO) {
           Serial.println("AutoMute Activated - piano volume reduced for this note.");
         }
@@ -118,10 +120,18 @@ int AutoMute::AutomaticallyDecreaseVolume(int velocity, int debug_level) {
   // All max MIDI volume are muted.
   if (velocity >= maximum_midi_velocity_) {
     return_velocity = mute_velocity_;
+    activated_ = true;
     if (debug_level >= DEBUG_INFO) {
       Serial.println("AutoMute Activated - piano volume reduced for this note.");
     }
   }
 
   return return_velocity;
-}
\ No newline at end of file
+}
+
+// True once after any mute. Used to freeze the black box recorder.
+bool AutoMute::Activated() {
+  bool return_value = activated_;
+  activated_ = false;
+  return return_value;
+}
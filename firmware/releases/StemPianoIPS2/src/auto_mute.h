@@ -31,9 +31,11 @@ class AutoMute
     AutoMute();
     void Setup(int);
     int AutomaticallyDecreaseVolume(int, int);
+    bool Activated();
  
   private:
     int mute_velocity_;
+    bool activated_;
     int max_simultaneous_notes_;
     int simultaneous_note_count_;
     int max_simultaneous_volume_;
@@ -0,0 +1,423 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// black_box.cpp
+//
+// For ips pcb version 2.X
+//
+// Black-box recorder of raw frames and events in external PSRAM.
+//
+// Records every raw ADC frame, all NUM_CHANNELS channels, plus the
+// hammer and damper events into a ring buffer in PSRAM. After a
+// problem, freeze the recorder and dump the last seconds to a
+// computer for replay. See software/releases/ips2_black_box.
+//
+// Frames are compressed by FrameCoder, in blocks of
+// BLACK_BOX_BLOCK_FRAMES frames (see frame_coder.cpp). When the
+// memory is full the oldest blocks are overwritten.
+//
+// Freezes on the "blackbox freeze" command or when AutoMute
+// activates. Recording continues for post_trigger_frames so the
+// dump shows what happened after the trigger.
+//
+// Commands (serial monitor or Ethernet, see command_line.cpp):
+//   blackbox          Report the state and the recorded length.
+//   blackbox freeze   Freeze the recorder.
+//   blackbox dump     Freeze if needed, then send the recording to
+//                     where the command came from.
+//   blackbox on       Clear and start recording.
+//   blackbox off      Stop recording.
+//
+// Dump packets, all values least significant byte first. Over the
+// serial monitor each packet is one line of "bb " then hex digits.
+//   bytes 0-1     'B' 'B'
+//   byte 2        Type: 'H' header, 'K' block, 'D' data, 'E' end.
+//   bytes 3-4     Packet sequence number.
+//   'H' then      Sample period (4), channels (1), block frames (2),
+//                 blocks (4), trigger frame (4), events dropped (4),
+//                 Rice escapes (4), reason (BLACK_BOX_REASON_LENGTH).
+//   'K' then      First frame (4), micros (4), frames (4), bytes (4).
+//   'D' then      Block bytes, in order.
+
+#include "black_box.h"
+
+// The frames in PSRAM, and the block index, 64 kB, in the second RAM
+// bank so that the PSRAM holds only the power of 2 ring. Neither is
+// initialized at startup.
+EXTMEM static uint8_t black_box_memory[BLACK_BOX_BYTES];
+DMAMEM static BlackBoxBlock black_box_blocks[BLACK_BOX_MAX_BLOCKS];
+
+// From the Teensy 4.1 linker script. Everything placed in EXTMEM.
+extern "C" uint8_t _extram_start;
+extern "C" uint8_t _extram_end;
+
+BlackBox::BlackBox() {}
+
+void BlackBox::Setup(bool black_box_enable, int post_trigger_frames,
+int sample_period, int debug_level) {
+
+  debug_level_ = debug_level;
+  sample_period_ = sample_period;
+  post_trigger_frames_ = post_trigger_frames;
+  blocks_ = black_box_blocks;
+
+  // Without PSRAM, writing to EXTMEM memory hangs the processor.
+  // Check all of EXTMEM, not only the ring, in case other classes
+  // put memory there too.
+  enable_ = black_box_enable;
+  uint32_t extmem_bytes = &_extram_end - &_extram_start;
+  if (enable_ == true &&
+  static_cast<uint32_t>(external_psram_size) * 1024 * 1024 < extmem_bytes) {
+    enable_ = false;
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.printf("Black box disabled, EXTMEM needs %lu kB of PSRAM, found %d MB.\n",
+      static_cast<unsigned long>(extmem_bytes / 1024), external_psram_size);
+    }
+  }
+
+  Start();
+
+  if (enable_ == true && debug_level_ >= DEBUG_INFO) {
+    Serial.printf("Black box recording, %d MB of PSRAM.\n",
+    BLACK_BOX_BYTES / (1024*1024));
+  }
+}
+
+// Change the sample period while running. The dump header has the
+// period at the time of the dump. Each block has its start time.
+void BlackBox::SetSamplePeriod(int sample_period) {
+  sample_period_ = sample_period;
+}
+
+// Returns true if the command was a black box command.
+bool BlackBox::ParseCommand(const char *command, CommandLine *Cmd) {
+
+  const char *arguments = CommandLine::Arguments(command, "blackbox");
+  if (arguments == nullptr) {
+    return false;
+  }
+
+  char reply[COMMAND_REPLY_LENGTH];
+
+  if (enable_ == false) {
+    Cmd->Reply("Black box is disabled.");
+  }
+  else if (strcmp(arguments, "on") == 0) {
+    Start();
+    Cmd->Reply("Black box is recording.");
+  }
+  else if (strcmp(arguments, "off") == 0) {
+    EndBlock();
+    recording_ = false;
+    Cmd->Reply("Black box is off.");
+  }
+  else if (strcmp(arguments, "freeze") == 0) {
+    Freeze("command");
+    Cmd->Reply("Black box freeze.");
+  }
+  else if (strcmp(arguments, "dump") == 0) {
+    if (newest_ < oldest_) {
+      Cmd->Reply("Error - black box is empty.");
+    }
+    else {
+      Freeze("dump");
+      dump_to_network_ = Cmd->LastCommandFromNetwork();
+      dump_stage_ = dump_header;
+      dump_sequence_ = 0;
+      dump_countdown_ = 1;
+      Cmd->Reply("Black box dump.");
+    }
+  }
+  else if (*arguments == 0) {
+    float seconds = 0.0;
+    float bits_per_value = 0.0;
+    if (newest_ >= oldest_) {
+      seconds = 1.0e-6 * (last_micros_ - GetBlock(oldest_)->micros);
+      uint32_t values = (frame_ - GetBlock(oldest_)->first_frame) * NUM_CHANNELS;
+      if (values > 0) {
+        bits_per_value = 8.0 * (head_ - GetBlock(oldest_)->start) / values;
+      }
+    }
+    snprintf(reply, COMMAND_REPLY_LENGTH,
+    "Black box %s, %.1f seconds, %.2f bits per value, %lu events dropped.",
+    frozen_ ? "frozen" : (recording_ ? "recording" : "off"),
+    seconds, bits_per_value, static_cast<unsigned long>(Coder_.EventsDropped()));
+    Cmd->Reply(reply);
+  }
+  else {
+    Cmd->Reply("Error - use blackbox, blackbox on, off, freeze, or dump.");
+  }
+  return true;
+}
+
+// Compress one frame of raw ADC values and the events into PSRAM.
+void BlackBox::AddFrame(const unsigned int *adc_values,
+const bool *hammer_event, const float *hammer_velocity,
+const bool *damper_event) {
+
+  if (recording_ == false || frozen_ == true) {
+    return;
+  }
+
+  if (block_open_ == false || Coder_.Frames() >= BLACK_BOX_BLOCK_FRAMES) {
+    StartBlock();
+  }
+
+  PutBytes(Coder_.AddFrame(adc_values, hammer_event, hammer_velocity,
+  damper_event, coded_));
+
+  GetBlock(newest_)->frames = Coder_.Frames();
+  frame_++;
+  last_micros_ = micros();
+
+  if (triggered_ == true) {
+    post_trigger_remaining_--;
+    if (post_trigger_remaining_ <= 0) {
+      EndBlock();
+      frozen_ = true;
+      if (debug_level_ >= DEBUG_INFO) {
+        Serial.printf("Black box frozen by %s.\n", reason_);
+      }
+    }
+  }
+}
+
+// Stop after post_trigger_frames more frames.
+// Only the first trigger counts until the next "blackbox on".
+void BlackBox::Freeze(const char *reason) {
+  if (recording_ == false || triggered_ == true) {
+    return;
+  }
+  triggered_ = true;
+  trigger_frame_ = frame_;
+  strncpy(reason_, reason, BLACK_BOX_REASON_LENGTH - 1);
+  reason_[BLACK_BOX_REASON_LENGTH - 1] = 0;
+  post_trigger_remaining_ = post_trigger_frames_;
+  if (post_trigger_remaining_ <= 0) {
+    EndBlock();
+    frozen_ = true;
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.printf("Black box frozen by %s.\n", reason_);
+    }
+  }
+}
+
+bool BlackBox::Frozen() {
+  return frozen_;
+}
+
+// Call every sample. During a dump, sends one packet every
+// BLACK_BOX_DUMP_INTERVAL samples to where the dump command came from.
+void BlackBox::SendDump(Network *Eth, bool switch_enable_ethernet,
+bool switch_require_tcp_connection) {
+
+  if (dump_stage_ == dump_idle || (frozen_ == false && recording_ == true)) {
+    return;
+  }
+  if (--dump_countdown_ > 0) {
+    return;
+  }
+  dump_countdown_ = BLACK_BOX_DUMP_INTERVAL;
+
+  int length;
+  if (dump_to_network_ == true) {
+    length = NextPacket(BLACK_BOX_NETWORK_PACKET_BYTES);
+    Eth->SendReplyBytes(packet_, length, switch_enable_ethernet,
+    switch_require_tcp_connection);
+  }
+  else {
+    // Wait instead of blocking in Serial.print().
+    if (Serial.availableForWrite() < 2 * BLACK_BOX_SERIAL_PACKET_BYTES + 8) {
+      dump_countdown_ = 1;
+      return;
+    }
+    length = NextPacket(BLACK_BOX_SERIAL_PACKET_BYTES);
+    static const char hex[] = "0123456789abcdef";
+    char line[2 * BLACK_BOX_SERIAL_PACKET_BYTES + 4];
+    int ptr = 0;
+    line[ptr++] = 'b';
+    line[ptr++] = 'b';
+    line[ptr++] = ' ';
+    for (int ind = 0; ind < length; ind++) {
+      line[ptr++] = hex[packet_[ind] >> 4];
+      line[ptr++] = hex[packet_[ind] & 15];
+    }
+    line[ptr] = 0;
+    Serial.println(line);
+  }
+
+  if (dump_stage_ == dump_idle && debug_level_ >= DEBUG_INFO) {
+    Serial.printf("Black box dump done, %u packets.\n", dump_sequence_);
+  }
+}
+
+// Length and compression of the recording, at DEBUG_STATS.
+void BlackBox::PrintStatistics() {
+  if (debug_level_ >= DEBUG_STATS && recording_ == true && frozen_ == false &&
+  newest_ >= oldest_) {
+    uint32_t values = (frame_ - GetBlock(oldest_)->first_frame) * NUM_CHANNELS;
+    if (values > 0) {
+      Serial.printf("Black box %.1f seconds, %.2f bits per value, %lu escapes.\n",
+      1.0e-6 * (last_micros_ - GetBlock(oldest_)->micros),
+      8.0 * (head_ - GetBlock(oldest_)->start) / values,
+      static_cast<unsigned long>(Coder_.Escapes()));
+    }
+  }
+}
+
+// Private methods. ////////
+
+void BlackBox::Start() {
+  recording_ = enable_;
+  frozen_ = false;
+  triggered_ = false;
+  reason_[0] = 0;
+  trigger_frame_ = 0;
+  head_ = 0;
+  block_open_ = false;
+  oldest_ = 0;
+  newest_ = -1;
+  frame_ = 0;
+  last_micros_ = micros();
+  Coder_.Setup();
+  dump_stage_ = dump_idle;
+}
+
+void BlackBox::StartBlock() {
+  EndBlock();
+  newest_++;
+  if (newest_ - oldest_ >= BLACK_BOX_MAX_BLOCKS) {
+    oldest_++;
+  }
+  BlackBoxBlock *block = GetBlock(newest_);
+  block->start = head_;
+  block->first_frame = frame_;
+  block->micros = micros();
+  block->frames = 0;
+  Coder_.StartBlock();
+  block_open_ = true;
+}
+
+void BlackBox::EndBlock() {
+  if (block_open_ == true) {
+    PutBytes(Coder_.EndBlock(coded_));
+    block_open_ = false;
+  }
+}
+
+// Overwrites the oldest blocks when the memory is full.
+void BlackBox::PutBytes(int num_bytes) {
+  for (int ind = 0; ind < num_bytes; ind++) {
+    while (oldest_ < newest_ &&
+    head_ - GetBlock(oldest_)->start >= BLACK_BOX_BYTES) {
+      oldest_++;
+    }
+    black_box_memory[head_ & (BLACK_BOX_BYTES - 1)] = coded_[ind];
+    head_++;
+  }
+}
+
+BlackBoxBlock *BlackBox::GetBlock(int block) {
+  return &blocks_[block & (BLACK_BOX_MAX_BLOCKS - 1)];
+}
+
+uint32_t BlackBox::BlockLength(int block) {
+  if (block < newest_) {
+    return GetBlock(block + 1)->start - GetBlock(block)->start;
+  }
+  return head_ - GetBlock(block)->start;
+}
+
+// Fill packet_ with the next dump packet and return its length.
+int BlackBox::NextPacket(int max_bytes) {
+
+  int ptr = 0;
+  uint32_t values[4];
+  int num_values = 0;
+
+  packet_[ptr++] = 'B';
+  packet_[ptr++] = 'B';
+  ptr++;
+  packet_[ptr++] = dump_sequence_ & 255;
+  packet_[ptr++] = (dump_sequence_ >> 8) & 255;
+  dump_sequence_++;
+
+  switch (dump_stage_) {
+    case dump_header:
+      packet_[2] = 'H';
+      for (int shift = 0; shift < 4; shift++) {
+        packet_[ptr++] = (sample_period_ >> (8*shift)) & 255;
+      }
+      packet_[ptr++] = NUM_CHANNELS;
+      packet_[ptr++] = BLACK_BOX_BLOCK_FRAMES & 255;
+      packet_[ptr++] = (BLACK_BOX_BLOCK_FRAMES >> 8) & 255;
+      values[num_values++] = newest_ - oldest_ + 1;
+      values[num_values++] = trigger_frame_;
+      values[num_values++] = Coder_.EventsDropped();
+      values[num_values++] = Coder_.Escapes();
+      for (int ind = 0; ind < num_values; ind++) {
+        for (int shift = 0; shift < 4; shift++) {
+          packet_[ptr++] = (values[ind] >> (8*shift)) & 255;
+        }
+      }
+      memcpy(&packet_[ptr], reason_, BLACK_BOX_REASON_LENGTH);
+      ptr += BLACK_BOX_REASON_LENGTH;
+      dump_block_ = oldest_;
+      dump_stage_ = dump_block;
+      break;
+
+    case dump_block:
+      packet_[2] = 'K';
+      values[num_values++] = GetBlock(dump_block_)->first_frame;
+      values[num_values++] = GetBlock(dump_block_)->micros;
+      values[num_values++] = GetBlock(dump_block_)->frames;
+      values[num_values++] = BlockLength(dump_block_);
+      for (int ind = 0; ind < num_values; ind++) {
+        for (int shift = 0; shift < 4; shift++) {
+          packet_[ptr++] = (values[ind] >> (8*shift)) & 255;
+        }
+      }
+      dump_offset_ = 0;
+      dump_stage_ = dump_data;
+      break;
+
+    case dump_data: {
+      packet_[2] = 'D';
+      uint32_t length = BlockLength(dump_block_);
+      uint32_t position = GetBlock(dump_block_)->start + dump_offset_;
+      while (ptr < max_bytes && dump_offset_ < length) {
+        packet_[ptr++] = black_box_memory[position & (BLACK_BOX_BYTES - 1)];
+        position++;
+        dump_offset_++;
+      }
+      if (dump_offset_ >= length) {
+        dump_block_++;
+        dump_stage_ = dump_block_ > newest_ ? dump_end : dump_block;
+      }
+      break;
+    }
+
+    default:
+      packet_[2] = 'E';
+      dump_stage_ = dump_idle;
+      break;
+  }
+
+  return ptr;
+}
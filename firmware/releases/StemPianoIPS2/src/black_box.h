@@ -0,0 +1,134 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// black_box.h
+//
+// For ips pcb version 2.X
+//
+// Black-box recorder of raw frames and events in external PSRAM.
+
+#ifndef BLACK_BOX_H_
+#define BLACK_BOX_H_
+
+#include "stem_piano_ips2.h"
+#include "command_line.h"
+#include "network.h"
+#include "frame_coder.h"
+
+// Bytes of PSRAM used. Must be a power of 2.
+// Can be 16 MB when both PSRAM chips are installed.
+#define BLACK_BOX_BYTES (8*1024*1024)
+
+// Frames per block. Each block starts with one uncompressed frame
+// so a block can be decoded without the blocks before it.
+#define BLACK_BOX_BLOCK_FRAMES 256
+
+// Blocks in the index. Enough for 30 seconds at 1 byte per channel.
+#define BLACK_BOX_MAX_BLOCKS 4096
+
+// Dump packet sizes. Serial packets are small so that one hex line
+// fits in the USB transmit buffer and the sample loop never blocks.
+#define BLACK_BOX_NETWORK_PACKET_BYTES 1024
+#define BLACK_BOX_SERIAL_PACKET_BYTES 128
+#define BLACK_BOX_PACKET_HEADER_BYTES 5
+
+// Samples between dump packets.
+#define BLACK_BOX_DUMP_INTERVAL 4
+
+#define BLACK_BOX_REASON_LENGTH 32
+
+// One entry of the block index.
+struct BlackBoxBlock {
+  uint32_t start;        // Absolute byte position of the block.
+  uint32_t first_frame;  // Frame number of the keyframe.
+  uint32_t micros;       // micros() at the keyframe.
+  uint32_t frames;       // Frames in the block.
+};
+
+class BlackBox
+{
+  public:
+    BlackBox();
+    void Setup(bool, int, int, int);
+    void SetSamplePeriod(int);
+    bool ParseCommand(const char *, CommandLine *);
+    void AddFrame(const unsigned int *, const bool *, const float *,
+    const bool *);
+    void Freeze(const char *);
+    bool Frozen();
+    void SendDump(Network *, bool, bool);
+    void PrintStatistics();
+
+  private:
+    void Start();
+    void StartBlock();
+    void EndBlock();
+    void PutBytes(int);
+    BlackBoxBlock *GetBlock(int);
+    uint32_t BlockLength(int);
+    int NextPacket(int);
+
+    int debug_level_;
+    bool enable_;
+    int sample_period_;
+
+    bool recording_;
+    bool frozen_;
+    bool triggered_;
+    int post_trigger_frames_;
+    int post_trigger_remaining_;
+    char reason_[BLACK_BOX_REASON_LENGTH];
+    uint32_t trigger_frame_;
+
+    FrameCoder Coder_;
+    uint8_t coded_[FRAME_CODER_MAX_BYTES];
+    bool block_open_;
+
+    // Absolute byte position of the next write. The PSRAM address
+    // is the position modulo BLACK_BOX_BYTES.
+    uint32_t head_;
+
+    // Block index, also in PSRAM. Blocks oldest_ to newest_ are
+    // in memory. Block numbers only increase.
+    BlackBoxBlock *blocks_;
+    int oldest_;
+    int newest_;
+    uint32_t frame_;
+    uint32_t last_micros_;
+
+
+    // Dump state.
+    enum DumpStage {
+      dump_idle = 0,
+      dump_header = 1,
+      dump_block = 2,
+      dump_data = 3,
+      dump_end = 4
+    };
+    int dump_stage_;
+    bool dump_to_network_;
+    int dump_block_;
+    uint32_t dump_offset_;
+    unsigned int dump_sequence_;
+    int dump_countdown_;
+    uint8_t packet_[BLACK_BOX_NETWORK_PACKET_BYTES];
+
+};
+
+#endif
@@ -23,8 +23,12 @@
 //
 // Transfer damper position from damper board to hammer board using CAN Bus.
 //
-// The code packs and unpacks position data from damper of 88 piano keys into
-// the 64*8 = 512 bits of CAN FD as follows:
+// Damper frames come in the formats below, each with its own CAN id.
+// The hammer board receives all of them, so boards with different
+// firmware versions still work together.
+//
+// Legacy (B2B_ID_LEGACY), position data only. The 88 damper positions
+// fill the 64*8 = 512 bits of CAN FD as follows:
 // A0  - 4 bits
 // A#0 - 4 bits
 // B0  - 4 bits
@@ -38,21 +42,179 @@
 // C8  - 4 bits
 // From the above: (4+4)*4 + 80*6 = 512.  So, it fits.
 //
-// The boards have enough pins to extend a keyboard beyond 88 keys.
-// In this case, the mapping described above would need to change
-// in order to fit the extra keys into the 512 available bits.
+// Version 1 (B2B_ID_POSITION), with a header and CRC:
+//   byte 0       - format version (4 bits), sequence bits 11:8
+//   byte 1       - sequence bits 7:0
+//   bytes 2, 3   - damper board micros() bits 15:0 when the frame was sent
+//   bytes 4..61  - 464 bits of damper position, msb first
+//   bytes 62, 63 - CRC-16 (CCITT, initial value 0xFFFF) of bytes 0..61
+// To make room for the header, some keys trade 2 bits:
+//   A0 to E1 (8 keys)     - 4 bits
+//   F1 to C6 (56 keys)    - 6 bits
+//   C#6 to C8 (24 keys)   - 4 bits
+// From the above: 8*4 + 56*6 + 24*4 = 464. The top keys of most acoustic
+// pianos have no dampers, so they lose the least.
+// A second frame per sample does not fit: one 64 byte frame at the
+// 2 Mbit/s data rate already takes about 300 microseconds.
+//
+// Events (B2B_ID_EVENTS), same header and CRC as version 1:
+//   bytes 4..14  - 88 bit damper event bitmask, A0 is the msb of byte 4
+//   bytes 15..25 - 88 bit damper up bitmask (position >= threshold)
+//   byte 26      - first key of the positions in this frame
+//   bytes 27..34 - 8 damper positions, 8 bits each, for the display
+//   bytes 35..61 - velocity * 127 as a signed byte, for each event in
+//                  key order, up to B2B_EVENTS_PER_FRAME
+// The damper board runs DspDamper at full ADC resolution, so the note
+// off timing has no quantization error, and the hammer board does not
+// run DspDamper. A full set of positions takes 11 frames.
+// If frames were lost, or arrived but were not read, a key whose damper
+// went down without an event gets an event with a fixed velocity, so
+// a lost frame never leaves a note sounding.
+//
+// Adaptive (B2B_ID_ADAPTIVE), same header and CRC as version 1:
+//   byte 4       - number of keys, up to B2B_ADAPTIVE_KEYS
+//   bytes 5..61  - for each key, msb first, a 1 bit flag. If the flag is
+//                  1, a new position follows in adaptive_bits_[key] bits.
+//                  If the flag is 0, the key did not move.
+// Resting keys cost 1 bit, so this carries all NUM_CHANNELS inputs, not
+// only NUM_NOTES, at higher resolution than version 1:
+//   A0 to C6 (64 keys)    - 10 bits
+//   C#6 to C8 (24 keys)   - 8 bits, most pianos have no dampers here
+//   Other inputs (pedals) - 8 bits
+// After the flags, 456 - 96 = 360 bits are left, so up to 36 keys that
+// moved fit in one frame. Keys that did not fit are first in line in
+// the next frame. A second frame per sample does not fit on the bus.
+// Packing is two passes over the keys and unpacking is one, so the time
+// does not depend on how many keys moved.
+//
+// The sequence finds lost and duplicated frames, the CRC finds corrupted
+// frames, and the timestamp gives the link delay. The boards' clocks are
+// not the same, so the delay is only relative: the minimum is an unknown
+// offset, and maximum minus minimum is the delay variation.
+// If no good frame arrives for stale_millis, LinkStale() returns true and
+// the hammer board uses its own damper estimate.
 //
-// TODO - Only supports 88 dampers. If a piano with more keys
-//        is built, and if want dampers on those keys, then will
-//        need to extend to the extra keys.
+// The hammer board receives with an interrupt. Each frame is copied into
+// a double-buffered latest-frame slot with an arrival time and sequence
+// number, so GetDamperData() always uses the newest frame, no matter how
+// many arrived since the last sample. If the two boards sample at
+// slightly different rates, frames are skipped or repeated instead of
+// queueing up and getting older. Frames never read (dropped), frames
+// overwritten while being read (overruns), and samples without a new
+// frame (stale) are counted and printed at DEBUG_STATS.
+//
+// Sample clock sync (B2B_ID_SYNC), hammer board to damper board:
+//   bytes 0, 1   - sync sequence
+//   bytes 2..5   - hammer board micros() when its sample interval started
+//   bytes 6, 7   - hammer board sample interval, microseconds
+//   bytes 8, 9   - hammer board sample period for normal playing, which
+//                  may be tuned at boot, for the damper board to follow
+//   bytes 10, 11 - zero
+// Each board has its own crystal, so without the sync the two sample
+// clocks slowly drift apart. The damper board measures arrival minus the
+// hammer timestamp. This is the clock offset plus the link delay. A sync
+// that waited for the bus has a longer delay, so the smallest value of the
+// last B2B_SYNC_WINDOW syncs is used. Then, with the fixed minimum link
+// delay from the settings, the damper board knows when the hammer board
+// sample started on its own clock, and moves its sample grid to match.
+//
+// TODO - Except for B2B_FRAME_ADAPTIVE, only supports 88 dampers.
+//        If a piano with more keys is built, and if want dampers on
+//        those keys, then use B2B_FRAME_ADAPTIVE.
 
 #include "board2board.h"
 
+// Note off velocity for an event recovered from the damper up bitmask.
+#define B2B_RECOVERED_VELOCITY -0.2
+
+Board2Board *Board2Board::receiver_ = nullptr;
+
 Board2Board::Board2Board() {}
 
-void Board2Board::Setup(bool enable) {
+void Board2Board::Setup(bool enable, int debug_level) {
 
   enable_ = enable;
+  debug_level_ = debug_level;
+
+  frame_format_ = B2B_FRAME_POSITION;
+  tx_sequence_ = 0;
+  position_start_key_ = 0;
+  remote_events_ = false;
+  recovered_ = 0;
+  for (int key = 0; key < NUM_NOTES; key++) {
+    pending_[key] = false;
+    pending_velocity_[key] = 0.0;
+    event_[key] = false;
+    velocity_[key] = 0.0;
+    damper_up_[key] = false;
+  }
+
+  for (int key = 0; key < NUM_NOTES; key++) {
+    if (key < 8 || key >= 64)
+      bits_[key] = 4;
+    else
+      bits_[key] = 6;
+  }
+
+  for (int key = 0; key < B2B_ADAPTIVE_KEYS; key++) {
+    if (key < 64)
+      adaptive_bits_[key] = 10;
+    else
+      adaptive_bits_[key] = 8;
+    sent_value_[key] = -1;  // Never sent, so send at the first frame.
+    send_[key] = false;
+    adaptive_position_[key] = 0.0;
+  }
+  refresh_key_ = 0;
+  changed_start_key_ = 0;
+  deferred_ = 0;
+
+  for (int slot = 0; slot < 2; slot++) {
+    slot_id_[slot] = 0;
+    slot_sequence_[slot] = 0;
+    slot_micros_[slot] = 0;
+  }
+  latest_ = 0;
+  received_ = 0;
+  last_sequence_ = 0;
+  dropped_ = 0;
+  overruns_ = 0;
+  stale_ = 0;
+  max_age_micros_ = 0;
+
+  stale_millis_ = 100;
+  last_valid_millis_ = millis();
+  have_valid_frame_ = false;
+  link_stale_ = true;
+  last_frame_sequence_ = -1;
+  valid_frames_ = 0;
+  lost_ = 0;
+  duplicates_ = 0;
+  crc_errors_ = 0;
+  version_errors_ = 0;
+  min_delay_micros_ = 0x10000;
+  max_delay_micros_ = -1;
+
+  sync_interval_ = 0;
+  sync_counter_ = 0;
+  sync_sequence_ = 0;
+  sync_hammer_micros_ = 0;
+  sync_arrival_micros_ = 0;
+  sync_period_ = 0;
+  sync_nominal_period_ = 0;
+  sync_received_ = 0;
+  sync_enable_ = false;
+  sync_latency_micros_ = 0;
+  sync_last_read_ = 0;
+  for (int ind = 0; ind < B2B_SYNC_WINDOW; ind++) {
+    sync_offset_[ind] = 0;
+  }
+  sync_offset_index_ = 0;
+  sync_offset_count_ = 0;
+  syncs_ = 0;
+  sync_mismatch_ = 0;
+  min_phase_error_ = 0;
+  max_phase_error_ = 0;
 
   // Connected to CAN Bus driver IC but not using these features
   // of the IC. Drive low and never change the state.
@@ -73,101 +235,790 @@ void Board2Board::Setup(bool enable) {
     can_.setRegions(64);
     can_.setBaudRate(config);
 
-    msg_tx_.id = 0x100;
+    msg_tx_.id = B2B_ID_POSITION;
     msg_tx_.len = CANBUS_LENGTH;
     for (int ind = 0; ind < msg_tx_.len; ind++) {
       msg_tx_.buf[ind] = 0;
     }
+
+    msg_sync_.id = B2B_ID_SYNC;
+    msg_sync_.len = B2B_SYNC_LENGTH;
+    for (int ind = 0; ind < msg_sync_.len; ind++) {
+      msg_sync_.buf[ind] = 0;
+    }
+  }
+}
+
+// Damper board. Frame format to send, B2B_FRAME_*.
+void Board2Board::SetupSend(int frame_format) {
+  frame_format_ = frame_format;
+  if (frame_format_ == B2B_FRAME_LEGACY)
+    msg_tx_.id = B2B_ID_LEGACY;
+  else if (frame_format_ == B2B_FRAME_EVENTS)
+    msg_tx_.id = B2B_ID_EVENTS;
+  else if (frame_format_ == B2B_FRAME_ADAPTIVE)
+    msg_tx_.id = B2B_ID_ADAPTIVE;
+  else
+    msg_tx_.id = B2B_ID_POSITION;
+}
+
+// Hammer board. Start receiving. The link is stale if
+// no good frame arrived in the last stale_millis.
+void Board2Board::SetupReceive(int stale_millis) {
+  stale_millis_ = static_cast<unsigned long>(stale_millis);
+  if (enable_ == true) {
+    // Without events(), FlexCAN calls onReceive() from the interrupt.
+    receiver_ = this;
+    can_.onReceive(ReceiveInterrupt);
+    can_.enableMBInterrupts();
+  }
+}
+
+// Hammer board. Send a sync frame every sync_interval samples.
+// Zero turns off the sync.
+void Board2Board::SetupSyncSend(int sync_interval) {
+  sync_interval_ = sync_interval;
+  sync_counter_ = 0;
+}
+
+// Damper board. Start receiving sync frames. sync_latency_micros is the
+// shortest time from SendSync() on the hammer board to the receive
+// interrupt on the damper board.
+void Board2Board::SetupSyncReceive(int sync_latency_micros) {
+  sync_latency_micros_ = sync_latency_micros;
+  if (enable_ == true) {
+    sync_enable_ = true;
+    receiver_ = this;
+    can_.onReceive(ReceiveInterrupt);
+    can_.enableMBInterrupts();
   }
 }
 
 // Pack the damper data into CAN Bus array and send it.
 // This function is called by the damper board code.
 void Board2Board::SendDamperData(const float *position) {
-  if (enable_ == true) {
-    int p_int[NUM_CHANNELS];
-    int p_int_limit;
-    for (int ind = 0; ind < NUM_CHANNELS; ind++) {
-      if (ind < 4 || ind > 83) {
-        p_int_limit = static_cast<int>(16.0 * position[ind]);
-        if (p_int_limit > 15)
-          p_int_limit = 15;
-        else if (p_int_limit < 0)
-          p_int_limit = 0;
-        p_int[ind] = p_int_limit;
-      }
-      else {
-        p_int_limit = static_cast<int>(64.0 * position[ind]);
-        if (p_int_limit > 63)
-          p_int_limit = 63;
-        else if (p_int_limit < 0)
-          p_int_limit = 0;
-        p_int[ind] = p_int_limit;
-      }
+  if (enable_ == true && frame_format_ != B2B_FRAME_EVENTS) {
+    if (frame_format_ == B2B_FRAME_LEGACY) {
+      PackLegacy(position);
     }
-    // First 4 and last 4 of 88 keys are 4 bits each.
-    msg_tx_.buf[0]  = (p_int[0]<<4)  | p_int[1];
-    msg_tx_.buf[1]  = (p_int[2]<<4)  | p_int[3];
-    msg_tx_.buf[62] = (p_int[84]<<4) | p_int[85];
-    msg_tx_.buf[63] = (p_int[86]<<4) | p_int[87];
-    // The middle 80 keys are 6 bits, which is 480 total bits.
-    // The following pattern repeats 480/8/3 = 20 times.
-    // AAAAAABB, BBBBCCCC, CCDDDDDD
-    for (int ind = 0; ind < 20; ind++) {
-      msg_tx_.buf[3*ind+2] = ( p_int[4*ind+4]<<2)       | ((p_int[4*ind+5]>>4)&0x03);
-      msg_tx_.buf[3*ind+3] = ((p_int[4*ind+5]<<4)&0xF0) | ((p_int[4*ind+6]>>2)&0x0F);
-      msg_tx_.buf[3*ind+4] = ((p_int[4*ind+6]<<6)&0xC0) | ( p_int[4*ind+7]    &0x3F);
+    else if (frame_format_ == B2B_FRAME_ADAPTIVE) {
+      PackAdaptive(position);
+    }
+    else {
+      PackPosition(position);
     }
     can_.write(msg_tx_);
   }
 }
 
-// Receive data from CAN Bus then unpack the damper data.
+// Send damper events from DspDamper instead of positions.
+// This function is called by the damper board code.
+void Board2Board::SendDamperEvents(const bool *event, const float *velocity,
+const float *position, float damper_threshold) {
+  if (enable_ == true && frame_format_ == B2B_FRAME_EVENTS) {
+    PackEvents(event, velocity, position, damper_threshold);
+    can_.write(msg_tx_);
+  }
+}
+
+// Unpack the newest damper data received from CAN Bus.
 // This function is called by the hammer board.
+// Returns false if no new good frame arrived since the last call,
+// and then position is not changed. For an events frame, only some
+// positions change, and the events are read with GetDamperEvents().
 bool Board2Board::GetDamperData(float *position) {
   if (enable_ == true) {
-    int read_return = can_.read(msg_rx_);
-    if (read_return) {
-      int p_int[NUM_CHANNELS];
-      // First 4 and last 4 of 88 keys are 4 bits each.
-      p_int[0]  = (msg_rx_.buf[0]>>4)&0x0F;
-      p_int[1]  = (msg_rx_.buf[0]>>0)&0x0F;
-      p_int[2]  = (msg_rx_.buf[1]>>4)&0x0F;
-      p_int[3]  = (msg_rx_.buf[1]>>0)&0x0F;
-      p_int[84] = (msg_rx_.buf[62]>>4)&0x0F;
-      p_int[85] = (msg_rx_.buf[62]>>0)&0x0F;
-      p_int[86] = (msg_rx_.buf[63]>>4)&0x0F;
-      p_int[87] = (msg_rx_.buf[63]>>0)&0x0F;
-      // The middle 80 keys are 6 bits, which is 480 total bits.
-      // The following pattern repeats 480/8/3 = 20 times.
-      // AAAAAABB, BBBBCCCC, CCDDDDDD
-      for (int ind = 0; ind < 20; ind++) {
-        p_int[4*ind+4] = ((msg_rx_.buf[3*ind+2]>>2)&0x3F);
-        p_int[4*ind+5] = ((msg_rx_.buf[3*ind+2]<<4)&0x30) | ((msg_rx_.buf[3*ind+3]>>4)&0x0F);
-        p_int[4*ind+6] = ((msg_rx_.buf[3*ind+3]<<2)&0x3C) | ((msg_rx_.buf[3*ind+4]>>6)&0x03);
-        p_int[4*ind+7] = ((msg_rx_.buf[3*ind+4]>>0)&0x3F);
+
+    // Events only last one sample.
+    for (int key = 0; key < NUM_NOTES; key++) {
+      event_[key] = false;
+    }
+
+    // Copy the latest slot. If the interrupt wrote it during the
+    // copy, the sequence changed, so try again with the new latest.
+    uint32_t sequence = 0;
+    uint32_t arrival_micros = 0;
+    uint32_t id = 0;
+    bool copied = false;
+    for (int attempt = 0; attempt < 2 && copied == false; attempt++) {
+      int slot = latest_;
+      sequence = slot_sequence_[slot];
+      if (sequence == 0 || sequence == last_sequence_) {
+        break;
+      }
+      arrival_micros = slot_micros_[slot];
+      id = slot_id_[slot];
+      for (int ind = 0; ind < CANBUS_LENGTH; ind++) {
+        buf_rx_[ind] = slot_buf_[slot][ind];
+      }
+      if (slot_sequence_[slot] == sequence) {
+        copied = true;
+      }
+      else {
+        overruns_++;
+      }
+    }
+
+    bool valid = false;
+    if (copied == true) {
+      uint32_t received_gap = 0;
+      if (last_sequence_ != 0 && sequence - last_sequence_ > 1) {
+        received_gap = sequence - last_sequence_ - 1;
+        dropped_ += received_gap;
+      }
+      last_sequence_ = sequence;
+      unsigned long age = micros() - arrival_micros;
+      if (age > max_age_micros_) {
+        max_age_micros_ = age;
+      }
+      if (id == B2B_ID_LEGACY) {
+        UnpackLegacy(position);
+        remote_events_ = false;
+        valid = true;
       }
-      for (int ind = 0; ind < NUM_CHANNELS; ind++) {
-        if (ind < 88) {
-          if (ind < 4 || ind > 83) {
-            position[ind] = static_cast<float>(p_int[ind] / 16.0);
+      else {
+        int missing = CheckHeader(arrival_micros, received_gap);
+        if (missing >= 0) {
+          if (id == B2B_ID_EVENTS) {
+            UnpackEvents(position, missing);
+            remote_events_ = true;
+            valid = true;
+          }
+          else if (id == B2B_ID_ADAPTIVE) {
+            valid = UnpackAdaptive(position);
+            remote_events_ = false;
           }
           else {
-            position[ind] = static_cast<float>(p_int[ind] / 64.0);
+            UnpackPosition(position);
+            remote_events_ = false;
+            valid = true;
           }
         }
+      }
+    }
+    else {
+      stale_++;
+    }
+
+    if (valid == true) {
+      last_valid_millis_ = millis();
+      have_valid_frame_ = true;
+    }
+    bool link_stale = have_valid_frame_ == false ||
+    millis() - last_valid_millis_ > stale_millis_;
+    if (link_stale != link_stale_ && debug_level_ >= DEBUG_INFO) {
+      if (link_stale == true)
+        Serial.println("CAN damper link is stale, using hammer estimate.");
+      else
+        Serial.println("CAN damper link is good.");
+    }
+    link_stale_ = link_stale;
+    return valid;
+  }
+  else {
+    return false;
+  }
+}
+
+// True if the damper board sends events, so the
+// hammer board should not run DspDamper.
+bool Board2Board::RemoteEvents() {
+  return remote_events_ == true && LinkStale() == false;
+}
+
+// Damper events from the last GetDamperData().
+// Same as DspDamper::GetDamperEventData() output.
+void Board2Board::GetDamperEvents(bool *event, float *velocity) {
+  for (int ind = 0; ind < NUM_CHANNELS; ind++) {
+    if (ind < NUM_NOTES && event_[ind] == true) {
+      event[ind] = true;
+      velocity[ind] = velocity_[ind];
+    }
+    else {
+      event[ind] = false;
+      velocity[ind] = 0.0;
+    }
+  }
+}
+
+// Hammer board. Call when AllowProcessing() starts a sample interval.
+// sample_period is the period for normal playing, sample_interval is
+// the current one, which is longer while the TFT display runs.
+void Board2Board::SendSync(unsigned long sample_start_micros,
+int sample_interval, int sample_period) {
+  if (enable_ == true && sync_interval_ > 0) {
+    sync_counter_++;
+    if (sync_counter_ >= sync_interval_) {
+      sync_counter_ = 0;
+      sync_sequence_++;
+      uint32_t start = static_cast<uint32_t>(sample_start_micros);
+      msg_sync_.buf[0] = sync_sequence_ >> 8;
+      msg_sync_.buf[1] = sync_sequence_ & 0xFF;
+      msg_sync_.buf[2] = start >> 24;
+      msg_sync_.buf[3] = (start >> 16) & 0xFF;
+      msg_sync_.buf[4] = (start >> 8) & 0xFF;
+      msg_sync_.buf[5] = start & 0xFF;
+      msg_sync_.buf[6] = (sample_interval >> 8) & 0xFF;
+      msg_sync_.buf[7] = sample_interval & 0xFF;
+      msg_sync_.buf[8] = (sample_period >> 8) & 0xFF;
+      msg_sync_.buf[9] = sample_period & 0xFF;
+      can_.write(msg_sync_);
+    }
+  }
+}
+
+// Damper board. When a new sync frame arrived, returns true and the phase
+// error in microseconds: how much later this board's sample interval
+// started than the hammer board's. Wrapped to +/- half an interval.
+// Returns false when the boards have different sample intervals,
+// for example while one board runs the TFT display.
+bool Board2Board::GetSyncPhaseError(unsigned long sample_start_micros,
+int sample_interval, int *phase_error) {
+  if (sync_enable_ == false) {
+    return false;
+  }
+  uint32_t count = sync_received_;
+  if (count == sync_last_read_) {
+    return false;
+  }
+  uint32_t hammer_micros = sync_hammer_micros_;
+  uint32_t arrival_micros = sync_arrival_micros_;
+  uint32_t period = sync_period_;
+  if (sync_received_ != count) {
+    return false;  // Changed while reading, use it next time.
+  }
+  sync_last_read_ = count;
+
+  if (static_cast<int>(period) != sample_interval || sample_interval <= 0) {
+    sync_mismatch_++;
+    return false;
+  }
+
+  // Smallest clock offset plus link delay in the window.
+  // Differences from the newest value, so the 32 bit wrap does not matter.
+  uint32_t offset = arrival_micros - hammer_micros;
+  sync_offset_[sync_offset_index_] = offset;
+  sync_offset_index_ = (sync_offset_index_ + 1) % B2B_SYNC_WINDOW;
+  if (sync_offset_count_ < B2B_SYNC_WINDOW) {
+    sync_offset_count_++;
+  }
+  int32_t min_difference = 0;
+  for (int ind = 0; ind < sync_offset_count_; ind++) {
+    int32_t difference = static_cast<int32_t>(sync_offset_[ind] - offset);
+    if (difference < min_difference) {
+      min_difference = difference;
+    }
+  }
+  uint32_t min_offset = offset + min_difference;
+  uint32_t hammer_start = hammer_micros + min_offset - sync_latency_micros_;
+
+  int error = static_cast<int32_t>(
+  static_cast<uint32_t>(sample_start_micros) - hammer_start) % sample_interval;
+  if (error >= sample_interval / 2)
+    error -= sample_interval;
+  else if (error < -sample_interval / 2)
+    error += sample_interval;
+
+  if (syncs_ == 0 || error < min_phase_error_)
+    min_phase_error_ = error;
+  if (syncs_ == 0 || error > max_phase_error_)
+    max_phase_error_ = error;
+  syncs_++;
+
+  *phase_error = error;
+  return true;
+}
+
+// Damper board. The hammer board sample period for normal
+// playing, or 0 if no sync frame arrived yet.
+int Board2Board::HammerSamplePeriod() {
+  return static_cast<int>(sync_nominal_period_);
+}
+
+// True if the hammer board should not use the damper board data.
+bool Board2Board::LinkStale() {
+  return enable_ == false || link_stale_ == true;
+}
+
+// Hammer board, receiving damper frames.
+void Board2Board::PrintStatistics() {
+  if (enable_ == true && debug_level_ >= DEBUG_STATS) {
+    Serial.printf("CAN damper: received = %lu, dropped = %lu, ",
+    static_cast<unsigned long>(received_), dropped_);
+    Serial.printf("overruns = %lu, stale = %lu, max age = %lu us.\n",
+    overruns_, stale_, max_age_micros_);
+    Serial.printf("CAN damper link: good = %lu, lost = %lu, ", valid_frames_,
+    lost_);
+    Serial.printf("duplicate = %lu, bad = %lu, other version = %lu, ",
+    duplicates_, crc_errors_, version_errors_);
+    Serial.printf("recovered events = %lu", recovered_);
+    if (max_delay_micros_ >= 0) {
+      Serial.printf(", delay variation = %d us",
+      max_delay_micros_ - min_delay_micros_);
+    }
+    Serial.println(".");
+  }
+  dropped_ = 0;
+  overruns_ = 0;
+  stale_ = 0;
+  max_age_micros_ = 0;
+  valid_frames_ = 0;
+  lost_ = 0;
+  duplicates_ = 0;
+  crc_errors_ = 0;
+  version_errors_ = 0;
+  recovered_ = 0;
+  min_delay_micros_ = 0x10000;
+  max_delay_micros_ = -1;
+}
+
+// Damper board, sending B2B_FRAME_ADAPTIVE frames.
+void Board2Board::PrintSendStatistics() {
+  if (frame_format_ == B2B_FRAME_ADAPTIVE && debug_level_ >= DEBUG_STATS) {
+    Serial.printf("CAN adaptive: keys deferred to a later frame = %lu.\n",
+    deferred_);
+  }
+  deferred_ = 0;
+}
+
+// Damper board, following the hammer board sample clock.
+void Board2Board::PrintSyncStatistics() {
+  if (sync_enable_ == true && debug_level_ >= DEBUG_STATS) {
+    Serial.printf("CAN sync: syncs = %lu, other interval = %lu",
+    syncs_, sync_mismatch_);
+    if (syncs_ > 0) {
+      Serial.printf(", phase error = %d to %d us",
+      min_phase_error_, max_phase_error_);
+    }
+    Serial.println(".");
+  }
+  syncs_ = 0;
+  sync_mismatch_ = 0;
+}
+
+// Private methods. ////////
+
+void Board2Board::ReceiveInterrupt(const CANFD_message_t &msg) {
+  if (receiver_ != nullptr) {
+    receiver_->Receive(msg);
+  }
+}
+
+// Interrupt context. Keep short: copy the payload and return.
+void Board2Board::Receive(const CANFD_message_t &msg) {
+  if (msg.id == B2B_ID_SYNC && msg.len == B2B_SYNC_LENGTH) {
+    sync_arrival_micros_ = micros();
+    sync_hammer_micros_ = (static_cast<uint32_t>(msg.buf[2]) << 24) |
+    (static_cast<uint32_t>(msg.buf[3]) << 16) | (msg.buf[4] << 8) | msg.buf[5];
+    sync_period_ = (msg.buf[6] << 8) | msg.buf[7];
+    sync_nominal_period_ = (msg.buf[8] << 8) | msg.buf[9];
+    sync_received_ = sync_received_ + 1;
+    return;
+  }
+  if ((msg.id != B2B_ID_LEGACY && msg.id != B2B_ID_POSITION &&
+  msg.id != B2B_ID_EVENTS && msg.id != B2B_ID_ADAPTIVE) ||
+  msg.len != CANBUS_LENGTH) {
+    return;
+  }
+  int slot = 1 - latest_;
+  slot_sequence_[slot] = 0;
+  for (int ind = 0; ind < CANBUS_LENGTH; ind++) {
+    slot_buf_[slot][ind] = msg.buf[ind];
+  }
+  slot_id_[slot] = msg.id;
+  slot_micros_[slot] = micros();
+  received_++;
+  if (received_ == 0) {
+    received_ = 1;  // Sequence 0 is reserved.
+  }
+  slot_sequence_[slot] = received_;
+  latest_ = slot;
+}
+
+void Board2Board::PackLegacy(const float *position) {
+  int p_int[NUM_CHANNELS];
+  int p_int_limit;
+  for (int ind = 0; ind < NUM_CHANNELS; ind++) {
+    if (ind < 4 || ind > 83) {
+      p_int_limit = static_cast<int>(16.0 * position[ind]);
+      if (p_int_limit > 15)
+        p_int_limit = 15;
+      else if (p_int_limit < 0)
+        p_int_limit = 0;
+      p_int[ind] = p_int_limit;
+    }
+    else {
+      p_int_limit = static_cast<int>(64.0 * position[ind]);
+      if (p_int_limit > 63)
+        p_int_limit = 63;
+      else if (p_int_limit < 0)
+        p_int_limit = 0;
+      p_int[ind] = p_int_limit;
+    }
+  }
+  // First 4 and last 4 of 88 keys are 4 bits each.
+  msg_tx_.buf[0]  = (p_int[0]<<4)  | p_int[1];
+  msg_tx_.buf[1]  = (p_int[2]<<4)  | p_int[3];
+  msg_tx_.buf[62] = (p_int[84]<<4) | p_int[85];
+  msg_tx_.buf[63] = (p_int[86]<<4) | p_int[87];
+  // The middle 80 keys are 6 bits, which is 480 total bits.
+  // The following pattern repeats 480/8/3 = 20 times.
+  // AAAAAABB, BBBBCCCC, CCDDDDDD
+  for (int ind = 0; ind < 20; ind++) {
+    msg_tx_.buf[3*ind+2] = ( p_int[4*ind+4]<<2)       | ((p_int[4*ind+5]>>4)&0x03);
+    msg_tx_.buf[3*ind+3] = ((p_int[4*ind+5]<<4)&0xF0) | ((p_int[4*ind+6]>>2)&0x0F);
+    msg_tx_.buf[3*ind+4] = ((p_int[4*ind+6]<<6)&0xC0) | ( p_int[4*ind+7]    &0x3F);
+  }
+}
+
+// Version, sequence, and timestamp. The CRC is added last.
+void Board2Board::PackHeader() {
+  tx_sequence_ = (tx_sequence_ + 1) & 0x0FFF;
+  uint16_t timestamp = static_cast<uint16_t>(micros());
+  msg_tx_.buf[0] = (B2B_FORMAT_VERSION << 4) | (tx_sequence_ >> 8);
+  msg_tx_.buf[1] = tx_sequence_ & 0xFF;
+  msg_tx_.buf[2] = timestamp >> 8;
+  msg_tx_.buf[3] = timestamp & 0xFF;
+}
+
+void Board2Board::PackPosition(const float *position) {
+  PackHeader();
+  int bit = 0;
+  for (int key = 0; key < NUM_NOTES; key++) {
+    int levels = 1 << bits_[key];
+    int p_int = static_cast<int>(levels * position[key]);
+    if (p_int > levels - 1)
+      p_int = levels - 1;
+    else if (p_int < 0)
+      p_int = 0;
+    PutBits(msg_tx_.buf + 4, bit, bits_[key], p_int);
+    bit += bits_[key];
+  }
+  uint16_t crc = Crc16(msg_tx_.buf, CANBUS_LENGTH - 2);
+  msg_tx_.buf[62] = crc >> 8;
+  msg_tx_.buf[63] = crc & 0xFF;
+}
+
+void Board2Board::PackEvents(const bool *event, const float *velocity,
+const float *position, float damper_threshold) {
+
+  for (int key = 0; key < NUM_NOTES; key++) {
+    if (event[key] == true) {
+      pending_[key] = true;
+      pending_velocity_[key] = velocity[key];
+    }
+  }
+
+  PackHeader();
+  for (int ind = 4; ind < CANBUS_LENGTH - 2; ind++) {
+    msg_tx_.buf[ind] = 0;
+  }
+
+  int count = 0;
+  for (int key = 0; key < NUM_NOTES; key++) {
+    if (pending_[key] == true && count < B2B_EVENTS_PER_FRAME) {
+      PutBits(msg_tx_.buf + 4, key, 1, 1);
+      int v_int = static_cast<int>(127.0 * pending_velocity_[key]);
+      if (v_int > 127)
+        v_int = 127;
+      else if (v_int < -127)
+        v_int = -127;
+      msg_tx_.buf[35 + count] = static_cast<uint8_t>(v_int);
+      pending_[key] = false;
+      count++;
+    }
+    if (position[key] >= damper_threshold) {
+      PutBits(msg_tx_.buf + 15, key, 1, 1);
+    }
+  }
+
+  msg_tx_.buf[26] = position_start_key_;
+  for (int ind = 0; ind < B2B_POSITIONS_PER_FRAME; ind++) {
+    int key = position_start_key_ + ind;
+    int p_int = 0;
+    if (key < NUM_NOTES) {
+      p_int = static_cast<int>(256.0 * position[key]);
+      if (p_int > 255)
+        p_int = 255;
+      else if (p_int < 0)
+        p_int = 0;
+    }
+    msg_tx_.buf[27 + ind] = p_int;
+  }
+  position_start_key_ += B2B_POSITIONS_PER_FRAME;
+  if (position_start_key_ >= NUM_NOTES) {
+    position_start_key_ = 0;
+  }
+
+  uint16_t crc = Crc16(msg_tx_.buf, CANBUS_LENGTH - 2);
+  msg_tx_.buf[62] = crc >> 8;
+  msg_tx_.buf[63] = crc & 0xFF;
+}
+
+void Board2Board::PackAdaptive(const float *position) {
+
+  PackHeader();
+  for (int ind = 4; ind < CANBUS_LENGTH - 2; ind++) {
+    msg_tx_.buf[ind] = 0;
+  }
+  msg_tx_.buf[4] = B2B_ADAPTIVE_KEYS;
+
+  // Bits left for positions after the flags.
+  int budget = (CANBUS_LENGTH - 2 - 5) * 8 - B2B_ADAPTIVE_KEYS;
+
+  // First the refresh keys.
+  for (int key = 0; key < B2B_ADAPTIVE_KEYS; key++) {
+    send_[key] = false;
+  }
+  for (int ind = 0; ind < B2B_ADAPTIVE_REFRESH_KEYS; ind++) {
+    int key = (refresh_key_ + ind) % B2B_ADAPTIVE_KEYS;
+    send_[key] = true;
+    budget -= adaptive_bits_[key];
+  }
+  refresh_key_ = (refresh_key_ + B2B_ADAPTIVE_REFRESH_KEYS) %
+  B2B_ADAPTIVE_KEYS;
+
+  // Then the keys that moved, starting with the first
+  // key that did not fit in the last frame.
+  int first_deferred = -1;
+  for (int ind = 0; ind < B2B_ADAPTIVE_KEYS; ind++) {
+    int key = (changed_start_key_ + ind) % B2B_ADAPTIVE_KEYS;
+    if (send_[key] == false) {
+      int p_int = Quantize(position[key], adaptive_bits_[key]);
+      if (abs(p_int - sent_value_[key]) > B2B_ADAPTIVE_DEADBAND) {
+        if (budget >= adaptive_bits_[key]) {
+          send_[key] = true;
+          budget -= adaptive_bits_[key];
+        }
         else {
-          // Zero out keys 88, 89, 90, 91, 92, 93, 94, 95.
-          position[ind] = 0.0;
+          if (first_deferred < 0) {
+            first_deferred = key;
+          }
+          deferred_++;
         }
       }
-      return true;
+    }
+  }
+  changed_start_key_ = (first_deferred >= 0) ? first_deferred : 0;
+
+  int bit = 5 * 8;
+  for (int key = 0; key < B2B_ADAPTIVE_KEYS; key++) {
+    if (send_[key] == true) {
+      int p_int = Quantize(position[key], adaptive_bits_[key]);
+      PutBits(msg_tx_.buf, bit, 1, 1);
+      PutBits(msg_tx_.buf, bit + 1, adaptive_bits_[key], p_int);
+      bit += 1 + adaptive_bits_[key];
+      sent_value_[key] = p_int;
     }
     else {
-      return false;
+      bit++;
     }
   }
-  else {
+
+  uint16_t crc = Crc16(msg_tx_.buf, CANBUS_LENGTH - 2);
+  msg_tx_.buf[62] = crc >> 8;
+  msg_tx_.buf[63] = crc & 0xFF;
+}
+
+void Board2Board::UnpackLegacy(float *position) {
+  int p_int[NUM_CHANNELS];
+  // First 4 and last 4 of 88 keys are 4 bits each.
+  p_int[0]  = (buf_rx_[0]>>4)&0x0F;
+  p_int[1]  = (buf_rx_[0]>>0)&0x0F;
+  p_int[2]  = (buf_rx_[1]>>4)&0x0F;
+  p_int[3]  = (buf_rx_[1]>>0)&0x0F;
+  p_int[84] = (buf_rx_[62]>>4)&0x0F;
+  p_int[85] = (buf_rx_[62]>>0)&0x0F;
+  p_int[86] = (buf_rx_[63]>>4)&0x0F;
+  p_int[87] = (buf_rx_[63]>>0)&0x0F;
+  // The middle 80 keys are 6 bits, which is 480 total bits.
+  // The following pattern repeats 480/8/3 = 20 times.
+  // AAAAAABB, BBBBCCCC, CCDDDDDD
+  for (int ind = 0; ind < 20; ind++) {
+    p_int[4*ind+4] = ((buf_rx_[3*ind+2]>>2)&0x3F);
+    p_int[4*ind+5] = ((buf_rx_[3*ind+2]<<4)&0x30) | ((buf_rx_[3*ind+3]>>4)&0x0F);
+    p_int[4*ind+6] = ((buf_rx_[3*ind+3]<<2)&0x3C) | ((buf_rx_[3*ind+4]>>6)&0x03);
+    p_int[4*ind+7] = ((buf_rx_[3*ind+4]>>0)&0x3F);
+  }
+  for (int ind = 0; ind < NUM_CHANNELS; ind++) {
+    if (ind < 88) {
+      if (ind < 4 || ind > 83) {
+        position[ind] = static_cast<float>(p_int[ind] / 16.0);
+      }
+      else {
+        position[ind] = static_cast<float>(p_int[ind] / 64.0);
+      }
+    }
+    else {
+      // Zero out keys 88, 89, 90, 91, 92, 93, 94, 95.
+      position[ind] = 0.0;
+    }
+  }
+}
+
+// Check the header and CRC of a frame with a header.
+// received_gap is the number of received frames that were never read.
+// Returns -1 for a bad or repeated frame, otherwise the number of
+// frames since the last good frame that were lost or not read.
+int Board2Board::CheckHeader(uint32_t arrival_micros, uint32_t received_gap) {
+
+  uint16_t crc = (buf_rx_[62] << 8) | buf_rx_[63];
+  if (Crc16(buf_rx_, CANBUS_LENGTH - 2) != crc) {
+    crc_errors_++;
+    return -1;
+  }
+  if ((buf_rx_[0] >> 4) != B2B_FORMAT_VERSION) {
+    version_errors_++;
+    return -1;
+  }
+
+  int frame_sequence = ((buf_rx_[0] & 0x0F) << 8) | buf_rx_[1];
+  if (frame_sequence == last_frame_sequence_) {
+    duplicates_++;
+    return -1;
+  }
+  int gap = 0;
+  if (last_frame_sequence_ >= 0) {
+    // Frames missing from the sequence, less the ones that
+    // arrived but were not read, were lost on the link.
+    gap = (frame_sequence - last_frame_sequence_ - 1) & 0x0FFF;
+    if (gap > static_cast<int>(received_gap)) {
+      lost_ += gap - received_gap;
+    }
+  }
+  last_frame_sequence_ = frame_sequence;
+  valid_frames_++;
+
+  uint16_t timestamp = (buf_rx_[2] << 8) | buf_rx_[3];
+  int delay = static_cast<uint16_t>(arrival_micros - timestamp);
+  if (delay < min_delay_micros_)
+    min_delay_micros_ = delay;
+  if (delay > max_delay_micros_)
+    max_delay_micros_ = delay;
+
+  return gap;
+}
+
+void Board2Board::UnpackPosition(float *position) {
+  int bit = 0;
+  for (int key = 0; key < NUM_NOTES; key++) {
+    int p_int = GetBits(buf_rx_ + 4, bit, bits_[key]);
+    position[key] = static_cast<float>(p_int) /
+    static_cast<float>(1 << bits_[key]);
+    bit += bits_[key];
+  }
+  for (int ind = NUM_NOTES; ind < NUM_CHANNELS; ind++) {
+    position[ind] = 0.0;
+  }
+}
+
+// Returns false if the frame has more keys or bits than fit.
+bool Board2Board::UnpackAdaptive(float *position) {
+  int num_keys = buf_rx_[4];
+  if (num_keys > B2B_ADAPTIVE_KEYS) {
+    crc_errors_++;
     return false;
   }
-}
\ No newline at end of file
+  int bit = 5 * 8;
+  int end_bit = (CANBUS_LENGTH - 2) * 8;
+  for (int key = 0; key < num_keys; key++) {
+    if (bit >= end_bit) {
+      crc_errors_++;
+      return false;
+    }
+    if (GetBits(buf_rx_, bit, 1) == 1) {
+      if (bit + 1 + adaptive_bits_[key] > end_bit) {
+        crc_errors_++;
+        return false;
+      }
+      int p_int = GetBits(buf_rx_, bit + 1, adaptive_bits_[key]);
+      adaptive_position_[key] = static_cast<float>(p_int) /
+      static_cast<float>(1 << adaptive_bits_[key]);
+      bit += 1 + adaptive_bits_[key];
+    }
+    else {
+      bit++;
+    }
+  }
+  for (int ind = 0; ind < NUM_CHANNELS; ind++) {
+    position[ind] = (ind < num_keys) ? adaptive_position_[ind] : 0.0;
+  }
+  return true;
+}
+
+// missing is the number of frames lost or not read before this one.
+void Board2Board::UnpackEvents(float *position, int missing) {
+  int count = 0;
+  for (int key = 0; key < NUM_NOTES; key++) {
+    bool damper_up = GetBits(buf_rx_ + 15, key, 1) == 1;
+    if (GetBits(buf_rx_ + 4, key, 1) == 1) {
+      event_[key] = true;
+      velocity_[key] = 0.0;
+      if (count < B2B_EVENTS_PER_FRAME) {
+        velocity_[key] = static_cast<int8_t>(buf_rx_[35 + count]) / 127.0;
+      }
+      count++;
+    }
+    else if (missing > 0 && damper_up_[key] == true && damper_up == false) {
+      event_[key] = true;
+      velocity_[key] = B2B_RECOVERED_VELOCITY;
+      recovered_++;
+    }
+    damper_up_[key] = damper_up;
+  }
+  int start_key = buf_rx_[26];
+  for (int ind = 0; ind < B2B_POSITIONS_PER_FRAME; ind++) {
+    int key = start_key + ind;
+    if (key < NUM_NOTES) {
+      position[key] = static_cast<float>(buf_rx_[27 + ind]) / 256.0;
+    }
+  }
+}
+
+// Write the lower num_bits of value, msb first, starting at bit.
+void Board2Board::PutBits(uint8_t *buf, int bit, int num_bits, int value) {
+  for (int k = num_bits - 1; k >= 0; k--) {
+    int byte = bit >> 3;
+    int mask = 0x80 >> (bit & 7);
+    if ((value >> k) & 1)
+      buf[byte] |= mask;
+    else
+      buf[byte] &= ~mask;
+    bit++;
+  }
+}
+
+int Board2Board::GetBits(const uint8_t *buf, int bit, int num_bits) {
+  int value = 0;
+  for (int k = 0; k < num_bits; k++) {
+    value = (value << 1) | ((buf[bit >> 3] >> (7 - (bit & 7))) & 1);
+    bit++;
+  }
+  return value;
+}
+
+// Position in [0, 1] to an integer with num_bits bits.
+int Board2Board::Quantize(float position, int num_bits) {
+  int max_value = (1 << num_bits) - 1;
+  int p_int = static_cast<int>(position * (max_value + 1));
+  if (p_int > max_value)
+    p_int = max_value;
+  else if (p_int < 0)
+    p_int = 0;
+  return p_int;
+}
+
+// CRC-16/CCITT, polynomial 0x1021, initial value 0xFFFF.
+uint16_t Board2Board::Crc16(const uint8_t *data, int length) {
+  uint16_t crc = 0xFFFF;
+  for (int ind = 0; ind < length; ind++) {
+    crc ^= data[ind] << 8;
+    for (int k = 0; k < 8; k++) {
+      if (crc & 0x8000)
+        crc = (crc << 1) ^ 0x1021;
+      else
+        crc = crc << 1;
+    }
+  }
+  return crc;
+}
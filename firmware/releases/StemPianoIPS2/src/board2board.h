@@ -34,18 +34,178 @@
 // #defined to clarify a magic number.
 #define CANBUS_LENGTH 64
 
+// Frame formats the damper board can send.
+#define B2B_FRAME_LEGACY 0    // Positions only, no header.
+#define B2B_FRAME_POSITION 1  // Header, positions, and CRC.
+#define B2B_FRAME_EVENTS 2    // Header, damper events, and CRC.
+#define B2B_FRAME_ADAPTIVE 3  // Header, changed positions only, and CRC.
+
+// The CAN id tells the receiver the frame format.
+#define B2B_ID_LEGACY 0x100
+#define B2B_ID_POSITION 0x101
+#define B2B_ID_EVENTS 0x102
+#define B2B_ID_ADAPTIVE 0x103
+
+// Version in the first 4 bits of a frame with a header.
+#define B2B_FORMAT_VERSION 1
+
+// Adaptive frame. All physical channels, not only NUM_NOTES.
+// A key is sent when it moved more than the deadband, in units of
+// its own resolution. Every frame also sends the next REFRESH_KEYS
+// keys, so a lost frame is repaired within NUM_CHANNELS/4 frames.
+#define B2B_ADAPTIVE_KEYS NUM_CHANNELS
+#define B2B_ADAPTIVE_DEADBAND 2
+#define B2B_ADAPTIVE_REFRESH_KEYS 4
+
+// Hammer board sample clock. A lower id wins arbitration, so a sync
+// frame never waits behind a queued damper frame.
+#define B2B_ID_SYNC 0x080
+#define B2B_SYNC_LENGTH 12
+
+// Number of sync frames used for the minimum link delay.
+#define B2B_SYNC_WINDOW 32
+
+// Events frame. Most damper events in one frame, and
+// damper positions for the display in one frame.
+#define B2B_EVENTS_PER_FRAME 27
+#define B2B_POSITIONS_PER_FRAME 8
+
 class Board2Board
 {
   public:
     Board2Board();
-    void Setup(bool);
+    void Setup(bool, int);
+    void SetupSend(int);
+    void SetupReceive(int);
+    void SetupSyncSend(int);
+    void SetupSyncReceive(int);
     void SendDamperData(const float *);
+    void SendDamperEvents(const bool *, const float *, const float *, float);
     bool GetDamperData(float *);
+    bool RemoteEvents();
+    void GetDamperEvents(bool *, float *);
+    bool LinkStale();
+    void SendSync(unsigned long, int, int);
+    bool GetSyncPhaseError(unsigned long, int, int *);
+    int HammerSamplePeriod();
+    void PrintStatistics();
+    void PrintSendStatistics();
+    void PrintSyncStatistics();
 
   private:
     FlexCAN_T4FD<CAN3, RX_SIZE_256, TX_SIZE_16> can_;
-    CANFD_message_t msg_tx_, msg_rx_;
+    CANFD_message_t msg_tx_;
     bool enable_;
+    int debug_level_;
+
+    // Sender.
+    int frame_format_;
+    uint16_t tx_sequence_;
+
+    // Sender, events frame. Events that did not fit wait for the next frame.
+    bool pending_[NUM_NOTES];
+    float pending_velocity_[NUM_NOTES];
+    int position_start_key_;
+
+    // Sender, adaptive frame. What the receiver has for each key,
+    // and where the next refresh and the next changed key search start.
+    int sent_value_[B2B_ADAPTIVE_KEYS];
+    bool send_[B2B_ADAPTIVE_KEYS];
+    int refresh_key_;
+    int changed_start_key_;
+    unsigned long deferred_;
+
+    // Bits per key in a B2B_ID_POSITION frame.
+    int bits_[NUM_NOTES];
+
+    // Bits per key when a key is sent in a B2B_ID_ADAPTIVE frame.
+    int adaptive_bits_[B2B_ADAPTIVE_KEYS];
+
+    // Receive interrupt. Only one instance can receive.
+    static Board2Board *receiver_;
+    static void ReceiveInterrupt(const CANFD_message_t &);
+    void Receive(const CANFD_message_t &);
+
+    // Latest frame, double buffered. The interrupt writes the slot
+    // that is not the latest. Sequence 0 means the slot is being written.
+    volatile uint8_t slot_buf_[2][CANBUS_LENGTH];
+    volatile uint32_t slot_id_[2];
+    volatile uint32_t slot_sequence_[2];
+    volatile uint32_t slot_micros_[2];
+    volatile int latest_;
+    volatile uint32_t received_;
+
+    // Reader side.
+    uint8_t buf_rx_[CANBUS_LENGTH];
+    uint32_t last_sequence_;
+    unsigned long dropped_;
+    unsigned long overruns_;
+    unsigned long stale_;
+    unsigned long max_age_micros_;
+
+    // Link quality, from the frame header.
+    unsigned long stale_millis_;
+    unsigned long last_valid_millis_;
+    bool have_valid_frame_;
+    bool link_stale_;
+    int last_frame_sequence_;
+    unsigned long valid_frames_;
+    unsigned long lost_;
+    unsigned long duplicates_;
+    unsigned long crc_errors_;
+    unsigned long version_errors_;
+    int min_delay_micros_;
+    int max_delay_micros_;
+
+    // Hammer board, sample clock sync.
+    CANFD_message_t msg_sync_;
+    int sync_interval_;
+    int sync_counter_;
+    uint16_t sync_sequence_;
+
+    // Damper board, sample clock sync. The interrupt writes these.
+    volatile uint32_t sync_hammer_micros_;
+    volatile uint32_t sync_arrival_micros_;
+    volatile uint32_t sync_period_;
+    volatile uint32_t sync_nominal_period_;
+    volatile uint32_t sync_received_;
+
+    // Damper board, sample clock sync. Reader side.
+    bool sync_enable_;
+    int sync_latency_micros_;
+    uint32_t sync_last_read_;
+    uint32_t sync_offset_[B2B_SYNC_WINDOW];
+    int sync_offset_index_;
+    int sync_offset_count_;
+    unsigned long syncs_;
+    unsigned long sync_mismatch_;
+    int min_phase_error_;
+    int max_phase_error_;
+
+    // Receiver, adaptive frame. Keys not in a frame keep their value.
+    float adaptive_position_[B2B_ADAPTIVE_KEYS];
+
+    // Receiver, events frame.
+    bool remote_events_;
+    bool event_[NUM_NOTES];
+    float velocity_[NUM_NOTES];
+    bool damper_up_[NUM_NOTES];
+    unsigned long recovered_;
+
+    void PackLegacy(const float *);
+    void PackHeader();
+    void PackPosition(const float *);
+    void PackEvents(const bool *, const float *, const float *, float);
+    void PackAdaptive(const float *);
+    void UnpackLegacy(float *);
+    int CheckHeader(uint32_t, uint32_t);
+    void UnpackPosition(float *);
+    void UnpackEvents(float *, int);
+    bool UnpackAdaptive(float *);
+    static void PutBits(uint8_t *, int, int, int);
+    static int GetBits(const uint8_t *, int, int);
+    static int Quantize(float, int);
+    static uint16_t Crc16(const uint8_t *, int);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -31,15 +31,6 @@ int debug_level, Nonvolatile *Nv) {
   // Setup the calibration state.
   InitializeState(Nv, debug_level);
   
-  // Only allow an EEPROM write every three seconds.
-  // This is a safety feature in case of a software bug
-  // or in case of extreme configuration switch noise.
-  // EEPROM is good for approximately 100,000 writes.
-  // Three seconds is assumed fastest time someone
-  // would configuration switch off then back on.
-  min_write_interval_millis_ = 3000;
-  last_write_time_ = millis();
-
   // Due to various nonideal conditions could
   // get clipping. Use this value to give some margin.
   gain_correction_ = 0.99;
@@ -66,15 +57,6 @@ bool switch_disable_and_reset_calibration, float *out, const float *in) {
   bool all_notes_calibrated = BuildCalibrationValues(switch_freeze_cal_values,
   switch_disable_and_reset_calibration, in);
 
-  // Use millis() to limit number of writes per second.
-  // This is to prevent a bug or other problem causing
-  // too many writes to the EEPROM memory.
-  if (millis() - last_write_time_ > min_write_interval_millis_) {
-    WriteEeprom(switch_freeze_cal_values, switch_disable_and_reset_calibration,
-    all_notes_calibrated);
-    last_write_time_ = millis();
-  }
-
   return all_notes_calibrated;
 }
 
@@ -281,6 +263,8 @@ void CalibrationPosition::InitializeState(Nonvolatile *Nv, int debug_level) {
 // A bug in this code that accidentally causes multiple writes
 // repeatedly could permanently damage the EEPROM.
 // So, be careful when editing code below.
+// Called from a scheduler task every few seconds, not every sample,
+// so a noisy switch cannot cause a burst of writes.
 void CalibrationPosition::WriteEeprom(bool switch_freeze_cal_values,
 bool switch_disable_and_reset_calibration,
 bool all_notes_are_using_calibration_values) {
@@ -288,20 +272,14 @@ bool all_notes_are_using_calibration_values) {
   if (switch_freeze_cal_values == true &&
   switch_freeze_cal_values_last_ == false) {
     if (all_notes_are_using_calibration_values == true) {
-      unsigned long start_write_time = micros();
       if (debug_level_ >= DEBUG_INFO) {
         Serial.println("Writing position max/min to EEPROM.");
       }
-      for (int note = 0; note < NUM_NOTES; note++) {
-        Nv_->WriteCalibrationPositionMax(note, max_[note]);
-        Nv_->WriteCalibrationPositionMin(note, min_[note]);
-      }
-      Nv_->WriteCalibrationDoneFlag(true);
-      Nv_->UpdateAndWriteTotalWrites();
-      if (debug_level_ >= DEBUG_INFO) {
-        Serial.print("Finished writing EEPROM, write time = ");
-        Serial.print(micros() - start_write_time);
-        Serial.println(" microseconds.");
+      // Too slow for one sample, so written a few bytes each sample.
+      // The queue sets the done flag and total writes when finished.
+      if (Nv_->QueueCalibrationPosition(min_, max_) == false &&
+      debug_level_ >= DEBUG_INFO) {
+        Serial.println("Calibration values not written to EEPROM.");
       }
     }
     else if (debug_level_ >= DEBUG_INFO) {
@@ -315,6 +293,8 @@ bool all_notes_are_using_calibration_values) {
   // This avoids extra unnecessary EEPROM writes.
   if (switch_disable_and_reset_calibration == true &&
   switch_disable_and_reset_calibration_last_ == false) {
+    // A queued write must not set the flag again afterwards.
+    Nv_->CancelQueue(NONVOLATILE_QUEUE_CALIBRATION);
     bool cal_done_flag = Nv_->ReadCalibrationDoneFlag();
     // To avoid unnecessary writes, only write a false if previous was true.
     if (cal_done_flag == true) {
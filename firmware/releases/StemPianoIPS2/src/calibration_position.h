@@ -34,6 +34,7 @@ class CalibrationPosition
     CalibrationPosition();
     void Setup(float, int, Nonvolatile *);
     bool Calibration(bool, bool, float *, const float *);
+    void WriteEeprom(bool, bool, bool);
  
   private:
 
@@ -59,15 +60,12 @@ class CalibrationPosition
     int buffer_index_;
 
     Nonvolatile *Nv_;
-    unsigned long last_write_time_;
-    unsigned long min_write_interval_millis_;
 
     double GetGain(double, double);
     double GetOffset(double);
     void InitializeState(Nonvolatile *, int);
     void ApplyCalibrationValues(bool, float *, const float *);
     bool BuildCalibrationValues(bool, bool, const float *);
-    void WriteEeprom(bool, bool, bool);
 
 };
 
@@ -52,15 +52,6 @@ Nonvolatile *Nv) {
   fixed_velocity_scale_ = fixed_velocity_scale;
   debug_level_ = debug_level;
   
-  // Only allow an EEPROM write every three seconds.
-  // This is a safety feature in case of a software bug
-  // or in case of extreme configuration switch noise.
-  // EEPROM is good for approximately 100,000 writes.
-  // Three seconds is assumed fastest time someone
-  // would configuration switch off then back on.
-  min_write_interval_millis_ = 3000;
-  last_write_time_ = millis();
-
   // Restrict the hammer velocity scaling to the following range.
   // If need a wider range, change velocity_scale in the settings
   // file. The reason for this narrow range is to avoid very loud
@@ -109,14 +100,6 @@ bool all_notes_using_cal) {
     BuildVelocityScale(velocity_data, velocity_event);
   }
 
-  // Use millis() to limit number of writes per second.
-  // This is to prevent a bug or other problem causing
-  // too many writes to the EEPROM memory.
-  if (millis() - last_write_time_ > min_write_interval_millis_) {
-    WriteEeprom(switch_freeze_cal_values, switch_disable_and_reset_calibration);
-    last_write_time_ = millis();
-  }
-
   // An optional dynamic algorithm, if the coarse value is not sufficient.
   // Run this last because ApplyVelocityScale() modifies velocity_data.
   if (switch_enable_dynamic_velocity == true) {
@@ -134,6 +117,11 @@ const bool *velocity_event) {
   FixedScale(velocity_data, velocity_event);
 }
 
+// Change the settings-based scaling while running.
+void CalibrationVelocity::SetFixedScale(float fixed_velocity_scale) {
+  fixed_velocity_scale_ = fixed_velocity_scale;
+}
+
 // Use the setting to adjust velocity.
 void CalibrationVelocity::FixedScale(float *velocity_data,
 const bool *velocity_event) {
@@ -234,6 +222,8 @@ void CalibrationVelocity::InitializeState(Nonvolatile *Nv) {
 // switch. A bug in this code that accidentally causes multiple
 // writes repeatedly could permanently damage the EEPROM.
 // So, be careful when editing code below.
+// The .ino code calls this from the same slow task as the
+// position calibration, so at most once every few seconds.
 void CalibrationVelocity::WriteEeprom(bool switch_freeze_cal_values,
 bool switch_disable_and_reset_calibration) {
 
@@ -35,6 +35,8 @@ class CalibrationVelocity
     void Setup(float, int, Nonvolatile *);
     void HammerVelocityScale(float *, const bool *, bool, bool, bool, bool);
     void DamperVelocityScale(float *, const bool *);
+    void SetFixedScale(float);
+    void WriteEeprom(bool, bool);
  
   private:
     float velocity_scale_;
@@ -47,8 +49,6 @@ class CalibrationVelocity
     int debug_level_;
 
     Nonvolatile *Nv_;
-    unsigned long last_write_time_;
-    unsigned long min_write_interval_millis_;
 
     bool switch_freeze_cal_values_last_;
     bool switch_disable_and_reset_calibration_last_;
@@ -57,7 +57,6 @@ class CalibrationVelocity
     void BuildVelocityScale(const float *, const bool *);
     void ApplyVelocityScale(float *, const bool *);
     void InitializeState(Nonvolatile *);
-    void WriteEeprom(bool, bool);
 
 };
 
@@ -0,0 +1,233 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// capture.cpp
+//
+// For ips pcb version 2.X
+// For sca pcb version 0.0
+//
+// High-speed capture of a small list of channels.
+//
+// Generalizes test_index to a list of up to CAPTURE_MAX_CHANNELS keys.
+// Only the listed channels are sampled, so the sample period shrinks
+// to overhead_microseconds + num_channels * microseconds_per_channel.
+// While capture is active all piano functions are disabled.
+//
+// Commands (serial monitor or Ethernet, see command_line.cpp):
+//   capture k1 k2 ... kN   Capture keys k1 to kN and start.
+//   capture on             Start with the present key list.
+//   capture off            Stop and return to normal piano operation.
+//   capture                Report the state and the achieved rate.
+//
+// Ethernet packet, all values least significant byte first:
+//   byte 0        'C'
+//   byte 1        Number of channels, N.
+//   bytes 2-3     Number of frames in this packet, F.
+//   bytes 4-7     Measured frames per second.
+//   bytes 8-9     Packet sequence number.
+//   bytes 10-     N key indices, one byte each.
+//   then          F frames of N raw ADC counts, 3 bytes each.
+
+#include "capture.h"
+
+Capture::Capture() {}
+
+void Capture::Setup(bool capture_enable, const int *key_list, int num_keys,
+int microseconds_per_channel, int overhead_microseconds,
+SixChannelAnalog00 *Adc, int debug_level) {
+
+  debug_level_ = debug_level;
+  Adc_ = Adc;
+  microseconds_per_channel_ = microseconds_per_channel;
+  overhead_microseconds_ = overhead_microseconds;
+  sequence_ = 0;
+  achieved_rate_ = 0;
+
+  active_ = false;
+  num_channels_ = 0;
+  if (SetChannels(key_list, num_keys) == true) {
+    active_ = capture_enable;
+  }
+  if (active_ == true) {
+    Serial.println("WARNING - In multi-channel capture mode.");
+    Serial.println("MIDI is disabled.");
+  }
+}
+
+// Returns true if the command was a capture command.
+bool Capture::ParseCommand(const char *command, CommandLine *Cmd) {
+
+  const char *arguments = CommandLine::Arguments(command, "capture");
+  if (arguments == nullptr) {
+    return false;
+  }
+
+  char reply[COMMAND_LINE_LENGTH];
+
+  if (strcmp(arguments, "off") == 0) {
+    active_ = false;
+    Cmd->Reply("Capture is off.");
+  }
+  else if (strcmp(arguments, "on") == 0) {
+    if (num_channels_ > 0) {
+      active_ = true;
+      rate_start_micros_ = micros();
+      rate_frame_count_ = 0;
+      Cmd->Reply("Capture is on.");
+    }
+    else {
+      Cmd->Reply("Error - no capture channels.");
+    }
+  }
+  else if (*arguments == 0) {
+    snprintf(reply, COMMAND_LINE_LENGTH,
+    "Capture %s, %d channels, period %d us, measured %lu frames/s.",
+    active_ ? "on" : "off", num_channels_, SamplePeriod(), achieved_rate_);
+    Cmd->Reply(reply);
+  }
+  else {
+    // A list of keys.
+    int key_list[CAPTURE_MAX_CHANNELS];
+    int num_keys = 0;
+    bool ok = true;
+    char *end;
+    long value;
+    while (*arguments != 0) {
+      value = strtol(arguments, &end, 10);
+      if (end == arguments || num_keys >= CAPTURE_MAX_CHANNELS) {
+        ok = false;
+        break;
+      }
+      key_list[num_keys++] = static_cast<int>(value);
+      arguments = end;
+      while (*arguments == ' ') {
+        arguments++;
+      }
+    }
+    if (ok == true && SetChannels(key_list, num_keys) == true) {
+      active_ = true;
+      snprintf(reply, COMMAND_LINE_LENGTH,
+      "Capture on, %d channels, period %d us.", num_channels_, SamplePeriod());
+      Cmd->Reply(reply);
+    }
+    else {
+      snprintf(reply, COMMAND_LINE_LENGTH,
+      "Error - need 1 to %d keys in range 0 to %d.",
+      CAPTURE_MAX_CHANNELS, NUM_CHANNELS - 1);
+      Cmd->Reply(reply);
+    }
+  }
+  return true;
+}
+
+bool Capture::Active() {
+  return active_;
+}
+
+int Capture::SamplePeriod() {
+  return overhead_microseconds_ + num_channels_ * microseconds_per_channel_;
+}
+
+int Capture::NumChannels() {
+  return num_channels_;
+}
+
+const int *Capture::AdcChannels() {
+  return adc_channel_;
+}
+
+// Add one frame of raw ADC values, in key list order, to the
+// packet. Send the packet when full.
+void Capture::AddFrame(const unsigned int *adc_values, Network *Eth,
+bool switch_enable_ethernet, bool switch_require_tcp_connection) {
+
+  UpdateRate();
+
+  int ptr = data_start_ + 3 * num_channels_ * frame_in_packet_;
+  for (int ind = 0; ind < num_channels_; ind++) {
+    packet_[ptr++] = adc_values[ind]&255;
+    packet_[ptr++] = (adc_values[ind]>>8)&255;
+    packet_[ptr++] = (adc_values[ind]>>16)&255;
+  }
+  frame_in_packet_++;
+
+  if (frame_in_packet_ >= frames_per_packet_) {
+    packet_[0] = 'C';
+    packet_[1] = num_channels_;
+    packet_[2] = frame_in_packet_&255;
+    packet_[3] = (frame_in_packet_>>8)&255;
+    for (int shift = 0; shift < 4; shift++) {
+      packet_[4 + shift] = (achieved_rate_>>(8*shift))&255;
+    }
+    packet_[8] = sequence_&255;
+    packet_[9] = (sequence_>>8)&255;
+    for (int ind = 0; ind < num_channels_; ind++) {
+      packet_[CAPTURE_HEADER_BYTES + ind] = key_[ind];
+    }
+    Eth->SendBytes(packet_, ptr, switch_enable_ethernet,
+    switch_require_tcp_connection);
+    sequence_++;
+    frame_in_packet_ = 0;
+  }
+}
+
+// Private methods. ////////
+
+bool Capture::SetChannels(const int *key_list, int num_keys) {
+  if (num_keys < 1 || num_keys > CAPTURE_MAX_CHANNELS) {
+    return false;
+  }
+  for (int ind = 0; ind < num_keys; ind++) {
+    if (key_list[ind] < 0 || key_list[ind] >= NUM_CHANNELS) {
+      return false;
+    }
+  }
+  num_channels_ = num_keys;
+  for (int ind = 0; ind < num_channels_; ind++) {
+    key_[ind] = key_list[ind];
+    adc_channel_[ind] = Adc_->KeyToAdcChannel(key_[ind]);
+  }
+  data_start_ = CAPTURE_HEADER_BYTES + num_channels_;
+  frames_per_packet_ = (CAPTURE_MAX_PACKET_BYTES - data_start_) / (3 * num_channels_);
+  frame_in_packet_ = 0;
+  rate_start_micros_ = micros();
+  rate_frame_count_ = 0;
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.printf("Capture of %d channels, %d frames per packet.\n",
+    num_channels_, frames_per_packet_);
+    Serial.printf("Sample period is %d microseconds.\n", SamplePeriod());
+  }
+  return true;
+}
+
+// Measure frames per second over one second intervals.
+void Capture::UpdateRate() {
+  rate_frame_count_++;
+  unsigned long elapsed = micros() - rate_start_micros_;
+  if (elapsed >= 1000000) {
+    achieved_rate_ = static_cast<unsigned long>(
+    (1000000.0 * rate_frame_count_) / elapsed + 0.5);
+    rate_start_micros_ = micros();
+    rate_frame_count_ = 0;
+    if (debug_level_ >= DEBUG_STATS) {
+      Serial.printf("Capture rate = %lu frames per second, %d channels.\n",
+      achieved_rate_, num_channels_);
+    }
+  }
+}
@@ -0,0 +1,80 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// capture.h
+//
+// For ips pcb version 2.X
+// For sca pcb version 0.0
+//
+// High-speed capture of a small list of channels.
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include "stem_piano_ips2.h"
+#include "command_line.h"
+#include "network.h"
+#include "six_channel_analog_00.h"
+
+// Keep each packet below the Ethernet MTU.
+#define CAPTURE_MAX_PACKET_BYTES 1400
+#define CAPTURE_HEADER_BYTES 10
+
+class Capture
+{
+  public:
+    Capture();
+    void Setup(bool, const int *, int, int, int, SixChannelAnalog00 *, int);
+    bool ParseCommand(const char *, CommandLine *);
+    bool Active();
+    int SamplePeriod();
+    int NumChannels();
+    const int *AdcChannels();
+    void AddFrame(const unsigned int *, Network *, bool, bool);
+
+  private:
+    bool SetChannels(const int *, int);
+    void UpdateRate();
+
+    int debug_level_;
+    SixChannelAnalog00 *Adc_;
+
+    bool active_;
+    int num_channels_;
+    int key_[CAPTURE_MAX_CHANNELS];
+    int adc_channel_[CAPTURE_MAX_CHANNELS];
+
+    // Sample period is overhead plus time per channel.
+    int microseconds_per_channel_;
+    int overhead_microseconds_;
+
+    // Measured frames per second.
+    unsigned long rate_start_micros_;
+    unsigned long rate_frame_count_;
+    unsigned long achieved_rate_;
+
+    uint8_t packet_[CAPTURE_MAX_PACKET_BYTES];
+    int frames_per_packet_;
+    int frame_in_packet_;
+    int data_start_;
+    unsigned int sequence_;
+
+};
+
+#endif
@@ -0,0 +1,135 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// command_line.cpp
+//
+// This class is not hardware dependent.
+//
+// Receive text commands from the serial monitor or from Ethernet.
+//
+// A command is one line of text ending with a newline. For UDP, each
+// packet is one command. Reading is non-blocking. Characters are
+// gathered across calls, so at most one command is returned per call.
+
+#include "command_line.h"
+
+CommandLine::CommandLine() {}
+
+void CommandLine::Setup(Network *Eth, int debug_level) {
+  debug_level_ = debug_level;
+  Eth_ = Eth;
+  switch_enable_ethernet_ = false;
+  switch_require_tcp_connection_ = false;
+  reply_to_network_ = false;
+  serial_length_ = 0;
+  network_length_ = 0;
+  network_bytes_length_ = 0;
+  network_bytes_index_ = 0;
+}
+
+// If a full command was received, copy it into command and return true.
+// command must hold at least COMMAND_LINE_LENGTH characters.
+bool CommandLine::GetCommand(char *command, bool switch_enable_ethernet,
+bool switch_require_tcp_connection) {
+
+  switch_enable_ethernet_ = switch_enable_ethernet;
+  switch_require_tcp_connection_ = switch_require_tcp_connection;
+
+  while (Serial.available() > 0) {
+    if (AddCharacter(Serial.read(), serial_line_, &serial_length_, command)) {
+      reply_to_network_ = false;
+      return true;
+    }
+  }
+
+  if (switch_enable_ethernet_ == true) {
+    if (network_bytes_index_ >= network_bytes_length_) {
+      network_bytes_length_ = Eth_->ReadBytes(network_bytes_, COMMAND_LINE_LENGTH);
+      network_bytes_index_ = 0;
+    }
+    while (network_bytes_index_ < network_bytes_length_) {
+      if (AddCharacter(network_bytes_[network_bytes_index_++], network_line_,
+      &network_length_, command)) {
+        reply_to_network_ = true;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// Send a reply to wherever the last command came from.
+void CommandLine::Reply(const char *text) {
+  Send(text, reply_to_network_);
+}
+
+// Send a line of text. Always echo on the serial monitor.
+void CommandLine::Send(const char *text, bool to_network) {
+  Serial.println(text);
+  if (to_network == true) {
+    char reply[COMMAND_REPLY_LENGTH];
+    int length = snprintf(reply, COMMAND_REPLY_LENGTH, "%s\n", text);
+    if (length >= COMMAND_REPLY_LENGTH) {
+      length = COMMAND_REPLY_LENGTH - 1;
+    }
+    Eth_->SendReplyBytes(reinterpret_cast<const uint8_t *>(reply), length,
+    switch_enable_ethernet_, switch_require_tcp_connection_);
+  }
+}
+
+bool CommandLine::LastCommandFromNetwork() {
+  return reply_to_network_;
+}
+
+// If the command is the keyword, alone or followed by a space, returns
+// the arguments after the spaces. Otherwise nullptr, so "capturex" is
+// not the capture command.
+const char *CommandLine::Arguments(const char *command, const char *keyword) {
+  int length = strlen(keyword);
+  if (strncmp(command, keyword, length) != 0 ||
+  (command[length] != ' ' && command[length] != 0)) {
+    return nullptr;
+  }
+  const char *arguments = command + length;
+  while (*arguments == ' ') {
+    arguments++;
+  }
+  return arguments;
+}
+
+// Returns true when a newline completes a non-empty line.
+// Characters beyond the line length are dropped.
+bool CommandLine::AddCharacter(char c, char *line, int *length, char *command) {
+  if (c == '\n' || c == '\r') {
+    if (*length > 0) {
+      line[*length] = 0;
+      strcpy(command, line);
+      *length = 0;
+      if (debug_level_ >= DEBUG_ALG) {
+        Serial.printf("Command received: %s\n", command);
+      }
+      return true;
+    }
+  }
+  else if (*length < COMMAND_LINE_LENGTH - 1) {
+    line[(*length)++] = c;
+  }
+  return false;
+}
@@ -0,0 +1,70 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// command_line.h
+//
+// This class is not hardware dependent.
+//
+// Receive text commands from the serial monitor or from Ethernet.
+
+#ifndef COMMAND_LINE_H_
+#define COMMAND_LINE_H_
+
+#include "stem_piano_ips2.h"
+#include "network.h"
+
+// Longest command, including the terminating zero.
+#define COMMAND_LINE_LENGTH 128
+
+// Longest reply or telemetry line, including the terminating zero.
+#define COMMAND_REPLY_LENGTH 256
+
+class CommandLine
+{
+  public:
+    CommandLine();
+    void Setup(Network *, int);
+    bool GetCommand(char *, bool, bool);
+    void Reply(const char *);
+    void Send(const char *, bool);
+    bool LastCommandFromNetwork();
+    static const char *Arguments(const char *, const char *);
+
+  private:
+    bool AddCharacter(char, char *, int *, char *);
+
+    int debug_level_;
+    Network *Eth_;
+
+    bool switch_enable_ethernet_;
+    bool switch_require_tcp_connection_;
+    bool reply_to_network_;
+
+    char serial_line_[COMMAND_LINE_LENGTH];
+    int serial_length_;
+
+    char network_line_[COMMAND_LINE_LENGTH];
+    int network_length_;
+    uint8_t network_bytes_[COMMAND_LINE_LENGTH];
+    int network_bytes_length_;
+    int network_bytes_index_;
+
+};
+
+#endif
@@ -0,0 +1,166 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+//
+// damper_stream.cpp
+//
+// This class is not hardware dependent.
+//
+// Continuous damper position per key, over MIDI and Ethernet.
+//
+// DspDamper only uses the damper position for a threshold crossing.
+// This class also sends the damper height itself, 0 (damper on the
+// string) to 127 (damper fully lifted), so a synth can model partial
+// damping and half re-pedaling. Over MIDI it is polyphonic aftertouch
+// for the key. Over Ethernet it is a UDP packet on the data stream:
+//   'D', 'S', count, then count pairs of (key index, value).
+//
+// A key is only sent if its value changed by at least the delta, or
+// returned to 0, and not faster than once per key interval. All keys
+// share a MIDI budget of messages per second. When the budget is used
+// up, the remaining keys wait for a later sample on MIDI. Ethernet has
+// no budget, so it still sends them. The next key checked rotates
+// every sample so no key is starved.
+//
+// Aftertouch has the lowest MIDI priority, after every note and pedal
+// in the sample. See midiout.cpp for how DIN keeps it from delaying
+// note events.
+
+#include "damper_stream.h"
+
+DamperStream::DamperStream() {}
+
+void DamperStream::Setup(bool midi_enable, bool network_enable, int delta,
+int key_interval_millis, int midi_messages_per_second, int debug_level) {
+
+  debug_level_ = debug_level;
+  midi_enable_ = midi_enable;
+  network_enable_ = network_enable;
+  enable_ = true;
+
+  delta_ = delta < 1 ? 1 : delta;
+  key_interval_millis_ = static_cast<unsigned long>(key_interval_millis);
+  for (int key = 0; key < NUM_NOTES; key++) {
+    last_value_[key] = 0;
+    last_millis_[key] = millis();
+    midi_last_value_[key] = 0;
+    midi_last_millis_[key] = millis();
+  }
+  start_key_ = 0;
+
+  // Allow a burst of up to 20 milliseconds of budget.
+  if (midi_messages_per_second < 1) midi_messages_per_second = 1;
+  messages_per_micro_ = static_cast<float>(midi_messages_per_second) / 1000000.0;
+  max_tokens_ = 0.02 * static_cast<float>(midi_messages_per_second);
+  if (max_tokens_ < 1.0) max_tokens_ = 1.0;
+  tokens_ = max_tokens_;
+  last_micros_ = micros();
+  skipped_ = 0;
+
+  packet_[0] = 'D';
+  packet_[1] = 'S';
+
+  if (debug_level_ >= DEBUG_INFO) {
+    if (midi_enable_ == true) {
+      Serial.printf("Damper stream over MIDI aftertouch, %d per second.\n",
+      midi_messages_per_second);
+    }
+    if (network_enable_ == true) {
+      Serial.println("Damper stream over Ethernet.");
+    }
+  }
+}
+
+// Call once per sample after the note and pedal messages were added.
+void DamperStream::Update(const float *damper_position, MidiOut *Midi,
+Network *Eth, bool switch_enable_ethernet, bool switch_require_tcp_connection) {
+
+  if (enable_ == false || (midi_enable_ == false && network_enable_ == false)) {
+    return;
+  }
+
+  unsigned long now_micros = micros();
+  tokens_ += messages_per_micro_ * static_cast<float>(now_micros - last_micros_);
+  if (tokens_ > max_tokens_) tokens_ = max_tokens_;
+  last_micros_ = now_micros;
+
+  unsigned long now_millis = millis();
+  int count = 0;
+  for (int ind = 0; ind < NUM_NOTES; ind++) {
+    int key = (start_key_ + ind) % (NUM_NOTES);
+
+    float position = damper_position[key];
+    if (position < 0.0) position = 0.0;
+    if (position > 1.0) position = 1.0;
+    int value = static_cast<int>(127.0 * position + 0.5);
+
+    if (midi_enable_ == true && ShouldSend(value, midi_last_value_[key],
+    midi_last_millis_[key], now_millis) == true) {
+      if (tokens_ < 1.0) {
+        skipped_++;
+      }
+      else {
+        tokens_ -= 1.0;
+        Midi->SendPolyPressure(key, value);
+        midi_last_value_[key] = value;
+        midi_last_millis_[key] = now_millis;
+      }
+    }
+
+    if (network_enable_ == true && ShouldSend(value, last_value_[key],
+    last_millis_[key], now_millis) == true) {
+      packet_[3 + 2*count] = key;
+      packet_[4 + 2*count] = value;
+      count++;
+      last_value_[key] = value;
+      last_millis_[key] = now_millis;
+    }
+  }
+  start_key_ = (start_key_ + 1) % (NUM_NOTES);
+
+  if (network_enable_ == true && count > 0) {
+    packet_[2] = count;
+    Eth->SendBytes(packet_, 3 + 2*count, switch_enable_ethernet,
+    switch_require_tcp_connection);
+  }
+}
+
+void DamperStream::Enable(bool enable) {
+  enable_ = enable;
+}
+
+// Only printed when MIDI held back updates.
+void DamperStream::PrintStatistics() {
+  if (debug_level_ >= DEBUG_STATS && skipped_ > 0) {
+    Serial.printf("Damper stream: %lu updates waited for MIDI budget.\n",
+    skipped_);
+  }
+  skipped_ = 0;
+}
+
+// Private methods. ////////
+
+// Changed by at least the delta, or returned to 0, and not sent
+// within the key interval.
+bool DamperStream::ShouldSend(int value, int last_value,
+unsigned long last_millis, unsigned long now_millis) {
+  int difference = abs(value - last_value);
+  return (difference >= delta_ || (value == 0 && difference > 0)) &&
+  now_millis - last_millis >= key_interval_millis_;
+}
@@ -0,0 +1,74 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+//
+// damper_stream.h
+//
+// This class is not hardware dependent.
+//
+// Continuous damper position per key, over MIDI and Ethernet.
+
+#ifndef DAMPER_STREAM_H_
+#define DAMPER_STREAM_H_
+
+#include "stem_piano_ips2.h"
+#include "midiout.h"
+#include "network.h"
+
+// Header bytes, count byte, then a key and value byte per key.
+#define DAMPER_STREAM_PACKET_SIZE (3 + 2*(NUM_NOTES))
+
+class DamperStream
+{
+  public:
+    DamperStream();
+    void Setup(bool, bool, int, int, int, int);
+    void Update(const float *, MidiOut *, Network *, bool, bool);
+    void Enable(bool);
+    void PrintStatistics();
+
+  private:
+    int debug_level_;
+    bool enable_;
+    bool midi_enable_;
+    bool network_enable_;
+
+    // Per key gating. MIDI and Ethernet each keep the last value
+    // sent, because MIDI can wait for its budget.
+    int delta_;
+    unsigned long key_interval_millis_;
+    int last_value_[NUM_NOTES];
+    unsigned long last_millis_[NUM_NOTES];
+    int midi_last_value_[NUM_NOTES];
+    unsigned long midi_last_millis_[NUM_NOTES];
+    int start_key_;
+
+    // Global MIDI budget, in messages.
+    float messages_per_micro_;
+    float max_tokens_;
+    float tokens_;
+    unsigned long last_micros_;
+    unsigned long skipped_;
+
+    uint8_t packet_[DAMPER_STREAM_PACKET_SIZE];
+
+    bool ShouldSend(int, int, unsigned long, unsigned long);
+};
+
+#endif
@@ -193,6 +193,19 @@ void DspDamper::CheckHammerDamperSync(bool *damper_event, float *velocity,
   }
 }
 
+// Change threshold and scaling while running. Call between samples.
+void DspDamper::SetThreshold(float damper_threshold, float velocity_scaling) {
+  damper_threshold_ = damper_threshold;
+  damper_low_threshold_ = 0.5 * damper_threshold_;
+  velocity_scaling_ = velocity_scaling;
+}
+
+// Change the sample period while running. Call between samples.
+void DspDamper::SetSamplePeriod(int adc_sample_period_microseconds) {
+  samples_per_second_ = 1000000.0 /
+  static_cast<float>(adc_sample_period_microseconds);
+}
+
 void DspDamper::Enable(bool enable) {
   enable_ = enable;
 }
\ No newline at end of file
@@ -40,6 +40,8 @@ class DspDamper
     void Setup(float, float, int, int);
     void GetDamperEventData(bool *, float *, const float *);
     void CheckHammerDamperSync(bool *, float *, const float *, const bool *);
+    void SetThreshold(float, float);
+    void SetSamplePeriod(int);
     void Enable(bool);
 
   private:
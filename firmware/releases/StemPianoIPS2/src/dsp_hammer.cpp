@@ -44,6 +44,7 @@ float hammer_travel_meters, int debug_level) {
   strike_threshold_ = strike_threshold;
   release_threshold_ = release_threshold;
 
+  min_repetition_seconds_ = min_repetition_seconds;
   min_repetition_samples_ = static_cast<int>(min_repetition_seconds *
   (float) samples_per_second_);
 
@@ -74,6 +75,25 @@ void DspHammer::GetHammerEventData(bool *event, float *velocity, const float *po
   UpdateMaxHammerVelocity();  // Must be called AFTER DetectHammerStrike().
 }
 
+// Change thresholds while running. Call between samples.
+void DspHammer::SetThresholds(float strike_threshold, float release_threshold,
+float min_repetition_seconds, float min_strike_velocity) {
+  strike_threshold_ = strike_threshold;
+  release_threshold_ = release_threshold;
+  min_repetition_seconds_ = min_repetition_seconds;
+  min_repetition_samples_ = static_cast<int>(min_repetition_seconds *
+  (float) samples_per_second_);
+  min_strike_velocity_ = min_strike_velocity;
+}
+
+// Change the sample period while running, so velocity stays in m/s.
+// Call between samples.
+void DspHammer::SetSamplePeriod(int sample_period) {
+  samples_per_second_ = static_cast<int>(1.0/(sample_period*1e-6));
+  min_repetition_samples_ = static_cast<int>(min_repetition_seconds_ *
+  (float) samples_per_second_);
+}
+
 // Convert hammer position into hammer velocity.
 // Derivative is inherently a high-pass filter which enhances noise.
 // Therefore, a boxcar average is convolved into the filter.
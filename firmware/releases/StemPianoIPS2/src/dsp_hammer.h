@@ -37,6 +37,8 @@ class DspHammer
     DspHammer();
     void Setup(int, int, float, float, float, float, float, int);
     void GetHammerEventData(bool *, float *, const float *);
+    void SetThresholds(float, float, float, float);
+    void SetSamplePeriod(int);
     void Enable(bool);
 
   private:
@@ -54,6 +56,7 @@ class DspHammer
     int samples_per_second_;
     float strike_threshold_;
     float release_threshold_;
+    float min_repetition_seconds_;
     int min_repetition_samples_;
     int repetition_counter_[NUM_CHANNELS];
     bool released_[NUM_CHANNELS];
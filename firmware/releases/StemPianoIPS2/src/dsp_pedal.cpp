@@ -23,117 +23,273 @@
 //
 // Pedal input processing
 //
+// Each pedal is described by a PedalDescriptor in the settings file:
+// the ADC pin, the jack connected pin, the MIDI control change number,
+// the polarity, the threshold, and the mode. All pedals run through
+// the same code, so adding a pedal is a settings change.
+//
 // Pedal (for polarity of the triple pedal I tested with):
 //   When connected:
 //     Pedal not pressed = small resistance, leading to a small ADC value.
 //     Pedal is pressed = large resistance, leading to a larger ADC value.
 //   When not connected:
 //     Pedal is open circuited, leading to a larger ADC value.
+//   A pedal with the opposite polarity sets inverted = true.
 // Connected signal:
 //     Pedal is connected - tied to ground.
 //     Pedal is not connected - tied to pedal signal.
 //
-// TODO - Does not handle the following pedal corner cases:
-//        1. Resetting max value if a different pedal is plugged in.
-//        2. Detecting that a pedal was removed.
-//        3. Different pedal polarities.
-// TODO - The names and MIDI functionality of everything is hardcoded
-//        to sustain, sostenuto, and una corda. What if someone wants
-//        a different pedal type with a different MIDI code?
-//        Since pedals are independent could refactor into a single class
-//        and iterate over for pedals of different types and positions.
-// TODO - Does not use the quarter inch jack connected inputs.
-// TODO - Compile time check that pin numbers do not exceed NUM_CHANNELS.
+// If a connected pin is set, it decides if the pedal is plugged in.
+// Unplugging a pedal releases it (sends 0 if it was on) and forgets the
+// learned travel, so a different pedal can be plugged in.
+// Without a connected pin, a pedal is declared connected the first
+// time it is below the initial threshold and is never disconnected.
+// An inverted pedal without a connected pin looks connected when
+// unplugged, so inverted pedals need a connected pin.
+//
+// Continuous (half-pedal) mode:
+//   Instead of only the threshold crossings, the pedal travel between
+//   the rest position and the learned maximum position is mapped to a
+//   MIDI value 0 to 127. A small dead band at each end makes a resting
+//   foot 0 and a full press 127. A new value is only reported if it
+//   changed by at least the hysteresis, or reached 0 or 127, and not
+//   faster than once per interval, so MIDI is not flooded.
+//   Until the first full press the maximum is unknown, so the pedal
+//   reports 0 or 127 at the threshold, the same as switch mode.
+//
+// The .ino code calls UpdatePedalState() from a scheduler task, at the
+// pedal sample interval, and ClearPedalChanges() in the other samples.
 
 #include "dsp_pedal.h"
 
+// Number of pedal samples the connected pin must hold a new
+// value before the pedal is plugged in or unplugged.
+#define PEDAL_CONNECT_SAMPLES 20
+
 // Public methods. ////////
 
 DspPedal::DspPedal() {}
 
 void DspPedal::Setup(int pedal_sample_interval_microseconds,
-float pedal_threshold, int sustain_pin, int sustain_connected_pin,
-int sostenuto_pin, int sostenuto_connected_pin, int una_corda_pin,
-int una_corda_connected_pin, int debug_level) {
+float pedal_threshold, const PedalDescriptor *pedals, int num_pedals,
+int debug_level) {
 
   debug_level_ = debug_level;
- 
-  Timing_.Setup(pedal_sample_interval_microseconds, debug_level);
+  pedal_sample_interval_microseconds_ = pedal_sample_interval_microseconds;
 
   // Want a small value, just enough to detect a pedal is connected.
   initial_threshold_ = 0.2;
-  
-  // Threshold when running.
-  pedal_threshold_ = pedal_threshold;
 
-  // To which ADC pin is the pedal signal connected?
-  // These pins are selected in the settings.cpp file
-  // associated with the board.
-  sustain_pin_ = sustain_pin;
-  sostenuto_pin_ = sostenuto_pin;
-  una_corda_pin_ = una_corda_pin;
-
-  // Not used yet.
-  sustain_connected_pin_ = sustain_connected_pin;
-  sostenuto_connected_pin_ = sostenuto_connected_pin;
-  una_corda_connected_pin_ = una_corda_connected_pin;
-
-  for (int ind = 0; ind < NUM_PEDALS; ind++) {
-    pedal_last_[ind] = 0.0;
-    connected_[ind] = false;
-    state_[ind] = State::no_change;
-    max_position_[ind] = 0.0;
-    max_position_valid_[ind] = false;
-    threshold_[ind] = initial_threshold_;
+  num_pedals_ = 0;
+  for (int ind = 0; ind < MAX_PEDALS; ind++) {
+    ResetPedal(ind);
   }
+  SetupContinuous(2, 10, 0.1);
+
+  SetPedalSettings(pedal_threshold, pedals, num_pedals);
   enable_ = true;
 }
 
-// Position measurement is [0.0 to 1.0], where 1.0 is maximum ADC value.
-void DspPedal::UpdatePedalState(const float *position) {
-
-  if (Timing_.AllowProcessing() == true) {
+// Global continuous mode parameters.
+// Which pedals are continuous is set by each pedal mode.
+void DspPedal::SetupContinuous(int hysteresis, int interval_millis,
+float deadband) {
+  continuous_hysteresis_ = hysteresis < 1 ? 1 : hysteresis;
+  // Counted in pedal samples, rounded up.
+  int interval_microseconds = 1000 * interval_millis;
+  int pedal_sample = pedal_sample_interval_microseconds_ > 0 ?
+  pedal_sample_interval_microseconds_ : 1;
+  continuous_interval_samples_ = (interval_microseconds + pedal_sample - 1) /
+  pedal_sample;
+  if (continuous_interval_samples_ < 0) continuous_interval_samples_ = 0;
+  if (deadband < 0.0) deadband = 0.0;
+  if (deadband > 0.4) deadband = 0.4;
+  continuous_deadband_ = deadband;
+}
 
-    state_[Ind::sustain] = ComputeState(position[sustain_pin_],
-    pedal_last_[Ind::sustain], threshold_[Ind::sustain]);
+// Change threshold and pedals while running. Call between samples.
+// A pedal that moved to a new pin must be detected and learned again.
+void DspPedal::SetPedalSettings(float pedal_threshold,
+const PedalDescriptor *pedals, int num_pedals) {
 
-    state_[Ind::sostenuto] = ComputeState(position[sostenuto_pin_],
-    pedal_last_[Ind::sostenuto], threshold_[Ind::sostenuto]);
+  pedal_threshold_ = pedal_threshold;
 
-    state_[Ind::una_corda] = ComputeState(position[una_corda_pin_],
-    pedal_last_[Ind::una_corda], threshold_[Ind::una_corda]);
+  if (num_pedals > MAX_PEDALS) num_pedals = MAX_PEDALS;
+  if (num_pedals < 0) num_pedals = 0;
 
-    pedal_last_[Ind::sustain] = position[sustain_pin_];
-    pedal_last_[Ind::sostenuto] = position[sostenuto_pin_];
-    pedal_last_[Ind::una_corda] = position[una_corda_pin_];
+  // Stop at the first pedal with an invalid pin.
+  for (int ind = 0; ind < num_pedals; ind++) {
+    if (pedals[ind].pin < 0 || pedals[ind].pin >= NUM_CHANNELS ||
+    pedals[ind].connected_pin >= NUM_CHANNELS) {
+      if (debug_level_ >= DEBUG_INFO) {
+        Serial.printf("DspPedal ERROR - pedal %d pin out of range.\n", ind);
+      }
+      num_pedals = ind;
+      break;
+    }
+  }
 
-    if (IsSustainConnected(position[sustain_pin_]) == false) {
-      state_[Ind::sustain] = State::no_change;
+  for (int ind = 0; ind < num_pedals; ind++) {
+    if (ind >= num_pedals_ ||
+    pedals[ind].pin != pedal_[ind].pin ||
+    pedals[ind].connected_pin != pedal_[ind].connected_pin ||
+    pedals[ind].inverted != pedal_[ind].inverted) {
+      ResetPedal(ind);
     }
-    if (IsSostenutoConnected(position[sostenuto_pin_]) == false) {
-      state_[Ind::sostenuto] = State::no_change;
+    pedal_[ind] = pedals[ind];
+  }
+  num_pedals_ = num_pedals;
+  UpdatePedalThresholds();
+}
+
+// Position measurement is [0.0 to 1.0], where 1.0 is maximum ADC value.
+// Call once per pedal sample.
+void DspPedal::UpdatePedalState(const float *position) {
+
+  for (int ind = 0; ind < num_pedals_; ind++) {
+
+    float pedal_position = position[pedal_[ind].pin];
+    if (pedal_[ind].inverted == true) {
+      pedal_position = 1.0 - pedal_position;
     }
-    if (IsUnaCordaConnected(position[una_corda_pin_]) == false) {
-      state_[Ind::una_corda] = State::no_change;
+
+    bool was_connected = connected_[ind];
+    if (IsConnected(ind, position, pedal_position) == false) {
+      if (was_connected == true) {
+        // Unplugged. Release the pedal if it was on.
+        bool was_on = pedal_last_[ind] > threshold_[ind] ||
+        continuous_value_[ind] > 0;
+        ResetPedal(ind);
+        if (was_on == true) {
+          state_[ind] = State::on_to_off;
+          continuous_change_[ind] = true;
+        }
+      }
+      else {
+        state_[ind] = State::no_change;
+        continuous_change_[ind] = false;
+      }
+      continue;
     }
 
-    DetectSustainFirstPress(position[sustain_pin_]);
-    DetectSostenutoFirstPress(position[sostenuto_pin_]);
-    DetectUnaCordaFirstPress(position[una_corda_pin_]);
-    UpdateSustainMaxValue(position[sustain_pin_]);
-    UpdateSostenutoMaxValue(position[sostenuto_pin_]);
-    UpdateUnaCordaMaxValue(position[una_corda_pin_]);
-    UpdatePedalThresholds();
+    state_[ind] = ComputeState(pedal_position, pedal_last_[ind],
+    threshold_[ind]);
+    pedal_last_[ind] = pedal_position;
 
+    DetectFirstPress(ind);
+    UpdateMaxValue(ind, pedal_position);
+    UpdateContinuous(ind, pedal_position);
   }
-  else {
-      // Want the state change to pulse otherwise will send
-      // repeated state change signals over MIDI.
-      state_[Ind::sustain] = State::no_change;
-      state_[Ind::sostenuto] = State::no_change;
-      state_[Ind::una_corda] = State::no_change;
+  UpdatePedalThresholds();
+
+}
+
+// Call in samples without a pedal sample.
+// Want the state change to pulse otherwise will send
+// repeated state change signals over MIDI.
+void DspPedal::ClearPedalChanges() {
+  for (int ind = 0; ind < num_pedals_; ind++) {
+    state_[ind] = State::no_change;
+    continuous_change_[ind] = false;
+  }
+}
+
+int DspPedal::NumPedals() {
+  return num_pedals_;
+}
+
+int DspPedal::GetMidiCC(int ind) {
+  return pedal_[ind].midi_cc;
+}
+
+bool DspPedal::GetCrossedDownThreshold(int ind) {
+  if (state_[ind] == State::off_to_on)
+    return true;
+  else
+    return false;
+}
+
+bool DspPedal::GetCrossedUpThreshold(int ind) {
+  if (state_[ind] == State::on_to_off)
+    return true;
+  else
+    return false;
+}
+
+// True while the pedal is pressed past its threshold, or while a
+// continuous pedal is sending a value above 0.
+bool DspPedal::GetPedalDown(int ind) {
+  return connected_[ind] == true &&
+  (pedal_last_[ind] > threshold_[ind] || continuous_value_[ind] > 0);
+}
+
+// Returns true if a new MIDI value should be sent for the pedal.
+bool DspPedal::GetMidiChange(int ind, int *value) {
+  if (pedal_[ind].mode == PEDAL_MODE_CONTINUOUS) {
+    *value = continuous_value_[ind];
+    return continuous_change_[ind];
+  }
+  else if (state_[ind] == State::off_to_on) {
+    *value = 127;
+    return true;
   }
+  else if (state_[ind] == State::on_to_off) {
+    *value = 0;
+    return true;
+  }
+  return false;
+}
 
+void DspPedal::Enable(bool enable) {
+  enable_ = enable;
+}
+
+// Private methods. ////////
+
+// Forget everything learned about a pedal.
+void DspPedal::ResetPedal(int ind) {
+  pedal_last_[ind] = 0.0;
+  connected_[ind] = false;
+  connected_count_[ind] = 0;
+  state_[ind] = State::no_change;
+  max_position_[ind] = 0.0;
+  max_position_valid_[ind] = false;
+  threshold_[ind] = initial_threshold_;
+  min_position_[ind] = 1.0;
+  continuous_value_[ind] = 0;
+  continuous_change_[ind] = false;
+  continuous_wait_[ind] = 0;
+}
+
+// Both unconnected and pedal being pressed down results in a large
+// ADC value. Therefore, need to detect if the pedal is connected
+// otherwise an unconnected pedal will result in the pedal active
+// being sent out MIDI. With a connected pin, use it. Otherwise,
+// declare the pedal connected the first time it is < threshold.
+bool DspPedal::IsConnected(int ind, const float *position,
+float pedal_position) {
+  if (pedal_[ind].connected_pin < 0) {
+    if (pedal_position < initial_threshold_) {
+      connected_[ind] = true;
+    }
+    return connected_[ind];
+  }
+  bool plugged_in = position[pedal_[ind].connected_pin] < initial_threshold_;
+  if (plugged_in != connected_[ind]) {
+    connected_count_[ind]++;
+    if (connected_count_[ind] >= PEDAL_CONNECT_SAMPLES) {
+      connected_[ind] = plugged_in;
+      connected_count_[ind] = 0;
+      if (debug_level_ >= DEBUG_INFO) {
+        Serial.printf("Pedal %d (CC %d) %s.\n", ind, pedal_[ind].midi_cc,
+        plugged_in == true ? "plugged in" : "unplugged");
+      }
+    }
+  }
+  else {
+    connected_count_[ind] = 0;
+  }
+  return connected_[ind];
 }
 
 int DspPedal::ComputeState(float position, float last_position, float threshold) {
@@ -153,13 +309,57 @@ int DspPedal::ComputeState(float position, float last_position, float threshold)
   return pedal_state_out;
 }
 
+// Map the pedal travel to 0 to 127 and decide if it is sent.
+void DspPedal::UpdateContinuous(int ind, float position) {
+
+  continuous_change_[ind] = false;
+  if (pedal_[ind].mode != PEDAL_MODE_CONTINUOUS) {
+    return;
+  }
+
+  if (position < min_position_[ind]) {
+    min_position_[ind] = position;
+  }
+
+  int value;
+  if (max_position_valid_[ind] == false) {
+    value = (position > threshold_[ind]) ? 127 : 0;
+  }
+  else {
+    float range = max_position_[ind] - min_position_[ind];
+    float travel = 0.0;
+    if (range > 0.0) {
+      travel = (position - min_position_[ind]) / range;
+    }
+    travel = (travel - continuous_deadband_) / (1.0 - 2.0*continuous_deadband_);
+    if (travel < 0.0) travel = 0.0;
+    if (travel > 1.0) travel = 1.0;
+    value = static_cast<int>(127.0 * travel + 0.5);
+  }
+
+  if (continuous_wait_[ind] > 0) {
+    continuous_wait_[ind]--;
+  }
+  int difference = abs(value - continuous_value_[ind]);
+  bool at_end = (value == 0 || value == 127);
+  if ((difference >= continuous_hysteresis_ || (at_end && difference > 0)) &&
+  continuous_wait_[ind] == 0) {
+    continuous_value_[ind] = value;
+    continuous_change_[ind] = true;
+    continuous_wait_[ind] = continuous_interval_samples_;
+  }
+}
+
 // Set the pedals up/down threshold based on the max
 // position as measured by the sensor. If the max position
 // has yet to be determined, then use the threshold directly.
+// A pedal threshold of 0.0 uses the common pedal threshold.
 void DspPedal::UpdatePedalThresholds() {
-  for (int ind = 0; ind < NUM_PEDALS; ind++) {
+  for (int ind = 0; ind < num_pedals_; ind++) {
     if (max_position_valid_[ind] == true) {
-      threshold_[ind] = max_position_[ind] * pedal_threshold_;
+      float fraction = pedal_[ind].threshold > 0.0 ?
+      pedal_[ind].threshold : pedal_threshold_;
+      threshold_[ind] = max_position_[ind] * fraction;
     }
     else {
       threshold_[ind] = initial_threshold_;
@@ -167,37 +367,15 @@ void DspPedal::UpdatePedalThresholds() {
   }
 }
 
-// Keep track of min and max hammer position.
+// Keep track of max pedal position.
 // However, when the pedal is disconnected, the max will be at ADC max.
 // Therefore, only check this after confirming a pedal is connected.
-void DspPedal::UpdateSustainMaxValue(float position) {
-  if (max_position_valid_[Ind::sustain] == true) {
-    if (position > max_position_[Ind::sustain]) {
-      max_position_[Ind::sustain] = position;
-      if (debug_level_ >= DEBUG_ALG) {
-        Serial.print("UpdateSustainMaxValue() new max = ");
-        Serial.println(position);
-      }
-    }
-  }
-}
-void DspPedal::UpdateSostenutoMaxValue(float position) {
-  if (max_position_valid_[Ind::sostenuto] == true) {
-    if (position > max_position_[Ind::sostenuto]) {
-      max_position_[Ind::sostenuto] = position;
+void DspPedal::UpdateMaxValue(int ind, float position) {
+  if (max_position_valid_[ind] == true) {
+    if (position > max_position_[ind]) {
+      max_position_[ind] = position;
       if (debug_level_ >= DEBUG_ALG) {
-        Serial.print("UpdateSostenutoMaxValue() new max = ");
-        Serial.println(position);
-      }
-    }
-  }
-}
-void DspPedal::UpdateUnaCordaMaxValue(float position) {
-  if (max_position_valid_[Ind::una_corda] == true) {
-    if (position > max_position_[Ind::una_corda]) {
-      max_position_[Ind::una_corda] = position;
-      if (debug_level_ >= DEBUG_ALG) {
-        Serial.print("UpdateUnaCordaMaxValue() new max = ");
+        Serial.printf("Pedal %d new max = ", ind);
         Serial.println(position);
       }
     }
@@ -206,80 +384,8 @@ void DspPedal::UpdateUnaCordaMaxValue(float position) {
 
 // Until a pedal is pressed once, the max positions will be incorrect.
 // Therefore, check and set a flag that the max positions are valid.
-void DspPedal::DetectSustainFirstPress(float position) {
-  if (GetSustainCrossedDownThreshold() && IsSustainConnected(position))
-    max_position_valid_[Ind::sustain] = true;
-}
-void DspPedal::DetectSostenutoFirstPress(float position) {
-  if (GetSostenutoCrossedDownThreshold() && IsSostenutoConnected(position))
-    max_position_valid_[Ind::sostenuto] = true;
-}
-void DspPedal::DetectUnaCordaFirstPress(float position) {
-  if (GetUnaCordaCrossedDownThreshold() && IsUnaCordaConnected(position))
-    max_position_valid_[Ind::una_corda] = true;
+// Only called for a connected pedal.
+void DspPedal::DetectFirstPress(int ind) {
+  if (GetCrossedDownThreshold(ind) == true)
+    max_position_valid_[ind] = true;
 }
-
-// Both unconnected and pedal being pressed down results in a large
-// ADC value. Therefore, need to detect if the pedal is connected
-// otherwise an unconnected pedal will result in sustain/sostenuto/unacorda
-// active being sent out MIDI. The solution is decalare the pedal connected
-// the first time it is < threshold.
-bool DspPedal::IsSustainConnected(float position) {
-  if (position < initial_threshold_) {
-    connected_[Ind::sustain] = true;
-  }
-  return connected_[Ind::sustain];
-}
-bool DspPedal::IsSostenutoConnected(float position) {
-  if (position < initial_threshold_) {
-    connected_[Ind::sostenuto] = true;
-  }
-  return connected_[Ind::sostenuto];
-}
-bool DspPedal::IsUnaCordaConnected(float position) {
-  if (position < initial_threshold_) {
-    connected_[Ind::una_corda] = true;
-  }
-  return connected_[Ind::una_corda];
-}
-
-bool DspPedal::GetSustainCrossedDownThreshold() {
-  if (state_[Ind::sustain] == State::off_to_on)
-    return true;
-  else
-    return false;
-}
-bool DspPedal::GetSustainCrossedUpThreshold() {
-  if (state_[Ind::sustain] == State::on_to_off)
-    return true;
-  else
-    return false;
-}
-bool DspPedal::GetSostenutoCrossedDownThreshold() {
-  if (state_[Ind::sostenuto] == State::off_to_on)
-    return true;
-  else
-    return false;
-}
-bool DspPedal::GetSostenutoCrossedUpThreshold() {
-  if (state_[Ind::sostenuto] == State::on_to_off)
-    return true;
-  else
-    return false;
-}
-bool DspPedal::GetUnaCordaCrossedDownThreshold() {
-  if (state_[Ind::una_corda] == State::off_to_on)
-    return true;
-  else
-    return false;
-}
-bool DspPedal::GetUnaCordaCrossedUpThreshold() {
-  if (state_[Ind::una_corda] == State::on_to_off)
-    return true;
-  else
-    return false;
-}
-
-void DspPedal::Enable(bool enable) {
-  enable_ = enable;
-}
\ No newline at end of file
@@ -27,23 +27,36 @@
 #define DSP_PEDAL_H_
 
 #include "stem_piano_ips2.h"
-#include "timing.h"
 
-// Use #define since sizes memory.
-#define NUM_PEDALS 3
+// Pedal modes.
+#define PEDAL_MODE_SWITCH 0      // Send 0 or 127 at the threshold.
+#define PEDAL_MODE_CONTINUOUS 1  // Send 0 to 127 following the pedal travel.
+
+// One entry per pedal input. Set in the settings file.
+struct PedalDescriptor {
+  int pin;            // ADC channel of the pedal signal.
+  int connected_pin;  // ADC channel of the jack connected signal, -1 if none.
+  int midi_cc;        // MIDI control change number.
+  bool inverted;      // True if pressing the pedal lowers the ADC value.
+  float threshold;    // Fraction of learned travel for on/off, 0.0 = default.
+  int mode;           // PEDAL_MODE_SWITCH or PEDAL_MODE_CONTINUOUS.
+};
 
 class DspPedal
 {
   public:
     DspPedal();
-    void Setup(int, float, int, int, int, int, int, int, int);
+    void Setup(int, float, const PedalDescriptor *, int, int);
     void UpdatePedalState(const float *);
-    bool GetSustainCrossedDownThreshold();
-    bool GetSustainCrossedUpThreshold();
-    bool GetSostenutoCrossedDownThreshold();
-    bool GetSostenutoCrossedUpThreshold();
-    bool GetUnaCordaCrossedDownThreshold();
-    bool GetUnaCordaCrossedUpThreshold();
+    void ClearPedalChanges();
+    void SetPedalSettings(float, const PedalDescriptor *, int);
+    void SetupContinuous(int, int, float);
+    int NumPedals();
+    int GetMidiCC(int);
+    bool GetCrossedDownThreshold(int);
+    bool GetCrossedUpThreshold(int);
+    bool GetPedalDown(int);
+    bool GetMidiChange(int, int *);
     void Enable(bool);
 
   private:
@@ -51,44 +64,39 @@ class DspPedal
     bool enable_;
     int debug_level_;
 
-    bool IsSustainConnected(float);
-    bool IsSostenutoConnected(float);
-    bool IsUnaCordaConnected(float);
+    void ResetPedal(int);
+    bool IsConnected(int, const float *, float);
     int ComputeState(float, float, float);
     void UpdatePedalThresholds();
-    void UpdateSustainMaxValue(float);
-    void UpdateSostenutoMaxValue(float);
-    void UpdateUnaCordaMaxValue(float);
-    void DetectSustainFirstPress(float);
-    void DetectSostenutoFirstPress(float);
-    void DetectUnaCordaFirstPress(float);
+    void UpdateMaxValue(int, float);
+    void DetectFirstPress(int);
+    void UpdateContinuous(int, float);
+
+    int pedal_sample_interval_microseconds_;
 
-    Timing Timing_;
+    int num_pedals_;
+    PedalDescriptor pedal_[MAX_PEDALS];
 
     float pedal_threshold_;
     float initial_threshold_;
-    float pedal_last_[NUM_PEDALS];
-    bool connected_[NUM_PEDALS];
-    int state_[NUM_PEDALS];
+    float pedal_last_[MAX_PEDALS];
+    bool connected_[MAX_PEDALS];
+    int connected_count_[MAX_PEDALS];
+    int state_[MAX_PEDALS];
 
     // For dynamically learning the pedal thresholds.
-    float max_position_[NUM_PEDALS];
-    bool max_position_valid_[NUM_PEDALS];
-    float threshold_[NUM_PEDALS];
-
-    int sustain_pin_;
-    int sostenuto_pin_;
-    int una_corda_pin_;
-
-    int sustain_connected_pin_;
-    int sostenuto_connected_pin_;
-    int una_corda_connected_pin_;
-
-    enum Ind {
-      sustain = 0,
-      sostenuto = 1,
-      una_corda = 2
-    };
+    float max_position_[MAX_PEDALS];
+    bool max_position_valid_[MAX_PEDALS];
+    float threshold_[MAX_PEDALS];
+
+    // Continuous (half-pedal) output.
+    float min_position_[MAX_PEDALS];
+    int continuous_value_[MAX_PEDALS];
+    bool continuous_change_[MAX_PEDALS];
+    int continuous_wait_[MAX_PEDALS];
+    int continuous_hysteresis_;
+    int continuous_interval_samples_;
+    float continuous_deadband_;
 
     enum State {
       no_change = 0,
@@ -98,4 +106,4 @@ class DspPedal
 
 };
 
-#endif
\ No newline at end of file
+#endif
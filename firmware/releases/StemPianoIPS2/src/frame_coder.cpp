@@ -0,0 +1,189 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// frame_coder.cpp
+//
+// This class is not hardware dependent.
+//
+// Lossless compression of raw ADC frames and events.
+// Used by the black box recorder and the SD card log.
+//
+// Frames are coded in blocks. Each block can be decoded without the
+// blocks before it. Bits are packed most significant first.
+//
+// Each frame in a block is:
+//   1 bit, set to 1.
+//   For the first frame of the block, 24 bits per channel.
+//   For other frames, per channel, the difference from the previous
+//   frame, mapped to 0, -1, 1, -2, ... -> 0, 1, 2, 3, ... and Rice
+//   coded. The Rice parameter k follows the mean of each channel
+//   and starts at 4 in each block. A quotient of FRAME_CODER_ESCAPE
+//   or more is sent as that many ones then FRAME_CODER_ESCAPE_BITS
+//   bits of the mapped value.
+//   1 bit for any events. If set then a 4-bit count, and per event
+//   a 7-bit key, 1 bit (1 = hammer), and 8 bits of velocity.
+// The block ends with 1 bit set to 0, then zeros to the next byte.
+//
+// The decoder is in software/releases/ips2_black_box.
+
+#include "frame_coder.h"
+
+FrameCoder::FrameCoder() {}
+
+void FrameCoder::Setup() {
+  bit_buffer_ = 0;
+  bit_count_ = 0;
+  frames_ = 0;
+  events_dropped_ = 0;
+  escapes_ = 0;
+}
+
+void FrameCoder::StartBlock() {
+  bit_buffer_ = 0;
+  bit_count_ = 0;
+  frames_ = 0;
+  // mean_ is 16 times the running mean, so k starts at 4.
+  for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+    mean_[channel] = 16 << 4;
+  }
+}
+
+// Code one frame. Writes the completed bytes to out and returns
+// how many, at most FRAME_CODER_MAX_BYTES.
+int FrameCoder::AddFrame(const unsigned int *adc_values,
+const bool *hammer_event, const float *hammer_velocity,
+const bool *damper_event, uint8_t *out) {
+
+  out_ = out;
+  out_bytes_ = 0;
+
+  PutBits(1, 1);
+
+  uint32_t value;
+  if (frames_ == 0) {
+    for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+      value = adc_values[channel] & 0xFFFFFF;
+      PutBits(value, 24);
+      previous_[channel] = value;
+    }
+  }
+  else {
+    int32_t difference;
+    uint32_t mapped, mean;
+    int k;
+    for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+      value = adc_values[channel] & 0xFFFFFF;
+      difference = static_cast<int32_t>(value) -
+      static_cast<int32_t>(previous_[channel]);
+      previous_[channel] = value;
+      mapped = difference >= 0 ? 2 * difference : -2 * difference - 1;
+      mean = mean_[channel] >> 4;
+      k = mean > 0 ? 31 - __builtin_clz(mean) : 0;
+      PutRice(mapped, k);
+      mean_[channel] += mapped - (mean_[channel] >> 4);
+    }
+  }
+
+  int num_events = 0;
+  for (int key = 0; key < NUM_CHANNELS; key++) {
+    if (hammer_event[key] == true) num_events++;
+    if (damper_event[key] == true) num_events++;
+  }
+  if (num_events == 0) {
+    PutBits(0, 1);
+  }
+  else {
+    if (num_events > FRAME_CODER_MAX_EVENTS) {
+      events_dropped_ += num_events - FRAME_CODER_MAX_EVENTS;
+      num_events = FRAME_CODER_MAX_EVENTS;
+    }
+    PutBits(1, 1);
+    PutBits(num_events, 4);
+    int velocity;
+    for (int key = 0; key < NUM_CHANNELS && num_events > 0; key++) {
+      if (hammer_event[key] == true) {
+        velocity = static_cast<int>(fabsf(hammer_velocity[key]) * 255.0 + 0.5);
+        PutBits(key, 7);
+        PutBits(1, 1);
+        PutBits(velocity > 255 ? 255 : velocity, 8);
+        num_events--;
+      }
+      if (damper_event[key] == true && num_events > 0) {
+        PutBits(key, 7);
+        PutBits(0, 1);
+        PutBits(0, 8);
+        num_events--;
+      }
+    }
+  }
+
+  frames_++;
+  return out_bytes_;
+}
+
+// Mark the end of the block and pad the last byte.
+int FrameCoder::EndBlock(uint8_t *out) {
+  out_ = out;
+  out_bytes_ = 0;
+  PutBits(0, 1);
+  if (bit_count_ > 0) {
+    PutBits(0, 8 - bit_count_);
+  }
+  return out_bytes_;
+}
+
+// Frames in the present block.
+int FrameCoder::Frames() {
+  return frames_;
+}
+
+uint32_t FrameCoder::EventsDropped() {
+  return events_dropped_;
+}
+
+uint32_t FrameCoder::Escapes() {
+  return escapes_;
+}
+
+// Private methods. ////////
+
+void FrameCoder::PutBits(uint32_t value, int num_bits) {
+  bit_buffer_ = (bit_buffer_ << num_bits) | (value & ((1UL << num_bits) - 1));
+  bit_count_ += num_bits;
+  while (bit_count_ >= 8) {
+    bit_count_ -= 8;
+    out_[out_bytes_++] = (bit_buffer_ >> bit_count_) & 0xFF;
+  }
+}
+
+// Quotient in unary as ones then a zero, then k remainder bits.
+void FrameCoder::PutRice(uint32_t value, int k) {
+  uint32_t quotient = value >> k;
+  if (quotient < FRAME_CODER_ESCAPE) {
+    PutBits(((1UL << quotient) - 1) << 1, quotient + 1);
+    if (k > 0) {
+      PutBits(value, k);
+    }
+  }
+  else {
+    PutBits((1UL << FRAME_CODER_ESCAPE) - 1, FRAME_CODER_ESCAPE);
+    PutBits(value, FRAME_CODER_ESCAPE_BITS);
+    escapes_++;
+  }
+}
@@ -0,0 +1,78 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// frame_coder.h
+//
+// This class is not hardware dependent.
+//
+// Lossless compression of raw ADC frames and events.
+
+#ifndef FRAME_CODER_H_
+#define FRAME_CODER_H_
+
+#include "stem_piano_ips2.h"
+
+// A Rice code with this many leading ones is followed by the
+// value in FRAME_CODER_ESCAPE_BITS bits.
+#define FRAME_CODER_ESCAPE 16
+#define FRAME_CODER_ESCAPE_BITS 25
+
+// Events coded per frame. More are counted but not stored.
+#define FRAME_CODER_MAX_EVENTS 15
+
+// Most bytes written by one call to AddFrame() or EndBlock().
+#define FRAME_CODER_MAX_BYTES ((NUM_CHANNELS * \
+  (FRAME_CODER_ESCAPE + FRAME_CODER_ESCAPE_BITS) + 6 + \
+  FRAME_CODER_MAX_EVENTS * 16) / 8 + 2)
+
+class FrameCoder
+{
+  public:
+    FrameCoder();
+    void Setup();
+    void StartBlock();
+    int AddFrame(const unsigned int *, const bool *, const float *,
+    const bool *, uint8_t *);
+    int EndBlock(uint8_t *);
+    int Frames();
+    uint32_t EventsDropped();
+    uint32_t Escapes();
+
+  private:
+    void PutBits(uint32_t, int);
+    void PutRice(uint32_t, int);
+
+    // Output of the present call.
+    uint8_t *out_;
+    int out_bytes_;
+    uint64_t bit_buffer_;
+    int bit_count_;
+
+    int frames_;
+
+    // Per-channel state of the delta and Rice coders.
+    uint32_t previous_[NUM_CHANNELS];
+    uint32_t mean_[NUM_CHANNELS];
+
+    uint32_t events_dropped_;
+    uint32_t escapes_;
+
+};
+
+#endif
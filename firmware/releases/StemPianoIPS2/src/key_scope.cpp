@@ -0,0 +1,139 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// key_scope.cpp
+//
+// This class is not hardware dependent.
+//
+// Triggered capture of one key at the full sample rate.
+//
+// Add() runs every sample and copies the position of the selected key,
+// its change since the last sample as a velocity estimate, and its
+// hammer and damper events into a ring buffer. A hammer event is the
+// trigger. After the trigger, the capture continues until the buffer
+// holds KEY_SCOPE_PRETRIGGER samples from before the trigger and the
+// rest from after it. Then the capture is ready and stops until
+// Rearm(), so it can be read at any speed, for example by the TFT.
+
+#include "key_scope.h"
+
+KeyScope::KeyScope() {}
+
+void KeyScope::Setup(int debug_level) {
+  debug_level_ = debug_level;
+  strike_threshold_ = 0.0;
+  release_threshold_ = 0.0;
+  key_ = -1;
+  for (int sample = 0; sample < KEY_SCOPE_SAMPLES; sample++) {
+    position_[sample] = 0.0;
+    velocity_[sample] = 0.0;
+    events_[sample] = 0;
+  }
+  Rearm();
+}
+
+// Saved with each capture for drawing.
+void KeyScope::SetThresholds(float strike_threshold, float release_threshold) {
+  strike_threshold_ = strike_threshold;
+  release_threshold_ = release_threshold;
+}
+
+// Key from 0 to NUM_CHANNELS - 1, or -1 to stop capturing.
+void KeyScope::SelectKey(int key) {
+  if (key < -1 || key >= NUM_CHANNELS) {
+    key = -1;
+  }
+  key_ = key;
+  Rearm();
+  if (debug_level_ >= DEBUG_NOTES) {
+    Serial.printf("Key scope is on key %d.\n", key_);
+  }
+}
+
+int KeyScope::Key() {
+  return key_;
+}
+
+// Call every sample.
+void KeyScope::Add(const float *position, const bool *hammer_event,
+const float *hammer_velocity, const bool *damper_event) {
+  if (key_ < 0 || state_ == State::ready) {
+    return;
+  }
+  float p = position[key_];
+  position_[write_] = p;
+  velocity_[write_] = p - last_position_;
+  events_[write_] = (hammer_event[key_] == true ? KEY_SCOPE_HAMMER_EVENT : 0) |
+  (damper_event[key_] == true ? KEY_SCOPE_DAMPER_EVENT : 0);
+  last_position_ = p;
+  write_ = (write_ + 1) & (KEY_SCOPE_SAMPLES - 1);
+  if (state_ == State::armed) {
+    if (filled_ < KEY_SCOPE_PRETRIGGER) {
+      filled_++;
+    }
+    else if (hammer_event[key_] == true) {
+      trigger_velocity_ = hammer_velocity[key_];
+      remaining_ = KEY_SCOPE_SAMPLES - KEY_SCOPE_PRETRIGGER - 1;
+      state_ = State::triggered;
+    }
+  }
+  else if (remaining_ > 0) {
+    remaining_--;
+  }
+  if (state_ == State::triggered && remaining_ == 0) {
+    state_ = State::ready;
+  }
+}
+
+// True when a capture is ready to read.
+bool KeyScope::Ready() {
+  return state_ == State::ready;
+}
+
+// Start waiting for the next trigger.
+void KeyScope::Rearm() {
+  state_ = State::armed;
+  write_ = 0;
+  filled_ = 0;
+  remaining_ = 0;
+  last_position_ = 0.0;
+  trigger_velocity_ = 0.0;
+}
+
+// Sample from 0 to KEY_SCOPE_SAMPLES - 1, oldest first. The trigger is
+// sample KEY_SCOPE_PRETRIGGER. Velocity is the change per sample.
+void KeyScope::Get(int sample, float *position, float *velocity, int *events) {
+  int index = (write_ + sample) & (KEY_SCOPE_SAMPLES - 1);
+  *position = position_[index];
+  *velocity = velocity_[index];
+  *events = events_[index];
+}
+
+// Hammer velocity of the trigger event.
+float KeyScope::TriggerVelocity() {
+  return trigger_velocity_;
+}
+
+float KeyScope::StrikeThreshold() {
+  return strike_threshold_;
+}
+
+float KeyScope::ReleaseThreshold() {
+  return release_threshold_;
+}
@@ -0,0 +1,84 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// key_scope.h
+//
+// This class is not hardware dependent.
+//
+// Triggered capture of one key at the full sample rate.
+
+#ifndef KEY_SCOPE_H_
+#define KEY_SCOPE_H_
+
+#include "stem_piano_ips2.h"
+
+// Samples in a capture. Must be a power of 2.
+#define KEY_SCOPE_SAMPLES 256
+
+// Samples in a capture from before the trigger.
+#define KEY_SCOPE_PRETRIGGER 64
+
+// Bits of the events value.
+#define KEY_SCOPE_HAMMER_EVENT 1
+#define KEY_SCOPE_DAMPER_EVENT 2
+
+class KeyScope
+{
+  public:
+    KeyScope();
+    void Setup(int);
+    void SetThresholds(float, float);
+    void SelectKey(int);
+    int Key();
+    void Add(const float *, const bool *, const float *, const bool *);
+    bool Ready();
+    void Rearm();
+    void Get(int, float *, float *, int *);
+    float TriggerVelocity();
+    float StrikeThreshold();
+    float ReleaseThreshold();
+
+  private:
+
+    int debug_level_;
+
+    int key_;
+    float strike_threshold_;
+    float release_threshold_;
+
+    enum State {
+      armed = 0,
+      triggered = 1,
+      ready = 2
+    };
+    int state_;
+
+    // Ring buffer of the selected key.
+    float position_[KEY_SCOPE_SAMPLES];
+    float velocity_[KEY_SCOPE_SAMPLES];
+    uint8_t events_[KEY_SCOPE_SAMPLES];
+    int write_;
+    int filled_;
+    int remaining_;
+    float last_position_;
+    float trigger_velocity_;
+
+};
+
+#endif
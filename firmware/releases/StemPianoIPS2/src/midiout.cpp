@@ -23,22 +23,73 @@
 //
 // Output data over MIDI
 //
-// TODO - Easily support other pedal functions.
+// All messages from one sample are collected, then SendFrame() sends
+// them in this order: note off, pedal up, other controllers, and
+// note on with the loudest first. At 31.25 kbaud each DIN byte takes
+// 320 microseconds, so for a large chord this puts the note offs and
+// the loudest notes on the wire first. With running status a chord
+// is 2 bytes per note instead of 3.
+//
+// DIN messages are only written when the UART buffer has space, so
+// the processing loop never waits. The rest are sent next sample.
+// USB MIDI is flushed once per sample with send_now().
+//
+// Note on velocity uses a velocity curve (see velocity_curve.cpp) with
+// 14-bit output. Optionally the lower 7 bits are sent as the MIDI high
+// resolution velocity prefix, CC88, immediately before the note on.
+// Receivers that do not support CC88 ignore it. On DIN this costs 3 more
+// bytes per note and breaks running status, so it is off by default.
+//
+// Pedals are sent as the control change number in each pedal descriptor.
+//
+// Polyphonic aftertouch (see damper_stream.cpp) is sent after everything
+// else in the sample. On DIN it is best effort: it is only queued if no
+// earlier messages are waiting, only written while the UART has little
+// waiting, and never deferred to the next sample, so it cannot delay a
+// later note.
 
 #include "midiout.h"
 #include "auto_mute.h"
 
 MidiOut::MidiOut() {}
 
+// Call after addMemoryForWrite(), so the UART buffer size is known.
 void MidiOut::Setup(int midi_channel, MY_MIDI_INTERFACE *MidiInstance,
-int maximum_midi_value, int debug_level) {
+HardwareSerial *uart, int maximum_midi_value, int debug_level) {
   debug_level_ = debug_level;
   midi_channel_ = midi_channel;
   mi_ = MidiInstance;
   midi_value_for_A0_ = 21;  // MIDI standard.
-  pedal_midi_value_ = 127;  // Send this when a threshold pedal is activated.
   maximum_midi_value_ = maximum_midi_value;
+  Rtp_ = nullptr;
+  uart_ = uart;
   mi_->begin();
+
+  // Linear and no CC88 until SetupVelocityCurve() is called.
+  Curve_.Setup(VELOCITY_CURVE_LINEAR, 1.0, nullptr, DEBUG_NONE);
+  send_high_resolution_velocity_ = false;
+
+  frame_count_ = 0;
+  din_count_ = 0;
+  din_capacity_bytes_ = uart_->availableForWrite();
+  din_running_status_ = 0;
+  max_queue_bytes_ = 0;
+  max_wire_delay_micros_ = 0;
+  max_chord_skew_micros_ = 0;
+  deferred_messages_ = 0;
+  dropped_messages_ = 0;
+  skipped_aftertouch_ = 0;
+}
+
+// Optional. Also send all MIDI over the network.
+void MidiOut::SetupRtpMidi(RtpMidi *Rtp) {
+  Rtp_ = Rtp;
+}
+
+void MidiOut::SetupVelocityCurve(int type, float exponent,
+const float *table, bool send_high_resolution_velocity) {
+  Curve_.Setup(type, exponent, table, debug_level_);
+  send_high_resolution_velocity_ = send_high_resolution_velocity;
 }
 
 void MidiOut::SendNoteOn(AutoMute *mute, const bool *event, const float *velocity) {
@@ -51,80 +102,145 @@ bool source) {
 }
 
 void MidiOut::SendPedal(DspPedal *DspP) {
-  if (DspP->GetSustainCrossedDownThreshold() == true) {
-    mi_->sendControlChange(64, pedal_midi_value_, midi_channel_);
-    #ifdef ENABLE_USB_MIDI
-    usbMIDI.sendControlChange(64, pedal_midi_value_, midi_channel_);
-    #endif
-    if (debug_level_ >= DEBUG_NOTES) {
-      Serial.println("MIDI sustain ON.");
+  int value;
+  for (int ind = 0; ind < DspP->NumPedals(); ind++) {
+    if (DspP->GetMidiChange(ind, &value) == true) {
+      SendControlChange(DspP->GetMidiCC(ind), value);
+      if (debug_level_ >= DEBUG_NOTES) {
+        Serial.printf("MIDI pedal CC %d = %d.\n", DspP->GetMidiCC(ind), value);
+      }
     }
   }
-  else if (DspP->GetSustainCrossedUpThreshold() == true) {
-    mi_->sendControlChange(64, 0, midi_channel_);
-    #ifdef ENABLE_USB_MIDI
-    usbMIDI.sendControlChange(64, 0, midi_channel_);
-    #endif
-    if (debug_level_ >= DEBUG_NOTES) {
-      Serial.println("MIDI sustain OFF.");
+}
+
+// Key index is 0 for A0.
+void MidiOut::SendPolyPressure(int key, int value) {
+  if (value < 0) value = 0;
+  if (value > 127) value = 127;
+  AddMessage(0xA0, key + midi_value_for_A0_, value, 0);
+}
+
+// Call once per sample after all notes and pedals.
+void MidiOut::SendFrame() {
+
+  SortFrame();
+
+  // USB and network have no meaningful wire delay.
+  for (int k = 0; k < frame_count_; k++) {
+    uint8_t status = frame_[k].status;
+    if (status == 0x90 && send_high_resolution_velocity_ == true) {
+      #ifdef ENABLE_USB_MIDI
+      usbMIDI.sendControlChange(88, frame_[k].lsb, midi_channel_);
+      #endif
+      if (Rtp_ != nullptr) {
+        Rtp_->ControlChange(88, frame_[k].lsb);
+      }
     }
-  }
-  if (DspP->GetSostenutoCrossedDownThreshold() == true) {
-    mi_->sendControlChange(66, pedal_midi_value_, midi_channel_);
     #ifdef ENABLE_USB_MIDI
-    usbMIDI.sendControlChange(66, pedal_midi_value_, midi_channel_);
+    if (status == 0x90)
+      usbMIDI.sendNoteOn(frame_[k].data1, frame_[k].data2, midi_channel_);
+    else if (status == 0x80)
+      usbMIDI.sendNoteOff(frame_[k].data1, frame_[k].data2, midi_channel_);
+    else if (status == 0xA0)
+      usbMIDI.sendAfterTouchPoly(frame_[k].data1, frame_[k].data2, midi_channel_);
+    else
+      usbMIDI.sendControlChange(frame_[k].data1, frame_[k].data2, midi_channel_);
     #endif
-    if (debug_level_ >= DEBUG_NOTES) {
-      Serial.println("MIDI sostenuto ON.");
+    if (Rtp_ != nullptr) {
+      if (status == 0x90)
+        Rtp_->NoteOn(frame_[k].data1, frame_[k].data2);
+      else if (status == 0x80)
+        Rtp_->NoteOff(frame_[k].data1, frame_[k].data2);
+      else if (status == 0xA0)
+        Rtp_->PolyPressure(frame_[k].data1, frame_[k].data2);
+      else
+        Rtp_->ControlChange(frame_[k].data1, frame_[k].data2);
     }
   }
-  else if (DspP->GetSostenutoCrossedUpThreshold() == true) {
-    mi_->sendControlChange(66, 0, midi_channel_);
-    #ifdef ENABLE_USB_MIDI
-    usbMIDI.sendControlChange(66, 0, midi_channel_);
-    #endif
-    if (debug_level_ >= DEBUG_NOTES) {
-      Serial.println("MIDI sostenuto OFF.");
-    }
+  #ifdef ENABLE_USB_MIDI
+  if (frame_count_ > 0) {
+    usbMIDI.send_now();
   }
-  if (DspP->GetUnaCordaCrossedDownThreshold() == true) {
-    mi_->sendControlChange(67, pedal_midi_value_, midi_channel_);
-    #ifdef ENABLE_USB_MIDI
-    usbMIDI.sendControlChange(67, pedal_midi_value_, midi_channel_);
-    #endif
-    if (debug_level_ >= DEBUG_NOTES) {
-      Serial.println("MIDI una corda ON.");
-    }
+  #endif
+  if (Rtp_ != nullptr) {
+    Rtp_->SendFrame();
   }
-  else if (DspP->GetUnaCordaCrossedUpThreshold() == true) {
-    mi_->sendControlChange(67, 0, midi_channel_);
-    #ifdef ENABLE_USB_MIDI
-    usbMIDI.sendControlChange(67, 0, midi_channel_);
-    #endif
-    if (debug_level_ >= DEBUG_NOTES) {
-      Serial.println("MIDI una corda OFF.");
+
+  // DIN messages wait behind any not yet sent from earlier samples.
+  // Aftertouch is dropped instead of waiting.
+  bool din_backlog = din_count_ > 0;
+  for (int k = 0; k < frame_count_; k++) {
+    if (frame_[k].status == 0xA0 && din_backlog == true) {
+      skipped_aftertouch_++;
     }
+    else if (din_count_ < MIDI_QUEUE_SIZE) {
+      din_[din_count_++] = frame_[k];
+    }
+    else {
+      dropped_messages_++;
+    }
+  }
+  frame_count_ = 0;
+  SendDin();
+}
+
+// DIN queue and wire timing since the last call.
+void MidiOut::PrintStatistics() {
+  if (debug_level_ >= DEBUG_STATS) {
+    Serial.printf("MIDI DIN: max queue = %d bytes, max wire delay = %d us, ",
+    max_queue_bytes_, max_wire_delay_micros_);
+    Serial.printf("max chord skew = %d us, deferred = %lu, dropped = %lu, ",
+    max_chord_skew_micros_, deferred_messages_, dropped_messages_);
+    Serial.printf("aftertouch skipped = %lu.\n", skipped_aftertouch_);
   }
+  max_queue_bytes_ = 0;
+  max_wire_delay_micros_ = 0;
+  max_chord_skew_micros_ = 0;
+  deferred_messages_ = 0;
+  dropped_messages_ = 0;
+  skipped_aftertouch_ = 0;
+}
+
+// Private methods. ////////
+
+void MidiOut::SendControlChange(int number, int value) {
+  AddMessage(0xB0, number, value, 0);
 }
 
 void MidiOut::SendNote(AutoMute *mute,
 const bool *event, const float *velocity, bool send_on, bool source) {
   int velocity_int;
+  int velocity_lsb;
   int midi_note;
   int velocity_potentially_muted;
   for (int key = 0; key < NUM_NOTES; key++) {
     if (event[key] == true) {
       midi_note = key + midi_value_for_A0_;
-      velocity_int = static_cast<int>(128.0 * velocity[key]);
-      if (velocity_int < 0) {
-        velocity_int = -velocity_int;
+      if (send_on == true) {
+        // 14-bit velocity. Note on velocity must be at least 1.
+        int velocity_14bit = Curve_.Lookup(velocity[key]);
+        if (velocity_14bit < 128) {
+          velocity_14bit = 128;
+        }
+        if (velocity_14bit > ((maximum_midi_value_ << 7) | 0x7F)) {
+          velocity_14bit = (maximum_midi_value_ << 7) | 0x7F;
+        }
+        velocity_int = velocity_14bit >> 7;
+        velocity_lsb = velocity_14bit & 0x7F;
       }
-      if (velocity_int > maximum_midi_value_) {
-        velocity_int = maximum_midi_value_;
+      else {
+        velocity_int = static_cast<int>(128.0 * velocity[key]);
+        if (velocity_int < 0) {
+          velocity_int = -velocity_int;
+        }
+        if (velocity_int > maximum_midi_value_) {
+          velocity_int = maximum_midi_value_;
+        }
+        velocity_lsb = 0;
       }
       if (debug_level_ >= DEBUG_NOTES) {
-        Serial.printf("MIDI note (%2d) index(%2d) velocity(%2d)",
-        midi_note, key, velocity_int);
+        Serial.printf("MIDI note (%2d) index(%2d) velocity(%2d.%03d)",
+        midi_note, key, velocity_int, (1000 * velocity_lsb) >> 7);
         if (send_on == true) {
           Serial.println(" ON.");
         }
@@ -141,23 +257,136 @@ const bool *event, const float *velocity, bool send_on, bool source) {
       if (send_on == true) {
         velocity_potentially_muted = 
         mute->AutomaticallyDecreaseVolume(velocity_int, debug_level_);
+        if (velocity_potentially_muted != velocity_int) {
+          velocity_lsb = 0;
+        }
       }
       else {
         // Do not mute for the note off (damper) velocity.
         velocity_potentially_muted = velocity_int;
       }
       if (send_on == true) {
-        mi_->sendNoteOn(midi_note, velocity_potentially_muted, midi_channel_);
-        #ifdef ENABLE_USB_MIDI
-	      usbMIDI.sendNoteOn(midi_note, velocity_potentially_muted, midi_channel_);
-        #endif
+        AddMessage(0x90, midi_note, velocity_potentially_muted, velocity_lsb);
       }
       else {
-        mi_->sendNoteOff(midi_note, velocity_potentially_muted, midi_channel_);
-        #ifdef ENABLE_USB_MIDI
-	      usbMIDI.sendNoteOff(midi_note, velocity_potentially_muted, midi_channel_);
-        #endif
+        AddMessage(0x80, midi_note, velocity_potentially_muted, 0);
       }
     }
   }
 }
+
+// Priority 0 is sent first.
+void MidiOut::AddMessage(uint8_t status, uint8_t data1, uint8_t data2,
+uint8_t lsb) {
+  if (frame_count_ >= MIDI_QUEUE_SIZE) {
+    dropped_messages_++;
+    return;
+  }
+  uint8_t priority;
+  if (status == 0x80)
+    priority = 0;
+  else if (status == 0xB0 && data2 == 0)
+    priority = 1;
+  else if (status == 0xB0)
+    priority = 2;
+  else if (status == 0x90)
+    priority = 3;
+  else
+    priority = 4;
+  frame_[frame_count_++] = {status, data1, data2, lsb, priority};
+}
+
+// Insertion sort, because there are usually only a few messages.
+// Stable, so equal messages stay in key order.
+void MidiOut::SortFrame() {
+  for (int k = 1; k < frame_count_; k++) {
+    Message message = frame_[k];
+    int j = k - 1;
+    while (j >= 0 && (frame_[j].priority > message.priority ||
+    (frame_[j].priority == 3 && message.priority == 3 &&
+    ((frame_[j].data2 << 7) | frame_[j].lsb) <
+    ((message.data2 << 7) | message.lsb)))) {
+      frame_[j + 1] = frame_[j];
+      j--;
+    }
+    frame_[j + 1] = message;
+  }
+}
+
+// Write DIN messages while the UART buffer has space.
+void MidiOut::SendDin() {
+
+  int queue_bytes = din_capacity_bytes_ - uart_->availableForWrite();
+  int first_delay = -1;
+  int delay = 0;
+  int sent = 0;
+
+  while (sent < din_count_) {
+    Message *message = &din_[sent];
+    int bytes = DinBytes(message);
+    if (uart_->availableForWrite() < bytes) {
+      break;
+    }
+    if (message->status == 0xA0 &&
+    queue_bytes + bytes > MIDI_DIN_AFTERTOUCH_BYTES) {
+      skipped_aftertouch_++;
+      sent++;
+      continue;
+    }
+    if (message->status == 0x90 && send_high_resolution_velocity_ == true) {
+      mi_->sendControlChange(88, message->lsb, midi_channel_);
+    }
+    if (message->status == 0x90)
+      mi_->sendNoteOn(message->data1, message->data2, midi_channel_);
+    else if (message->status == 0x80)
+      mi_->sendNoteOff(message->data1, message->data2, midi_channel_);
+    else if (message->status == 0xA0)
+      mi_->sendAfterTouch(message->data1, message->data2, midi_channel_);
+    else
+      mi_->sendControlChange(message->data1, message->data2, midi_channel_);
+    din_running_status_ = message->status;
+
+    // Time until the last byte of this message is on the wire.
+    queue_bytes += bytes;
+    delay = 320 * queue_bytes;
+    if (first_delay < 0) {
+      first_delay = delay;
+    }
+    sent++;
+  }
+
+  if (sent > 0) {
+    if (queue_bytes > max_queue_bytes_)
+      max_queue_bytes_ = queue_bytes;
+    if (delay > max_wire_delay_micros_)
+      max_wire_delay_micros_ = delay;
+    if (delay - first_delay > max_chord_skew_micros_)
+      max_chord_skew_micros_ = delay - first_delay;
+  }
+
+  // Keep unsent messages, in order, for the next sample.
+  // Unsent aftertouch is dropped.
+  int kept = 0;
+  for (int k = sent; k < din_count_; k++) {
+    if (din_[k].status == 0xA0) {
+      skipped_aftertouch_++;
+    }
+    else {
+      din_[kept++] = din_[k];
+    }
+  }
+  deferred_messages_ += kept;
+  din_count_ = kept;
+}
+
+// Bytes on the wire, with running status.
+int MidiOut::DinBytes(const Message *message) {
+  uint8_t running_status = din_running_status_;
+  int bytes = 0;
+  if (message->status == 0x90 && send_high_resolution_velocity_ == true) {
+    bytes += (running_status == 0xB0) ? 2 : 3;
+    running_status = 0xB0;
+  }
+  bytes += (message->status == running_status) ? 2 : 3;
+  return bytes;
+}
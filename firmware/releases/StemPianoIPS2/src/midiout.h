@@ -31,9 +31,23 @@
 #include <MIDI.h>
 #include "auto_mute.h"
 #include "dsp_pedal.h"
+#include "rtp_midi.h"
+#include "velocity_curve.h"
+
+// Running status drops repeated status bytes on the DIN output.
+struct MidiOutSettings : public MIDI_NAMESPACE::DefaultSettings {
+  static const bool UseRunningStatus = true;
+};
 
 #define MY_SERIAL_MIDI MIDI_NAMESPACE::SerialMIDI<HardwareSerial>
-#define MY_MIDI_INTERFACE MIDI_NAMESPACE::MidiInterface<MY_SERIAL_MIDI>
+#define MY_MIDI_INTERFACE MIDI_NAMESPACE::MidiInterface<MY_SERIAL_MIDI, MidiOutSettings>
+
+// Maximum number of MIDI messages waiting to be sent.
+#define MIDI_QUEUE_SIZE 256
+
+// Aftertouch is only written to DIN if no more than this many bytes
+// would be waiting in the UART, about 3 milliseconds of wire time.
+#define MIDI_DIN_AFTERTOUCH_BYTES 9
 
 #define ENABLE_USB_MIDI
 
@@ -41,24 +55,61 @@ class MidiOut
 {
   public:
     MidiOut();
-    void Setup(int, MY_MIDI_INTERFACE *, int, int);
+    void Setup(int, MY_MIDI_INTERFACE *, HardwareSerial *, int, int);
+    void SetupRtpMidi(RtpMidi *);
+    void SetupVelocityCurve(int, float, const float *, bool);
     void SendNoteOn(AutoMute *, const bool *, const float *);
     void SendNoteOff(AutoMute *, const bool *, const float *, bool);
     void SendPedal(DspPedal *);
+    void SendPolyPressure(int, int);
+    void SendFrame();
+    void PrintStatistics();
 
   private:
+    struct Message {
+      uint8_t status;
+      uint8_t data1;
+      uint8_t data2;
+      uint8_t lsb;  // High resolution velocity, for note on.
+      uint8_t priority;
+    };
+
     int debug_level_;
     int midi_channel_;
     int midi_value_for_A0_;
     MY_MIDI_INTERFACE *mi_;
+    HardwareSerial *uart_;
+    RtpMidi *Rtp_;
+    void SendControlChange(int, int);
     void SendNote(AutoMute *, const bool *, const float *, bool, bool);
+    void AddMessage(uint8_t, uint8_t, uint8_t, uint8_t);
+    int DinBytes(const Message *);
+    void SortFrame();
+    void SendDin();
+
+    // Messages from this sample, and messages waiting for the DIN UART.
+    Message frame_[MIDI_QUEUE_SIZE];
+    int frame_count_;
+    Message din_[MIDI_QUEUE_SIZE];
+    int din_count_;
+
+    // DIN wire timing.
+    int din_capacity_bytes_;
+    uint8_t din_running_status_;
+    int max_queue_bytes_;
+    int max_wire_delay_micros_;
+    int max_chord_skew_micros_;
+    unsigned long deferred_messages_;
+    unsigned long dropped_messages_;
+    unsigned long skipped_aftertouch_;
 
     // Some receiving software treats 127 special.
     // So, option for a smaller max value.
     int maximum_midi_value_;
 
-    // What to send when a threshold pedal is activated.
-    int pedal_midi_value_;
+    // Note on velocity.
+    VelocityCurve Curve_;
+    bool send_high_resolution_velocity_;
 
 };
 
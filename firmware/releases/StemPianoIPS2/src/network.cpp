@@ -32,6 +32,18 @@
 // - Setup a TCP server on another computer, set it to begin listening for a client connection.
 // - If not require_tcp_connection, switch the Ethernet DIP off then on.
 // - If require_tcp_connection, it will continuously try to connect (Ethernet DIP must also be on). Piano won't be playable unless Ethernet data is streaming.
+//
+// Call UpdateNetworkState() once per sample, before any Send function.
+//
+// How to share one UDP stream among several programs:
+// - Set a multicast group address, for example 239.1.2.3, with SetupDestinations().
+// - Each receiving program joins the group, including the one on computer_ip.
+//   The Teensy sends each packet once, so adding receivers adds no load on
+//   the Teensy. With multicast, the stream is not also sent to computer_ip.
+// - Extra unicast destinations are also supported. They are in addition to
+//   computer_ip or the group, and each costs one more packet per sample.
+// - Command replies are not streamed. They go only to whoever sent the command,
+//   at the port it was sent from.
 
 #include "network.h"
 
@@ -62,6 +74,16 @@ void Network::Setup(bool true_for_tcp_else_udp, const char *computer_ip,
 
   GetMacAddress();
   SetIpAddresses(computer_ip, teensy_ip, port);
+
+  // Only computer_ip until SetupDestinations() is called.
+  multicast_enable_ = false;
+  multicast_joined_ = false;
+  num_destinations_ = 0;
+  for (int k = 0; k < 4; k++) {
+    reply_ip_[k] = computer_ip_[k];
+  }
+  reply_port_ = port;
+
   SetupNetwork(false, switch_enable_ethernet, false);
 
   for (int ind = 0; ind < NUM_CHANNELS; ind++) {
@@ -69,6 +91,11 @@ void Network::Setup(bool true_for_tcp_else_udp, const char *computer_ip,
     send_ind_[ind] = ind;
   }
 
+  // No raw streaming until SetupRawStream() is called.
+  raw_num_channels_ = 0;
+  raw_decimation_ = 1;
+  raw_decimation_counter_ = 0;
+
   // Send A0 damper data as Ethernet channel 1.
   true_for_hammer_else_damper_[1] = false;
   send_ind_[1] = 0;
@@ -78,13 +105,6 @@ void Network::Setup(bool true_for_tcp_else_udp, const char *computer_ip,
 void Network::SendPianoPacket(const float *hammer_in, const float *damper_in,
   bool switch_enable_ethernet, bool switch_require_tcp_connection, int test_index) {
 
-  SetupNetwork(switch_require_tcp_connection,
-    switch_enable_ethernet, switch_enable_ethernet_last_);
-  if (true_for_tcp_else_udp_ == true) {
-    EndNetwork(switch_enable_ethernet, switch_enable_ethernet_last_);
-  }
-  switch_enable_ethernet_last_ = switch_enable_ethernet;
-
   if (switch_enable_ethernet == true) {
 
     if (send_data_ok_ == true) {
@@ -113,56 +133,280 @@ void Network::SendPianoPacket(const float *hammer_in, const float *damper_in,
         ethernet_values_[2*ind+1] = (data_int>>8)&255;
       }
 
-      // Setup for UDP each time.
-      if (true_for_tcp_else_udp_ == false) {
-        IPAddress ip(computer_ip_[0], computer_ip_[1], computer_ip_[2], computer_ip_[3]);
-        Udp.beginPacket(ip, port_);
+      if (test_index < 0) {  // Normal case.
+        WritePacket(ethernet_values_, sizeof(ethernet_values_), true);
+      }
+      else {
+        WritePacket(ethernet_values_, 2, true);
       }
+    }
+  }
 
-      if (true_for_tcp_else_udp_ == true) {
+}
 
-        // Send via TCP, as client.
-        if (Client.connected()) {
-          unsigned int available_space = Client.availableForWrite();
-          if (available_space >= sizeof(ethernet_values_)) {
-            unsigned int now = micros();
-            if (test_index < 0) {  // Normal case.
-              Client.write(ethernet_values_, sizeof(ethernet_values_));
-            }
-            else {
-              Client.write(ethernet_values_, 2);
-            }
-            #ifdef QNETHERNET
-            Client.flush();
-            #endif
-            if (debug_level_ >= DEBUG_INFO) {
-              if (micros() - now > 20) {
-                Serial.printf("Client.write = %d microseconds.\n", micros() - now);
-                Serial.printf("%d \n",available_space);
-              }
-            }
-          }
-        }
+// UDP only. Send data streams to a multicast group and to a list of
+// extra unicast destinations. An empty multicast_ip is no multicast.
+// extra_ips is a comma separated list, for example
+// "192.168.1.20,192.168.1.21". An empty list is no extra destinations.
+// Extra destinations are in addition to computer_ip. With multicast,
+// data streams are no longer sent to computer_ip, it joins the group.
+void Network::SetupDestinations(const char *multicast_ip, const char *extra_ips) {
+
+  if (true_for_tcp_else_udp_ == true) {
+    if (debug_level_ >= DEBUG_INFO &&
+    (multicast_ip[0] != '\0' || extra_ips[0] != '\0')) {
+      Serial.println("Multicast and extra destinations require UDP.");
+    }
+    return;
+  }
+
+  multicast_enable_ = false;
+  if (sscanf(multicast_ip, "%d.%d.%d.%d", multicast_ip_, multicast_ip_ + 1,
+  multicast_ip_ + 2, multicast_ip_ + 3) == 4) {
+    // Multicast addresses are 224.0.0.0 to 239.255.255.255.
+    if (multicast_ip_[0] >= 224 && multicast_ip_[0] <= 239) {
+      multicast_enable_ = true;
+    }
+    else if (debug_level_ >= DEBUG_INFO) {
+      Serial.printf("Error - %s is not a multicast address.\n", multicast_ip);
+    }
+  }
+
+  num_destinations_ = 0;
+  const char *ptr = extra_ips;
+  while (ptr != nullptr && *ptr != '\0' &&
+  num_destinations_ < NETWORK_MAX_DESTINATIONS) {
+    int *ip = destination_ip_[num_destinations_];
+    if (sscanf(ptr, "%d.%d.%d.%d", ip, ip + 1, ip + 2, ip + 3) == 4) {
+      num_destinations_++;
+    }
+    ptr = strchr(ptr, ',');
+    if (ptr != nullptr) {
+      ptr++;
+    }
+  }
+
+  if (multicast_enable_ == true && network_has_been_initialized_ == true &&
+  send_data_ok_ == true) {
+    JoinMulticastGroup();
+  }
+
+  if (debug_level_ >= DEBUG_INFO) {
+    if (multicast_enable_ == true) {
+      Serial.printf("  Data is sent to multicast group %d.%d.%d.%d:%d\n",
+      multicast_ip_[0], multicast_ip_[1], multicast_ip_[2], multicast_ip_[3],
+      port_);
+    }
+    else {
+      Serial.printf("  Data is sent to %d.%d.%d.%d:%d\n",
+      computer_ip_[0], computer_ip_[1], computer_ip_[2], computer_ip_[3],
+      port_);
+    }
+    for (int k = 0; k < num_destinations_; k++) {
+      Serial.printf("  Data is sent to %d.%d.%d.%d:%d\n",
+      destination_ip_[k][0], destination_ip_[k][1], destination_ip_[k][2],
+      destination_ip_[k][3], port_);
+    }
+  }
+}
+
+// Select which channels are sent by SendRawPacket().
+// Channels are sent in increasing index order. With a decimation
+// of N, every Nth call to SendRawPacket() sends a packet.
+void Network::SetupRawStream(const bool *raw_stream_channel,
+  int raw_stream_decimation) {
+
+  raw_num_channels_ = 0;
+  for (int ind = 0; ind < NUM_CHANNELS; ind++) {
+    if (raw_stream_channel[ind] == true) {
+      raw_send_ind_[raw_num_channels_++] = ind;
+    }
+  }
+
+  if (raw_stream_decimation < 1) {
+    raw_stream_decimation = 1;
+  }
+  raw_decimation_ = raw_stream_decimation;
+  raw_decimation_counter_ = 0;
+
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.printf("Raw ADC streaming of %d channels, ", raw_num_channels_);
+    Serial.printf("%d bytes per packet, decimation = %d.\n",
+    3*raw_num_channels_, raw_decimation_);
+  }
+}
 
+// Send raw ADC counts, without normalization or calibration.
+// Each count is sent as 3 bytes, least significant byte first.
+// This holds the full 18-bit ADC value. There is no header,
+// so the receiver must know the channel list and the order.
+void Network::SendRawPacket(const unsigned int *adc_in,
+  bool switch_enable_ethernet, bool switch_require_tcp_connection) {
+
+  if (switch_enable_ethernet == true && send_data_ok_ == true &&
+  raw_num_channels_ > 0) {
+
+    raw_decimation_counter_++;
+    if (raw_decimation_counter_ >= raw_decimation_) {
+      raw_decimation_counter_ = 0;
+
+      unsigned int data;
+      for (int ind = 0; ind < raw_num_channels_; ind++) {
+        data = adc_in[raw_send_ind_[ind]];
+        raw_values_[3*ind+0] = data&255;
+        raw_values_[3*ind+1] = (data>>8)&255;
+        raw_values_[3*ind+2] = (data>>16)&255;
       }
-      // Send via UDP.
-      else {
-        if (test_index < 0) {  // Normal case.
-          Udp.write(ethernet_values_, sizeof(ethernet_values_));
+
+      WritePacket(raw_values_, 3*raw_num_channels_, true);
+    }
+  }
+
+}
+
+// Send an already formatted packet as part of a data stream.
+void Network::SendBytes(const uint8_t *data, unsigned int length,
+  bool switch_enable_ethernet, bool switch_require_tcp_connection) {
+
+  if (switch_enable_ethernet == true && send_data_ok_ == true) {
+    WritePacket(data, length, true);
+  }
+
+}
+
+// Send an already formatted packet to whoever sent the last command.
+void Network::SendReplyBytes(const uint8_t *data, unsigned int length,
+  bool switch_enable_ethernet, bool switch_require_tcp_connection) {
+
+  if (switch_enable_ethernet == true && send_data_ok_ == true) {
+    WritePacket(data, length, false);
+  }
+
+}
+
+// Non-blocking read of bytes sent by the computer.
+// For UDP, one packet is read per call and a packet always ends a line.
+// Returns the number of bytes placed in data.
+int Network::ReadBytes(uint8_t *data, int max_length) {
+  int length = 0;
+  if (send_data_ok_ == true && max_length > 1) {
+    if (true_for_tcp_else_udp_ == true) {
+      if (Client.connected()) {
+        while (Client.available() > 0 && length < max_length) {
+          data[length++] = Client.read();
         }
-        else {
-          Udp.write(ethernet_values_, 2);
+      }
+    }
+    else if (Udp.parsePacket() > 0) {
+      length = Udp.read(data, max_length - 1);
+      if (length < 0) {
+        length = 0;
+      }
+      if (length > 0 && data[length - 1] != '\n') {
+        data[length++] = '\n';
+      }
+      if (length > 0) {
+        IPAddress remote = Udp.remoteIP();
+        for (int k = 0; k < 4; k++) {
+          reply_ip_[k] = remote[k];
         }
+        reply_port_ = Udp.remotePort();
       }
+    }
+  }
+  return length;
+}
 
-      // Finish UDP each time.
-      if (true_for_tcp_else_udp_ == false) {
-        Udp.endPacket();
-        Udp.flush();
+// True after Ethernet.begin(), so other classes can open UDP ports.
+bool Network::EthernetStarted() {
+  return network_has_been_initialized_ == true &&
+  Ethernet.hardwareStatus() != EthernetNoHardware;
+}
+
+// Check the Ethernet switch and connect or disconnect as needed.
+// Call once per sample. When a TCP connection is required and there
+// is none, each call tries to connect, which takes up to 100 ms.
+void Network::UpdateNetworkState(bool switch_enable_ethernet,
+  bool switch_require_tcp_connection) {
+  SetupNetwork(switch_require_tcp_connection,
+    switch_enable_ethernet, switch_enable_ethernet_last_);
+  if (true_for_tcp_else_udp_ == true) {
+    EndNetwork(switch_enable_ethernet, switch_enable_ethernet_last_);
+  }
+  switch_enable_ethernet_last_ = switch_enable_ethernet;
+}
+
+// IGMP join, so switches with IGMP snooping forward the group.
+// For NativeEthernet, the join uses its own socket. Udp is already
+// open at port_ for commands, and beginMulticast() on it would
+// reopen it. The join socket is never read, so its port is only
+// different from port_.
+void Network::JoinMulticastGroup() {
+  if (multicast_joined_ == false) {
+    IPAddress group(multicast_ip_[0], multicast_ip_[1], multicast_ip_[2],
+    multicast_ip_[3]);
+    #ifdef QNETHERNET
+    multicast_joined_ = Ethernet.joinGroup(group);
+    #else
+    multicast_joined_ = UdpMulticast.beginMulticast(group, port_ + 1);
+    #endif
+    if (debug_level_ >= DEBUG_INFO && multicast_joined_ == false) {
+      Serial.println("Error - could not join the multicast group.");
+    }
+  }
+}
+
+// Send one packet over TCP or UDP.
+// For UDP, a stream packet goes to all destinations and any
+// other packet goes to whoever sent the last command.
+void Network::WritePacket(const uint8_t *data, unsigned int length,
+  bool stream) {
+
+  // Send via TCP, as client.
+  if (true_for_tcp_else_udp_ == true) {
+    if (Client.connected()) {
+      unsigned int available_space = Client.availableForWrite();
+      if (available_space >= length) {
+        unsigned int now = micros();
+        Client.write(data, length);
+        #ifdef QNETHERNET
+        Client.flush();
+        #endif
+        if (debug_level_ >= DEBUG_INFO) {
+          if (micros() - now > 20) {
+            Serial.printf("Client.write = %d microseconds.\n", micros() - now);
+            Serial.printf("%d \n",available_space);
+          }
+        }
       }
     }
   }
 
+  // Send via UDP.
+  else if (stream == false) {
+    WriteUdpPacket(reply_ip_, reply_port_, data, length);
+  }
+  else {
+    if (multicast_enable_ == true) {
+      WriteUdpPacket(multicast_ip_, port_, data, length);
+    }
+    else {
+      WriteUdpPacket(computer_ip_, port_, data, length);
+    }
+    for (int k = 0; k < num_destinations_; k++) {
+      WriteUdpPacket(destination_ip_[k], port_, data, length);
+    }
+  }
+
+}
+
+void Network::WriteUdpPacket(const int *ip_address, int port,
+  const uint8_t *data, unsigned int length) {
+  IPAddress ip(ip_address[0], ip_address[1], ip_address[2], ip_address[3]);
+  Udp.beginPacket(ip, port);
+  Udp.write(data, length);
+  Udp.endPacket();
+  Udp.flush();
 }
 
 void Network::GetMacAddress() {
@@ -279,6 +523,9 @@ void Network::SetupNetwork(bool switch_require_tcp_connection,
       else if (network_has_been_initialized_ == false) {
         Udp.begin(port_);
         send_data_ok_ = true;
+        if (multicast_enable_ == true) {
+          JoinMulticastGroup();
+        }
       }
     }
 
@@ -322,6 +569,14 @@ void Network::Setup(const char *a, const char *b, int c, bool d, int debug_level
     Serial.println("Ethernet is not in build and is not used.");
   }
 }
+void Network::UpdateNetworkState(bool a, bool b) {}
 void Network::SendPianoPacket(const float * a, bool b, int c) {}
+void Network::SetupDestinations(const char *a, const char *b) {}
+void Network::SetupRawStream(const bool *a, int b) {}
+void Network::SendRawPacket(const unsigned int *a, bool b, bool c) {}
+void Network::SendBytes(const uint8_t *a, unsigned int b, bool c, bool d) {}
+void Network::SendReplyBytes(const uint8_t *a, unsigned int b, bool c, bool d) {}
+int Network::ReadBytes(uint8_t *a, int b) {return 0;}
+bool Network::EthernetStarted() {return false;}
 
 #endif
\ No newline at end of file
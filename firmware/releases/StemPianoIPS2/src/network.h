@@ -44,12 +44,23 @@ using namespace qindesign::network;
 #include <NativeEthernetUdp.h>
 #endif
 
+// Maximum number of extra unicast UDP destinations.
+#define NETWORK_MAX_DESTINATIONS 4
+
 class Network
 {
   public:
     Network();
     void Setup(bool, const char *, const char *, int, bool, int);
+    void UpdateNetworkState(bool, bool);
     void SendPianoPacket(const float *, const float *, bool, bool, int);
+    void SetupDestinations(const char *, const char *);
+    void SetupRawStream(const bool *, int);
+    void SendRawPacket(const unsigned int *, bool, bool);
+    void SendBytes(const uint8_t *, unsigned int, bool, bool);
+    void SendReplyBytes(const uint8_t *, unsigned int, bool, bool);
+    int ReadBytes(uint8_t *, int);
+    bool EthernetStarted();
 
   private:
     int debug_level_;
@@ -60,6 +71,17 @@ class Network
     int port_;
     bool send_data_ok_;
 
+    // UDP data streams go to computer_ip or a multicast group, and to
+    // extra unicast destinations. Replies to commands go to whoever
+    // sent the command.
+    bool multicast_enable_;
+    bool multicast_joined_;
+    int multicast_ip_[4];
+    int num_destinations_;
+    int destination_ip_[NETWORK_MAX_DESTINATIONS][4];
+    int reply_ip_[4];
+    int reply_port_;
+
     uint8_t ethernet_values_[2*(NUM_CHANNELS)];
     bool network_has_been_initialized_;
     bool switch_enable_ethernet_last_;
@@ -67,13 +89,26 @@ class Network
     bool true_for_hammer_else_damper_[NUM_CHANNELS];
     int send_ind_[NUM_CHANNELS];
 
+    // Raw ADC count streaming. Each count is sent as 3 bytes.
+    uint8_t raw_values_[3*(NUM_CHANNELS)];
+    int raw_send_ind_[NUM_CHANNELS];
+    int raw_num_channels_;
+    int raw_decimation_;
+    int raw_decimation_counter_;
+
     EthernetUDP Udp;        // For UDP.
+    #ifndef QNETHERNET
+    EthernetUDP UdpMulticast;  // Only to join the multicast group.
+    #endif
     EthernetClient Client;  // For TCP.
 
     void GetMacAddress();
     void SetIpAddresses(const char *, const char *, int);
     void SetupNetwork(bool, bool, bool);
     void EndNetwork(bool, bool);
+    void JoinMulticastGroup();
+    void WritePacket(const uint8_t *, unsigned int, bool);
+    void WriteUdpPacket(const int *, int, const uint8_t *, unsigned int);
 };
 
 #else
@@ -83,7 +118,15 @@ class Network
   public:
     Network();
     void Setup(const char *, const char *, int, bool, int);
+    void UpdateNetworkState(bool, bool);
     void SendPianoPacket(const float *, bool, int);
+    void SetupDestinations(const char *, const char *);
+    void SetupRawStream(const bool *, int);
+    void SendRawPacket(const unsigned int *, bool, bool);
+    void SendBytes(const uint8_t *, unsigned int, bool, bool);
+    void SendReplyBytes(const uint8_t *, unsigned int, bool, bool);
+    int ReadBytes(uint8_t *, int);
+    bool EthernetStarted();
 };
 
 #endif
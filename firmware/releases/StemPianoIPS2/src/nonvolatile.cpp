@@ -27,10 +27,18 @@
 
 Nonvolatile::Nonvolatile() {}
 
-void Nonvolatile::Setup(int debug_level) {
+void Nonvolatile::Setup(int queue_slice_micros, int debug_level) {
 
   debug_level_ = debug_level;
 
+  // Longest time each sample spends on queued writes.
+  queue_slice_micros_ = queue_slice_micros;
+  queue_contents_ = NONVOLATILE_QUEUE_CALIBRATION;
+  queue_length_ = 0;
+  queue_position_ = 0;
+  queue_late_frames_ = 0;
+  queue_max_late_micros_ = 0;
+
   if (sizeof(double) != SIZE_DOUBLE) {
     if (debug_level_ >= DEBUG_INFO) {
       Serial.printf("Nonvolatile::Setup() ERROR.\n");
@@ -66,6 +74,12 @@ void Nonvolatile::Setup(int debug_level) {
   velocity_scale_address_ = velocity_scale_flag_address_ + 1;
   ////////////////////////////////////////////////
 
+  ////////////////////////////////////////////////
+  // Nonvolatile memory for runtime settings.
+  settings_flag_address_ = velocity_scale_address_ + SIZE_DOUBLE;
+  settings_start_address_ = settings_flag_address_ + 1;
+  ////////////////////////////////////////////////
+
   // Set to true in code below anytime nonvolatile memory was written.
   // Cleared by NonvolatileWasWritten().
   nonvolatile_was_written_ = false;
@@ -163,6 +177,214 @@ void Nonvolatile::WriteMaxVelocityStoredFlag(bool data) {
 /////////////////////////////////////////////
 
 
+//////////////////////////////////////////////////////
+// Settings written by the remote configuration commands.
+// Same flag convention as for calibration values.
+bool Nonvolatile::ReadSettingsStoredFlag() {
+  int data = EEPROM.read(settings_flag_address_);
+  if (data == 0xFF)
+    return false;
+  else
+    return true;
+}
+void Nonvolatile::WriteSettingsStoredFlag(bool data) {
+  bool last_value = ReadSettingsStoredFlag();
+  if (last_value != data) {
+    int write_data;
+    if (data == false)
+      write_data = 0xFF;
+    else
+      write_data = 0;
+    EEPROM.write(settings_flag_address_, write_data);
+    nonvolatile_was_written_ = true;
+  }
+}
+double Nonvolatile::ReadSetting(int index) {
+  int base_address = (SIZE_DOUBLE) * index + settings_start_address_;
+  return ReadDouble(base_address);
+}
+void Nonvolatile::WriteSetting(int index, double data) {
+  int base_address = (SIZE_DOUBLE) * index + settings_start_address_;
+  WriteDouble(base_address, data);
+}
+/////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////
+// Write-behind queue for position calibration values
+// and runtime settings.
+// Writing all values takes too long for one sample, and
+// a flash erase in the EEPROM emulation can take
+// milliseconds. So, take a snapshot of the values and
+// write a few bytes each sample with WriteQueue().
+// The stored flag is cleared by the first queued write
+// and set by the last, so a partial write is never used.
+// Nothing is written here, so these are safe to call
+// during a sample.
+// Returns false if the queue is busy with other values.
+bool Nonvolatile::QueueCalibrationPosition(const double *min,
+const double *max) {
+  if (StartQueue(NONVOLATILE_QUEUE_CALIBRATION) == false) {
+    return false;
+  }
+  QueueByte(calibration_flag_address_, 0xFF);
+  for (int note = 0; note < NUM_NOTES; note++) {
+    QueueDouble((SIZE_DOUBLE) * note + calibration_max_start_address_,
+    max[note]);
+    QueueDouble((SIZE_DOUBLE) * note + calibration_min_start_address_,
+    min[note]);
+  }
+  FinishQueue(calibration_flag_address_);
+  return true;
+}
+
+bool Nonvolatile::QueueSettings(const double *values, int num_values) {
+  if (StartQueue(NONVOLATILE_QUEUE_SETTINGS) == false) {
+    return false;
+  }
+  QueueByte(settings_flag_address_, 0xFF);
+  for (int index = 0; index < num_values &&
+  index < NONVOLATILE_MAX_SETTINGS; index++) {
+    QueueDouble((SIZE_DOUBLE) * index + settings_start_address_,
+    values[index]);
+  }
+  FinishQueue(settings_flag_address_);
+  return true;
+}
+
+// Unwritten bytes are dropped and the stored flag stays clear.
+// Only if the queue holds these contents.
+void Nonvolatile::CancelQueue(int contents) {
+  if (QueueBusy() == false || queue_contents_ != contents) {
+    return;
+  }
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.printf("Canceled EEPROM queue, %d of %d bytes written.\n",
+    queue_position_, queue_length_);
+  }
+  queue_length_ = 0;
+  queue_position_ = 0;
+}
+
+// Call once each sample. Writes until queue_slice_micros_ is used
+// or the deadline for the next sample is close.
+// A single byte write cannot be split, so a flash erase can still
+// make one sample late. Only one instead of one per queued byte.
+// Samples that ended after the deadline are counted.
+void Nonvolatile::WriteQueue(unsigned long deadline_micros) {
+  if (QueueBusy() == false) {
+    return;
+  }
+  queue_frames_++;
+  unsigned long start_micros = micros();
+  while (queue_position_ < queue_length_ &&
+  (long) (micros() - start_micros) < queue_slice_micros_ &&
+  (long) (deadline_micros - micros()) > NONVOLATILE_QUEUE_MARGIN_MICROS) {
+    unsigned long byte_start_micros = micros();
+    if (queue_address_[queue_position_] >= MAX_EEPROM_ADDRESS ||
+    enable_memory_ == false) {
+      CancelQueue(queue_contents_);
+      return;
+    }
+    EEPROM.write(queue_address_[queue_position_],
+    queue_data_[queue_position_]);
+    queue_position_++;
+    unsigned long byte_micros = micros() - byte_start_micros;
+    if (byte_micros > queue_max_byte_micros_) {
+      queue_max_byte_micros_ = byte_micros;
+    }
+  }
+  long late_micros = (long) (micros() - deadline_micros);
+  if (late_micros > 0) {
+    queue_late_frames_++;
+    if ((unsigned long) late_micros > queue_max_late_micros_) {
+      queue_max_late_micros_ = late_micros;
+    }
+  }
+  if (queue_position_ == queue_length_) {
+    nonvolatile_was_written_ = true;
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.printf("Finished EEPROM queue, %d bytes in %d samples, ",
+      queue_length_, queue_frames_);
+      Serial.printf("%lu milliseconds, longest byte %lu microseconds.\n",
+      millis() - queue_start_millis_, queue_max_byte_micros_);
+    }
+    if (debug_level_ >= DEBUG_STATS) {
+      Serial.printf("EEPROM queue made %d samples late, ", queue_late_frames_);
+      Serial.printf("at most %lu microseconds.\n", queue_max_late_micros_);
+    }
+    queue_length_ = 0;
+    queue_position_ = 0;
+  }
+}
+
+bool Nonvolatile::QueueBusy() {
+  return queue_length_ > 0;
+}
+
+int Nonvolatile::QueuePercentWritten() {
+  if (QueueBusy() == false) {
+    return 100;
+  }
+  return (100 * queue_position_) / queue_length_;
+}
+
+// Samples the last queue made late.
+int Nonvolatile::QueueLateFrames() {
+  return queue_late_frames_;
+}
+
+bool Nonvolatile::StartQueue(int contents) {
+  if (QueueBusy() == true && queue_contents_ != contents) {
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.println("EEPROM queue is busy, values not written.");
+    }
+    return false;
+  }
+  queue_contents_ = contents;
+  queue_length_ = 0;
+  queue_position_ = 0;
+  queue_frames_ = 0;
+  queue_max_byte_micros_ = 0;
+  queue_late_frames_ = 0;
+  queue_max_late_micros_ = 0;
+  queue_start_millis_ = millis();
+  return true;
+}
+
+// Last, set the stored flag and count the write.
+void Nonvolatile::FinishQueue(int flag_address) {
+  QueueByte(flag_address, 0);
+  int x = ReadTotalWrites() + 1;
+  for (int shift = 0; shift < 3; shift++) {
+    QueueByte(total_writes_address_ + shift, (x >> (8*shift)) & 0x0FF);
+  }
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.printf("Queued %d bytes for EEPROM.\n", queue_length_);
+  }
+}
+
+void Nonvolatile::QueueDouble(int address, double d) {
+  union DoubleBytes {
+    double d;
+    unsigned char b[SIZE_DOUBLE];
+  } db;
+  db.d = d;
+  for (int byte = 0; byte < SIZE_DOUBLE; byte++) {
+    QueueByte(address + byte, db.b[byte]);
+  }
+}
+
+void Nonvolatile::QueueByte(int address, uint8_t data) {
+  if (queue_length_ < NONVOLATILE_QUEUE_BYTES) {
+    queue_address_[queue_length_] = address;
+    queue_data_[queue_length_] = data;
+    queue_length_++;
+  }
+}
+/////////////////////////////////////////////
+
+
 /////////////////////////////////////////////
 // Read / write floating point values.
 double Nonvolatile::ReadDouble(int address) {
@@ -39,11 +39,27 @@
 // enfore EEPROM size limits. A check is run at compile time.
 #define SIZE_DOUBLE 8
 
+// Maximum number of runtime settings that can be saved.
+#define NONVOLATILE_MAX_SETTINGS 32
+
+// Queued writes hold the calibration flag clear, the position
+// calibration min and max, the calibration flag set, and the three
+// total writes bytes. The runtime settings are smaller.
+#define NONVOLATILE_QUEUE_BYTES (1 + 2*(SIZE_DOUBLE)*(NUM_NOTES) + 1 + 3)
+
+// What the queue holds.
+#define NONVOLATILE_QUEUE_CALIBRATION 0
+#define NONVOLATILE_QUEUE_SETTINGS 1
+
+// Do not start a queued byte write with less time than this
+// left before the next sample.
+#define NONVOLATILE_QUEUE_MARGIN_MICROS 20
+
 class Nonvolatile
 {
   public:
     Nonvolatile();
-    void Setup(int);
+    void Setup(int, int);
  
     // Index is from 0 to NUM_NOTES - 1
     double ReadCalibrationPositionMin(int);
@@ -58,10 +74,25 @@ class Nonvolatile
     double ReadMaxVelocity();
     void WriteMaxVelocity(double);
 
+    // Index is from 0 to NONVOLATILE_MAX_SETTINGS - 1
+    bool ReadSettingsStoredFlag();
+    void WriteSettingsStoredFlag(bool);
+    double ReadSetting(int);
+    void WriteSetting(int, double);
+
     void UpdateAndWriteTotalWrites();
     int ReadTotalWrites();
 
     bool NonvolatileWasWritten();
+
+    // Write-behind queue for the position calibration and settings.
+    bool QueueCalibrationPosition(const double *, const double *);
+    bool QueueSettings(const double *, int);
+    void CancelQueue(int);
+    void WriteQueue(unsigned long);
+    bool QueueBusy();
+    int QueuePercentWritten();
+    int QueueLateFrames();
     
   private:
 
@@ -81,10 +112,29 @@ class Nonvolatile
     int calibration_flag_address_;
     int velocity_scale_flag_address_;
     int velocity_scale_address_;
+    int settings_flag_address_;
+    int settings_start_address_;
     int total_writes_address_;
 
     bool nonvolatile_was_written_;
 
+    int queue_slice_micros_;
+    int queue_contents_;
+    uint16_t queue_address_[NONVOLATILE_QUEUE_BYTES];
+    uint8_t queue_data_[NONVOLATILE_QUEUE_BYTES];
+    int queue_length_;
+    int queue_position_;
+    unsigned long queue_start_millis_;
+    int queue_frames_;
+    unsigned long queue_max_byte_micros_;
+    int queue_late_frames_;
+    unsigned long queue_max_late_micros_;
+
+    bool StartQueue(int);
+    void FinishQueue(int);
+    void QueueDouble(int, double);
+    void QueueByte(int, uint8_t);
+
 };
 
 #endif
\ No newline at end of file
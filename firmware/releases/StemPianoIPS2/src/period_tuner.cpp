@@ -0,0 +1,163 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// period_tuner.cpp
+//
+// This class is not hardware dependent.
+//
+// Pick the sample period from the measured processing time.
+//
+// At boot, the .ino code reads the ADC and runs the DSP PERIOD_TUNER_RUNS
+// times on synthetic worst case input, where every key and pedal moves
+// full scale every sample, so every key makes hammer and damper events
+// as often as the DSP allows. The cycle counter measures the worst
+// acquisition and worst processing time. The sample period is that time
+// plus margin (for MIDI, Ethernet, and status, which are not run at boot
+// so no notes play), between min_period and the configured period.
+//
+// While running, frames that took longer than the sample period are
+// overruns. If there are too many in a window, the period backs off by
+// 10%, up to the configured period.
+
+#include "period_tuner.h"
+
+PeriodTuner::PeriodTuner() {}
+
+// max_period is the configured sample period, and margin is the
+// fraction added to the measured time, for example 0.5.
+void PeriodTuner::Setup(bool enable, int max_period, int min_period,
+float margin, int debug_level) {
+  enable_ = enable;
+  debug_level_ = debug_level;
+  max_period_ = max_period;
+  min_period_ = (min_period < max_period) ? min_period : max_period;
+  margin_ = margin;
+  sample_period_ = max_period_;
+  start_cycles_ = ARM_DWT_CYCCNT;
+  acquisition_end_cycles_ = start_cycles_;
+  max_acquisition_cycles_ = 0;
+  max_processing_cycles_ = 0;
+  frame_start_cycles_ = start_cycles_;
+  frames_ = 0;
+  overruns_ = 0;
+}
+
+// Worst case for the DSP: every position goes between 0 and 1 each run.
+void PeriodTuner::SyntheticInput(float *hammer_position,
+float *damper_position, int run) {
+  float position = (run % 2 == 0) ? 0.0 : 1.0;
+  for (int ind = 0; ind < NUM_CHANNELS; ind++) {
+    hammer_position[ind] = position;
+    damper_position[ind] = position;
+  }
+}
+
+void PeriodTuner::MeasureStart() {
+  start_cycles_ = ARM_DWT_CYCCNT;
+}
+
+void PeriodTuner::AcquisitionEnd() {
+  acquisition_end_cycles_ = ARM_DWT_CYCCNT;
+  uint32_t cycles = acquisition_end_cycles_ - start_cycles_;
+  if (cycles > max_acquisition_cycles_) {
+    max_acquisition_cycles_ = cycles;
+  }
+}
+
+void PeriodTuner::ProcessingEnd() {
+  uint32_t cycles = ARM_DWT_CYCCNT - acquisition_end_cycles_;
+  if (cycles > max_processing_cycles_) {
+    max_processing_cycles_ = cycles;
+  }
+}
+
+// Returns the sample period to use, in microseconds.
+int PeriodTuner::ChoosePeriod() {
+  if (enable_ == false) {
+    return sample_period_;
+  }
+  float cycles_per_micro = static_cast<float>(F_CPU_ACTUAL / 1000000);
+  float acquisition_micros = max_acquisition_cycles_ / cycles_per_micro;
+  float processing_micros = max_processing_cycles_ / cycles_per_micro;
+  int period = static_cast<int>((acquisition_micros + processing_micros) *
+  (1.0 + margin_)) + 1;
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.printf("Sample period tuning: acquisition = %.1f us, ",
+    acquisition_micros);
+    Serial.printf("processing = %.1f us, needed = %d us.\n",
+    processing_micros, period);
+    if (period > max_period_) {
+      Serial.printf("Warning - more than the %d us sample period setting.\n",
+      max_period_);
+    }
+  }
+  if (period > max_period_)
+    period = max_period_;
+  else if (period < min_period_)
+    period = min_period_;
+  sample_period_ = period;
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.printf("The sample period is set to %d microseconds.\n",
+    sample_period_);
+  }
+  frames_ = 0;
+  overruns_ = 0;
+  return sample_period_;
+}
+
+void PeriodTuner::FrameStart() {
+  frame_start_cycles_ = ARM_DWT_CYCCNT;
+}
+
+// Returns true if the sample period changed.
+bool PeriodTuner::FrameEnd() {
+  if (enable_ == false || sample_period_ >= max_period_) {
+    return false;
+  }
+  uint32_t cycles = ARM_DWT_CYCCNT - frame_start_cycles_;
+  uint32_t period_cycles = static_cast<uint32_t>(sample_period_) *
+  (F_CPU_ACTUAL / 1000000);
+  if (cycles > period_cycles) {
+    overruns_++;
+  }
+  frames_++;
+  if (overruns_ > PERIOD_TUNER_MAX_OVERRUNS) {
+    int step = sample_period_ / 10;
+    sample_period_ += (step > 0) ? step : 1;
+    if (sample_period_ > max_period_) {
+      sample_period_ = max_period_;
+    }
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.printf("Sample period overruns, backing off to %d us.\n",
+      sample_period_);
+    }
+    frames_ = 0;
+    overruns_ = 0;
+    return true;
+  }
+  if (frames_ >= PERIOD_TUNER_WINDOW) {
+    frames_ = 0;
+    overruns_ = 0;
+  }
+  return false;
+}
+
+int PeriodTuner::SamplePeriod() {
+  return sample_period_;
+}
@@ -0,0 +1,73 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// period_tuner.h
+//
+// This class is not hardware dependent.
+//
+// Pick the sample period from the measured processing time.
+
+#ifndef PERIOD_TUNER_H_
+#define PERIOD_TUNER_H_
+
+#include "stem_piano_ips2.h"
+
+// Number of boot-time measurements.
+#define PERIOD_TUNER_RUNS 64
+
+// Back off when more than this many overruns in PERIOD_TUNER_WINDOW frames.
+#define PERIOD_TUNER_MAX_OVERRUNS 4
+#define PERIOD_TUNER_WINDOW 4000
+
+class PeriodTuner
+{
+  public:
+    PeriodTuner();
+    void Setup(bool, int, int, float, int);
+    void SyntheticInput(float *, float *, int);
+    void MeasureStart();
+    void AcquisitionEnd();
+    void ProcessingEnd();
+    int ChoosePeriod();
+    void FrameStart();
+    bool FrameEnd();
+    int SamplePeriod();
+
+  private:
+    bool enable_;
+    int debug_level_;
+    int max_period_;
+    int min_period_;
+    float margin_;
+    int sample_period_;
+
+    // Boot-time measurement.
+    uint32_t start_cycles_;
+    uint32_t acquisition_end_cycles_;
+    uint32_t max_acquisition_cycles_;
+    uint32_t max_processing_cycles_;
+
+    // Running.
+    uint32_t frame_start_cycles_;
+    int frames_;
+    int overruns_;
+
+};
+
+#endif
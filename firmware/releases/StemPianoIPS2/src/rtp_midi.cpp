@@ -0,0 +1,509 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// rtp_midi.cpp
+//
+// This class is not hardware dependent.
+//
+// Network MIDI output using RTP-MIDI (AppleMIDI, RFC 6295).
+//
+// The Teensy is a session listener. A computer running the macOS
+// Audio MIDI Setup network session, rtpMIDI on Windows, or rtpmidid
+// on Linux connects to the Teensy IP at control port P (data port
+// is P+1). One session at a time.
+//
+// All note and pedal events from one sample are sent in one RTP
+// packet, so the latency does not depend on chord size the way it
+// does for the 31.25 kbaud DIN output.
+//
+// Each packet has a recovery journal (chapters C and N) for the
+// notes and controllers that changed since the last packet that
+// the computer acknowledged (RS feedback). After a lost packet the
+// receiver uses the journal to correct stuck or missing notes.
+// When there are no new events, a few guard packets with only the
+// journal are sent, so a lost final packet is also recovered.
+
+#include "rtp_midi.h"
+
+#ifdef ETHERNET_INSTALLED
+
+#include "string.h"
+
+RtpMidi::RtpMidi() {}
+
+void RtpMidi::Setup(bool enable, int control_port, const char *name,
+int midi_channel, Network *Eth, int debug_level) {
+
+  debug_level_ = debug_level;
+  enable_ = enable;
+  started_ = false;
+  control_port_ = control_port;
+  midi_channel_ = midi_channel;
+  strncpy(name_, name, RTP_MIDI_NAME_LENGTH - 1);
+  name_[RTP_MIDI_NAME_LENGTH - 1] = '\0';
+  Eth_ = Eth;
+
+  connected_ = false;
+  session_timeout_millis_ = 60000;
+  guard_interval_millis_ = 250;
+  guard_count_ = 0;
+  command_length_ = 0;
+  sequence_ = 0;
+  last_micros_ = micros();
+  micros_wraps_ = 0;
+  ssrc_ = 0x53500000 | (micros() & 0x000FFFFF);
+  ClearJournal();
+
+  if (enable_ == true && debug_level_ >= DEBUG_INFO) {
+    Serial.printf("RTP-MIDI session \"%s\" on ports %d and %d.\n",
+    name_, control_port_, control_port_ + 1);
+  }
+}
+
+// Call every sample. Handles the session and clock sync packets.
+void RtpMidi::Update(bool switch_enable_ethernet) {
+  if (enable_ == false) {
+    return;
+  }
+  Timestamp();  // Keep up with micros() rollover.
+  if (switch_enable_ethernet == false) {
+    return;
+  }
+  // Network class owns Ethernet.begin(). Wait until it is done.
+  if (started_ == false) {
+    if (Eth_->EthernetStarted() == false) {
+      return;
+    }
+    started_ = Control.begin(control_port_) && Data.begin(control_port_ + 1);
+    if (started_ == false) {
+      if (debug_level_ >= DEBUG_INFO) {
+        Serial.println("Error - RTP-MIDI could not open UDP ports.");
+      }
+      enable_ = false;
+      return;
+    }
+  }
+  ReadControl();
+  ReadData();
+  if (connected_ == true &&
+  millis() - last_receive_millis_ > session_timeout_millis_) {
+    connected_ = false;
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.println("RTP-MIDI session timed out.");
+    }
+  }
+}
+
+// midi_channel_ is 1 to 16, the same as for the MIDI library.
+void RtpMidi::NoteOn(int note, int velocity) {
+  AddCommand(0x90 | ((midi_channel_ - 1) & 0x0F), note, velocity);
+}
+
+void RtpMidi::NoteOff(int note, int velocity) {
+  AddCommand(0x80 | ((midi_channel_ - 1) & 0x0F), note, velocity);
+}
+
+void RtpMidi::ControlChange(int number, int value) {
+  AddCommand(0xB0 | ((midi_channel_ - 1) & 0x0F), number, value);
+}
+
+// Not in the recovery journal. A lost value is replaced by the next one.
+void RtpMidi::PolyPressure(int note, int pressure) {
+  AddCommand(0xA0 | ((midi_channel_ - 1) & 0x0F), note, pressure);
+}
+
+// Call once per sample after all events were added.
+void RtpMidi::SendFrame() {
+  if (connected_ == false) {
+    command_length_ = 0;
+    return;
+  }
+  if (command_length_ > 0) {
+    Send(false);
+    guard_count_ = 0;
+  }
+  else if (guard_count_ < 4 &&
+  millis() - last_send_millis_ > guard_interval_millis_) {
+    Send(true);
+    guard_count_++;
+  }
+}
+
+bool RtpMidi::Connected() {
+  return connected_;
+}
+
+// Private methods. ////////
+
+void RtpMidi::ReadControl() {
+  int length = Control.parsePacket();
+  if (length > 0) {
+    length = Control.read(packet_, RTP_MIDI_PACKET_SIZE);
+    HandleSessionPacket(&Control, length, false);
+  }
+}
+
+void RtpMidi::ReadData() {
+  int length = Data.parsePacket();
+  if (length <= 0) {
+    return;
+  }
+  length = Data.read(packet_, RTP_MIDI_PACKET_SIZE);
+  if (length < 4 || packet_[0] != 0xFF || packet_[1] != 0xFF) {
+    return;  // Incoming MIDI is not used.
+  }
+  if (packet_[2] == 'C' && packet_[3] == 'K') {
+    HandleClockSync(length);
+  }
+  else if (packet_[2] == 'R' && packet_[3] == 'S') {
+    HandleFeedback(length);
+  }
+  else {
+    HandleSessionPacket(&Data, length, true);
+  }
+}
+
+// Invitation (IN) and end session (BY). The computer first invites
+// on the control port, then on the data port.
+void RtpMidi::HandleSessionPacket(EthernetUDP *Udp, int length, bool data_port) {
+  if (length < 16 || packet_[0] != 0xFF || packet_[1] != 0xFF) {
+    return;
+  }
+  uint32_t token = Get32(packet_ + 8);
+  uint32_t remote_ssrc = Get32(packet_ + 12);
+
+  if (packet_[2] == 'I' && packet_[3] == 'N') {
+    if (connected_ == true && remote_ssrc != remote_ssrc_) {
+      SendSessionReply(Udp, "NO", token);
+      return;
+    }
+    SendSessionReply(Udp, "OK", token);
+    if (data_port == true) {
+      connected_ = true;
+      remote_ssrc_ = remote_ssrc;
+      token_ = token;
+      remote_ip_ = Udp->remoteIP();
+      remote_data_port_ = Udp->remotePort();
+      last_receive_millis_ = millis();
+      last_send_millis_ = millis();
+      guard_count_ = 0;
+      checkpoint_ = sequence_;
+      ClearJournal();
+      if (debug_level_ >= DEBUG_INFO) {
+        Serial.print("RTP-MIDI session started with ");
+        Serial.println(remote_ip_);
+      }
+    }
+  }
+  else if (packet_[2] == 'B' && packet_[3] == 'Y') {
+    if (connected_ == true && remote_ssrc == remote_ssrc_) {
+      connected_ = false;
+      if (debug_level_ >= DEBUG_INFO) {
+        Serial.println("RTP-MIDI session ended.");
+      }
+    }
+  }
+}
+
+void RtpMidi::SendSessionReply(EthernetUDP *Udp, const char *command,
+uint32_t token) {
+  uint8_t reply[16 + RTP_MIDI_NAME_LENGTH];
+  reply[0] = 0xFF;
+  reply[1] = 0xFF;
+  reply[2] = command[0];
+  reply[3] = command[1];
+  Put32(reply + 4, 2);  // Protocol version.
+  Put32(reply + 8, token);
+  Put32(reply + 12, ssrc_);
+  int length = 16;
+  if (command[0] == 'O') {
+    strcpy(reinterpret_cast<char *>(reply + 16), name_);
+    length += strlen(name_) + 1;
+  }
+  Udp->beginPacket(Udp->remoteIP(), Udp->remotePort());
+  Udp->write(reply, length);
+  Udp->endPacket();
+}
+
+// The computer starts a clock sync with count 0. Reply with count 1
+// and this timestamp. With count 2 the round trip time is known.
+void RtpMidi::HandleClockSync(int length) {
+  if (length < 36 || connected_ == false || Get32(packet_ + 4) != remote_ssrc_) {
+    return;
+  }
+  last_receive_millis_ = millis();
+  int count = packet_[8];
+  if (count == 0) {
+    Put32(packet_ + 4, ssrc_);
+    packet_[8] = 1;
+    Put64(packet_ + 20, Timestamp());
+    Data.beginPacket(remote_ip_, remote_data_port_);
+    Data.write(packet_, 36);
+    Data.endPacket();
+  }
+  else if (count == 2 && debug_level_ >= DEBUG_STATS) {
+    uint64_t round_trip = Get64(packet_ + 28) - Get64(packet_ + 12);
+    Serial.printf("RTP-MIDI clock sync, round trip = %d.%d ms.\n",
+    static_cast<int>(round_trip / 10), static_cast<int>(round_trip % 10));
+  }
+}
+
+// The computer received all packets up to this sequence number,
+// so they no longer need to be in the journal.
+void RtpMidi::HandleFeedback(int length) {
+  if (length < 12 || connected_ == false || Get32(packet_ + 4) != remote_ssrc_) {
+    return;
+  }
+  last_receive_millis_ = millis();
+  uint16_t acknowledged = (packet_[8] << 8) | packet_[9];
+  checkpoint_ = acknowledged + 1;
+  for (int k = 0; k < 128; k++) {
+    if (static_cast<int16_t>(note_sequence_[k] - checkpoint_) < 0) {
+      note_logged_[k] = false;
+    }
+    if (static_cast<int16_t>(control_sequence_[k] - checkpoint_) < 0) {
+      control_logged_[k] = false;
+    }
+  }
+}
+
+void RtpMidi::AddCommand(uint8_t status, uint8_t data1, uint8_t data2) {
+  if (connected_ == true && command_length_ + 3 <= RTP_MIDI_COMMAND_SIZE) {
+    command_[command_length_++] = status;
+    command_[command_length_++] = data1 & 0x7F;
+    command_[command_length_++] = data2 & 0x7F;
+  }
+}
+
+// One RTP packet: header, MIDI command section, recovery journal.
+// A guard packet has no commands and is only sent with a journal.
+void RtpMidi::Send(bool guard) {
+
+  uint64_t timestamp = Timestamp();
+  packet_[0] = 0x80;  // RTP version 2.
+  packet_[1] = 0x61;  // Payload type 97.
+  Put16(packet_ + 2, sequence_);
+  Put32(packet_ + 4, static_cast<uint32_t>(timestamp));
+  Put32(packet_ + 8, ssrc_);
+  int ptr = 12;
+
+  // Commands after the first have a delta time of 0.
+  int num_commands = command_length_ / 3;
+  int length = num_commands > 0 ? 4*num_commands - 1 : 0;
+  int header = ptr;
+  if (length <= 15) {
+    packet_[ptr++] = length;
+  }
+  else {
+    packet_[ptr++] = 0x80 | ((length >> 8) & 0x0F);
+    packet_[ptr++] = length & 0xFF;
+  }
+  for (int k = 0; k < num_commands; k++) {
+    if (k > 0) {
+      packet_[ptr++] = 0x00;
+    }
+    memcpy(packet_ + ptr, command_ + 3*k, 3);
+    ptr += 3;
+  }
+
+  // Journal of the packets before this one.
+  int journal_length = AddJournal(packet_ + ptr);
+  if (journal_length > 0) {
+    packet_[header] |= 0x40;
+    ptr += journal_length;
+  }
+  else if (guard == true) {
+    return;
+  }
+
+  Data.beginPacket(remote_ip_, remote_data_port_);
+  Data.write(packet_, ptr);
+  Data.endPacket();
+  last_send_millis_ = millis();
+
+  // Add this packet to the journal for the next packets.
+  for (int k = 0; k < num_commands; k++) {
+    uint8_t status = command_[3*k] & 0xF0;
+    uint8_t number = command_[3*k + 1];
+    if (status == 0x90 || status == 0x80) {
+      note_logged_[number] = true;
+      note_on_[number] = (status == 0x90);
+      note_velocity_[number] = command_[3*k + 2];
+      note_sequence_[number] = sequence_;
+    }
+    else if (status == 0xB0) {
+      control_logged_[number] = true;
+      control_value_[number] = command_[3*k + 2];
+      control_sequence_[number] = sequence_;
+    }
+  }
+  command_length_ = 0;
+  sequence_++;
+}
+
+// Journal with one channel and chapters C (controllers) and N (notes).
+// Returns the number of bytes, or 0 if there is nothing to journal.
+int RtpMidi::AddJournal(uint8_t *journal) {
+
+  int ptr = 3;
+  int channel_header = ptr;
+  ptr += 3;
+  uint8_t toc = 0;
+
+  // Chapter C.
+  int count = 0;
+  int chapter = ptr++;
+  for (int k = 0; k < 128; k++) {
+    if (control_logged_[k] == true) {
+      journal[ptr++] = k;
+      journal[ptr++] = control_value_[k];
+      count++;
+    }
+  }
+  if (count > 0) {
+    toc |= 0x40;
+    journal[chapter] = count - 1;
+  }
+  else {
+    ptr--;
+  }
+
+  // Chapter N. Notes that are on have a log. Notes that are
+  // off are a bit in OFFBITS. LOW > HIGH means no OFFBITS.
+  count = 0;
+  int low = 15;
+  int high = 0;
+  chapter = ptr;
+  ptr += 2;
+  for (int k = 0; k < 128; k++) {
+    if (note_logged_[k] == true) {
+      if (note_on_[k] == true) {
+        // Y bit is 0. A late piano note is worse than a missing one.
+        journal[ptr++] = k;
+        journal[ptr++] = note_velocity_[k] == 0 ? 1 : note_velocity_[k];
+        count++;
+      }
+      else {
+        if (k/8 < low) low = k/8;
+        if (k/8 > high) high = k/8;
+      }
+    }
+  }
+  if (low <= high) {
+    for (int octet = low; octet <= high; octet++) {
+      journal[ptr] = 0;
+      for (int bit = 0; bit < 8; bit++) {
+        int k = 8*octet + bit;
+        if (note_logged_[k] == true && note_on_[k] == false) {
+          journal[ptr] |= 0x80 >> bit;
+        }
+      }
+      ptr++;
+    }
+  }
+  else {
+    low = 15;
+    high = 0;
+  }
+  if (count > 0 || low <= high) {
+    toc |= 0x08;
+    journal[chapter] = count;
+    journal[chapter + 1] = (low << 4) | high;
+  }
+  else {
+    ptr -= 2;
+  }
+
+  if (toc == 0) {
+    return 0;
+  }
+
+  int channel_length = ptr - channel_header;
+  journal[channel_header] = (((midi_channel_ - 1) & 0x0F) << 3) |
+  ((channel_length >> 8) & 0x03);
+  journal[channel_header + 1] = channel_length & 0xFF;
+  journal[channel_header + 2] = toc;
+
+  journal[0] = 0x20;  // A = 1, one channel.
+  Put16(journal + 1, checkpoint_);
+  return ptr;
+}
+
+void RtpMidi::ClearJournal() {
+  for (int k = 0; k < 128; k++) {
+    note_logged_[k] = false;
+    note_on_[k] = false;
+    note_velocity_[k] = 0;
+    note_sequence_[k] = 0;
+    control_logged_[k] = false;
+    control_value_[k] = 0;
+    control_sequence_[k] = 0;
+  }
+}
+
+// Units are 100 microseconds, per AppleMIDI.
+uint64_t RtpMidi::Timestamp() {
+  uint32_t now = micros();
+  if (now < last_micros_) {
+    micros_wraps_++;
+  }
+  last_micros_ = now;
+  return ((micros_wraps_ << 32) + now) / 100;
+}
+
+// Network byte order.
+void RtpMidi::Put16(uint8_t *buffer, uint16_t value) {
+  buffer[0] = value >> 8;
+  buffer[1] = value & 0xFF;
+}
+
+void RtpMidi::Put32(uint8_t *buffer, uint32_t value) {
+  for (int k = 0; k < 4; k++) {
+    buffer[k] = (value >> (24 - 8*k)) & 0xFF;
+  }
+}
+
+void RtpMidi::Put64(uint8_t *buffer, uint64_t value) {
+  Put32(buffer, static_cast<uint32_t>(value >> 32));
+  Put32(buffer + 4, static_cast<uint32_t>(value));
+}
+
+uint32_t RtpMidi::Get32(const uint8_t *buffer) {
+  return (static_cast<uint32_t>(buffer[0]) << 24) |
+  (static_cast<uint32_t>(buffer[1]) << 16) |
+  (static_cast<uint32_t>(buffer[2]) << 8) | buffer[3];
+}
+
+uint64_t RtpMidi::Get64(const uint8_t *buffer) {
+  return (static_cast<uint64_t>(Get32(buffer)) << 32) | Get32(buffer + 4);
+}
+
+#else
+
+RtpMidi::RtpMidi() {}
+void RtpMidi::Setup(bool a, int b, const char *c, int d, Network *e, int f) {}
+void RtpMidi::Update(bool a) {}
+void RtpMidi::NoteOn(int a, int b) {}
+void RtpMidi::NoteOff(int a, int b) {}
+void RtpMidi::ControlChange(int a, int b) {}
+void RtpMidi::PolyPressure(int a, int b) {}
+void RtpMidi::SendFrame() {}
+bool RtpMidi::Connected() {return false;}
+
+#endif
@@ -0,0 +1,135 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// rtp_midi.h
+//
+// This class is not hardware dependent.
+//
+// Network MIDI output using RTP-MIDI (AppleMIDI).
+
+#ifndef RTP_MIDI_H_
+#define RTP_MIDI_H_
+
+#include "stem_piano_ips2.h"
+#include "network.h"
+
+#define RTP_MIDI_PACKET_SIZE 1400
+#define RTP_MIDI_COMMAND_SIZE 384
+#define RTP_MIDI_NAME_LENGTH 32
+
+#ifdef ETHERNET_INSTALLED
+
+class RtpMidi
+{
+  public:
+    RtpMidi();
+    void Setup(bool, int, const char *, int, Network *, int);
+    void Update(bool);
+    void NoteOn(int, int);
+    void NoteOff(int, int);
+    void ControlChange(int, int);
+    void PolyPressure(int, int);
+    void SendFrame();
+    bool Connected();
+
+  private:
+    int debug_level_;
+    bool enable_;
+    bool started_;
+    int control_port_;
+    int midi_channel_;
+    char name_[RTP_MIDI_NAME_LENGTH];
+    Network *Eth_;
+
+    EthernetUDP Control;
+    EthernetUDP Data;
+    uint8_t packet_[RTP_MIDI_PACKET_SIZE];
+
+    // One session at a time.
+    bool connected_;
+    uint32_t ssrc_;
+    uint32_t remote_ssrc_;
+    uint32_t token_;
+    IPAddress remote_ip_;
+    uint16_t remote_data_port_;
+    unsigned long last_receive_millis_;
+    unsigned long session_timeout_millis_;
+
+    // MIDI commands for this frame.
+    uint8_t command_[RTP_MIDI_COMMAND_SIZE];
+    int command_length_;
+    uint16_t sequence_;
+    unsigned long last_send_millis_;
+    unsigned long guard_interval_millis_;
+    int guard_count_;
+
+    // 64-bit timestamp in units of 100 microseconds.
+    uint32_t last_micros_;
+    uint64_t micros_wraps_;
+
+    // Recovery journal state. A note or controller is in the journal
+    // if it changed at or after the checkpoint packet.
+    uint16_t checkpoint_;
+    bool note_logged_[128];
+    bool note_on_[128];
+    uint8_t note_velocity_[128];
+    uint16_t note_sequence_[128];
+    bool control_logged_[128];
+    uint8_t control_value_[128];
+    uint16_t control_sequence_[128];
+
+    void ReadControl();
+    void ReadData();
+    void HandleSessionPacket(EthernetUDP *, int, bool);
+    void SendSessionReply(EthernetUDP *, const char *, uint32_t);
+    void HandleClockSync(int);
+    void HandleFeedback(int);
+    void AddCommand(uint8_t, uint8_t, uint8_t);
+    void Send(bool);
+    int AddJournal(uint8_t *);
+    void ClearJournal();
+    uint64_t Timestamp();
+
+    static void Put16(uint8_t *, uint16_t);
+    static void Put32(uint8_t *, uint32_t);
+    static void Put64(uint8_t *, uint64_t);
+    static uint32_t Get32(const uint8_t *);
+    static uint64_t Get64(const uint8_t *);
+
+};
+
+#else
+
+class RtpMidi
+{
+  public:
+    RtpMidi();
+    void Setup(bool, int, const char *, int, Network *, int);
+    void Update(bool);
+    void NoteOn(int, int);
+    void NoteOff(int, int);
+    void ControlChange(int, int);
+    void PolyPressure(int, int);
+    void SendFrame();
+    bool Connected();
+};
+
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// scheduler.cpp
+//
+// This class is not hardware dependent.
+//
+// Run work that does not need every sample at a lower rate.
+//
+// The task table is fixed at compile time in the .ino file. Each
+// sample, FrameStart() counts a frame, and the .ino code runs a task
+// inside an if (Begin(task)) { ...; End(task); } block. Begin() is
+// true only in the samples the task is due. Nothing is preempted.
+// Picking phases so that no two slow tasks share a sample keeps their
+// costs from adding up in one sample period. Setup() warns if any two
+// tasks can run in the same sample.
+//
+// While the sampling is slowed on purpose, for example for the TFT,
+// each frame stands for several samples of the task table. A task is
+// then due in the frame that reaches or passes its sample, so it keeps
+// about the same rate in time. Several tasks can then share a frame,
+// which is fine because a slowed frame has plenty of time.
+//
+// A run that takes longer than the task budget is an overrun. Runs,
+// overruns, and the longest run of each task are printed by
+// PrintStatistics() at DEBUG_STATS.
+
+#include "scheduler.h"
+
+Scheduler::Scheduler() {}
+
+void Scheduler::Setup(const SchedulerTask *tasks, int num_tasks,
+int debug_level) {
+  debug_level_ = debug_level;
+  tasks_ = tasks;
+  num_tasks_ = num_tasks;
+  if (num_tasks_ > SCHEDULER_MAX_TASKS) {
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.printf("Scheduler::Setup() ERROR. %d tasks, maximum is %d.\n",
+      num_tasks_, SCHEDULER_MAX_TASKS);
+    }
+    num_tasks_ = SCHEDULER_MAX_TASKS;
+  }
+  frame_ = 0;
+  last_frame_ = 0;
+  start_micros_ = micros();
+  for (int task = 0; task < SCHEDULER_MAX_TASKS; task++) {
+    runs_[task] = 0;
+    overruns_[task] = 0;
+    max_micros_[task] = 0;
+  }
+  CheckPhases();
+}
+
+// Call once at the start of each sample. samples is how many samples
+// of the task table this frame stands for, 1 unless the sampling is
+// slowed on purpose.
+void Scheduler::FrameStart(int samples) {
+  last_frame_ = frame_;
+  frame_ += samples > 1 ? samples : 1;
+}
+
+// True if the task is due in this sample.
+bool Scheduler::Begin(int task) {
+  if (task < 0 || task >= num_tasks_ || tasks_[task].period <= 0) {
+    return false;
+  }
+  unsigned long period = tasks_[task].period;
+  unsigned long phase = tasks_[task].phase;
+  if ((frame_ + phase) / period == (last_frame_ + phase) / period) {
+    return false;
+  }
+  start_micros_ = micros();
+  return true;
+}
+
+// Call after the task ran.
+void Scheduler::End(int task) {
+  if (task < 0 || task >= num_tasks_) {
+    return;
+  }
+  unsigned long run_micros = micros() - start_micros_;
+  runs_[task]++;
+  if (run_micros > max_micros_[task]) {
+    max_micros_[task] = run_micros;
+  }
+  if (run_micros > static_cast<unsigned long>(tasks_[task].budget_micros)) {
+    overruns_[task]++;
+  }
+}
+
+// Call from a task every few seconds.
+void Scheduler::PrintStatistics() {
+  if (debug_level_ >= DEBUG_STATS) {
+    Serial.print("Tasks (runs/overruns/max us):");
+    for (int task = 0; task < num_tasks_; task++) {
+      Serial.printf(" %s=%lu/%lu/%lu", tasks_[task].name, runs_[task],
+      overruns_[task], max_micros_[task]);
+    }
+    Serial.println(".");
+  }
+  for (int task = 0; task < num_tasks_; task++) {
+    runs_[task] = 0;
+    overruns_[task] = 0;
+    max_micros_[task] = 0;
+  }
+}
+
+// Since the last PrintStatistics().
+unsigned long Scheduler::Runs(int task) {
+  return (task >= 0 && task < num_tasks_) ? runs_[task] : 0;
+}
+
+unsigned long Scheduler::Overruns(int task) {
+  return (task >= 0 && task < num_tasks_) ? overruns_[task] : 0;
+}
+
+// Pairs of tasks that can run in the same sample, found by Setup().
+int Scheduler::Collisions() {
+  return collisions_;
+}
+
+// Private methods. ////////
+
+// Two tasks with periods a and b and phases p and q run in the same
+// sample at some time if (p - q) is a multiple of gcd(a, b).
+// Tasks that run every sample are not checked.
+void Scheduler::CheckPhases() {
+  collisions_ = 0;
+  for (int task_a = 0; task_a < num_tasks_; task_a++) {
+    for (int task_b = task_a + 1; task_b < num_tasks_; task_b++) {
+      int a = tasks_[task_a].period;
+      int b = tasks_[task_b].period;
+      if (a <= 1 || b <= 1) {
+        continue;
+      }
+      while (b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+      }
+      if ((tasks_[task_a].phase - tasks_[task_b].phase) % a == 0) {
+        collisions_++;
+        if (debug_level_ >= DEBUG_INFO) {
+          Serial.printf("Scheduler warning - tasks %s and %s can run in the "
+          "same sample.\n", tasks_[task_a].name, tasks_[task_b].name);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,74 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// scheduler.h
+//
+// This class is not hardware dependent.
+//
+// Run work that does not need every sample at a lower rate.
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "stem_piano_ips2.h"
+
+// Using a #define because statically allocates arrays.
+#define SCHEDULER_MAX_TASKS 16
+
+// One row of the task table. Period and phase are in samples. A task
+// runs in samples where (sample + phase) % period == 0. Budget is the
+// longest time the task should take, in microseconds.
+struct SchedulerTask {
+  const char *name;
+  int period;
+  int phase;
+  int budget_micros;
+};
+
+class Scheduler
+{
+  public:
+    Scheduler();
+    void Setup(const SchedulerTask *, int, int);
+    void FrameStart(int);
+    bool Begin(int);
+    void End(int);
+    void PrintStatistics();
+    unsigned long Runs(int);
+    unsigned long Overruns(int);
+    int Collisions();
+
+  private:
+    int debug_level_;
+    const SchedulerTask *tasks_;
+    int num_tasks_;
+    unsigned long frame_;
+    unsigned long last_frame_;
+    int collisions_;
+
+    unsigned long start_micros_;
+    unsigned long runs_[SCHEDULER_MAX_TASKS];
+    unsigned long overruns_[SCHEDULER_MAX_TASKS];
+    unsigned long max_micros_[SCHEDULER_MAX_TASKS];
+
+    void CheckPhases();
+
+};
+
+#endif
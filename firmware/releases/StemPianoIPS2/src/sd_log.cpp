@@ -0,0 +1,587 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// sd_log.cpp
+//
+// For ips pcb version 2.X
+//
+// Logging of raw frames and events to the SD card on the TFT.
+//
+// Every raw ADC frame, all NUM_CHANNELS channels, and the hammer and
+// damper events are compressed by FrameCoder and written to a log
+// file, /logNNN.bin, for as long as a rehearsal.
+//
+// The sample loop only codes each frame into a RAM buffer. Sectors
+// are written to the card by Write(), in the time left before the
+// next sample, and only when the card is not busy. So SD card delays
+// fill the buffer instead of delaying samples. If the buffer is full,
+// the frame is not logged and counted as an overflow.
+//
+// The file is allocated contiguous at the start, and the sectors are
+// written with one multiple-sector write, without the file system.
+//
+// Commands (serial monitor or Ethernet, see command_line.cpp):
+//   sdlog          Report the state and the statistics.
+//   sdlog start    Start logging. Creates the file if needed, which
+//                  pauses sampling while the card is searched.
+//   sdlog stop     Stop logging and write the header and time index.
+//
+// File format, all values least significant byte first:
+//   Sector 0       Header.
+//     bytes 0-7      "STEMLOG1"
+//     bytes 8-9      File number, NNN of the file name.
+//     byte 10        Channels.
+//     bytes 12-15    Sample period, microseconds.
+//     bytes 16-17    Frames per block.
+//     bytes 18-19    Index sectors.
+//     bytes 20-23    Blocks per index entry.
+//     bytes 24-27    Index entries.
+//     bytes 28-31    Data bytes.
+//     bytes 32-35    Frames.
+//     bytes 36-39    Blocks.
+//     bytes 40-43    Overflow frames.
+//     bytes 44-47    Events dropped.
+//     bytes 48-51    Rice escapes.
+//     bytes 52-55    Longest sector write, microseconds.
+//     bytes 56-59    Times the card was busy.
+//     bytes 60-91    Why logging stopped.
+//   Sectors 1 to SD_LOG_INDEX_SECTORS, time index. Per sector,
+//   SD_LOG_INDEX_PER_SECTOR entries of:
+//     Byte offset of a block in the data (4), frame (4), micros (4).
+//   Then the data, a series of blocks. Each block is:
+//     'S' 'L', file number (2), first frame (4), micros (4).
+//     Frames coded by FrameCoder, see frame_coder.cpp.
+//   When logging stops, the data is padded with zeros to a sector.
+//   The header and index are only written when logging stops. After
+//   a power loss the blocks can still be read up to the first
+//   block header that does not match.
+//
+// Read the log with software/releases/ips2_black_box/read_sd_log.py.
+
+#include "sd_log.h"
+
+#ifdef TFT_INSTALLED
+
+// Ring buffer, in the second RAM bank.
+DMAMEM static uint8_t sd_log_buffer[SD_LOG_BUFFER_BYTES];
+DMAMEM static uint8_t sd_log_index[SD_LOG_INDEX_SECTORS * SD_LOG_SECTOR_BYTES];
+DMAMEM static uint8_t sd_log_header[SD_LOG_SECTOR_BYTES];
+
+SdLog::SdLog() {}
+
+void SdLog::Setup(bool sd_log_enable, int megabytes, int sample_period,
+int sd_clock_mhz, TftDisplay *Tft, int debug_level) {
+
+  debug_level_ = debug_level;
+  enable_ = sd_log_enable;
+  sample_period_ = sample_period;
+  sd_clock_mhz_ = sd_clock_mhz > 0 ? sd_clock_mhz : 1;
+  Tft_ = Tft;
+  Sd_ = nullptr;
+  Card_ = nullptr;
+
+  // FAT32 files are less than 4 GB.
+  if (megabytes > 4095) {
+    megabytes = 4095;
+  }
+  if (megabytes < 1) {
+    megabytes = 1;
+  }
+  megabytes_ = megabytes;
+
+  ready_ = false;
+  logging_ = false;
+  finishing_ = false;
+  stop_reason_ = "";
+  stream_open_ = false;
+  frames_ = 0;
+  produced_bytes_ = 0;
+  data_capacity_ = 0;
+  overflow_frames_ = 0;
+  max_write_micros_ = 0;
+
+  if (enable_ == true) {
+    Start();
+  }
+}
+
+// Change the sample period while running. The file header has the
+// period when logging stopped. Each block and index entry has its
+// start time.
+void SdLog::SetSamplePeriod(int sample_period) {
+  sample_period_ = sample_period;
+}
+
+// Returns true if the command was a SD log command.
+bool SdLog::ParseCommand(const char *command, CommandLine *Cmd) {
+
+  const char *arguments = CommandLine::Arguments(command, "sdlog");
+  if (arguments == nullptr) {
+    return false;
+  }
+
+  char reply[COMMAND_REPLY_LENGTH];
+
+  if (strcmp(arguments, "start") == 0) {
+    if (logging_ == true) {
+      Cmd->Reply("SD log is already on.");
+    }
+    else if (finishing_ == true) {
+      Cmd->Reply("Error - SD log is still writing the last log.");
+    }
+    else {
+      Start();
+      if (logging_ == true) {
+        snprintf(reply, COMMAND_REPLY_LENGTH, "SD log on, /log%03d.bin.",
+        file_number_);
+        Cmd->Reply(reply);
+      }
+      else {
+        Cmd->Reply("Error - could not start the SD log.");
+      }
+    }
+  }
+  else if (strcmp(arguments, "stop") == 0) {
+    Stop("command");
+    Cmd->Reply("SD log stopping.");
+  }
+  else if (*arguments == 0) {
+    float minutes = frames_ * (sample_period_ * 1.0e-6 / 60.0);
+    float percent = 0.0;
+    if (ready_ == true && data_capacity_ > 0) {
+      percent = (100.0 * produced_bytes_) / data_capacity_;
+    }
+    snprintf(reply, COMMAND_REPLY_LENGTH,
+    "SD log %s, %.1f minutes, %.1f%% full, %lu overflow frames, "
+    "longest write %lu us.",
+    logging_ ? "on" : (finishing_ ? "stopping" : "off"), minutes, percent,
+    static_cast<unsigned long>(overflow_frames_), max_write_micros_);
+    Cmd->Reply(reply);
+  }
+  else {
+    Cmd->Reply("Error - use sdlog, sdlog start, or sdlog stop.");
+  }
+  return true;
+}
+
+// Code one frame into the RAM buffer. Never waits for the card.
+void SdLog::AddFrame(const unsigned int *adc_values,
+const bool *hammer_event, const float *hammer_velocity,
+const bool *damper_event) {
+
+  if (logging_ == false) {
+    return;
+  }
+
+  // Room for the end of a block, a block header, and the frame,
+  // plus one byte so that the block can always be ended.
+  const uint32_t needed = FRAME_CODER_MAX_BYTES + SD_LOG_BLOCK_HEADER_BYTES + 2;
+  if (produced_bytes_ + needed > data_capacity_) {
+    Stop("file full");
+    return;
+  }
+  if (FreeBytes() < needed) {
+    // The next logged frame starts a new block, so the decoder
+    // sees the gap from the frame numbers.
+    EndBlock();
+    overflow_frames_++;
+    frames_++;
+    return;
+  }
+
+  if (block_open_ == false || Coder_.Frames() >= SD_LOG_BLOCK_FRAMES) {
+    StartBlock();
+  }
+  PutBytes(coded_, Coder_.AddFrame(adc_values, hammer_event,
+  hammer_velocity, damper_event, coded_));
+  frames_++;
+}
+
+// Call often, with the time the next sample starts. Writes sectors
+// to the card until the card is busy or there is no time left.
+void SdLog::Write(unsigned long deadline_micros) {
+
+  if (Card_ == nullptr || (logging_ == false && finishing_ == false)) {
+    return;
+  }
+
+  while (static_cast<long>(deadline_micros - micros()) >
+  static_cast<long>(write_micros_ + SD_LOG_MARGIN_MICROS)) {
+
+    if (write_stage_ == write_data) {
+      if (produced_bytes_ / SD_LOG_SECTOR_BYTES > written_sectors_) {
+        if (Card_->isBusy() == true) {
+          busy_waits_++;
+          return;
+        }
+        if (stream_open_ == false) {
+          if (Card_->writeStart(first_sector_ + SD_LOG_DATA_SECTOR +
+          written_sectors_) == false) {
+            Fail("Could not start writing the SD log.");
+            return;
+          }
+          stream_open_ = true;
+          continue;
+        }
+        if (WriteSector(&sd_log_buffer[(written_sectors_ &
+        (SD_LOG_BUFFER_SECTORS - 1)) * SD_LOG_SECTOR_BYTES]) == false) {
+          return;
+        }
+        written_sectors_++;
+      }
+      else if (finishing_ == true) {
+        // Pad the last sector, finish the data, then the header.
+        uint32_t pad = (SD_LOG_SECTOR_BYTES -
+        produced_bytes_ % SD_LOG_SECTOR_BYTES) % SD_LOG_SECTOR_BYTES;
+        if (pad > 0) {
+          memset(coded_, 0, pad);
+          PutBytes(coded_, pad);
+          continue;
+        }
+        if (stream_open_ == true) {
+          if (Card_->isBusy() == true) {
+            busy_waits_++;
+            return;
+          }
+          Card_->writeStop();
+          stream_open_ = false;
+          continue;
+        }
+        MakeHeader();
+        write_stage_ = write_header;
+        header_sector_ = 0;
+      }
+      else {
+        return;
+      }
+    }
+
+    else if (write_stage_ == write_header) {
+      if (Card_->isBusy() == true) {
+        busy_waits_++;
+        return;
+      }
+      if (stream_open_ == false) {
+        if (Card_->writeStart(first_sector_) == false) {
+          Fail("Could not write the SD log header.");
+          return;
+        }
+        stream_open_ = true;
+      }
+      else if (header_sector_ <= SD_LOG_INDEX_SECTORS) {
+        const uint8_t *sector = header_sector_ == 0 ? sd_log_header :
+        &sd_log_index[(header_sector_ - 1) * SD_LOG_SECTOR_BYTES];
+        if (WriteSector(sector) == false) {
+          return;
+        }
+        header_sector_++;
+      }
+      else {
+        Card_->writeStop();
+        stream_open_ = false;
+        write_stage_ = write_data;
+        finishing_ = false;
+        Tft_->LockSdCard(false);
+        if (debug_level_ >= DEBUG_INFO) {
+          Serial.printf("SD log /log%03d.bin stopped, %s. %lu frames, "
+          "%lu overflow frames.\n", file_number_, stop_reason_,
+          static_cast<unsigned long>(frames_),
+          static_cast<unsigned long>(overflow_frames_));
+        }
+        return;
+      }
+    }
+
+    else {
+      return;
+    }
+  }
+}
+
+// Frames, and how well the card keeps up, while logging.
+void SdLog::PrintStatistics() {
+  if (debug_level_ >= DEBUG_STATS && logging_ == true) {
+    Serial.printf("SD log %lu frames, %lu overflow, %lu busy, "
+    "write %lu us, longest %lu us, buffer %lu bytes free.\n",
+    static_cast<unsigned long>(frames_),
+    static_cast<unsigned long>(overflow_frames_),
+    static_cast<unsigned long>(busy_waits_), write_micros_,
+    max_write_micros_, static_cast<unsigned long>(FreeBytes()));
+  }
+}
+
+// Private methods. ////////
+
+// Create the next /logNNN.bin and allocate all of it.
+bool SdLog::Open() {
+
+  Sd_ = Tft_->SdCard();
+  if (Sd_ == nullptr) {
+    Fail("SD log needs the TFT and a working SD card.");
+    return false;
+  }
+
+  char name[16];
+  for (file_number_ = 0; file_number_ < 1000; file_number_++) {
+    snprintf(name, sizeof(name), "/log%03d.bin", file_number_);
+    if (Sd_->exists(name) == false) {
+      break;
+    }
+  }
+  if (file_number_ >= 1000) {
+    Fail("Too many SD log files.");
+    return false;
+  }
+
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.printf("Allocating %lu MB for SD log %s.\n",
+    static_cast<unsigned long>(megabytes_), name);
+  }
+  File32 file = Sd_->open(name, O_RDWR | O_CREAT | O_TRUNC);
+  if (!file) {
+    Fail("Could not create the SD log file.");
+    return false;
+  }
+  if (file.preAllocate(megabytes_ * 1024UL * 1024UL) == false ||
+  file.contiguousRange(&first_sector_, &last_sector_) == false) {
+    file.close();
+    Fail("Could not allocate the SD log file, the card may be full.");
+    return false;
+  }
+  file.close();
+
+  Card_ = Sd_->card();
+  data_capacity_ = (last_sector_ - first_sector_ + 1 - SD_LOG_DATA_SECTOR) *
+  SD_LOG_SECTOR_BYTES;
+
+  Coder_.Setup();
+  block_open_ = false;
+  blocks_ = 0;
+  frames_ = 0;
+  produced_bytes_ = 0;
+  written_sectors_ = 0;
+  write_stage_ = write_data;
+  stream_open_ = false;
+  // Estimate until sectors are measured.
+  write_micros_ = (8 * SD_LOG_SECTOR_BYTES) / sd_clock_mhz_ + 10;
+  window_max_micros_ = 0;
+  window_count_ = 0;
+  index_entries_ = 0;
+  memset(sd_log_index, 0, sizeof(sd_log_index));
+  overflow_frames_ = 0;
+  busy_waits_ = 0;
+  max_write_micros_ = 0;
+
+  ready_ = true;
+  return true;
+}
+
+// Logging continues in the same file after a stop.
+void SdLog::Start() {
+  if (ready_ == false && Open() == false) {
+    return;
+  }
+  Tft_->LockSdCard(true);
+  logging_ = true;
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.printf("SD log /log%03d.bin started.\n", file_number_);
+    if (static_cast<int>(write_micros_ + SD_LOG_MARGIN_MICROS) >=
+    sample_period_) {
+      Serial.printf("SD log sectors take about %lu us at %d MHz, longer than a sample.\n",
+      write_micros_, sd_clock_mhz_);
+      Serial.println("Raise tft_sd_clock_mhz, or most frames overflow.");
+    }
+  }
+}
+
+// The rest is done by Write().
+void SdLog::Stop(const char *reason) {
+  if (logging_ == false) {
+    return;
+  }
+  EndBlock();
+  logging_ = false;
+  finishing_ = true;
+  stop_reason_ = reason;
+}
+
+void SdLog::StartBlock() {
+  EndBlock();
+  if (blocks_ % SD_LOG_INDEX_INTERVAL == 0) {
+    AddIndex();
+  }
+  uint32_t now = micros();
+  uint8_t header[SD_LOG_BLOCK_HEADER_BYTES];
+  header[0] = 'S';
+  header[1] = 'L';
+  header[2] = file_number_ & 255;
+  header[3] = (file_number_ >> 8) & 255;
+  for (int shift = 0; shift < 4; shift++) {
+    header[4 + shift] = (frames_ >> (8*shift)) & 255;
+    header[8 + shift] = (now >> (8*shift)) & 255;
+  }
+  PutBytes(header, SD_LOG_BLOCK_HEADER_BYTES);
+  Coder_.StartBlock();
+  block_open_ = true;
+  blocks_++;
+}
+
+void SdLog::EndBlock() {
+  if (block_open_ == true) {
+    PutBytes(coded_, Coder_.EndBlock(coded_));
+    block_open_ = false;
+  }
+}
+
+void SdLog::PutBytes(const uint8_t *data, int num_bytes) {
+  uint32_t address = produced_bytes_ & (SD_LOG_BUFFER_BYTES - 1);
+  uint32_t first = SD_LOG_BUFFER_BYTES - address;
+  if (first > static_cast<uint32_t>(num_bytes)) {
+    first = num_bytes;
+  }
+  memcpy(&sd_log_buffer[address], data, first);
+  memcpy(sd_log_buffer, data + first, num_bytes - first);
+  produced_bytes_ += num_bytes;
+}
+
+uint32_t SdLog::FreeBytes() {
+  return SD_LOG_BUFFER_BYTES -
+  (produced_bytes_ - written_sectors_ * SD_LOG_SECTOR_BYTES);
+}
+
+// Location of the block about to start.
+void SdLog::AddIndex() {
+  if (index_entries_ >= SD_LOG_INDEX_ENTRIES) {
+    return;
+  }
+  uint8_t *entry = &sd_log_index[
+  (index_entries_ / SD_LOG_INDEX_PER_SECTOR) * SD_LOG_SECTOR_BYTES +
+  (index_entries_ % SD_LOG_INDEX_PER_SECTOR) * SD_LOG_INDEX_ENTRY_BYTES];
+  uint32_t now = micros();
+  for (int shift = 0; shift < 4; shift++) {
+    entry[shift] = (produced_bytes_ >> (8*shift)) & 255;
+    entry[4 + shift] = (frames_ >> (8*shift)) & 255;
+    entry[8 + shift] = (now >> (8*shift)) & 255;
+  }
+  index_entries_++;
+}
+
+void SdLog::MakeHeader() {
+  memset(sd_log_header, 0, SD_LOG_SECTOR_BYTES);
+  memcpy(sd_log_header, "STEMLOG1", 8);
+  sd_log_header[8] = file_number_ & 255;
+  sd_log_header[9] = (file_number_ >> 8) & 255;
+  sd_log_header[10] = NUM_CHANNELS;
+  sd_log_header[16] = SD_LOG_BLOCK_FRAMES & 255;
+  sd_log_header[17] = (SD_LOG_BLOCK_FRAMES >> 8) & 255;
+  sd_log_header[18] = SD_LOG_INDEX_SECTORS & 255;
+  sd_log_header[19] = (SD_LOG_INDEX_SECTORS >> 8) & 255;
+  for (int shift = 0; shift < 4; shift++) {
+    sd_log_header[12 + shift] = (sample_period_ >> (8*shift)) & 255;
+  }
+  // Bytes 20 to 59.
+  uint32_t values[10] = {
+    SD_LOG_INDEX_INTERVAL,
+    static_cast<uint32_t>(index_entries_),
+    produced_bytes_,
+    frames_,
+    blocks_,
+    overflow_frames_,
+    Coder_.EventsDropped(),
+    Coder_.Escapes(),
+    static_cast<uint32_t>(max_write_micros_),
+    busy_waits_
+  };
+  for (int ind = 0; ind < 10; ind++) {
+    for (int shift = 0; shift < 4; shift++) {
+      sd_log_header[20 + 4*ind + shift] = (values[ind] >> (8*shift)) & 255;
+    }
+  }
+  strncpy(reinterpret_cast<char *>(&sd_log_header[60]), stop_reason_, 31);
+}
+
+// Write one sector of a multiple-sector write and measure how long
+// it takes. The longest time in the last 256 sectors is used to
+// decide if there is time for the next one.
+bool SdLog::WriteSector(const uint8_t *sector) {
+  unsigned long start = micros();
+  if (Card_->writeData(sector) == false) {
+    Fail("SD log write failed.");
+    return false;
+  }
+  unsigned long elapsed = micros() - start;
+  if (elapsed > max_write_micros_) {
+    max_write_micros_ = elapsed;
+  }
+  if (elapsed > window_max_micros_) {
+    window_max_micros_ = elapsed;
+  }
+  if (elapsed > write_micros_) {
+    write_micros_ = elapsed;
+  }
+  if (++window_count_ >= 256) {
+    write_micros_ = window_max_micros_;
+    window_max_micros_ = 0;
+    window_count_ = 0;
+  }
+  return true;
+}
+
+void SdLog::Fail(const char *message) {
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.println(message);
+  }
+  if (stream_open_ == true && Card_ != nullptr) {
+    Card_->writeStop();
+  }
+  stream_open_ = false;
+  logging_ = false;
+  finishing_ = false;
+  ready_ = false;
+  Card_ = nullptr;
+  if (Tft_ != nullptr) {
+    Tft_->LockSdCard(false);
+  }
+}
+
+#else
+
+SdLog::SdLog() {}
+
+void SdLog::Setup(bool sd_log_enable, int not_used, int not_used_2,
+int not_used_3, TftDisplay *not_used_4, int debug_level) {
+  if (sd_log_enable == true && debug_level >= DEBUG_INFO) {
+    Serial.println("SD log needs the TFT, which is not in build.");
+  }
+}
+
+void SdLog::SetSamplePeriod(int a) {}
+
+bool SdLog::ParseCommand(const char *a, CommandLine *b) {
+  return false;
+}
+
+void SdLog::AddFrame(const unsigned int *a, const bool *b, const float *c,
+const bool *d) {}
+
+void SdLog::Write(unsigned long a) {}
+
+void SdLog::PrintStatistics() {}
+
+#endif
@@ -0,0 +1,162 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// sd_log.h
+//
+// For ips pcb version 2.X
+//
+// Logging of raw frames and events to the SD card on the TFT.
+
+#ifndef SD_LOG_H_
+#define SD_LOG_H_
+
+#include "stem_piano_ips2.h"
+#include "command_line.h"
+#include "tft_display.h"
+
+#ifdef TFT_INSTALLED
+
+#include "frame_coder.h"
+
+#define SD_LOG_SECTOR_BYTES 512
+
+// RAM buffer between the sample loop and the SD card, in sectors.
+// A 128 kB ring. The writer takes any full sector after the last
+// one written. Must be a power of 2.
+#define SD_LOG_BUFFER_SECTORS 256
+#define SD_LOG_BUFFER_BYTES (SD_LOG_BUFFER_SECTORS * SD_LOG_SECTOR_BYTES)
+
+// Frames per block. Each block has a header and starts with an
+// uncompressed frame, see sd_log.cpp.
+#define SD_LOG_BLOCK_FRAMES 256
+#define SD_LOG_BLOCK_HEADER_BYTES 12
+
+// Time index, written after the header sector when logging stops.
+// One entry every SD_LOG_INDEX_INTERVAL blocks, about 4 seconds.
+#define SD_LOG_INDEX_SECTORS 64
+#define SD_LOG_INDEX_ENTRY_BYTES 12
+#define SD_LOG_INDEX_PER_SECTOR (SD_LOG_SECTOR_BYTES / SD_LOG_INDEX_ENTRY_BYTES)
+#define SD_LOG_INDEX_ENTRIES (SD_LOG_INDEX_SECTORS * SD_LOG_INDEX_PER_SECTOR)
+#define SD_LOG_INDEX_INTERVAL 64
+
+// Time kept free before the next sample when writing a sector.
+#define SD_LOG_MARGIN_MICROS 10
+
+// First sector of the data, after the header and the index.
+#define SD_LOG_DATA_SECTOR (1 + SD_LOG_INDEX_SECTORS)
+
+class SdLog
+{
+  public:
+    SdLog();
+    void Setup(bool, int, int, int, TftDisplay *, int);
+    void SetSamplePeriod(int);
+    bool ParseCommand(const char *, CommandLine *);
+    void AddFrame(const unsigned int *, const bool *, const float *,
+    const bool *);
+    void Write(unsigned long);
+    void PrintStatistics();
+
+  private:
+    bool Open();
+    void Start();
+    void Stop(const char *);
+    void StartBlock();
+    void EndBlock();
+    void PutBytes(const uint8_t *, int);
+    uint32_t FreeBytes();
+    void AddIndex();
+    void MakeHeader();
+    bool WriteSector(const uint8_t *);
+    void Fail(const char *);
+
+    int debug_level_;
+    bool enable_;
+    int sample_period_;
+    uint32_t megabytes_;
+    int sd_clock_mhz_;
+
+    TftDisplay *Tft_;
+    SdFat *Sd_;
+    SdCard *Card_;
+
+    // The log file is contiguous from first_sector_ to last_sector_.
+    int file_number_;
+    uint32_t first_sector_;
+    uint32_t last_sector_;
+    uint32_t data_capacity_;
+
+    bool ready_;
+    bool logging_;
+    bool finishing_;
+    const char *stop_reason_;
+
+    // Coding of the frames, in the sample loop.
+    FrameCoder Coder_;
+    uint8_t coded_[FRAME_CODER_MAX_BYTES];
+    bool block_open_;
+    uint32_t blocks_;
+    uint32_t frames_;
+
+    // Bytes put in the buffer and sectors written, since the start
+    // of the data. The buffer address is the count modulo the size.
+    uint32_t produced_bytes_;
+    uint32_t written_sectors_;
+
+    // Writing to the card, in the time left over after each sample.
+    enum WriteStage {
+      write_data = 0,
+      write_header = 1,
+      write_done = 2
+    };
+    int write_stage_;
+    int header_sector_;
+    bool stream_open_;
+    unsigned long write_micros_;
+    unsigned long window_max_micros_;
+    int window_count_;
+
+    int index_entries_;
+
+    // Statistics.
+    uint32_t overflow_frames_;
+    uint32_t busy_waits_;
+    unsigned long max_write_micros_;
+
+};
+
+#else
+
+class SdLog
+{
+  public:
+    SdLog();
+    void Setup(bool, int, int, int, TftDisplay *, int);
+    void SetSamplePeriod(int);
+    bool ParseCommand(const char *, CommandLine *);
+    void AddFrame(const unsigned int *, const bool *, const float *,
+    const bool *);
+    void Write(unsigned long);
+    void PrintStatistics();
+
+};
+
+#endif
+
+#endif
@@ -171,8 +171,10 @@ void SixChannelAnalog00::GetNewAdcValues(unsigned int *adc_array, int test_index
         // [mux16_next, mux8_next].
         // Write 0xFF so that DIN stays high.
         if (using18bitadc_ == true) {
-          // Not getting two lower bits. Force them to zero.
-          adc_array[adc_ind++] = (SPI.transfer16(0xFF) << 2);
+          // 18 bits are clocked out MSB first. SPI transfers are
+          // byte-sized so clock 24 bits and keep the upper 18.
+          adc_array[adc_ind] = (SPI.transfer16(0xFF) << 2);
+          adc_array[adc_ind++] |= (SPI.transfer(0xFF) >> 6);
         }
         else {
           adc_array[adc_ind++] = SPI.transfer16(0xFF);
@@ -201,6 +203,7 @@ void SixChannelAnalog00::GetNewAdcValues(unsigned int *adc_array, int test_index
     digitalWriteFast(convst_, LOW);
     if (using18bitadc_ == true) {
       adc_array[test_index] = (SPI.transfer16(0xFF) << 2);
+      adc_array[test_index] |= (SPI.transfer(0xFF) >> 6);
     }
     else {
       adc_array[test_index] = SPI.transfer16(0xFF);
@@ -210,6 +213,56 @@ void SixChannelAnalog00::GetNewAdcValues(unsigned int *adc_array, int test_index
   SPI.endTransaction();
 }
 
+// Sample only the channels in adc_channel[], in that order, and put
+// the values in adc_array[0, ..., num_channels-1]. Same pipelining as
+// GetNewAdcValues(). The channel numbers are ADC channels (see
+// KeyToAdcChannel()). The first conversion uses whatever channel the
+// muxes were left at, so the first call after a list change returns
+// one stale value.
+void SixChannelAnalog00::GetCaptureAdcValues(unsigned int *adc_array,
+const int *adc_channel, int num_channels) {
+  SPI.beginTransaction(SPISettings(sclk_frequency_, MSBFIRST, SPI_MODE1));
+  int next, mux8_next, mux16_next;
+  for (int ind = 0; ind < num_channels; ind++) {
+    digitalWriteFast(convst_, HIGH);
+    next = ind + 1;
+    if (next == num_channels) {
+      next = 0;
+    }
+    mux8_next = adc_channel[next] >> 4;
+    mux16_next = adc_channel[next] & 0x0F;
+    digitalWriteFast(mux16_1_pin_s0_, mux16_0_[mux16_next]);
+    digitalWriteFast(mux16_1_pin_s1_, mux16_1_[mux16_next]);
+    digitalWriteFast(mux16_1_pin_s2_, mux16_2_[mux16_next]);
+    digitalWriteFast(mux16_1_pin_s3_, mux16_3_[mux16_next]);
+    digitalWriteFast(mux8_1_pin_a_, mux8_a_[mux8_next]);
+    digitalWriteFast(mux8_1_pin_b_, mux8_b_[mux8_next]);
+    digitalWriteFast(mux8_1_pin_c_, mux8_c_[mux8_next]);
+    delayNanoseconds(ADC_CONVERSION_NANOSECONDS);
+    digitalWriteFast(convst_, LOW);
+    if (using18bitadc_ == true) {
+      adc_array[ind] = (SPI.transfer16(0xFF) << 2);
+      adc_array[ind] |= (SPI.transfer(0xFF) >> 6);
+    }
+    else {
+      adc_array[ind] = SPI.transfer16(0xFF);
+    }
+    digitalWrite(din_, HIGH);
+  }
+  SPI.endTransaction();
+}
+
+// Inverse of ReorderAdcValues(). Return the ADC channel, as
+// used by GetCaptureAdcValues() and test_index, for a key index.
+int SixChannelAnalog00::KeyToAdcChannel(int key) {
+  int channel = reorder_list_[key];
+  // Back row is the lower 8 channels of each group of 16.
+  if ((channel & 0x08) == 0) {
+    channel = (channel & ~0x07) | (7 - (channel & 0x07));
+  }
+  return channel;
+}
+
 // diff_scale_raw: adjust if differential but otherwise no changes.
 // normalized_float: scale to [0.0,1.0], where 1.0 is the max ADC value.
 void SixChannelAnalog00::NormalizeAdcValues(int *diff_scale_raw,
@@ -53,6 +53,8 @@ class SixChannelAnalog00
     SixChannelAnalog00();
     void Setup(int, bool, bool, float, float, float, const int *, TestpointLed *);
     void GetNewAdcValues(unsigned int *, int);
+    void GetCaptureAdcValues(unsigned int *, const int *, int);
+    int KeyToAdcChannel(int);
     void NormalizeAdcValues(int *, float *, const unsigned int *);
     void ReorderAdcValues(unsigned int *, const unsigned int *);
  
@@ -65,6 +65,18 @@
 // immediately below NUM_CHANNELS reminds of the relationship.
 #define NUM_NOTES 88
 
+// Maximum number of channels in the high-speed capture mode.
+// Using a #define because statically allocates arrays.
+#define CAPTURE_MAX_CHANNELS 8
+
+// Number of points in a velocity curve table setting.
+// Using a #define because statically allocates arrays.
+#define VELOCITY_CURVE_POINTS 17
+
+// Maximum number of pedal inputs.
+// Using a #define because statically allocates arrays.
+#define MAX_PEDALS 8
+
 // Better if this is in the midi class.
 #define MIDI_BUFFER_SIZE 128
 
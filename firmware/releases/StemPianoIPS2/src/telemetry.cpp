@@ -0,0 +1,156 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// telemetry.cpp
+//
+// This class is not hardware dependent.
+//
+// Per-stage processing time and event counters.
+//
+// Stage times use the processor cycle counter. Each StageEnd() call
+// charges the cycles since the previous mark to that stage. Once per
+// interval, when enabled, one line of text is sent:
+//   telemetry frames=F overruns=O hammer=H damper=D frame=avg/max
+//     adc=avg/max cal=avg/max dsp=avg/max midi=avg/max eth=avg/max
+//     status=avg/max
+// All times are in microseconds. An overrun is a frame whose
+// processing took longer than the sample period.
+//
+// Commands (serial monitor or Ethernet, see command_line.cpp):
+//   telemetry on    Send telemetry to where this command came from.
+//   telemetry off   Stop sending telemetry.
+
+#include "telemetry.h"
+
+Telemetry::Telemetry() {}
+
+void Telemetry::Setup(int interval_millis, int sample_period_microseconds,
+int debug_level) {
+  debug_level_ = debug_level;
+  enable_ = false;
+  to_network_ = false;
+  interval_millis_ = static_cast<unsigned long>(interval_millis);
+  last_millis_ = millis();
+  ResetInterval(sample_period_microseconds);
+  Clear();
+}
+
+// Returns true if the command was a telemetry command.
+bool Telemetry::ParseCommand(const char *command, CommandLine *Cmd) {
+  if (strcmp(command, "telemetry on") == 0) {
+    enable_ = true;
+    to_network_ = Cmd->LastCommandFromNetwork();
+    Clear();
+    last_millis_ = millis();
+    Cmd->Reply("Telemetry is on.");
+    return true;
+  }
+  else if (strcmp(command, "telemetry off") == 0) {
+    enable_ = false;
+    Cmd->Reply("Telemetry is off.");
+    return true;
+  }
+  return false;
+}
+
+// Sample period for counting overruns.
+void Telemetry::ResetInterval(int sample_period_microseconds) {
+  sample_period_cycles_ = static_cast<uint32_t>(sample_period_microseconds) *
+  (F_CPU_ACTUAL / 1000000);
+}
+
+void Telemetry::FrameStart() {
+  frame_start_cycles_ = ARM_DWT_CYCCNT;
+  stage_start_cycles_ = frame_start_cycles_;
+}
+
+void Telemetry::StageEnd(int stage) {
+  uint32_t now = ARM_DWT_CYCCNT;
+  uint32_t cycles = now - stage_start_cycles_;
+  stage_start_cycles_ = now;
+  stage_sum_cycles_[stage] += cycles;
+  if (cycles > stage_max_cycles_[stage]) {
+    stage_max_cycles_[stage] = cycles;
+  }
+}
+
+void Telemetry::CountEvents(const bool *hammer_event, const bool *damper_event) {
+  for (int key = 0; key < NUM_NOTES; key++) {
+    if (hammer_event[key] == true) {
+      hammer_events_++;
+    }
+    if (damper_event[key] == true) {
+      damper_events_++;
+    }
+  }
+}
+
+// Call once at the end of every frame.
+void Telemetry::Update(CommandLine *Cmd) {
+
+  uint32_t frame_cycles = ARM_DWT_CYCCNT - frame_start_cycles_;
+  frames_++;
+  frame_sum_cycles_ += frame_cycles;
+  if (frame_cycles > frame_max_cycles_) {
+    frame_max_cycles_ = frame_cycles;
+  }
+  if (frame_cycles > sample_period_cycles_) {
+    overruns_++;
+  }
+
+  if (millis() - last_millis_ > interval_millis_) {
+    last_millis_ = millis();
+    if (enable_ == true && frames_ > 0) {
+      const char *stage_name[TELEMETRY_NUM_STAGES] =
+      {"adc", "cal", "dsp", "midi", "eth", "status"};
+      float cycles_per_micro = static_cast<float>(F_CPU_ACTUAL / 1000000);
+      char line[COMMAND_REPLY_LENGTH];
+      int length = snprintf(line, COMMAND_REPLY_LENGTH,
+      "telemetry frames=%lu overruns=%lu hammer=%lu damper=%lu frame=%.1f/%.1f",
+      frames_, overruns_, hammer_events_, damper_events_,
+      frame_sum_cycles_ / (frames_ * cycles_per_micro),
+      frame_max_cycles_ / cycles_per_micro);
+      for (int stage = 0; stage < TELEMETRY_NUM_STAGES; stage++) {
+        if (length < COMMAND_REPLY_LENGTH) {
+          length += snprintf(line + length, COMMAND_REPLY_LENGTH - length,
+          " %s=%.1f/%.1f", stage_name[stage],
+          stage_sum_cycles_[stage] / (frames_ * cycles_per_micro),
+          stage_max_cycles_[stage] / cycles_per_micro);
+        }
+      }
+      Cmd->Send(line, to_network_);
+    }
+    Clear();
+  }
+}
+
+// Private methods. ////////
+
+void Telemetry::Clear() {
+  for (int stage = 0; stage < TELEMETRY_NUM_STAGES; stage++) {
+    stage_max_cycles_[stage] = 0;
+    stage_sum_cycles_[stage] = 0;
+  }
+  frame_max_cycles_ = 0;
+  frame_sum_cycles_ = 0;
+  frames_ = 0;
+  overruns_ = 0;
+  hammer_events_ = 0;
+  damper_events_ = 0;
+}
@@ -0,0 +1,78 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// telemetry.h
+//
+// This class is not hardware dependent.
+//
+// Per-stage processing time and event counters.
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "stem_piano_ips2.h"
+#include "command_line.h"
+
+// Processing stages within one sample period.
+#define TELEMETRY_ADC     0
+#define TELEMETRY_CAL     1
+#define TELEMETRY_DSP     2
+#define TELEMETRY_MIDI    3
+#define TELEMETRY_NETWORK 4
+#define TELEMETRY_STATUS  5
+#define TELEMETRY_NUM_STAGES 6
+
+class Telemetry
+{
+  public:
+    Telemetry();
+    void Setup(int, int, int);
+    bool ParseCommand(const char *, CommandLine *);
+    void ResetInterval(int);
+    void FrameStart();
+    void StageEnd(int);
+    void CountEvents(const bool *, const bool *);
+    void Update(CommandLine *);
+
+  private:
+    void Clear();
+
+    int debug_level_;
+    bool enable_;
+    bool to_network_;
+
+    unsigned long interval_millis_;
+    unsigned long last_millis_;
+    uint32_t sample_period_cycles_;
+
+    uint32_t frame_start_cycles_;
+    uint32_t stage_start_cycles_;
+    uint32_t stage_max_cycles_[TELEMETRY_NUM_STAGES];
+    uint64_t stage_sum_cycles_[TELEMETRY_NUM_STAGES];
+    uint32_t frame_max_cycles_;
+    uint64_t frame_sum_cycles_;
+
+    unsigned long frames_;
+    unsigned long overruns_;
+    unsigned long hammer_events_;
+    unsigned long damper_events_;
+
+};
+
+#endif
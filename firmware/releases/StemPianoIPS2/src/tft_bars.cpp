@@ -0,0 +1,162 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// tft_bars.cpp
+//
+// For ips pcb version 2.X
+//
+// Live bar graph of all key positions on the TFT display.
+//
+// Hammer positions are drawn as bars on the upper half of the screen
+// and damper positions on the lower half. A marker between them turns
+// on for a short time when a hammer strikes.
+//
+// Summarize() and Events() run every sample and only change what the
+// bar graph should show. Draw() compares that with what the display
+// shows, and for each difference grows or shrinks a bar by at most
+// TFT_BARS_MAX_STEP pixels, until the time budget is used. So a large
+// change takes a few steps, and no single transfer is long.
+
+#include "tft_bars.h"
+
+#ifdef TFT_INSTALLED
+
+TftBars::TftBars() {}
+
+// x0 is the left edge of the lowest key. The remaining values are
+// pixel rows from the top of the screen.
+void TftBars::Setup(Adafruit_ILI9341 *tft, int x0, int hammer_base,
+int marker_top, int damper_base, int bar_height) {
+  TftPointer_ = tft;
+  x0_ = x0;
+  hammer_base_ = hammer_base;
+  marker_top_ = marker_top;
+  damper_base_ = damper_base;
+  bar_height_ = bar_height;
+  for (int key = 0; key < TFT_BARS_KEYS; key++) {
+    hammer_want_[key] = 0;
+    damper_want_[key] = 0;
+    marker_want_[key] = false;
+    marker_micros_[key] = 0;
+  }
+  Blank();
+}
+
+// Positions are [0.0 to 1.0]. Call every sample.
+void TftBars::Summarize(const float *hammer_position,
+const float *damper_position) {
+  for (int key = 0; key < TFT_BARS_KEYS; key++) {
+    int height = constrain(static_cast<int>(hammer_position[key] *
+    bar_height_), 0, bar_height_);
+    if (abs(height - hammer_shown_[key]) > TFT_BARS_DEADBAND ||
+    height == 0 || height == bar_height_) {
+      hammer_want_[key] = height;
+    }
+    height = constrain(static_cast<int>(damper_position[key] *
+    bar_height_), 0, bar_height_);
+    if (abs(height - damper_shown_[key]) > TFT_BARS_DEADBAND ||
+    height == 0 || height == bar_height_) {
+      damper_want_[key] = height;
+    }
+  }
+}
+
+// Hammer strike events. Call every sample the events are valid.
+void TftBars::Events(const bool *hammer_event) {
+  unsigned long now = micros();
+  for (int key = 0; key < TFT_BARS_KEYS; key++) {
+    if (hammer_event[key] == true) {
+      marker_want_[key] = true;
+      marker_micros_[key] = now;
+    }
+    else if (marker_want_[key] == true &&
+    now - marker_micros_[key] > TFT_BARS_MARKER_MICROS) {
+      marker_want_[key] = false;
+    }
+  }
+}
+
+// Call after the display was cleared.
+void TftBars::Blank() {
+  for (int key = 0; key < TFT_BARS_KEYS; key++) {
+    hammer_shown_[key] = 0;
+    damper_shown_[key] = 0;
+    marker_shown_[key] = false;
+  }
+  cursor_ = 0;
+}
+
+// Returns true if the display shows the whole bar graph.
+bool TftBars::Draw(unsigned long start_micros, unsigned long budget_micros) {
+  int clean = 0;
+  while (clean < TFT_BARS_KEYS && micros() - start_micros < budget_micros) {
+    int key = cursor_;
+    int x = x0_ + TFT_BARS_PITCH*key;
+    bool drew = DrawBar(x, hammer_base_, &hammer_shown_[key],
+    hammer_want_[key], ILI9341_YELLOW);
+    drew |= DrawBar(x, damper_base_, &damper_shown_[key],
+    damper_want_[key], ILI9341_CYAN);
+    if (marker_want_[key] != marker_shown_[key]) {
+      TftPointer_->fillRect(x, marker_top_, TFT_BARS_WIDTH, 4,
+      marker_want_[key] == true ? ILI9341_RED : ILI9341_BLACK);
+      marker_shown_[key] = marker_want_[key];
+      drew = true;
+    }
+    if (drew == true) {
+      clean = 0;
+    }
+    else {
+      clean++;
+    }
+    cursor_++;
+    if (cursor_ >= TFT_BARS_KEYS) {
+      cursor_ = 0;
+    }
+  }
+  return clean >= TFT_BARS_KEYS;
+}
+
+// Key under a horizontal pixel position, or -1 if none.
+int TftBars::KeyAt(int x) {
+  int key = (x - x0_) / TFT_BARS_PITCH;
+  if (x < x0_ || key >= TFT_BARS_KEYS) {
+    return -1;
+  }
+  return key;
+}
+
+// Private methods. ////////
+
+// Grow or shrink one bar toward its wanted height.
+// A bar covers the rows from base - height up to base.
+bool TftBars::DrawBar(int x, int base, int *shown, int want, int color) {
+  int step = constrain(want - *shown, -TFT_BARS_MAX_STEP, TFT_BARS_MAX_STEP);
+  if (step > 0) {
+    TftPointer_->fillRect(x, base - *shown - step, TFT_BARS_WIDTH, step,
+    color);
+  }
+  else if (step < 0) {
+    TftPointer_->fillRect(x, base - *shown, TFT_BARS_WIDTH, -step,
+    ILI9341_BLACK);
+  }
+  *shown += step;
+  return step != 0;
+}
+
+#endif
@@ -0,0 +1,92 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// tft_bars.h
+//
+// For ips pcb version 2.X
+//
+// Live bar graph of all key positions on the TFT display.
+
+#ifndef TFT_BARS_H_
+#define TFT_BARS_H_
+
+#include "stem_piano_ips2.h"
+
+#ifdef TFT_INSTALLED
+
+#include <Adafruit_GFX.h>
+#include "Adafruit_ILI9341.h"
+#include <SPI.h>
+
+// Piano keys drawn. The last 8 channels are typically pedals.
+#define TFT_BARS_KEYS (NUM_CHANNELS - 8)
+
+// Horizontal pixels per key and bar width. 88 keys fit in 264 pixels.
+#define TFT_BARS_PITCH 3
+#define TFT_BARS_WIDTH 2
+
+// Maximum bar height change drawn at a time, in pixels.
+#define TFT_BARS_MAX_STEP 16
+
+// Do not redraw a bar for a change of this many pixels or less.
+#define TFT_BARS_DEADBAND 1
+
+// How long a strike marker stays on.
+#define TFT_BARS_MARKER_MICROS 250000
+
+class TftBars
+{
+
+  public:
+
+    TftBars();
+    void Setup(Adafruit_ILI9341 *, int, int, int, int, int);
+    void Summarize(const float *, const float *);
+    void Events(const bool *);
+    void Blank();
+    bool Draw(unsigned long, unsigned long);
+    int KeyAt(int);
+
+  private:
+    bool DrawBar(int, int, int *, int, int);
+
+    Adafruit_ILI9341 *TftPointer_;
+
+    int x0_;
+    int hammer_base_;
+    int damper_base_;
+    int marker_top_;
+    int bar_height_;
+
+    // What the bar graph should show, and what the display shows.
+    int hammer_want_[TFT_BARS_KEYS];
+    int hammer_shown_[TFT_BARS_KEYS];
+    int damper_want_[TFT_BARS_KEYS];
+    int damper_shown_[TFT_BARS_KEYS];
+    bool marker_want_[TFT_BARS_KEYS];
+    bool marker_shown_[TFT_BARS_KEYS];
+    unsigned long marker_micros_[TFT_BARS_KEYS];
+
+    int cursor_;
+
+};
+
+#endif
+
+#endif
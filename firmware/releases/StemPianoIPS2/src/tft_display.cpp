@@ -23,17 +23,35 @@
 //
 // Control of 2.8" TFT display
 //
+// While the TFT switch is on, the display is drawn a little each sample,
+// so it can run at the normal sample rate. Display() only updates
+// what the text fields should show. TftText draws the changed
+// characters, and a new screen is cleared in slices, for at most
+// slice_micros_ each sample. The Adafruit_ILI9341 library has no
+// asynchronous DMA transfers, so the slices are small blocking
+// transfers instead.
+//
+// The touch screen is read over I2C, which is also blocking. At most
+// every TFT_TOUCH_POLL_MICROS, a position is read in two short transfers,
+// each only in a sample with time left before the deadline for the
+// slowest transfer measured. The transfers are part of the slice, so
+// the drawing after them gets less time.
+//
+// Touching the title goes to the next screen. One screen shows the key
+// with the maximum value, one a bar graph of all keys, and one a scope
+// trace of the key last touched on the bar graph.
+//
 // TODO - Lots of cool possibilities for the display.
-// TODO - Could use during real-time by writing just one value at a time?
 // TODO - Instead of -8, have a setting for the pedal inputs.
 
 #include "tft_display.h"
 
 #ifdef TFT_INSTALLED
 
-TftDisplay::TftDisplay() : Reader_(SD_) {}
+TftDisplay::TftDisplay() {}
 
-void TftDisplay::Setup(bool using_display, int debug_level) {
+void TftDisplay::Setup(bool using_display, int slice_microseconds,
+int sd_clock_mhz, int debug_level) {
 
   debug_level_ = debug_level;
 
@@ -47,6 +65,8 @@ void TftDisplay::Setup(bool using_display, int debug_level) {
   reset_ = 9;      // To reset the board, assert low.
   backlight_ = 7;  // PWM for backlight intensity.
   sd_detect_ = 34; // Pulled high if a SD card is detected.
+  sd_clock_mhz_ = sd_clock_mhz;
+  sd_card_locked_ = false;
 
   // Do not change - these are based on the 2.8" hardware.
   screen_rotation_ = 1;
@@ -61,6 +81,36 @@ void TftDisplay::Setup(bool using_display, int debug_level) {
   live_last_time_ = micros();
   live_wait_time_ = 500000;
 
+  picture_showing_ = false;
+  picture_micros_ = 0;
+
+  // Drawing a little each sample.
+  slice_micros_ = slice_microseconds;
+  slice_start_micros_ = micros();
+  slice_max_micros_ = 0;
+  sample_micros_ = 0;
+  clear_pixel_ = width_ * height_;
+  touch_x_ = 0;
+  touch_y_ = 0;
+  touch_last_micros_ = micros();
+  touch_step_ = 0;
+  // Estimate until measured: 6 bytes of 9 bits, plus the overhead.
+  touch_micros_ = (6 * 9 * 1000000) / TFT_TOUCH_I2C_HZ + 15;
+  touch_window_max_micros_ = 0;
+  touch_window_count_ = 0;
+  touch_max_micros_ = 0;
+  touch_waits_ = 0;
+  deadline_micros_ = micros();
+  screen_ = TFT_SCREEN_MAX;
+  Scope_ = nullptr;
+  scope_captures_ = 0;
+  scope_velocity_ = 0.0;
+  num_pedals_ = 0;
+  for (int pedal = 0; pedal < TFT_PEDAL_FIELDS; pedal++) {
+    pedal_cc_[pedal] = 0;
+    pedal_down_[pedal] = false;
+  }
+
   if (using_display_ == true) {
 
     // TFT backlight.  High = maximum brightness.
@@ -86,9 +136,25 @@ void TftDisplay::Setup(bool using_display, int debug_level) {
 
     // Internally instantiated classes.
     Text_.Setup(Tft_, height_);
+    Text_.SetupField(TFT_FIELD_TITLE, 0, height_, 2);
+    Text_.SetupField(TFT_FIELD_TOUCH, 0, 175, 2);
+    Text_.SetupField(TFT_FIELD_TYPE, 0, 100, 2);
+    Text_.SetupField(TFT_FIELD_KEY, 0, 75, 2);
+    Text_.SetupField(TFT_FIELD_VALUE, 0, 50, 3);
+    for (int pedal = 0; pedal < TFT_PEDAL_FIELDS; pedal++) {
+      Text_.SetupField(TFT_FIELD_PEDAL + pedal, 28 + 96*pedal, 24, 2);
+    }
+    Text_.SetupField(TFT_FIELD_SCOPE, 0, 24, 2);
+    // Bars are 80 pixels high. Hammers from row 24 to 104, strike
+    // markers below, and dampers from row 120 to 200.
+    Bars_.Setup(Tft_, 28, 104, 108, 200, 80);
+    // One column per sample from row 28 to 188, events below.
+    Trace_.Setup(Tft_, 32, 28, 160);
+    Image_.Setup(Tft_, width_, height_, sd_clock_mhz_, debug_level_);
 
     // Touch screen.
     bool ts_status = Ts_->begin(FT62XX_DEFAULT_THRESHOLD, &Wire2);
+    Wire2.setClock(TFT_TOUCH_I2C_HZ);
     if (ts_status == false) {
       using_display_ = false;
       if (debug_level_ >= DEBUG_INFO) {
@@ -99,7 +165,7 @@ void TftDisplay::Setup(bool using_display, int debug_level) {
     else {
       if (digitalRead(sd_detect_) == HIGH) {
         sd_card_detected_ = true;
-        if (!SD_.begin(sd_cs_, SD_SCK_MHZ(10))) {
+        if (!SD_.begin(sd_cs_, SD_SCK_MHZ(sd_clock_mhz_))) {
           sd_card_started_ = false;
           if (debug_level_ >= DEBUG_INFO) {
             Serial.println("Could not start the SD card.");
@@ -139,128 +205,290 @@ void TftDisplay::HelloWorld() {
 void TftDisplay::Clear() {
   if (using_display_ == true) {
     Tft_->fillScreen(ILI9341_BLACK);
+    Text_.BlankFields();
+    Bars_.Blank();
+    Trace_.Blank();
+    clear_pixel_ = width_ * height_;
   }
 }
 
 // Display the following when in TFT mode:
 //
-// (x,y) pair of where touching the screen.
+// The title. Touch it to go to the next screen.
 //
-// The maximum value over all piano keys:
-//   Whether a hammer or damper was largest.
-//   Which key was the max value.
-//   The maximum value.
-// Why is this useful?
-//   Because then can push one key at a time and
-//   get a display of the largest value read out
-//   from the sensor for that key.
-//   Use to check sensor physical position and / or calibrate sensor.
-void TftDisplay::Display(bool tft_switch, const float *hp, const float *dp) {
-  static float max_value_last = 0.0;
-  static int max_key_last = 0;
-  static bool was_hammer_last = true;
-  static int tx_last = 0;
-  static int ty_last = 0;
+// Then either the key with the maximum value (see DisplayMax()),
+// a bar graph of all keys (see DisplayKeys()), or a scope trace of
+// one key (see DisplayScope()).
+//
+// deadline_micros is when the next sample starts.
+void TftDisplay::Display(bool tft_switch, const float *hp, const float *dp,
+unsigned long deadline_micros) {
   if (using_display_ == true) {
+    sample_micros_ = micros() - slice_start_micros_;
+    slice_start_micros_ = micros();
+    deadline_micros_ = deadline_micros;
     if (tft_switch == true) {
 
       if (tft_switch_last_ == false) {
-        Clear();
+        StartClear();
       }
 
-      int color;
-      color = ReturnColor(50, 82, 123);  // Blue is for the sky.
-      Text_.Print("diy hybrid grand piano gcz", 0, height_, color, 2, 2);
-
-      float max_value = 0.0;
-      int max_key = 0;
-      bool was_hammer = true;
-      int tx = 0;
-      int ty = 0;
-      // Instead of -8 should track which are pedal.
-      for (int key = 0; key < NUM_CHANNELS - 8; key++) {
-        if (hp[key] > max_value) {
-          max_value = hp[key];
-          max_key = key;
-          was_hammer = true;
-        }
-        if (dp[key] > max_value) {
-          max_value = dp[key];
-          max_key = key;
-          was_hammer = false;
-        }
+      if (picture_showing_ == true) {
+        DisplayPicture();
       }
+      else {
+        DisplayScreen(hp, dp);
+      }
+
+    }
+    else if (tft_switch_last_ == true) {
+      // Done with TFT so redraw the startup screen.
+      Image_.Close();
+      picture_showing_ = false;
+      StartClear();
+      ClearSlice();
+    }
+    else if (ClearSlice() == true) {
+      LiveDraw();
+    }
+    if (micros() - slice_start_micros_ > slice_max_micros_) {
+      slice_max_micros_ = micros() - slice_start_micros_;
+    }
+  }
+  tft_switch_last_ = tft_switch;
+}
 
-      // Write black first to erase the previous value from the screen.
+// Hammer strike events and pedal state for the bar graph, and the
+// key scope that captures the key selected on the bar graph.
+// Call every sample that events are valid, before Display().
+void TftDisplay::KeyEvents(const bool *hammer_event, DspPedal *Pedal,
+KeyScope *Scope) {
+  if (using_display_ == true) {
+    Scope_ = Scope;
+    Bars_.Events(hammer_event);
+    num_pedals_ = min(Pedal->NumPedals(), TFT_PEDAL_FIELDS);
+    for (int pedal = 0; pedal < num_pedals_; pedal++) {
+      pedal_cc_[pedal] = Pedal->GetMidiCC(pedal);
+      pedal_down_[pedal] = Pedal->GetPedalDown(pedal);
+    }
+  }
+}
 
-      // Red is for sunsets and sunrises.
-      GetTouchPosition(&tx, &ty);
-      color = ReturnColor(0, 0, 0);      PrintTouch(tx_last, ty_last, 0, 175, color, 2);
-      color = ReturnColor(153, 30, 53);  PrintTouch(tx,      ty,      0, 175, color, 2);
+// True while a picture is read from the SD card. A block read takes
+// longer than a sample at the full sample rate, so while this is true
+// sample at adc_sample_period_microseconds_during_tft instead.
+bool TftDisplay::PictureDrawing() {
+  return using_display_ == true && picture_showing_ == true &&
+  Image_.Active() == true;
+}
 
-      // Purple because the proto boards were purple.
-      color = ReturnColor(0, 0, 0);      PrintType(was_hammer_last, 0, 100, color, 2);
-      color = ReturnColor(186, 85, 255); PrintType(was_hammer,      0, 100, color, 2);
+// The SD card, for other classes that write to it.
+// Returns nullptr if there is no working card.
+SdFat *TftDisplay::SdCard() {
+  if (using_display_ == true && sd_card_started_ == true) {
+    return &SD_;
+  }
+  return nullptr;
+}
 
-      // Green because the Teensy is green.
-      color = ReturnColor(0, 0, 0);     PrintKey(max_key_last, 0, 75, color, 2);
-      color = ReturnColor(79, 121, 66); PrintKey(max_key,      0, 75, color, 2);
+// While locked, pictures are not read from the SD card, so that
+// another class can use it.
+void TftDisplay::LockSdCard(bool lock) {
+  sd_card_locked_ = lock;
+  if (lock == true && picture_showing_ == true) {
+    Image_.Close();
+    picture_showing_ = false;
+    StartClear();
+  }
+}
 
-      // Yellow is for sunshine.
-      color = ReturnColor(0, 0, 0);      PrintValue(max_value_last, 0, 50, color, 3);
-      color = ReturnColor(218, 165, 32); PrintValue(max_value,      0, 50, color, 3);
+// Drawing and touch timing since the last call, at DEBUG_STATS.
+void TftDisplay::PrintStatistics() {
+  if (using_display_ == true && debug_level_ >= DEBUG_STATS) {
+    Serial.printf("TFT drew %lu character rows since startup, longest slice %lu us.\n",
+    Text_.RowsDrawn(), slice_max_micros_);
+    Serial.printf("TFT longest touch transfer %lu us, %lu waited for time.\n",
+    touch_max_micros_, touch_waits_);
+  }
+  slice_max_micros_ = 0;
+  touch_max_micros_ = 0;
+  touch_waits_ = 0;
+}
 
-      tx_last = tx;
-      ty_last = ty;
-      max_value_last = max_value;
-      max_key_last = max_key;
-      was_hammer_last = was_hammer;
+// Private methods. ////////
 
-      // If touch the lower right corner, display an image for 1.0 seconds.
-      if (tx > 250 && ty < 50) {
-        Picture();
-        delay(1000);
-        Clear();
-      }
+// The current screen, and touches of it.
+void TftDisplay::DisplayScreen(const float *hp, const float *dp) {
+  // The touch position is held until the next time it is read.
+  bool touch_read = false;
+  if (micros() - touch_last_micros_ > TFT_TOUCH_POLL_MICROS) {
+    touch_read = GetTouchPosition(&touch_x_, &touch_y_);
+    if (touch_read == true) {
+      touch_last_micros_ = micros();
+    }
+  }
 
+  // Touching the title goes to the next screen. There is no scope
+  // screen without hammer events. Touching a key on the bar graph
+  // scopes that key.
+  if (touch_read == true && touch_y_ > height_ - 24) {
+    screen_++;
+    if (screen_ == TFT_SCREEN_SCOPE && Scope_ == nullptr) {
+      screen_++;
     }
-    else if (tft_switch_last_ == true) {
-      // Done with TFT so redraw the startup screen.
-      // Drawing takes quite a bit of time, so only do once.
-      Clear();
+    if (screen_ >= TFT_NUM_SCREENS) {
+      screen_ = 0;
     }
-    else {
-      LiveDraw();
+    StartClear();
+  }
+  else if (touch_read == true && screen_ == TFT_SCREEN_KEYS &&
+  touch_y_ > 40 && Scope_ != nullptr) {
+    int key = Bars_.KeyAt(touch_x_);
+    if (key >= 0) {
+      Scope_->SelectKey(key);
+      Trace_.Unload();
+      scope_captures_ = 0;
+      screen_ = TFT_SCREEN_SCOPE;
+      StartClear();
     }
   }
-  tft_switch_last_ = tft_switch;
+
+  int color;
+  color = ReturnColor(50, 82, 123);  // Blue is for the sky.
+  Text_.SetField(TFT_FIELD_TITLE, "diy hybrid grand piano gcz", color);
+
+  // Each screen sets the fields it uses.
+  for (int field = TFT_FIELD_TITLE + 1; field < TFT_NUM_FIELDS; field++) {
+    Text_.SetField(field, "", ILI9341_BLACK);
+  }
+  if (screen_ == TFT_SCREEN_KEYS) {
+    DisplayKeys(hp, dp);
+  }
+  else if (screen_ == TFT_SCREEN_SCOPE) {
+    DisplayScope();
+  }
+  else {
+    DisplayMax(hp, dp);
+  }
+
+  // Finish clearing the screen before drawing anything else.
+  if (ClearSlice() == true) {
+    Text_.UpdateFields(slice_start_micros_, slice_micros_);
+    if (screen_ == TFT_SCREEN_KEYS) {
+      Bars_.Draw(slice_start_micros_, slice_micros_);
+    }
+    else if (screen_ == TFT_SCREEN_SCOPE) {
+      Trace_.Draw(slice_start_micros_, slice_micros_);
+    }
+  }
+
+  // If touch the lower right corner, display an image for 1.0 seconds.
+  if (screen_ == TFT_SCREEN_MAX && touch_read == true &&
+  touch_x_ > 250 && touch_y_ < 50) {
+    Picture();
+  }
+}
+
+// (x,y) pair of where touching the screen.
+//
+// The maximum value over all piano keys:
+//   Whether a hammer or damper was largest.
+//   Which key was the max value.
+//   The maximum value.
+// Why is this useful?
+//   Because then can push one key at a time and
+//   get a display of the largest value read out
+//   from the sensor for that key.
+//   Use to check sensor physical position and / or calibrate sensor.
+void TftDisplay::DisplayMax(const float *hp, const float *dp) {
+  float max_value = 0.0;
+  int max_key = 0;
+  bool was_hammer = true;
+  // Instead of -8 should track which are pedal.
+  for (int key = 0; key < NUM_CHANNELS - 8; key++) {
+    if (hp[key] > max_value) {
+      max_value = hp[key];
+      max_key = key;
+      was_hammer = true;
+    }
+    if (dp[key] > max_value) {
+      max_value = dp[key];
+      max_key = key;
+      was_hammer = false;
+    }
+  }
+
+  // Red is for sunsets and sunrises.
+  PrintTouch(touch_x_, touch_y_, ReturnColor(153, 30, 53));
+
+  // Purple because the proto boards were purple.
+  PrintType(was_hammer, ReturnColor(186, 85, 255));
+
+  // Green because the Teensy is green.
+  PrintKey(max_key, ReturnColor(79, 121, 66));
+
+  // Yellow is for sunshine.
+  PrintValue(max_value, ReturnColor(218, 165, 32));
+}
+
+// Bar graph of hammer and damper positions, strike markers, and
+// the pedals by MIDI control change number. Bright when pressed.
+void TftDisplay::DisplayKeys(const float *hp, const float *dp) {
+  Bars_.Summarize(hp, dp);
+
+  for (int pedal = 0; pedal < num_pedals_; pedal++) {
+    char print_string[10];
+    snprintf(print_string, 10, "cc%d", pedal_cc_[pedal]);
+    Text_.SetField(TFT_FIELD_PEDAL + pedal, print_string,
+    pedal_down_[pedal] == true ? ILI9341_GREEN : ILI9341_DARKGREY);
+  }
+}
+
+// The last strike of the scoped key. A new capture replaces the trace
+// when it is ready, and the key scope waits for the next strike.
+void TftDisplay::DisplayScope() {
+  if (Scope_->Ready() == true) {
+    Trace_.Load(Scope_);
+    scope_velocity_ = Scope_->TriggerVelocity();
+    scope_captures_++;
+    Scope_->Rearm();
+  }
+  char print_string[30];
+  if (scope_captures_ == 0) {
+    snprintf(print_string, 30, "key %d, play it", Scope_->Key());
+  }
+  else {
+    snprintf(print_string, 30, "key %d #%d vel %1.3f", Scope_->Key(),
+    scope_captures_, scope_velocity_);
+  }
+  Text_.SetField(TFT_FIELD_SCOPE, print_string, ILI9341_WHITE);
 }
 
 // Small helper functions to keep code above cleaner.
 
-void TftDisplay::PrintTouch(int tx, int ty, int x, int y, int color, int size) {
+void TftDisplay::PrintTouch(int tx, int ty, int color) {
   char print_string[100];
   snprintf(print_string, 100, "touch(x,y) = (%d,%d)", tx, ty);
-  Text_.Print(print_string, x, y, color, size, 2);
+  Text_.SetField(TFT_FIELD_TOUCH, print_string, color);
 }
 
-void TftDisplay::PrintType(bool was_hammer, int x, int y, int color, int size) {
+void TftDisplay::PrintType(bool was_hammer, int color) {
   if (was_hammer == true)
-    Text_.Print("value is for a hammer", x, y, color, size, 2);
+    Text_.SetField(TFT_FIELD_TYPE, "value is for a hammer", color);
   else
-    Text_.Print("value is for a damper", x, y, color, size, 2);
+    Text_.SetField(TFT_FIELD_TYPE, "value is for a damper", color);
 }
 
-void TftDisplay::PrintKey(int key, int x, int y, int color, int size) {
+void TftDisplay::PrintKey(int key, int color) {
   char print_string[100];
   snprintf(print_string, 100, "Key = %d", key);
-  Text_.Print(print_string, x, y, color, size, 2);
+  Text_.SetField(TFT_FIELD_KEY, print_string, color);
 }
 
-void TftDisplay::PrintValue(float max, int x, int y, int color, int size) {
+void TftDisplay::PrintValue(float max, int color) {
   char print_string[100];
   snprintf(print_string, 100, "Value = %2.3f", max);
-  Text_.Print(print_string, x, y, color, size, 2);
+  Text_.SetField(TFT_FIELD_VALUE, print_string, color);
 }
 
 int TftDisplay::ReturnColor(unsigned int red, unsigned int green, unsigned int blue)
@@ -270,13 +498,42 @@ int TftDisplay::ReturnColor(unsigned int red, unsigned int green, unsigned int b
 
 // Get touch position. Notice x and y read back are swapped so that
 // (0,0) is the lower left according to how screen is installed on pcb.
-void TftDisplay::GetTouchPosition(int *x, int *y) {
-  if (using_display_ == true) {
-    TS_Point touch_point;
-    if (Ts_->touched()) {
-      touch_point = Ts_->getPoint();
-      *x = width_ - touch_point.y;
-      *y = height_ - touch_point.x;
+// Same registers as Adafruit_FT6206 touched() and getPoint(), but one
+// transfer sets the register and the next reads the status and first
+// point, so each is short. Returns true when a position was read, and
+// the position is (0,0) if not touched.
+bool TftDisplay::GetTouchPosition(int *x, int *y) {
+  if (using_display_ == false) {
+    return false;
+  }
+  if (TouchFits() == false) {
+    touch_waits_++;
+    return false;
+  }
+  unsigned long start = micros();
+  bool position_read = false;
+  if (touch_step_ == 0) {
+    Wire2.beginTransmission(FT62XX_ADDR);
+    Wire2.write(FT62XX_REG_NUMTOUCHES);
+    Wire2.endTransmission();
+    touch_step_ = 1;
+  }
+  else {
+    uint8_t data[5] = {0, 0, 0, 0, 0};
+    Wire2.requestFrom(FT62XX_ADDR, 5);
+    for (int ind = 0; ind < 5 && Wire2.available() > 0; ind++) {
+      data[ind] = Wire2.read();
+    }
+    touch_step_ = 0;
+    position_read = true;
+    *x = 0;
+    *y = 0;
+    int touches = data[0] & 0x0F;
+    if (touches == 1 || touches == 2) {
+      int touch_x = ((data[1] & 0x0F) << 8) | data[2];
+      int touch_y = ((data[3] & 0x0F) << 8) | data[4];
+      *x = width_ - touch_y;
+      *y = height_ - touch_x;
       if (debug_level_ >= DEBUG_INFO) {
         Serial.print("Touchscreen position (x=");
         Serial.print(*x);
@@ -286,23 +543,50 @@ void TftDisplay::GetTouchPosition(int *x, int *y) {
       }
     }
   }
+  MeasureTouch(micros() - start);
+  return position_read;
+}
+
+// True if the slowest touch transfer fits before the deadline.
+bool TftDisplay::TouchFits() {
+  return static_cast<long>(deadline_micros_ - micros()) >
+  static_cast<long>(touch_micros_ + TFT_TOUCH_MARGIN_MICROS);
+}
+
+void TftDisplay::MeasureTouch(unsigned long elapsed) {
+  if (elapsed > touch_max_micros_) {
+    touch_max_micros_ = elapsed;
+  }
+  if (elapsed > touch_window_max_micros_) {
+    touch_window_max_micros_ = elapsed;
+  }
+  if (elapsed > touch_micros_) {
+    touch_micros_ = elapsed;
+  }
+  if (++touch_window_count_ >= TFT_TOUCH_WINDOW) {
+    touch_micros_ = touch_window_max_micros_;
+    touch_window_max_micros_ = 0;
+    touch_window_count_ = 0;
+  }
 }
 
-// Display pictures used in one of the YouTube videos.
-// Each file must be 240x320 pixels in 24-bit BMP format.
+// Start displaying pictures used in one of the YouTube videos.
+// Each file must be 240x320 pixels in 24-bit BMP format, or the same
+// converted to .565 format (see tft_image.cpp).
 // Images smaller than 240x320 are allowed too.
 // The .bmp in code below is in the repository.
 // These images need to be copied onto a microSD card and
 // inserted into the 2.8" TFT display.
 void TftDisplay::Picture() {
   static int picture_number = 0;
-  if (using_display_ == true && sd_card_detected_ == true) {
+  if (using_display_ == true && sd_card_detected_ == true &&
+  sd_card_locked_ == false) {
     if (sd_card_started_ == false) {
       // Depending on power sequencing, sometimes the card will
       // not be detected at startup. If that happens, try again.
       // The following code usually fixes things.
       SD_.end();
-      if (!SD_.begin(sd_cs_, SD_SCK_MHZ(10))) {
+      if (!SD_.begin(sd_cs_, SD_SCK_MHZ(sd_clock_mhz_))) {
         sd_card_started_ = false;
         if (debug_level_ >= DEBUG_INFO) {
           Serial.println("Continue to cannot start SD card.");
@@ -316,38 +600,72 @@ void TftDisplay::Picture() {
       }
     }
     if (sd_card_started_ == true) {
-      ImageReturnCode stat;
+      const char *name;
       if (debug_level_ >= DEBUG_INFO) {
         Serial.println("New TFT picture.");
       }
       if (picture_number == 0) {
-        stat = Reader_.drawBMP("/diy_16_thumbnail.bmp", *Tft_, 0, 0);
+        name = "/diy_16_thumbnail";
         picture_number++;
       }
       else if (picture_number == 1) {
-        stat = Reader_.drawBMP("/diy_19_thumbnail.bmp", *Tft_, 0, 0);
+        name = "/diy_19_thumbnail";
         picture_number++;
       }
       else if (picture_number == 2) {
-        stat = Reader_.drawBMP("/diy_20_thumbnail.bmp", *Tft_, 0, 0);
+        name = "/diy_20_thumbnail";
         picture_number++;
       }
       else if (picture_number == 3) {
-        stat = Reader_.drawBMP("/diy_23_thumbnail.bmp", *Tft_, 0, 0);
+        name = "/diy_23_thumbnail";
         picture_number++;
       }
       else {
-        stat = Reader_.drawBMP("/diy_24_thumbnail.bmp", *Tft_, 0, 0);
+        name = "/diy_24_thumbnail";
         picture_number = 0;
       }
+      // Use the .565 version if it is on the card, it draws faster.
+      char file_name[40];
+      snprintf(file_name, 40, "%s.565", name);
+      picture_showing_ = Image_.Open(file_name, 0, 0);
+      if (picture_showing_ == false) {
+        snprintf(file_name, 40, "%s.bmp", name);
+        picture_showing_ = Image_.Open(file_name, 0, 0);
+      }
       if (debug_level_ >= DEBUG_INFO) {
         Serial.println("TftDisplay::Picture()");
-        Serial.println(stat);
+        Serial.println(picture_showing_);
       }
     }
   }
 }
 
+// Draw the picture a slice at a time, then show it for
+// TFT_PICTURE_MICROS, then go back to the screen that was showing.
+// Once the samples are slow (see PictureDrawing()), the picture draws
+// for half of each sample. Both the time since the last sample and the
+// time to the next one are long only once the new period is running.
+void TftDisplay::DisplayPicture() {
+  if (Image_.Active() == true) {
+    unsigned long budget = slice_micros_;
+    long left = static_cast<long>(deadline_micros_ - slice_start_micros_);
+    if (left > 0) {
+      unsigned long half = min(static_cast<unsigned long>(left),
+      sample_micros_) / 2;
+      if (half > budget) {
+        budget = half;
+      }
+    }
+    if (Image_.Draw(slice_start_micros_, budget, deadline_micros_) == true) {
+      picture_micros_ = micros();
+    }
+  }
+  else if (micros() - picture_micros_ > TFT_PICTURE_MICROS) {
+    picture_showing_ = false;
+    StartClear();
+  }
+}
+
 void TftDisplay::LiveDraw() {
   if (live_draw_state_ == false) {
     if (debug_level_ >= DEBUG_INFO) {
@@ -388,11 +706,32 @@ void TftDisplay::LiveDraw() {
   }
 }
 
+// Start clearing the screen. ClearSlice() does the clearing.
+void TftDisplay::StartClear() {
+  clear_pixel_ = 0;
+  Text_.BlankFields();
+  Bars_.Blank();
+  Trace_.Blank();
+}
+
+// Clear the screen a few pixels of one line at a time, until the
+// time budget is used. Returns true when the screen is clear.
+bool TftDisplay::ClearSlice() {
+  while (clear_pixel_ < width_ * height_ &&
+  micros() - slice_start_micros_ < slice_micros_) {
+    Tft_->fillRect(clear_pixel_ % width_, clear_pixel_ / width_,
+    TFT_CLEAR_PIXELS, 1, ILI9341_BLACK);
+    clear_pixel_ += TFT_CLEAR_PIXELS;
+  }
+  return clear_pixel_ >= width_ * height_;
+}
+
 #else
 
 TftDisplay::TftDisplay() {}
 
-void TftDisplay::Setup(bool not_used, int debug_level) {
+void TftDisplay::Setup(bool not_used, int not_used_2, int not_used_3,
+int debug_level) {
   if (debug_level >= DEBUG_INFO) {
     Serial.println("TFT Display is not in build and is not used.");
   }
@@ -402,6 +741,15 @@ void TftDisplay::HelloWorld() {}
 
 void TftDisplay::Clear() {}
 
-void TftDisplay::Display(bool a, const float *b, const float *c) {}
+void TftDisplay::Display(bool a, const float *b, const float *c,
+unsigned long d) {}
+
+void TftDisplay::KeyEvents(const bool *a, DspPedal *b, KeyScope *c) {}
+
+bool TftDisplay::PictureDrawing() {
+  return false;
+}
+
+void TftDisplay::PrintStatistics() {}
 
 #endif
\ No newline at end of file
@@ -27,6 +27,8 @@
 #define TFT_DISPLAY_H_
 
 #include "stem_piano_ips2.h"
+#include "dsp_pedal.h"
+#include "key_scope.h"
 
 #ifdef TFT_INSTALLED
 
@@ -40,31 +42,87 @@
 #include <Adafruit_ImageReader.h>
 
 #include "tft_text.h"
+#include "tft_bars.h"
+#include "tft_scope.h"
+#include "tft_image.h"
+
+// Text fields of the display.
+#define TFT_FIELD_TITLE 0
+#define TFT_FIELD_TOUCH 1
+#define TFT_FIELD_TYPE 2
+#define TFT_FIELD_KEY 3
+#define TFT_FIELD_VALUE 4
+#define TFT_FIELD_PEDAL 5  // Up to TFT_PEDAL_FIELDS fields.
+#define TFT_FIELD_SCOPE 8
+#define TFT_NUM_FIELDS 9
+
+// Pedals shown on the key screen.
+#define TFT_PEDAL_FIELDS 3
+
+// Screens. Touch the title to go to the next screen.
+#define TFT_SCREEN_MAX 0   // Key with the maximum value.
+#define TFT_SCREEN_KEYS 1  // Bar graph of all keys. Touch a key to scope it.
+#define TFT_SCREEN_SCOPE 2 // Triggered capture of one key.
+#define TFT_NUM_SCREENS 3
+
+// Pixels cleared at a time when clearing the screen in slices.
+#define TFT_CLEAR_PIXELS 64
+
+// Reading the touch screen over I2C is slow, so do not read every sample.
+#define TFT_TOUCH_POLL_MICROS 50000
+
+// FT6206 I2C clock, its maximum. The Wire2 default is 100 kHz.
+#define TFT_TOUCH_I2C_HZ 400000
+
+// A touch transfer only starts if the sample has this much more time
+// left than the slowest transfer in the last TFT_TOUCH_WINDOW.
+#define TFT_TOUCH_MARGIN_MICROS 10
+#define TFT_TOUCH_WINDOW 64
+
+// How long a picture shows after it is drawn.
+#define TFT_PICTURE_MICROS 1000000
 
 class TftDisplay
 {
   public:
     TftDisplay();
-    void Setup(bool, int);
+    void Setup(bool, int, int, int);
     void HelloWorld();
     void Clear();
-    void Display(bool, const float *, const float *);
+    void Display(bool, const float *, const float *, unsigned long);
+    void KeyEvents(const bool *, DspPedal *, KeyScope *);
+    bool PictureDrawing();
+    void PrintStatistics();
+    SdFat *SdCard();
+    void LockSdCard(bool);
 
   private:
-    void GetTouchPosition(int *, int *);
+    void DisplayScreen(const float *, const float *);
+    void DisplayPicture();
+    void DisplayMax(const float *, const float *);
+    void DisplayKeys(const float *, const float *);
+    void DisplayScope();
+    bool GetTouchPosition(int *, int *);
+    bool TouchFits();
+    void MeasureTouch(unsigned long);
     void Picture();
     int ReturnColor(unsigned int, unsigned int, unsigned int);
-    void PrintTouch(int, int, int, int, int, int);
-    void PrintType(bool, int, int, int, int);
-    void PrintKey(int, int, int, int, int);
-    void PrintValue(float, int, int, int, int);
+    void PrintTouch(int, int, int);
+    void PrintType(bool, int);
+    void PrintKey(int, int);
+    void PrintValue(float, int);
     void LiveDraw();
+    void StartClear();
+    bool ClearSlice();
 
     TftText Text_;
+    TftBars Bars_;
+    TftScope Trace_;
+    KeyScope *Scope_;
 
     Adafruit_ILI9341 *Tft_;
     Adafruit_FT6206 *Ts_;
-    Adafruit_ImageReader Reader_;
+    TftImage Image_;
     SdFat SD_;
 
     int debug_level_;
@@ -77,6 +135,7 @@ class TftDisplay
     int reset_;
     int sd_cs_;
     int sd_detect_;
+    int sd_clock_mhz_;
 
     unsigned int screen_rotation_;
     int width_;
@@ -84,11 +143,43 @@ class TftDisplay
 
     bool sd_card_started_;
     bool sd_card_detected_;
+    bool sd_card_locked_;
 
     int live_draw_x_, live_draw_y_, live_draw_l_;
     unsigned long live_last_time_, live_wait_time_;
     bool live_draw_state_;
 
+    // Each call to Display() draws for at most about this long.
+    unsigned long slice_micros_;
+    unsigned long slice_start_micros_;
+    unsigned long slice_max_micros_;
+    unsigned long deadline_micros_;
+    unsigned long sample_micros_;
+
+    int screen_;
+    int num_pedals_;
+    int pedal_cc_[TFT_PEDAL_FIELDS];
+    bool pedal_down_[TFT_PEDAL_FIELDS];
+    int scope_captures_;
+    float scope_velocity_;
+
+    bool picture_showing_;
+    unsigned long picture_micros_;
+
+    int clear_pixel_;
+    int touch_x_, touch_y_;
+    unsigned long touch_last_micros_;
+
+    // The touch position is read in two I2C transfers, in samples
+    // with enough time left. touch_micros_ is the slowest transfer
+    // in the last TFT_TOUCH_WINDOW, or an estimate until measured.
+    int touch_step_;
+    unsigned long touch_micros_;
+    unsigned long touch_window_max_micros_;
+    int touch_window_count_;
+    unsigned long touch_max_micros_;
+    unsigned long touch_waits_;
+
 };
 
 #else
@@ -97,10 +188,13 @@ class TftDisplay
 {
   public:
     TftDisplay();
-    void Setup(bool, int);
+    void Setup(bool, int, int, int);
     void HelloWorld();
-    void Display(bool, const float *, const float *);
+    void Display(bool, const float *, const float *, unsigned long);
+    void KeyEvents(const bool *, DspPedal *, KeyScope *);
     void Clear();
+    bool PictureDrawing();
+    void PrintStatistics();
 
 };
 
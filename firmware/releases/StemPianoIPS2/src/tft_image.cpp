@@ -0,0 +1,286 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// tft_image.cpp
+//
+// For ips pcb version 2.X
+//
+// Draw an image from the SD card on the TFT display, a slice at a time.
+//
+// Open() reads the file header. Each call to Draw() then reads
+// TFT_IMAGE_PIXELS pixels at a time from the file, converts them to
+// RGB565, and draws them, until the time budget is used. So a picture
+// is drawn over many samples instead of stopping loop() until it is done.
+//
+// The SD card reads whole 512 byte blocks. Most reads come from the
+// block already read, but one read in every few needs a new block.
+// A block takes about 0.5 ms with tft_sd_clock_mhz at 10, and roughly
+// a quarter of that at 40. A read that needs a new block only starts
+// if it ends before the next sample, based on the slowest block read
+// measured (see SdLog::Write()). If not, drawing stops for this sample.
+// At the full sample rate there is not time for a block, so TftDisplay
+// asks for slower samples while a picture draws (see
+// TftDisplay::PictureDrawing()). A picture that makes no progress for
+// TFT_IMAGE_GIVE_UP_MICROS stops.
+//
+// Two formats:
+//   .bmp - 24-bit uncompressed BMP, as written by most image editors.
+//   .565 - Width and height as 16-bit little endian values, then the
+//          pixels as 16-bit little endian RGB565, top row first.
+//          These are drawn as read, without any conversion. See
+//          software/releases/ips2_tft_images for a converter.
+
+#include "tft_image.h"
+
+#ifdef TFT_INSTALLED
+
+TftImage::TftImage() {}
+
+void TftImage::Setup(Adafruit_ILI9341 *tft, int display_width,
+int display_height, int sd_clock_mhz, int debug_level) {
+  TftPointer_ = tft;
+  display_width_ = display_width;
+  display_height_ = display_height;
+  debug_level_ = debug_level;
+  active_ = false;
+  sd_clock_mhz_ = sd_clock_mhz > 0 ? sd_clock_mhz : 1;
+  // Estimate until blocks are measured.
+  block_micros_ = (8 * TFT_IMAGE_BLOCK_BYTES) / sd_clock_mhz_ + 10;
+  window_max_micros_ = 0;
+  window_count_ = 0;
+  max_block_micros_ = 0;
+  progress_micros_ = micros();
+}
+
+// Start drawing an image with its upper left corner at (x,y),
+// in pixels from the upper left corner of the display.
+// The format is .565 if the file name ends with .565, else .bmp.
+bool TftImage::Open(const char *name, int x, int y) {
+  Close();
+  if (file_.open(name, O_RDONLY) == false) {
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.printf("TftImage::Open() could not open %s.\n", name);
+    }
+    return false;
+  }
+  int length = strlen(name);
+  bool ok;
+  if (length > 4 && strcmp(&name[length - 4], ".565") == 0) {
+    ok = OpenRaw();
+  }
+  else {
+    ok = OpenBmp();
+  }
+  if (ok == true && (x + width_ > display_width_ ||
+  y + height_ > display_height_)) {
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.printf("TftImage::Open() %s is %d x %d, too large.\n", name,
+      width_, height_);
+    }
+    ok = false;
+  }
+  if (ok == false) {
+    file_.close();
+    return false;
+  }
+  x_ = x;
+  y_ = y;
+  row_ = 0;
+  column_ = 0;
+  num_pixels_ = 0;
+  max_block_micros_ = 0;
+  progress_micros_ = micros();
+  active_ = true;
+  return true;
+}
+
+// Draw until the budget from start_micros is used. deadline_micros is
+// when the next sample starts. Returns true when the whole image is
+// drawn, on a read error, or if there was no time to read for too long.
+bool TftImage::Draw(unsigned long start_micros, unsigned long budget_micros,
+unsigned long deadline_micros) {
+  while (active_ == true && micros() - start_micros < budget_micros) {
+    if (num_pixels_ == 0) {
+      bool waiting = false;
+      if (ReadPixels(deadline_micros, &waiting) == false) {
+        if (debug_level_ >= DEBUG_INFO) {
+          Serial.println("TftImage::Draw() read error.");
+        }
+        Close();
+        break;
+      }
+      if (waiting == true) {
+        if (micros() - progress_micros_ > TFT_IMAGE_GIVE_UP_MICROS) {
+          if (debug_level_ >= DEBUG_INFO) {
+            Serial.println("TftImage::Draw() no time to read the SD card.");
+          }
+          Close();
+        }
+        break;
+      }
+      progress_micros_ = micros();
+    }
+    int row = top_down_ == true ? row_ : height_ - 1 - row_;
+    TftPointer_->drawRGBBitmap(x_ + column_, y_ + row, pixels_, num_pixels_, 1);
+    column_ += num_pixels_;
+    num_pixels_ = 0;
+    if (column_ >= width_) {
+      column_ = 0;
+      row_++;
+      if (row_ >= height_) {
+        if (debug_level_ >= DEBUG_STATS) {
+          Serial.printf("TftImage drew a picture, longest block read %lu us.\n",
+          max_block_micros_);
+        }
+        Close();
+      }
+    }
+  }
+  return active_ == false;
+}
+
+void TftImage::Close() {
+  if (active_ == true) {
+    file_.close();
+  }
+  active_ = false;
+}
+
+bool TftImage::Active() {
+  return active_;
+}
+
+// Private methods. ////////
+
+bool TftImage::OpenBmp() {
+  uint8_t header[TFT_IMAGE_BMP_HEADER_BYTES];
+  if (file_.read(header, TFT_IMAGE_BMP_HEADER_BYTES) !=
+  TFT_IMAGE_BMP_HEADER_BYTES || header[0] != 'B' || header[1] != 'M') {
+    return false;
+  }
+  long offset = Read32(&header[10]);
+  long width = Read32(&header[18]);
+  long height = Read32(&header[22]);
+  int planes = Read16(&header[26]);
+  int bits = Read16(&header[28]);
+  long compression = Read32(&header[30]);
+  if (planes != 1 || bits != 24 || compression != 0 || width <= 0 ||
+  height == 0) {
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.println("TftImage::OpenBmp() only 24-bit uncompressed BMP.");
+    }
+    return false;
+  }
+  // Rows are bottom up unless the height is negative.
+  top_down_ = height < 0;
+  format_ = TFT_IMAGE_BMP;
+  width_ = width;
+  height_ = abs(height);
+  row_padding_ = (4 - (3*width_) % 4) % 4;
+  return file_.seek(offset);
+}
+
+bool TftImage::OpenRaw() {
+  uint8_t header[TFT_IMAGE_RAW_HEADER_BYTES];
+  if (file_.read(header, TFT_IMAGE_RAW_HEADER_BYTES) !=
+  TFT_IMAGE_RAW_HEADER_BYTES) {
+    return false;
+  }
+  format_ = TFT_IMAGE_RAW;
+  width_ = Read16(&header[0]);
+  height_ = Read16(&header[2]);
+  top_down_ = true;
+  row_padding_ = 0;
+  return width_ > 0 && height_ > 0;
+}
+
+// Read up to TFT_IMAGE_PIXELS pixels of the current row. If the read
+// needs a new block and the block might not be read before the deadline,
+// nothing is read and *waiting is true.
+bool TftImage::ReadPixels(unsigned long deadline_micros, bool *waiting) {
+  int n = min(TFT_IMAGE_PIXELS, width_ - column_);
+  int bytes = format_ == TFT_IMAGE_RAW ? 2*n : 3*n;
+  if (column_ + n == width_) {
+    bytes += row_padding_;
+  }
+  int offset = file_.curPosition() % TFT_IMAGE_BLOCK_BYTES;
+  bool new_block = offset == 0 || offset + bytes > TFT_IMAGE_BLOCK_BYTES;
+  if (new_block == true && static_cast<long>(deadline_micros - micros()) <=
+  static_cast<long>(block_micros_ + TFT_IMAGE_MARGIN_MICROS)) {
+    *waiting = true;
+    return true;
+  }
+  unsigned long start = micros();
+
+  if (format_ == TFT_IMAGE_RAW) {
+    // Teensy is little endian, so read straight into the pixels.
+    if (file_.read(pixels_, 2*n) != 2*n) {
+      return false;
+    }
+  }
+  else {
+    if (file_.read(bytes_, 3*n) != 3*n) {
+      return false;
+    }
+    // BMP pixels are blue, green, red.
+    for (int k = 0; k < n; k++) {
+      pixels_[k] = ((bytes_[3*k + 2] & 0xF8) << 8) |
+      ((bytes_[3*k + 1] & 0xFC) << 3) | (bytes_[3*k] >> 3);
+    }
+    // Each row is padded to a multiple of 4 bytes.
+    if (column_ + n == width_ && row_padding_ > 0) {
+      if (file_.read(bytes_, row_padding_) != row_padding_) {
+        return false;
+      }
+    }
+  }
+  num_pixels_ = n;
+  if (new_block == true) {
+    MeasureBlock(micros() - start);
+  }
+  return true;
+}
+
+void TftImage::MeasureBlock(unsigned long elapsed) {
+  if (elapsed > max_block_micros_) {
+    max_block_micros_ = elapsed;
+  }
+  if (elapsed > window_max_micros_) {
+    window_max_micros_ = elapsed;
+  }
+  if (elapsed > block_micros_) {
+    block_micros_ = elapsed;
+  }
+  if (++window_count_ >= TFT_IMAGE_WINDOW) {
+    block_micros_ = window_max_micros_;
+    window_max_micros_ = 0;
+    window_count_ = 0;
+  }
+}
+
+int TftImage::Read16(const uint8_t *b) {
+  return b[0] | (b[1] << 8);
+}
+
+long TftImage::Read32(const uint8_t *b) {
+  return static_cast<long>(static_cast<int32_t>(b[0] | (b[1] << 8) |
+  (b[2] << 16) | (static_cast<uint32_t>(b[3]) << 24)));
+}
+
+#endif
@@ -0,0 +1,113 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// tft_image.h
+//
+// For ips pcb version 2.X
+//
+// Draw an image from the SD card on the TFT display, a slice at a time.
+
+#ifndef TFT_IMAGE_H_
+#define TFT_IMAGE_H_
+
+#include "stem_piano_ips2.h"
+
+#ifdef TFT_INSTALLED
+
+#include <Adafruit_GFX.h>
+#include "Adafruit_ILI9341.h"
+#include <SPI.h>
+#include <SdFat.h>
+
+// Pixels read, decoded, and drawn at a time.
+#define TFT_IMAGE_PIXELS 32
+
+// Image file formats.
+#define TFT_IMAGE_BMP 0  // 24-bit uncompressed BMP.
+#define TFT_IMAGE_RAW 1  // .565 file, see tft_image.cpp.
+
+#define TFT_IMAGE_BMP_HEADER_BYTES 54
+#define TFT_IMAGE_RAW_HEADER_BYTES 4
+
+// The SD card reads 512 byte blocks. A read that needs a new block
+// only starts if the sample has this much more time left than the
+// slowest block read in the last TFT_IMAGE_WINDOW.
+#define TFT_IMAGE_BLOCK_BYTES 512
+#define TFT_IMAGE_MARGIN_MICROS 10
+#define TFT_IMAGE_WINDOW 64
+
+// Stop a picture if no block could be read for this long.
+#define TFT_IMAGE_GIVE_UP_MICROS 1000000
+
+class TftImage
+{
+
+  public:
+
+    TftImage();
+    void Setup(Adafruit_ILI9341 *, int, int, int, int);
+    bool Open(const char *, int, int);
+    bool Draw(unsigned long, unsigned long, unsigned long);
+    void Close();
+    bool Active();
+
+  private:
+    bool OpenBmp();
+    bool OpenRaw();
+    bool ReadPixels(unsigned long, bool *);
+    void MeasureBlock(unsigned long);
+    static int Read16(const uint8_t *);
+    static long Read32(const uint8_t *);
+
+    Adafruit_ILI9341 *TftPointer_;
+    File32 file_;
+
+    int debug_level_;
+    int display_width_;
+    int display_height_;
+
+    bool active_;
+    int format_;
+    int x_;
+    int y_;
+    int width_;
+    int height_;
+    bool top_down_;
+    int row_padding_;
+
+    int row_;
+    int column_;
+    int num_pixels_;
+    uint8_t bytes_[3*TFT_IMAGE_PIXELS];
+    uint16_t pixels_[TFT_IMAGE_PIXELS];
+
+    // block_micros_ is the slowest block read in the last
+    // TFT_IMAGE_WINDOW, or an estimate until measured.
+    int sd_clock_mhz_;
+    unsigned long block_micros_;
+    unsigned long window_max_micros_;
+    int window_count_;
+    unsigned long max_block_micros_;
+    unsigned long progress_micros_;
+
+};
+
+#endif
+
+#endif
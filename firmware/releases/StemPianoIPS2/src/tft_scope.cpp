@@ -0,0 +1,202 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// tft_scope.cpp
+//
+// For ips pcb version 2.X
+//
+// Draw a key scope capture on the TFT display.
+//
+// Position is yellow, from 0.0 at the bottom to 1.0 at the top, with
+// dotted strike and release thresholds. Velocity is cyan, scaled to
+// fit, around a dotted zero line in the middle. Hammer events are red
+// and damper events blue ticks below the traces. The trigger is at
+// column KEY_SCOPE_PRETRIGGER.
+//
+// Load() turns a capture into pixel rows. Draw() then redraws one
+// column at a time: erase the old traces, redraw the dotted lines,
+// draw the new traces and events. Vertical lines longer than
+// TFT_SCOPE_MAX_SPAN are split, so no single transfer is long.
+// Columns that did not change are skipped.
+
+#include "tft_scope.h"
+
+#ifdef TFT_INSTALLED
+
+TftScope::TftScope() {}
+
+// Pixel rows from the top of the screen. One column per sample.
+void TftScope::Setup(Adafruit_ILI9341 *tft, int x0, int top, int height) {
+  TftPointer_ = tft;
+  x0_ = x0;
+  top_ = top;
+  height_ = height;
+  strike_row_ = top_;
+  release_row_ = top_;
+  loaded_ = false;
+  Blank();
+}
+
+void TftScope::Load(KeyScope *Scope) {
+  float max_velocity = 0.0;
+  for (int sample = 0; sample < KEY_SCOPE_SAMPLES; sample++) {
+    float position, velocity;
+    int events;
+    Scope->Get(sample, &position, &velocity, &events);
+    if (fabs(velocity) > max_velocity) {
+      max_velocity = fabs(velocity);
+    }
+  }
+  float velocity_scale = 0.0;
+  if (max_velocity > 0.0) {
+    velocity_scale = (height_ / 2 - 1) / max_velocity;
+  }
+  int bottom = top_ + height_ - 1;
+  for (int sample = 0; sample < KEY_SCOPE_SAMPLES; sample++) {
+    float position, velocity;
+    int events;
+    Scope->Get(sample, &position, &velocity, &events);
+    want_position_[sample] = bottom -
+    static_cast<int>(constrain(position, 0.0, 1.0) * (height_ - 1));
+    want_velocity_[sample] = top_ + height_ / 2 -
+    static_cast<int>(velocity * velocity_scale);
+    want_events_[sample] = events;
+  }
+  strike_row_ = bottom - static_cast<int>(constrain(Scope->StrikeThreshold(),
+  0.0, 1.0) * (height_ - 1));
+  release_row_ = bottom - static_cast<int>(constrain(Scope->ReleaseThreshold(),
+  0.0, 1.0) * (height_ - 1));
+  loaded_ = true;
+  column_ = 0;
+  phase_ = 0;
+  span_offset_ = 0;
+}
+
+// Stop drawing the last capture.
+void TftScope::Unload() {
+  loaded_ = false;
+}
+
+// Call after the display was cleared.
+// A row of -1 means nothing is drawn in that column.
+void TftScope::Blank() {
+  for (int sample = 0; sample < KEY_SCOPE_SAMPLES; sample++) {
+    shown_position_[sample] = -1;
+    shown_velocity_[sample] = -1;
+    shown_events_[sample] = 0;
+  }
+  column_ = 0;
+  phase_ = 0;
+  span_offset_ = 0;
+}
+
+// Returns true if the display shows the whole capture.
+bool TftScope::Draw(unsigned long start_micros, unsigned long budget_micros) {
+  while (loaded_ == true && column_ < KEY_SCOPE_SAMPLES &&
+  micros() - start_micros < budget_micros) {
+    int c = column_;
+    int p = c > 0 ? c - 1 : c;
+    int x = x0_ + c;
+    bool done = true;
+    if (phase_ == 0) {
+      // Skip a column that did not change.
+      if (want_position_[c] == shown_position_[c] &&
+      want_position_[p] == shown_position_[p] &&
+      want_velocity_[c] == shown_velocity_[c] &&
+      want_velocity_[p] == shown_velocity_[p] &&
+      want_events_[c] == shown_events_[c]) {
+        phase_ = 6;
+      }
+      else if (shown_position_[p] >= 0 && shown_position_[c] >= 0) {
+        done = DrawSpan(x, shown_position_[p], shown_position_[c],
+        ILI9341_BLACK);
+      }
+    }
+    else if (phase_ == 1) {
+      if (shown_velocity_[p] >= 0 && shown_velocity_[c] >= 0) {
+        done = DrawSpan(x, shown_velocity_[p], shown_velocity_[c],
+        ILI9341_BLACK);
+      }
+    }
+    else if (phase_ == 2) {
+      if (c % 2 == 0) {
+        TftPointer_->drawPixel(x, strike_row_, ILI9341_DARKGREY);
+        TftPointer_->drawPixel(x, release_row_, ILI9341_DARKGREY);
+        TftPointer_->drawPixel(x, top_ + height_ / 2, ILI9341_DARKGREY);
+      }
+    }
+    else if (phase_ == 3) {
+      done = DrawSpan(x, want_position_[p], want_position_[c], ILI9341_YELLOW);
+    }
+    else if (phase_ == 4) {
+      done = DrawSpan(x, want_velocity_[p], want_velocity_[c], ILI9341_CYAN);
+    }
+    else if (phase_ == 5) {
+      int color = ILI9341_BLACK;
+      if ((want_events_[c] & KEY_SCOPE_HAMMER_EVENT) != 0) {
+        color = ILI9341_RED;
+      }
+      else if ((want_events_[c] & KEY_SCOPE_DAMPER_EVENT) != 0) {
+        color = ILI9341_BLUE;
+      }
+      TftPointer_->drawFastVLine(x, top_ + height_ + 2, 6, color);
+    }
+    if (done == true) {
+      phase_++;
+      if (phase_ > 5) {
+        NextColumn();
+      }
+    }
+  }
+  return loaded_ == false || column_ >= KEY_SCOPE_SAMPLES;
+}
+
+// Private methods. ////////
+
+void TftScope::NextColumn() {
+  // The previous column is still needed to erase this column.
+  if (column_ > 0) {
+    shown_position_[column_ - 1] = want_position_[column_ - 1];
+    shown_velocity_[column_ - 1] = want_velocity_[column_ - 1];
+    shown_events_[column_ - 1] = want_events_[column_ - 1];
+  }
+  column_++;
+  phase_ = 0;
+  if (column_ == KEY_SCOPE_SAMPLES) {
+    shown_position_[column_ - 1] = want_position_[column_ - 1];
+    shown_velocity_[column_ - 1] = want_velocity_[column_ - 1];
+    shown_events_[column_ - 1] = want_events_[column_ - 1];
+  }
+}
+
+// Vertical line from row a to row b, at most TFT_SCOPE_MAX_SPAN
+// pixels per call. Returns true when the whole line is drawn.
+bool TftScope::DrawSpan(int x, int a, int b, int color) {
+  int y0 = min(a, b) + span_offset_;
+  int length = min(max(a, b) - y0 + 1, TFT_SCOPE_MAX_SPAN);
+  TftPointer_->drawFastVLine(x, y0, length, color);
+  span_offset_ += length;
+  if (min(a, b) + span_offset_ > max(a, b)) {
+    span_offset_ = 0;
+    return true;
+  }
+  return false;
+}
+
+#endif
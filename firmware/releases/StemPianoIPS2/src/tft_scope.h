@@ -0,0 +1,83 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// tft_scope.h
+//
+// For ips pcb version 2.X
+//
+// Draw a key scope capture on the TFT display.
+
+#ifndef TFT_SCOPE_H_
+#define TFT_SCOPE_H_
+
+#include "stem_piano_ips2.h"
+
+#ifdef TFT_INSTALLED
+
+#include <Adafruit_GFX.h>
+#include "Adafruit_ILI9341.h"
+#include <SPI.h>
+
+#include "key_scope.h"
+
+// Longest vertical line drawn at a time, in pixels.
+#define TFT_SCOPE_MAX_SPAN 32
+
+class TftScope
+{
+
+  public:
+
+    TftScope();
+    void Setup(Adafruit_ILI9341 *, int, int, int);
+    void Load(KeyScope *);
+    void Unload();
+    void Blank();
+    bool Draw(unsigned long, unsigned long);
+
+  private:
+    void NextColumn();
+    bool DrawSpan(int, int, int, int);
+
+    Adafruit_ILI9341 *TftPointer_;
+
+    int x0_;
+    int top_;
+    int height_;
+
+    // Pixel rows of each column. Traces connect to the previous column.
+    int want_position_[KEY_SCOPE_SAMPLES];
+    int want_velocity_[KEY_SCOPE_SAMPLES];
+    uint8_t want_events_[KEY_SCOPE_SAMPLES];
+    int shown_position_[KEY_SCOPE_SAMPLES];
+    int shown_velocity_[KEY_SCOPE_SAMPLES];
+    uint8_t shown_events_[KEY_SCOPE_SAMPLES];
+    int strike_row_;
+    int release_row_;
+    bool loaded_;
+
+    int column_;
+    int phase_;
+    int span_offset_;
+
+};
+
+#endif
+
+#endif
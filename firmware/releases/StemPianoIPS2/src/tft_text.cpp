@@ -22,6 +22,13 @@
 // This class is not hardware dependent.
 //
 // Text drawing on TFT display.
+//
+// Print() draws the whole string right away. Fields are drawn
+// incrementally instead. SetField() only changes what a field should
+// show. UpdateFields() compares that with what the display shows, and
+// draws changed character cells one pixel row at a time, until the time
+// budget is used. Each row is one small SPI transfer, so a call never
+// goes far past its budget. The rest is drawn in the next call.
 
 #include "tft_text.h"
 
@@ -32,6 +39,15 @@ TftText::TftText() {}
 void TftText::Setup(Adafruit_ILI9341 *tft, int display_height) {
   TftPointer_ = tft;
   display_height_ = display_height;
+  num_fields_ = 0;
+  for (int field = 0; field < TFT_TEXT_MAX_FIELDS; field++) {
+    fields_[field].num_chars = 0;
+  }
+  Cell_ = new GFXcanvas16(6*TFT_TEXT_MAX_SIZE, 8*TFT_TEXT_MAX_SIZE);
+  cell_field_ = 0;
+  cell_char_ = 0;
+  cell_row_ = -1;
+  rows_drawn_ = 0;
 }
 
 // mode: 0=wrap print, 1=no wrap print, 2=no wrap println.
@@ -56,4 +72,113 @@ void TftText::Print(char const *text, int x, int y, int color, int size, int mod
   }
 }
 
+// Field number from 0 to TFT_TEXT_MAX_FIELDS - 1.
+// Same x and y as Print(). Size from 1 to TFT_TEXT_MAX_SIZE.
+void TftText::SetupField(int field, int x, int y, int size) {
+  if (field < 0 || field >= TFT_TEXT_MAX_FIELDS) {
+    return;
+  }
+  size = constrain(size, 1, TFT_TEXT_MAX_SIZE);
+  fields_[field].x = x;
+  fields_[field].top = display_height_ - y;
+  fields_[field].size = size;
+  fields_[field].num_chars = min((TftPointer_->width() - x) / (6*size),
+  TFT_TEXT_FIELD_CHARS);
+  for (int c = 0; c < TFT_TEXT_FIELD_CHARS; c++) {
+    fields_[field].want[c] = ' ';
+    fields_[field].shown[c] = ' ';
+    fields_[field].shown_color[c] = ILI9341_BLACK;
+  }
+  fields_[field].want_color = ILI9341_BLACK;
+  if (field >= num_fields_) {
+    num_fields_ = field + 1;
+  }
+}
+
+// Text past the end of the field is not drawn.
+void TftText::SetField(int field, char const *text, int color) {
+  if (field < 0 || field >= num_fields_) {
+    return;
+  }
+  int c = 0;
+  while (c < fields_[field].num_chars && text[c] != '\0') {
+    fields_[field].want[c] = text[c];
+    c++;
+  }
+  while (c < fields_[field].num_chars) {
+    fields_[field].want[c] = ' ';
+    c++;
+  }
+  fields_[field].want_color = color;
+}
+
+// Call after the display was cleared.
+void TftText::BlankFields() {
+  for (int field = 0; field < num_fields_; field++) {
+    for (int c = 0; c < TFT_TEXT_FIELD_CHARS; c++) {
+      fields_[field].shown[c] = ' ';
+      fields_[field].shown_color[c] = ILI9341_BLACK;
+    }
+  }
+  cell_row_ = -1;
+}
+
+// Returns true if the display shows every field.
+bool TftText::UpdateFields(unsigned long start_micros,
+unsigned long budget_micros) {
+  while (micros() - start_micros < budget_micros) {
+    if (cell_row_ < 0 && NextDirtyCell() == false) {
+      return true;
+    }
+    TftTextField *f = &fields_[cell_field_];
+    int width = 6*f->size;
+    TftPointer_->drawRGBBitmap(f->x + width*cell_char_, f->top + cell_row_,
+    Cell_->getBuffer() + 6*TFT_TEXT_MAX_SIZE*cell_row_, width, 1);
+    rows_drawn_++;
+    cell_row_++;
+    if (cell_row_ == 8*f->size) {
+      f->shown[cell_char_] = cell_text_;
+      f->shown_color[cell_char_] = cell_color_;
+      cell_row_ = -1;
+    }
+  }
+  return false;
+}
+
+unsigned long TftText::RowsDrawn() {
+  return rows_drawn_;
+}
+
+// Private methods. ////////
+
+// Find the next character cell that differs from what is shown,
+// starting after the last one drawn, and draw it into the cell buffer.
+// A space in any color looks the same, so it is not redrawn.
+bool TftText::NextDirtyCell() {
+  for (int count = 0; count < num_fields_*TFT_TEXT_FIELD_CHARS; count++) {
+    cell_char_++;
+    if (cell_char_ >= fields_[cell_field_].num_chars) {
+      cell_char_ = 0;
+      cell_field_++;
+      if (cell_field_ >= num_fields_) {
+        cell_field_ = 0;
+      }
+    }
+    TftTextField *f = &fields_[cell_field_];
+    if (cell_char_ >= f->num_chars) {
+      continue;
+    }
+    char want = f->want[cell_char_];
+    if (want != f->shown[cell_char_] ||
+    (want != ' ' && f->want_color != f->shown_color[cell_char_])) {
+      cell_text_ = want;
+      cell_color_ = f->want_color;
+      Cell_->drawChar(0, 0, cell_text_, cell_color_, ILI9341_BLACK, f->size);
+      cell_row_ = 0;
+      return true;
+    }
+  }
+  return false;
+}
+
 #endif
\ No newline at end of file
@@ -34,6 +34,27 @@
 #include "Adafruit_ILI9341.h"
 #include <SPI.h>
 
+// Maximum number of text fields that are drawn incrementally.
+#define TFT_TEXT_MAX_FIELDS 12
+
+// Characters in a field. 320 pixels wide at 12 pixels per size 2 character.
+#define TFT_TEXT_FIELD_CHARS 27
+
+// Largest text size of a field. Sets the size of the character cell buffer.
+#define TFT_TEXT_MAX_SIZE 3
+
+// What a field should show, and what the display actually shows.
+struct TftTextField {
+  int x;
+  int top;
+  int size;
+  int num_chars;
+  char want[TFT_TEXT_FIELD_CHARS];
+  uint16_t want_color;
+  char shown[TFT_TEXT_FIELD_CHARS];
+  uint16_t shown_color[TFT_TEXT_FIELD_CHARS];
+};
+
 class TftText
 {
 
@@ -43,10 +64,30 @@ class TftText
     void Setup(Adafruit_ILI9341 *, int);
     void Print(char const *, int, int, int, int, int);
 
+    void SetupField(int, int, int, int);
+    void SetField(int, char const *, int);
+    void BlankFields();
+    bool UpdateFields(unsigned long, unsigned long);
+    unsigned long RowsDrawn();
+
   private:
+    bool NextDirtyCell();
+
     Adafruit_ILI9341 *TftPointer_;
     int display_height_;
 
+    TftTextField fields_[TFT_TEXT_MAX_FIELDS];
+    int num_fields_;
+
+    // The character cell being drawn, one pixel row at a time.
+    GFXcanvas16 *Cell_;
+    int cell_field_;
+    int cell_char_;
+    int cell_row_;
+    char cell_text_;
+    uint16_t cell_color_;
+    unsigned long rows_drawn_;
+
 };
 
 #endif
@@ -19,18 +19,41 @@
 //
 // timing.cpp
 //
-// This class is not hardware dependent.
+// This class is not hardware dependent, except the optional
+// frame clock, which uses a Teensy IntervalTimer.
 //
 // Control how often something runs
+//
+// With the hardware frame clock, a PIT interrupt marks each deadline
+// and AllowProcessing() returns true once per deadline. Deadlines are
+// absolute, so a late poll makes that frame late but does not move
+// later frames, and the sample rate is exactly 1 / processing_interval.
+// The time from the deadline to the poll (start jitter) goes into a
+// histogram, and deadlines that passed with no frame are missed.
+// Both are printed at DEBUG_STATS.
 
 #include "timing.h"
 
+Timing *Timing::clock_owner_ = nullptr;
+
 Timing::Timing() {}
 
 void Timing::Setup(int processing_interval, int debug_level) {
   last_micros_ = micros();
   processing_interval_ = (unsigned long) processing_interval;
   debug_level_ = debug_level;
+  fixed_grid_ = false;
+
+  hardware_clock_ = false;
+  ticks_ = 0;
+  tick_micros_ = last_micros_;
+  restore_interval_ = false;
+  ticks_read_ = 0;
+  missed_deadlines_ = 0;
+  for (int bin = 0; bin < TIMING_JITTER_BINS; bin++) {
+    jitter_histogram_[bin] = 0;
+  }
+  max_jitter_ = 0;
 
   // Checking for errors in processing interval.
   start_micros_ = micros();
@@ -40,10 +63,34 @@ void Timing::Setup(int processing_interval, int debug_level) {
 // Use a separate function for changing the processing interval
 // during runtime because Setup() functions are reserved for init.
 void Timing::ResetInterval(int processing_interval) {
+  if (hardware_clock_ == true &&
+  processing_interval_ != (unsigned long) processing_interval) {
+    // Takes effect at the next deadline.
+    timer_.update(processing_interval);
+  }
   processing_interval_ = (unsigned long) processing_interval;
 }
 
 bool Timing::AllowProcessing() {
+  if (hardware_clock_ == true) {
+    return AllowProcessingHardwareClock();
+  }
+  if (fixed_grid_ == true) {
+    // Signed because AdjustPhase() can move the start into the future.
+    unsigned long now_micros = micros();
+    long interval = static_cast<long>(processing_interval_);
+    if (static_cast<long>(now_micros - last_micros_) >= interval) {
+      last_micros_ += processing_interval_;
+      // Fell more than one interval behind, so start a new grid.
+      if (static_cast<long>(now_micros - last_micros_) >= interval) {
+        last_micros_ = now_micros;
+      }
+      return true;
+    }
+    else {
+      return false;
+    }
+  }
   if (micros() - last_micros_ > processing_interval_) {
     last_micros_ = micros();
     return true;
@@ -53,6 +100,67 @@ bool Timing::AllowProcessing() {
   }
 }
 
+// By default, each interval starts when AllowProcessing() sees that
+// the last one ended, so the time until the poll adds to every interval.
+// With a fixed grid, each interval starts exactly processing_interval
+// after the last one. Required for lining up samples on two boards.
+void Timing::SetFixedGrid(bool fixed_grid) {
+  fixed_grid_ = fixed_grid;
+}
+
+// Pace frames with a hardware timer instead of polling micros().
+// Returns to polling if the timer cannot start.
+void Timing::SetHardwareClock(bool hardware_clock) {
+  if (hardware_clock == true && hardware_clock_ == false) {
+    clock_owner_ = this;
+    ticks_ = 0;
+    ticks_read_ = 0;
+    if (timer_.begin(TimerInterrupt,
+    static_cast<unsigned int>(processing_interval_)) == true) {
+      hardware_clock_ = true;
+    }
+    else if (debug_level_ >= DEBUG_INFO) {
+      Serial.println("Timing - no free timer, polling for frames instead.");
+    }
+  }
+  else if (hardware_clock == false && hardware_clock_ == true) {
+    timer_.end();
+    hardware_clock_ = false;
+  }
+}
+
+// Move the fixed grid. A positive phase error means this board
+// samples late, so the next interval starts sooner.
+// Only a quarter of the error is corrected, and at most 1/8 of the
+// interval, so one bad measurement does not disturb the sampling.
+void Timing::AdjustPhase(int phase_error) {
+  int max_correction = static_cast<int>(processing_interval_ / 8);
+  int correction = phase_error / 4;
+  if (correction > max_correction)
+    correction = max_correction;
+  else if (correction < -max_correction)
+    correction = -max_correction;
+  if (hardware_clock_ == true) {
+    // Shorten or stretch one period. The interrupt restores the
+    // interval at the next deadline, when the new period has loaded.
+    timer_.update(
+    static_cast<unsigned int>(processing_interval_ - correction));
+    restore_interval_ = true;
+  }
+  else {
+    last_micros_ -= correction;
+  }
+}
+
+// When the last AllowProcessing() interval started.
+unsigned long Timing::ProcessingStartMicros() {
+  return last_micros_;
+}
+
+int Timing::ProcessingInterval() {
+  return static_cast<int>(processing_interval_);
+}
+
 void Timing::WarnOnProcessingInterval() {
   if (debug_level_ >= DEBUG_INFO) {
     unsigned long now_micros, delta_micros;
@@ -67,4 +175,74 @@ void Timing::WarnOnProcessingInterval() {
       last_long_micros_ = micros();
     }
   }
-}
\ No newline at end of file
+}
+
+// Histogram of frame start jitter since the last call.
+void Timing::PrintStatistics() {
+  if (debug_level_ >= DEBUG_STATS) {
+    Serial.print("Frame start jitter (us):");
+    for (int bin = 0; bin < TIMING_JITTER_BINS; bin++) {
+      if (bin == 0)
+        Serial.printf(" <1=%lu", jitter_histogram_[bin]);
+      else if (bin == TIMING_JITTER_BINS - 1)
+        Serial.printf(" >=%d=%lu", 1 << (bin - 1), jitter_histogram_[bin]);
+      else
+        Serial.printf(" %d-%d=%lu", 1 << (bin - 1), (1 << bin) - 1,
+        jitter_histogram_[bin]);
+    }
+    Serial.printf(", max = %lu, missed deadlines = %lu.\n", max_jitter_,
+    missed_deadlines_);
+  }
+  for (int bin = 0; bin < TIMING_JITTER_BINS; bin++) {
+    jitter_histogram_[bin] = 0;
+  }
+  max_jitter_ = 0;
+  missed_deadlines_ = 0;
+}
+
+// Private methods. ////////
+
+void Timing::TimerInterrupt() {
+  if (clock_owner_ != nullptr) {
+    clock_owner_->Tick();
+  }
+}
+
+void Timing::Tick() {
+  tick_micros_ = micros();
+  ticks_ = ticks_ + 1;
+  if (restore_interval_ == true) {
+    timer_.update(static_cast<unsigned int>(processing_interval_));
+    restore_interval_ = false;
+  }
+}
+
+bool Timing::AllowProcessingHardwareClock() {
+  uint32_t ticks;
+  unsigned long deadline_micros;
+  do {
+    ticks = ticks_;
+    deadline_micros = tick_micros_;
+  } while (ticks != ticks_);
+
+  if (ticks == ticks_read_) {
+    return false;
+  }
+  if (ticks_read_ != 0) {
+    missed_deadlines_ += ticks - ticks_read_ - 1;
+  }
+  ticks_read_ = ticks;
+  last_micros_ = deadline_micros;
+
+  unsigned long jitter = micros() - deadline_micros;
+  int bin = 0;
+  while (bin < TIMING_JITTER_BINS - 1 && (jitter >> bin) != 0) {
+    bin++;
+  }
+  jitter_histogram_[bin]++;
+  if (jitter > max_jitter_) {
+    max_jitter_ = jitter;
+  }
+
+  return true;
+}
@@ -19,7 +19,8 @@
 //
 // timing.h
 //
-// This class is not hardware dependent.
+// This class is not hardware dependent, except the optional
+// frame clock, which uses a Teensy IntervalTimer.
 //
 // Control how often something runs
 
@@ -28,6 +29,10 @@
 
 #include "stem_piano_ips2.h"
 
+// Frame start jitter histogram. Bin k counts jitter in [2^(k-1), 2^k)
+// microseconds, bin 0 is less than 1 us, and the last bin is the rest.
+#define TIMING_JITTER_BINS 10
+
 class Timing
 {
   public:
@@ -36,14 +41,37 @@ class Timing
     bool AllowProcessing();
     void ResetInterval(int);
     void WarnOnProcessingInterval();
+    void PrintStatistics();
+    void SetFixedGrid(bool);
+    void SetHardwareClock(bool);
+    void AdjustPhase(int);
+    unsigned long ProcessingStartMicros();
+    int ProcessingInterval();
  
   private:
     int debug_level_;
+    bool fixed_grid_;
     unsigned long last_micros_;
     unsigned long processing_interval_;
     unsigned long start_micros_;
     unsigned long last_long_micros_;
 
+    // Hardware frame clock. Only one instance can own the timer.
+    bool hardware_clock_;
+    IntervalTimer timer_;
+    static Timing *clock_owner_;
+    static void TimerInterrupt();
+    void Tick();
+    volatile uint32_t ticks_;
+    volatile unsigned long tick_micros_;
+    volatile bool restore_interval_;
+    uint32_t ticks_read_;
+    unsigned long missed_deadlines_;
+    unsigned long jitter_histogram_[TIMING_JITTER_BINS];
+    unsigned long max_jitter_;
+
+    bool AllowProcessingHardwareClock();
+
 };
 
 #endif
@@ -0,0 +1,99 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// velocity_curve.cpp
+//
+// This class is not hardware dependent.
+//
+// Map a velocity in range [0.0, ..., 1.0] to a 14-bit MIDI velocity
+// in range [0, ..., 16383]. The upper 7 bits are the note on velocity
+// and the lower 7 bits are the optional high resolution velocity
+// prefix (CC88).
+//
+// Curve types:
+//   VELOCITY_CURVE_LINEAR   Same as the original 128 * velocity.
+//   VELOCITY_CURVE_POWER    velocity ^ exponent. Exponent > 1.0 gives
+//                           more control for soft playing.
+//   VELOCITY_CURVE_TABLE    Straight lines between VELOCITY_CURVE_POINTS
+//                           values, equally spaced from velocity 0.0 to
+//                           1.0. Each value is in range [0.0, ..., 1.0].
+//
+// The curve is only computed in Setup(). Lookup() is a table
+// interpolation, with no pow() or other slow math per note.
+
+#include "velocity_curve.h"
+
+VelocityCurve::VelocityCurve() {}
+
+void VelocityCurve::Setup(int type, float exponent, const float *table,
+int debug_level) {
+
+  debug_level_ = debug_level;
+
+  if (type == VELOCITY_CURVE_POWER && exponent <= 0.0) {
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.println("Error - velocity curve exponent must be > 0.0.");
+      Serial.println("Using a linear velocity curve.");
+    }
+    type = VELOCITY_CURVE_LINEAR;
+  }
+
+  float x, y;
+  for (int ind = 0; ind < VELOCITY_CURVE_LOOKUP_SIZE; ind++) {
+    x = static_cast<float>(ind) / (VELOCITY_CURVE_LOOKUP_SIZE - 1);
+    if (type == VELOCITY_CURVE_POWER) {
+      y = powf(x, exponent);
+    }
+    else if (type == VELOCITY_CURVE_TABLE) {
+      float position = x * (VELOCITY_CURVE_POINTS - 1);
+      int point = static_cast<int>(position);
+      if (point >= VELOCITY_CURVE_POINTS - 1) {
+        point = VELOCITY_CURVE_POINTS - 2;
+      }
+      float fraction = position - point;
+      y = table[point] + fraction * (table[point + 1] - table[point]);
+    }
+    else {
+      y = x;
+    }
+    if (y < 0.0) y = 0.0;
+    if (y > 1.0) y = 1.0;
+    lookup_[ind] = static_cast<uint16_t>(16383.0 * y + 0.5);
+  }
+
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.printf("Velocity curve type %d, 0.5 maps to MIDI velocity %d.\n",
+    type, lookup_[(VELOCITY_CURVE_LOOKUP_SIZE - 1) / 2] >> 7);
+  }
+}
+
+// Negative velocity is treated as positive, the same as before.
+int VelocityCurve::Lookup(float velocity) {
+  if (velocity < 0.0) {
+    velocity = -velocity;
+  }
+  if (velocity >= 1.0) {
+    return lookup_[VELOCITY_CURVE_LOOKUP_SIZE - 1];
+  }
+  float position = velocity * (VELOCITY_CURVE_LOOKUP_SIZE - 1);
+  int ind = static_cast<int>(position);
+  float fraction = position - ind;
+  return static_cast<int>(lookup_[ind] +
+  fraction * (lookup_[ind + 1] - lookup_[ind]) + 0.5);
+}
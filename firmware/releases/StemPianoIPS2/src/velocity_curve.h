@@ -0,0 +1,51 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// velocity_curve.h
+//
+// This class is not hardware dependent.
+//
+// Map a velocity in range [0.0, ..., 1.0] to a 14-bit MIDI velocity.
+
+#ifndef VELOCITY_CURVE_H_
+#define VELOCITY_CURVE_H_
+
+#include "stem_piano_ips2.h"
+
+#define VELOCITY_CURVE_LINEAR 0
+#define VELOCITY_CURVE_POWER  1
+#define VELOCITY_CURVE_TABLE  2
+
+// Size of the lookup table built by Setup(). One more than a
+// power of two so the last segment ends exactly at 1.0.
+#define VELOCITY_CURVE_LOOKUP_SIZE 257
+
+class VelocityCurve
+{
+  public:
+    VelocityCurve();
+    void Setup(int, float, const float *, int);
+    int Lookup(float);
+
+  private:
+    int debug_level_;
+    uint16_t lookup_[VELOCITY_CURVE_LOOKUP_SIZE];
+};
+
+#endif
@@ -0,0 +1,55 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// Adafruit_ILI9341.h
+//
+// Host stand-in for the Adafruit ILI9341 library, for the host tests.
+// Only drawRGBBitmap(), which draws into pixels_ and adds
+// HOST_TFT_DRAW_MICROS to host_micros, about 32 pixels of 16 bits
+// at 30 MHz SPI.
+
+#ifndef HOST_ADAFRUIT_ILI9341_H_
+#define HOST_ADAFRUIT_ILI9341_H_
+
+#include <Arduino.h>
+
+#define HOST_TFT_WIDTH 320
+#define HOST_TFT_HEIGHT 240
+#define HOST_TFT_DRAW_MICROS 20
+
+class Adafruit_ILI9341
+{
+  public:
+    void drawRGBBitmap(int16_t x, int16_t y, uint16_t *bitmap, int16_t w,
+    int16_t h) {
+      for (int row = 0; row < h; row++) {
+        for (int column = 0; column < w; column++) {
+          if (x + column < HOST_TFT_WIDTH && y + row < HOST_TFT_HEIGHT) {
+            pixels_[y + row][x + column] = bitmap[row*w + column];
+          }
+        }
+      }
+      host_micros += HOST_TFT_DRAW_MICROS;
+    }
+
+    // For the tests.
+    uint16_t pixels_[HOST_TFT_HEIGHT][HOST_TFT_WIDTH];
+};
+
+#endif
@@ -0,0 +1,128 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// Arduino.h
+//
+// Host stand-in for the Teensy Arduino core, for the host tests.
+// Only what the tested classes use. micros() returns host_micros,
+// which a test sets. Serial1 is a model of the DIN MIDI UART, see
+// host_midi.cpp.
+
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define DMAMEM
+#define EXTMEM
+#define FASTRUN
+
+extern unsigned long host_micros;
+
+unsigned long micros();
+unsigned long millis();
+void pinMode(int, int);
+void digitalWrite(int, int);
+
+template<class T> T min(T a, T b) { return a < b ? a : b; }
+template<class T> T max(T a, T b) { return a > b ? a : b; }
+
+class HostSerial;
+
+// For classes that print themselves, such as IPAddress.
+class Printable
+{
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(HostSerial &) const = 0;
+};
+
+class HostSerial
+{
+  public:
+    int printf(const char *, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char *);
+    size_t print(long);
+    void println(const char *);
+    void println(long);
+    void println(const Printable &);
+    void println();
+};
+
+extern HostSerial Serial;
+
+#define HOST_UART_BUFFER_BYTES 64
+#define HOST_UART_LOG_BYTES 8192
+#define HOST_UART_BYTE_MICROS 320
+
+// Transmit side of a UART at 31.25 kbaud. Each written byte is logged
+// with the time its last bit leaves the wire. A write to a full buffer
+// would block on the Teensy, here it is counted.
+class HardwareSerial
+{
+  public:
+    HardwareSerial();
+    void addMemoryForWrite(void *, size_t);
+    int availableForWrite();
+    size_t write(uint8_t);
+    void Clear();
+    int bytes_;
+    uint8_t byte_[HOST_UART_LOG_BYTES];
+    unsigned long wire_micros_[HOST_UART_LOG_BYTES];
+    int blocked_writes_;
+
+  private:
+    int capacity_;
+    int Waiting();
+};
+
+extern HardwareSerial Serial1;
+
+#define HOST_USB_MIDI_LOG 1024
+
+// Teensy usbMIDI. Messages are logged with their status byte.
+class HostUsbMidi
+{
+  public:
+    void sendNoteOn(uint8_t, uint8_t, uint8_t);
+    void sendNoteOff(uint8_t, uint8_t, uint8_t);
+    void sendControlChange(uint8_t, uint8_t, uint8_t);
+    void sendAfterTouchPoly(uint8_t, uint8_t, uint8_t);
+    void send_now();
+    void Clear();
+    int messages_;
+    uint8_t message_[HOST_USB_MIDI_LOG][3];
+    int flushes_;
+
+  private:
+    void Log(uint8_t, uint8_t, uint8_t, uint8_t);
+};
+
+extern HostUsbMidi usbMIDI;
+
+#endif
@@ -0,0 +1,61 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// EEPROM.h
+//
+// Host stand-in for the Teensy 4.1 EEPROM, with a latency model.
+//
+// The Teensy 4.1 emulates EEPROM in flash. Each address belongs to one
+// of HOST_EEPROM_SECTORS sectors, and a write that changes a byte adds
+// an entry to its sector. When a sector is full it is erased and
+// rewritten, which stops the processor for milliseconds. Writing the
+// same value again only reads. Each call adds its time to host_micros.
+// The times are rough, for checking how the queue spreads the writes.
+
+#ifndef HOST_EEPROM_H_
+#define HOST_EEPROM_H_
+
+#include <Arduino.h>
+
+#define HOST_EEPROM_BYTES 4284
+#define HOST_EEPROM_SECTORS 15
+#define HOST_EEPROM_SECTOR_ENTRIES 2048
+
+#define HOST_EEPROM_READ_MICROS 2
+#define HOST_EEPROM_WRITE_MICROS 30
+#define HOST_EEPROM_ERASE_MICROS 15000
+
+class EEPROMClass
+{
+  public:
+    EEPROMClass();
+    uint8_t read(int);
+    void write(int, uint8_t);
+    void Reset();
+
+    // For the tests.
+    uint8_t data_[HOST_EEPROM_BYTES];
+    int entries_[HOST_EEPROM_SECTORS];
+    unsigned long writes_;
+    unsigned long erases_;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
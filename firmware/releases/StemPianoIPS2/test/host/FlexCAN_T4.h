@@ -0,0 +1,74 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// FlexCAN_T4.h
+//
+// Host stand-in for the FlexCAN_T4 library, for the host tests.
+// write() keeps the last frame in host_can_frame, and onReceive()
+// keeps the callback in host_can_receive, so a test can deliver a
+// frame as if from the receive interrupt.
+
+#ifndef HOST_FLEXCAN_T4_H_
+#define HOST_FLEXCAN_T4_H_
+
+#include <Arduino.h>
+
+enum CAN_DEV_TABLE { CAN1, CAN2, CAN3 };
+enum RXQUEUE_TABLE { RX_SIZE_256 };
+enum TXQUEUE_TABLE { TX_SIZE_16 };
+enum FLEXCAN_CLOCK { CLK_24MHz };
+
+typedef struct CANFD_message_t {
+  uint32_t id = 0;
+  uint8_t len = 0;
+  uint8_t buf[64] = {0};
+} CANFD_message_t;
+
+typedef struct CANFD_timings_t {
+  double baudrate;
+  double baudrateFD;
+  double bus_length;
+  double clock;
+  double propdelay;
+  double sample;
+} CANFD_timings_t;
+
+typedef void (*_MBFD_ptr)(const CANFD_message_t &);
+
+extern CANFD_message_t host_can_frame;
+extern int host_can_writes;
+extern _MBFD_ptr host_can_receive;
+
+template <CAN_DEV_TABLE B, RXQUEUE_TABLE R, TXQUEUE_TABLE T>
+class FlexCAN_T4FD
+{
+  public:
+    void begin() {}
+    void setRegions(int) {}
+    bool setBaudRate(CANFD_timings_t) { return true; }
+    void onReceive(_MBFD_ptr handler) { host_can_receive = handler; }
+    void enableMBInterrupts() {}
+    int write(const CANFD_message_t &msg) {
+      host_can_frame = msg;
+      host_can_writes++;
+      return 1;
+    }
+};
+
+#endif
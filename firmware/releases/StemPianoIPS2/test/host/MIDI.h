@@ -0,0 +1,91 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// MIDI.h
+//
+// Host stand-in for the Arduino MIDI library, for the host tests.
+// The send functions write the same bytes as the library, including
+// running status when the settings ask for it.
+
+#ifndef HOST_MIDI_H_
+#define HOST_MIDI_H_
+
+#include <Arduino.h>
+
+#define MIDI_NAMESPACE midi
+
+namespace midi {
+
+struct DefaultSettings {
+  static const bool UseRunningStatus = false;
+};
+
+template<class SerialPort>
+class SerialMIDI
+{
+  public:
+    SerialMIDI(SerialPort &port) : port_(port) {}
+    void write(uint8_t value) { port_.write(value); }
+
+  private:
+    SerialPort &port_;
+};
+
+template<class Transport, class Settings = DefaultSettings>
+class MidiInterface
+{
+  public:
+    MidiInterface(Transport &transport) : transport_(transport) {}
+    void begin() { running_status_ = 0; }
+    void sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel) {
+      Send(0x90, note, velocity, channel);
+    }
+    void sendNoteOff(uint8_t note, uint8_t velocity, uint8_t channel) {
+      Send(0x80, note, velocity, channel);
+    }
+    void sendControlChange(uint8_t number, uint8_t value, uint8_t channel) {
+      Send(0xB0, number, value, channel);
+    }
+    void sendAfterTouch(uint8_t note, uint8_t pressure, uint8_t channel) {
+      Send(0xA0, note, pressure, channel);
+    }
+
+  private:
+    void Send(uint8_t type, uint8_t data1, uint8_t data2, uint8_t channel) {
+      uint8_t status = type | ((channel - 1) & 0x0F);
+      if (Settings::UseRunningStatus == false || status != running_status_) {
+        transport_.write(status);
+        running_status_ = status;
+      }
+      transport_.write(data1 & 0x7F);
+      transport_.write(data2 & 0x7F);
+    }
+
+    Transport &transport_;
+    uint8_t running_status_;
+};
+
+}
+
+#define MIDI_CREATE_CUSTOM_INSTANCE(Type, SerialPort, Name, Settings) \
+  MIDI_NAMESPACE::SerialMIDI<Type> serial##Name(SerialPort); \
+  MIDI_NAMESPACE::MidiInterface<MIDI_NAMESPACE::SerialMIDI<Type>, \
+  Settings> Name((MIDI_NAMESPACE::SerialMIDI<Type> &)serial##Name);
+
+#endif
@@ -0,0 +1,133 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// QNEthernet.h
+//
+// Host stand-in for the QNEthernet library, for the host tests.
+// EthernetUDP uses real UDP sockets bound to the address given to
+// Ethernet.begin(), so a test can use loopback addresses such as
+// 127.0.0.2 for the computer and have several programs receive.
+// Multicast is sent and joined on the loopback interface. There is
+// no TCP, EthernetClient never connects.
+
+#ifndef HOST_QNETHERNET_H_
+#define HOST_QNETHERNET_H_
+
+#include <Arduino.h>
+
+// Fixed MAC address fuses.
+#define HW_OCOTP_MAC0 0x00123456
+#define HW_OCOTP_MAC1 0x00000401
+
+#define HOST_UDP_PACKET_BYTES 1500
+
+namespace qindesign {
+namespace network {
+
+class IPAddress : public Printable
+{
+  public:
+    IPAddress();
+    IPAddress(uint8_t, uint8_t, uint8_t, uint8_t);
+    uint8_t operator[](int) const;
+    uint8_t &operator[](int);
+    bool operator==(const IPAddress &) const;
+    uint32_t NetworkOrder() const;
+    size_t printTo(HostSerial &) const override;
+
+  private:
+    uint8_t bytes_[4];
+};
+
+enum EthernetHardwareStatus {
+  EthernetNoHardware,
+  EthernetOtherHardware
+};
+
+class EthernetClass
+{
+  public:
+    EthernetClass();
+    void macAddress(uint8_t *);
+    bool begin(const IPAddress &, const IPAddress &, const IPAddress &);
+    EthernetHardwareStatus hardwareStatus();
+    bool joinGroup(const IPAddress &);
+    IPAddress localIP();
+
+    // For the tests.
+    int begins_;
+    int groups_joined_;
+    IPAddress last_group_;
+
+  private:
+    IPAddress local_ip_;
+};
+
+extern EthernetClass Ethernet;
+
+class EthernetUDP
+{
+  public:
+    EthernetUDP();
+    ~EthernetUDP();
+    uint8_t begin(uint16_t);
+    void stop();
+    int beginPacket(const IPAddress &, uint16_t);
+    size_t write(const uint8_t *, size_t);
+    int endPacket();
+    void flush();
+    int parsePacket();
+    int read(uint8_t *, size_t);
+    IPAddress remoteIP();
+    uint16_t remotePort();
+
+    // For the tests.
+    unsigned long packets_sent_;
+
+  private:
+    int socket_;
+    uint8_t out_[HOST_UDP_PACKET_BYTES];
+    size_t out_length_;
+    IPAddress out_ip_;
+    uint16_t out_port_;
+    uint8_t in_[HOST_UDP_PACKET_BYTES];
+    int in_length_;
+    int in_read_;
+    IPAddress remote_ip_;
+    uint16_t remote_port_;
+};
+
+class EthernetClient
+{
+  public:
+    void setConnectionTimeout(int);
+    bool connect(const IPAddress &, uint16_t);
+    bool connected();
+    int available();
+    int read();
+    int availableForWrite();
+    size_t write(const uint8_t *, size_t);
+    void flush();
+    void stop();
+};
+
+}  // namespace network
+}  // namespace qindesign
+
+#endif
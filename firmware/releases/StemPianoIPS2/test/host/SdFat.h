@@ -0,0 +1,63 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// SdFat.h
+//
+// Host stand-in for the SdFat library, with a latency model.
+//
+// A test adds files with host_sd_add(). A read that needs a 512 byte
+// block other than the last one read adds HOST_SD_BLOCK_MICROS to
+// host_micros, the time at tft_sd_clock_mhz = 10. Other reads come
+// from the block already read and add HOST_SD_CACHED_MICROS.
+
+#ifndef HOST_SDFAT_H_
+#define HOST_SDFAT_H_
+
+#include <Arduino.h>
+
+#define O_RDONLY 0
+
+#define HOST_SD_BLOCK_BYTES 512
+#define HOST_SD_BLOCK_MICROS 419
+#define HOST_SD_CACHED_MICROS 1
+#define HOST_SD_FILES 4
+
+void host_sd_add(const char *, const uint8_t *, int);
+
+class File32
+{
+  public:
+    File32();
+    bool open(const char *, int);
+    int read(void *, int);
+    bool seek(uint32_t);
+    uint32_t curPosition();
+    void close();
+
+    // For the tests.
+    unsigned long blocks_read_;
+
+  private:
+    const uint8_t *data_;
+    int size_;
+    uint32_t position_;
+    long block_;
+};
+
+#endif
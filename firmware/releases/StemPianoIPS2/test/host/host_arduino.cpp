@@ -0,0 +1,84 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// host_arduino.cpp
+//
+// Host stand-in for the Teensy Arduino core, for the host tests.
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+unsigned long host_micros = 0;
+HostSerial Serial;
+
+unsigned long micros() {
+  return host_micros;
+}
+
+unsigned long millis() {
+  return host_micros / 1000;
+}
+
+void pinMode(int pin, int mode) {}
+void digitalWrite(int pin, int value) {}
+
+int HostSerial::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int length = vprintf(format, args);
+  va_end(args);
+  return length;
+}
+
+size_t HostSerial::print(const char *text) {
+  fputs(text, stdout);
+  return strlen(text);
+}
+
+size_t HostSerial::print(long value) {
+  return ::printf("%ld", value);
+}
+
+void HostSerial::println(const char *text) {
+  puts(text);
+}
+
+void HostSerial::println(long value) {
+  ::printf("%ld\n", value);
+}
+
+void HostSerial::println(const Printable &value) {
+  value.printTo(*this);
+  putchar('\n');
+}
+
+void HostSerial::println() {
+  putchar('\n');
+}
+
+#include "../host_test.h"
+
+int host_test_checks = 0;
+int host_test_failures = 0;
+
+int HostTestResult(const char *name) {
+  ::printf("%s: %d checks, %d failed.\n", name, host_test_checks,
+  host_test_failures);
+  return host_test_failures == 0 ? 0 : 1;
+}
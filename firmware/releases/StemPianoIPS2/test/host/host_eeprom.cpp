@@ -0,0 +1,68 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// host_eeprom.cpp
+//
+// Host stand-in for the Teensy 4.1 EEPROM. See EEPROM.h.
+
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass() {
+  Reset();
+}
+
+// Erased flash reads 0xFF.
+void EEPROMClass::Reset() {
+  for (int address = 0; address < HOST_EEPROM_BYTES; address++) {
+    data_[address] = 0xFF;
+  }
+  for (int sector = 0; sector < HOST_EEPROM_SECTORS; sector++) {
+    entries_[sector] = 0;
+  }
+  writes_ = 0;
+  erases_ = 0;
+}
+
+uint8_t EEPROMClass::read(int address) {
+  host_micros += HOST_EEPROM_READ_MICROS;
+  if (address < 0 || address >= HOST_EEPROM_BYTES) {
+    return 0xFF;
+  }
+  return data_[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  if (read(address) == value || address < 0 ||
+  address >= HOST_EEPROM_BYTES) {
+    return;
+  }
+  data_[address] = value;
+  writes_++;
+  int sector = (address >> 2) % HOST_EEPROM_SECTORS;
+  if (++entries_[sector] >= HOST_EEPROM_SECTOR_ENTRIES) {
+    entries_[sector] = 0;
+    erases_++;
+    host_micros += HOST_EEPROM_ERASE_MICROS;
+  }
+  else {
+    host_micros += HOST_EEPROM_WRITE_MICROS;
+  }
+}
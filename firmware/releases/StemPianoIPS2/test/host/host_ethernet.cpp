@@ -0,0 +1,239 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// host_ethernet.cpp
+//
+// Host stand-in for the QNEthernet library. See QNEthernet.h.
+
+#include "QNEthernet.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace qindesign {
+namespace network {
+
+EthernetClass Ethernet;
+
+IPAddress::IPAddress() {
+  for (int k = 0; k < 4; k++) {
+    bytes_[k] = 0;
+  }
+}
+
+IPAddress::IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  bytes_[0] = a;
+  bytes_[1] = b;
+  bytes_[2] = c;
+  bytes_[3] = d;
+}
+
+uint8_t IPAddress::operator[](int index) const {
+  return bytes_[index];
+}
+
+uint8_t &IPAddress::operator[](int index) {
+  return bytes_[index];
+}
+
+bool IPAddress::operator==(const IPAddress &other) const {
+  return memcmp(bytes_, other.bytes_, 4) == 0;
+}
+
+uint32_t IPAddress::NetworkOrder() const {
+  uint32_t address;
+  memcpy(&address, bytes_, 4);
+  return address;
+}
+
+size_t IPAddress::printTo(HostSerial &serial) const {
+  return serial.printf("%d.%d.%d.%d", bytes_[0], bytes_[1], bytes_[2],
+  bytes_[3]);
+}
+
+EthernetClass::EthernetClass() {
+  begins_ = 0;
+  groups_joined_ = 0;
+}
+
+void EthernetClass::macAddress(uint8_t *mac) {}
+
+bool EthernetClass::begin(const IPAddress &ip, const IPAddress &netmask,
+const IPAddress &gateway) {
+  local_ip_ = ip;
+  begins_++;
+  return true;
+}
+
+EthernetHardwareStatus EthernetClass::hardwareStatus() {
+  return begins_ > 0 ? EthernetOtherHardware : EthernetNoHardware;
+}
+
+// Sockets join for themselves on the host, so only count the join.
+bool EthernetClass::joinGroup(const IPAddress &group) {
+  groups_joined_++;
+  last_group_ = group;
+  return true;
+}
+
+IPAddress EthernetClass::localIP() {
+  return local_ip_;
+}
+
+EthernetUDP::EthernetUDP() {
+  socket_ = -1;
+  out_length_ = 0;
+  in_length_ = 0;
+  in_read_ = 0;
+  remote_port_ = 0;
+  packets_sent_ = 0;
+}
+
+EthernetUDP::~EthernetUDP() {
+  stop();
+}
+
+uint8_t EthernetUDP::begin(uint16_t port) {
+  stop();
+  socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_ < 0) {
+    return 0;
+  }
+  int on = 1;
+  setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = Ethernet.localIP().NetworkOrder();
+  if (bind(socket_, reinterpret_cast<struct sockaddr *>(&address),
+  sizeof(address)) != 0) {
+    stop();
+    return 0;
+  }
+  struct in_addr interface_address;
+  interface_address.s_addr = address.sin_addr.s_addr;
+  setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, &interface_address,
+  sizeof(interface_address));
+  unsigned char loop = 1;
+  setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  return 1;
+}
+
+void EthernetUDP::stop() {
+  if (socket_ >= 0) {
+    close(socket_);
+    socket_ = -1;
+  }
+}
+
+int EthernetUDP::beginPacket(const IPAddress &ip, uint16_t port) {
+  out_ip_ = ip;
+  out_port_ = port;
+  out_length_ = 0;
+  return socket_ >= 0;
+}
+
+size_t EthernetUDP::write(const uint8_t *data, size_t length) {
+  length = min(length, sizeof(out_) - out_length_);
+  memcpy(&out_[out_length_], data, length);
+  out_length_ += length;
+  return length;
+}
+
+int EthernetUDP::endPacket() {
+  if (socket_ < 0) {
+    return 0;
+  }
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(out_port_);
+  address.sin_addr.s_addr = out_ip_.NetworkOrder();
+  ssize_t sent = sendto(socket_, out_, out_length_, 0,
+  reinterpret_cast<struct sockaddr *>(&address), sizeof(address));
+  if (sent != static_cast<ssize_t>(out_length_)) {
+    return 0;
+  }
+  packets_sent_++;
+  return 1;
+}
+
+void EthernetUDP::flush() {}
+
+// Non-blocking, the same as on the Teensy.
+int EthernetUDP::parsePacket() {
+  in_length_ = 0;
+  in_read_ = 0;
+  if (socket_ < 0) {
+    return 0;
+  }
+  struct sockaddr_in address = {};
+  socklen_t address_length = sizeof(address);
+  ssize_t length = recvfrom(socket_, in_, sizeof(in_), MSG_DONTWAIT,
+  reinterpret_cast<struct sockaddr *>(&address), &address_length);
+  if (length <= 0) {
+    return 0;
+  }
+  in_length_ = length;
+  uint8_t *ip = reinterpret_cast<uint8_t *>(&address.sin_addr.s_addr);
+  remote_ip_ = IPAddress(ip[0], ip[1], ip[2], ip[3]);
+  remote_port_ = ntohs(address.sin_port);
+  return in_length_;
+}
+
+int EthernetUDP::read(uint8_t *data, size_t length) {
+  int bytes = min(static_cast<int>(length), in_length_ - in_read_);
+  memcpy(data, &in_[in_read_], bytes);
+  in_read_ += bytes;
+  return bytes;
+}
+
+IPAddress EthernetUDP::remoteIP() {
+  return remote_ip_;
+}
+
+uint16_t EthernetUDP::remotePort() {
+  return remote_port_;
+}
+
+void EthernetClient::setConnectionTimeout(int millis) {}
+bool EthernetClient::connect(const IPAddress &ip, uint16_t port) {
+  return false;
+}
+bool EthernetClient::connected() {
+  return false;
+}
+int EthernetClient::available() {
+  return 0;
+}
+int EthernetClient::read() {
+  return -1;
+}
+int EthernetClient::availableForWrite() {
+  return 0;
+}
+size_t EthernetClient::write(const uint8_t *data, size_t length) {
+  return 0;
+}
+void EthernetClient::flush() {}
+void EthernetClient::stop() {}
+
+}  // namespace network
+}  // namespace qindesign
@@ -0,0 +1,118 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// host_midi.cpp
+//
+// Host stand-in for the Teensy Serial1 UART and usbMIDI. See Arduino.h.
+//
+// A byte written to the UART starts on the wire when the byte before
+// it is done, or now if the wire is idle, and takes 320 microseconds.
+// Bytes not yet on the wire are waiting in the transmit buffer.
+
+#include <Arduino.h>
+
+HardwareSerial Serial1;
+HostUsbMidi usbMIDI;
+
+HardwareSerial::HardwareSerial() {
+  capacity_ = HOST_UART_BUFFER_BYTES;
+  Clear();
+}
+
+void HardwareSerial::addMemoryForWrite(void *buffer, size_t size) {
+  capacity_ = HOST_UART_BUFFER_BYTES + size;
+}
+
+int HardwareSerial::availableForWrite() {
+  return capacity_ - Waiting();
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+  if (Waiting() >= capacity_) {
+    blocked_writes_++;
+  }
+  if (bytes_ >= HOST_UART_LOG_BYTES) {
+    return 0;
+  }
+  unsigned long start = host_micros;
+  if (bytes_ > 0 && wire_micros_[bytes_ - 1] > start) {
+    start = wire_micros_[bytes_ - 1];
+  }
+  byte_[bytes_] = value;
+  wire_micros_[bytes_] = start + HOST_UART_BYTE_MICROS;
+  bytes_++;
+  return 1;
+}
+
+// Empties the log, for a test that starts with an idle wire.
+void HardwareSerial::Clear() {
+  bytes_ = 0;
+  blocked_writes_ = 0;
+}
+
+// Bytes that have not started on the wire.
+int HardwareSerial::Waiting() {
+  int waiting = 0;
+  for (int k = bytes_ - 1; k >= 0; k--) {
+    if (wire_micros_[k] - HOST_UART_BYTE_MICROS <= host_micros) {
+      break;
+    }
+    waiting++;
+  }
+  return waiting;
+}
+
+void HostUsbMidi::sendNoteOn(uint8_t note, uint8_t velocity,
+uint8_t channel) {
+  Log(0x90, note, velocity, channel);
+}
+
+void HostUsbMidi::sendNoteOff(uint8_t note, uint8_t velocity,
+uint8_t channel) {
+  Log(0x80, note, velocity, channel);
+}
+
+void HostUsbMidi::sendControlChange(uint8_t number, uint8_t value,
+uint8_t channel) {
+  Log(0xB0, number, value, channel);
+}
+
+void HostUsbMidi::sendAfterTouchPoly(uint8_t note, uint8_t pressure,
+uint8_t channel) {
+  Log(0xA0, note, pressure, channel);
+}
+
+void HostUsbMidi::send_now() {
+  flushes_++;
+}
+
+void HostUsbMidi::Clear() {
+  messages_ = 0;
+  flushes_ = 0;
+}
+
+void HostUsbMidi::Log(uint8_t type, uint8_t data1, uint8_t data2,
+uint8_t channel) {
+  if (messages_ < HOST_USB_MIDI_LOG) {
+    message_[messages_][0] = type | ((channel - 1) & 0x0F);
+    message_[messages_][1] = data1;
+    message_[messages_][2] = data2;
+    messages_++;
+  }
+}
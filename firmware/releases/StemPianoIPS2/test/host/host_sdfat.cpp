@@ -0,0 +1,93 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// host_sdfat.cpp
+//
+// Host stand-in for the SdFat library. See SdFat.h.
+
+#include "SdFat.h"
+
+static const char *host_sd_name[HOST_SD_FILES];
+static const uint8_t *host_sd_data[HOST_SD_FILES];
+static int host_sd_size[HOST_SD_FILES];
+static int host_sd_files = 0;
+
+// The data is not copied, so it must stay in scope.
+void host_sd_add(const char *name, const uint8_t *data, int size) {
+  if (host_sd_files < HOST_SD_FILES) {
+    host_sd_name[host_sd_files] = name;
+    host_sd_data[host_sd_files] = data;
+    host_sd_size[host_sd_files] = size;
+    host_sd_files++;
+  }
+}
+
+File32::File32() {
+  data_ = nullptr;
+  blocks_read_ = 0;
+}
+
+bool File32::open(const char *name, int flags) {
+  for (int file = 0; file < host_sd_files; file++) {
+    if (strcmp(name, host_sd_name[file]) == 0) {
+      data_ = host_sd_data[file];
+      size_ = host_sd_size[file];
+      position_ = 0;
+      block_ = -1;
+      blocks_read_ = 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+int File32::read(void *buffer, int bytes) {
+  if (data_ == nullptr) {
+    return -1;
+  }
+  bytes = min(bytes, size_ - static_cast<int>(position_));
+  for (int ind = 0; ind < bytes; ind++) {
+    long block = (position_ + ind) / HOST_SD_BLOCK_BYTES;
+    if (block != block_) {
+      block_ = block;
+      blocks_read_++;
+      host_micros += HOST_SD_BLOCK_MICROS;
+    }
+  }
+  host_micros += HOST_SD_CACHED_MICROS;
+  memcpy(buffer, &data_[position_], bytes);
+  position_ += bytes;
+  return bytes;
+}
+
+bool File32::seek(uint32_t position) {
+  if (data_ == nullptr || position > static_cast<uint32_t>(size_)) {
+    return false;
+  }
+  position_ = position;
+  return true;
+}
+
+uint32_t File32::curPosition() {
+  return position_;
+}
+
+void File32::close() {
+  data_ = nullptr;
+}
@@ -0,0 +1,44 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// host_test.h
+//
+// Checks for the host tests. A failed check prints the file, line,
+// and expression, and the test exits with an error at the end.
+
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+#include <stdio.h>
+
+extern int host_test_checks;
+extern int host_test_failures;
+
+#define CHECK(condition) do { \
+  host_test_checks++; \
+  if (!(condition)) { \
+    host_test_failures++; \
+    printf("%s:%d: CHECK(%s) failed.\n", __FILE__, __LINE__, #condition); \
+  } \
+} while (0)
+
+// Print the result and return the exit code for main().
+int HostTestResult(const char *);
+
+#endif
@@ -0,0 +1,427 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// test_board2board.cpp
+//
+// Host test of the Board2Board frame packing. A sender packs a frame,
+// the FlexCAN stand-in delivers it to the receive interrupt of a
+// receiver, and the receiver unpacks it.
+//
+// ./test_board2board          Run the tests.
+// ./test_board2board bench    Also time packing and unpacking.
+
+#include <chrono>
+
+#include "board2board.h"
+#include "host_test.h"
+
+static Board2Board Tx;
+static Board2Board Rx;
+
+// Same CRC as the firmware, written out again so the test does not
+// depend on the code it checks.
+static uint16_t TestCrc16(const uint8_t *data, int length) {
+  uint16_t crc = 0xFFFF;
+  for (int ind = 0; ind < length; ind++) {
+    crc ^= data[ind] << 8;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+static void SetCrc(CANFD_message_t *msg) {
+  uint16_t crc = TestCrc16(msg->buf, CANBUS_LENGTH - 2);
+  msg->buf[62] = crc >> 8;
+  msg->buf[63] = crc & 0xFF;
+}
+
+static float Random(float low, float high) {
+  return low + (high - low) * static_cast<float>(rand()) / RAND_MAX;
+}
+
+static void Start(int frame_format) {
+  Tx.Setup(true, DEBUG_NONE);
+  Tx.SetupSend(frame_format);
+  Rx.Setup(true, DEBUG_NONE);
+  Rx.SetupReceive(100);
+}
+
+// One sample: the frame arrives, then the receiver reads it.
+static bool Deliver(const CANFD_message_t &msg, float *position) {
+  host_micros += 250;
+  host_can_receive(msg);
+  host_micros += 50;
+  return Rx.GetDamperData(position);
+}
+
+static int PositionBits(int key) {
+  return (key < 8 || key >= 64) ? 4 : 6;
+}
+
+static void TestPositionRoundTrip() {
+  Start(B2B_FRAME_POSITION);
+  float in[NUM_CHANNELS], out[NUM_CHANNELS];
+  for (int frame = 0; frame < 2000; frame++) {
+    for (int key = 0; key < NUM_CHANNELS; key++) {
+      // Include values outside [0, 1], which are clipped.
+      in[key] = Random(-0.2, 1.2);
+    }
+    Tx.SendDamperData(in);
+    CHECK(Deliver(host_can_frame, out) == true);
+    for (int key = 0; key < NUM_NOTES; key++) {
+      int levels = 1 << PositionBits(key);
+      int expected = static_cast<int>(levels * in[key]);
+      expected = max(0, min(levels - 1, expected));
+      CHECK(out[key] == static_cast<float>(expected) / levels);
+    }
+    for (int key = NUM_NOTES; key < NUM_CHANNELS; key++) {
+      CHECK(out[key] == 0.0);
+    }
+  }
+}
+
+static void TestRejectBadFrames() {
+  Start(B2B_FRAME_POSITION);
+  float in[NUM_CHANNELS], out[NUM_CHANNELS];
+  for (int key = 0; key < NUM_CHANNELS; key++) {
+    in[key] = 0.5;
+    out[key] = -1.0;
+  }
+
+  // Any single bit error fails the CRC, and the positions do not change.
+  for (int bit = 0; bit < 8 * CANBUS_LENGTH; bit++) {
+    Tx.SendDamperData(in);
+    CANFD_message_t msg = host_can_frame;
+    msg.buf[bit / 8] ^= 0x80 >> (bit % 8);
+    CHECK(Deliver(msg, out) == false);
+    CHECK(out[0] == -1.0);
+  }
+
+  // A good frame after bad ones is used.
+  Tx.SendDamperData(in);
+  CANFD_message_t good = host_can_frame;
+  CHECK(Deliver(good, out) == true);
+  CHECK(out[0] == 0.5);
+
+  // The same frame again is a duplicate.
+  CHECK(Deliver(good, out) == false);
+
+  // Another format version, with a good CRC.
+  Tx.SendDamperData(in);
+  CANFD_message_t msg = host_can_frame;
+  msg.buf[0] = ((B2B_FORMAT_VERSION + 1) << 4) | (msg.buf[0] & 0x0F);
+  SetCrc(&msg);
+  CHECK(Deliver(msg, out) == false);
+
+  // A frame of the wrong length never reaches the reader.
+  Tx.SendDamperData(in);
+  msg = host_can_frame;
+  msg.len = 32;
+  CHECK(Deliver(msg, out) == false);
+}
+
+// Damper events across the 12 bit sequence wrap. A lost frame makes
+// the receiver recover a note off for a damper that went down.
+static void TestSequenceWrap() {
+  Start(B2B_FRAME_EVENTS);
+  bool event[NUM_CHANNELS], out_event[NUM_CHANNELS];
+  float velocity[NUM_CHANNELS], position[NUM_CHANNELS];
+  float out[NUM_CHANNELS], out_velocity[NUM_CHANNELS];
+  const float threshold = 0.5;
+  for (int key = 0; key < NUM_CHANNELS; key++) {
+    event[key] = false;
+    velocity[key] = 0.0;
+    position[key] = 0.0;
+  }
+
+  // Key 10 damper up. Sequences 1 to 4095.
+  position[10] = 1.0;
+  for (int frame = 1; frame <= 4095; frame++) {
+    Tx.SendDamperEvents(event, velocity, position, threshold);
+    CHECK(Deliver(host_can_frame, out) == true);
+  }
+  CHECK(((host_can_frame.buf[0] & 0x0F) << 8 | host_can_frame.buf[1]) == 4095);
+
+  // Sequence 0, damper down without an event. No frame is missing
+  // across the wrap, so no event is recovered.
+  position[10] = 0.0;
+  Tx.SendDamperEvents(event, velocity, position, threshold);
+  CHECK(((host_can_frame.buf[0] & 0x0F) << 8 | host_can_frame.buf[1]) == 0);
+  CHECK(Deliver(host_can_frame, out) == true);
+  Rx.GetDamperEvents(out_event, out_velocity);
+  CHECK(out_event[10] == false);
+
+  // Up at sequence 1, then sequence 2 is lost with the damper down.
+  position[10] = 1.0;
+  Tx.SendDamperEvents(event, velocity, position, threshold);
+  CHECK(Deliver(host_can_frame, out) == true);
+  position[10] = 0.0;
+  Tx.SendDamperEvents(event, velocity, position, threshold);
+  Tx.SendDamperEvents(event, velocity, position, threshold);
+  CHECK(Deliver(host_can_frame, out) == true);
+  Rx.GetDamperEvents(out_event, out_velocity);
+  CHECK(out_event[10] == true);
+  CHECK(out_velocity[10] < 0.0);
+
+  // An event with its velocity.
+  event[20] = true;
+  velocity[20] = 0.5;
+  Tx.SendDamperEvents(event, velocity, position, threshold);
+  CHECK(Deliver(host_can_frame, out) == true);
+  Rx.GetDamperEvents(out_event, out_velocity);
+  CHECK(out_event[20] == true);
+  CHECK(out_velocity[20] == 63 / 127.0f);
+  CHECK(out_event[10] == false);
+}
+
+static int AdaptiveBits(int key) {
+  return key < 64 ? 10 : 8;
+}
+
+static int Quantized(float position, int bits) {
+  int levels = 1 << bits;
+  int value = static_cast<int>(levels * position);
+  return max(0, min(levels - 1, value));
+}
+
+// Which keys an adaptive frame carries, and how many bits it uses.
+static int AdaptiveSent(const CANFD_message_t &msg, bool *sent) {
+  int bit = 5 * 8;
+  for (int key = 0; key < msg.buf[4]; key++) {
+    sent[key] = (msg.buf[bit / 8] >> (7 - bit % 8)) & 1;
+    bit += sent[key] ? 1 + AdaptiveBits(key) : 1;
+  }
+  return bit;
+}
+
+static void TestAdaptiveRoundTrip() {
+  Start(B2B_FRAME_ADAPTIVE);
+  float in[NUM_CHANNELS], out[NUM_CHANNELS];
+  bool sent[NUM_CHANNELS];
+  for (int key = 0; key < NUM_CHANNELS; key++) {
+    in[key] = Random(-0.2, 1.2);
+  }
+  in[40] = 0.25;
+  in[41] = 0.25;
+
+  // Nothing was sent yet, so every key moved. Keys that do not fit
+  // wait, and a still input is complete after a few frames.
+  for (int frame = 0; frame < 4; frame++) {
+    Tx.SendDamperData(in);
+    CHECK(host_can_frame.buf[4] == B2B_ADAPTIVE_KEYS);
+    CHECK(AdaptiveSent(host_can_frame, sent) <= (CANBUS_LENGTH - 2) * 8);
+    CHECK(Deliver(host_can_frame, out) == true);
+  }
+  for (int key = 0; key < NUM_CHANNELS; key++) {
+    int bits = AdaptiveBits(key);
+    CHECK(out[key] == static_cast<float>(Quantized(in[key], bits)) /
+    (1 << bits));
+  }
+
+  // Still input, so only the refresh keys are sent.
+  Tx.SendDamperData(in);
+  int count = 0;
+  AdaptiveSent(host_can_frame, sent);
+  for (int key = 0; key < NUM_CHANNELS; key++) {
+    count += sent[key];
+  }
+  CHECK(count == B2B_ADAPTIVE_REFRESH_KEYS);
+
+  CHECK(Deliver(host_can_frame, out) == true);
+
+  // A move inside the deadband is not sent, one outside it is.
+  in[40] = (256 + B2B_ADAPTIVE_DEADBAND + 0.5) / 1024.0;
+  in[41] = (256 + B2B_ADAPTIVE_DEADBAND + 1.5) / 1024.0;
+  Tx.SendDamperData(in);
+  AdaptiveSent(host_can_frame, sent);
+  CHECK(Deliver(host_can_frame, out) == true);
+  CHECK(sent[40] == false);
+  CHECK(out[40] == 0.25);
+  CHECK(sent[41] == true);
+  CHECK(out[41] == (256 + B2B_ADAPTIVE_DEADBAND + 1) / 1024.0f);
+}
+
+// Every key moves every frame, more than fits in a frame.
+static void TestAdaptiveBudget() {
+  Start(B2B_FRAME_ADAPTIVE);
+  float in[NUM_CHANNELS], out[NUM_CHANNELS];
+  bool sent[NUM_CHANNELS];
+  bool sent_high[NUM_CHANNELS];
+  int last_frame[NUM_CHANNELS];
+  const int budget = (CANBUS_LENGTH - 2 - 5) * 8 - B2B_ADAPTIVE_KEYS;
+  for (int key = 0; key < NUM_CHANNELS; key++) {
+    sent_high[key] = false;
+    last_frame[key] = 0;
+  }
+  int start_key = 0;
+  int max_wait = 0;
+  for (int frame = 1; frame <= 1000; frame++) {
+    for (int key = 0; key < NUM_CHANNELS; key++) {
+      // At least 0.2 from the last value sent, outside the deadband.
+      in[key] = (sent_high[key] == true) ? Random(0.0, 0.3) : Random(0.5, 1.0);
+    }
+    Tx.SendDamperData(in);
+    int end_bit = AdaptiveSent(host_can_frame, sent);
+    CHECK(end_bit - 5 * 8 - B2B_ADAPTIVE_KEYS <= budget);
+    CHECK(end_bit - 5 * 8 - B2B_ADAPTIVE_KEYS > budget - 10);
+
+    // The first key that did not fit in the last frame is sent, and
+    // the keys after it until the budget is used.
+    CHECK(sent[start_key] == true);
+    for (int ind = 0; ind < NUM_CHANNELS; ind++) {
+      int key = (start_key + ind) % NUM_CHANNELS;
+      if (sent[key] == false) {
+        start_key = key;
+        break;
+      }
+    }
+    for (int key = 0; key < NUM_CHANNELS; key++) {
+      if (sent[key] == true) {
+        max_wait = max(max_wait, frame - last_frame[key]);
+        last_frame[key] = frame;
+        sent_high[key] = in[key] >= 0.5;
+      }
+    }
+
+    CHECK(Deliver(host_can_frame, out) == true);
+    for (int key = 0; key < NUM_CHANNELS; key++) {
+      if (sent[key] == true) {
+        int bits = AdaptiveBits(key);
+        CHECK(out[key] == static_cast<float>(Quantized(in[key], bits)) /
+        (1 << bits));
+      }
+    }
+  }
+  // No key waits for more than a few frames.
+  CHECK(max_wait <= 3);
+}
+
+static void TestAdaptiveNumKeys() {
+  Start(B2B_FRAME_ADAPTIVE);
+  float in[NUM_CHANNELS], out[NUM_CHANNELS];
+  for (int key = 0; key < NUM_CHANNELS; key++) {
+    in[key] = 0.5;
+  }
+  for (int frame = 0; frame < 4; frame++) {
+    Tx.SendDamperData(in);
+    CHECK(Deliver(host_can_frame, out) == true);
+  }
+  Tx.SendDamperData(in);
+  CANFD_message_t msg = host_can_frame;
+
+  // More keys than the receiver has.
+  msg.buf[4] = B2B_ADAPTIVE_KEYS + 1;
+  SetCrc(&msg);
+  CHECK(Deliver(msg, out) == false);
+
+  // Fewer keys, so the rest are 0.
+  Tx.SendDamperData(in);
+  msg = host_can_frame;
+  msg.buf[4] = 50;
+  SetCrc(&msg);
+  CHECK(Deliver(msg, out) == true);
+  CHECK(out[0] == 0.5);
+  CHECK(out[49] == 0.5);
+  CHECK(out[50] == 0.0);
+  CHECK(out[NUM_CHANNELS - 1] == 0.0);
+
+  // Every flag set runs past the end of the frame.
+  Tx.SendDamperData(in);
+  msg = host_can_frame;
+  for (int ind = 5; ind < CANBUS_LENGTH - 2; ind++) {
+    msg.buf[ind] = 0xFF;
+  }
+  SetCrc(&msg);
+  CHECK(Deliver(msg, out) == false);
+}
+
+// Random frames with a good CRC must never read past the frame.
+static void TestRandomFrames() {
+  Start(B2B_FRAME_POSITION);
+  float out[NUM_CHANNELS];
+  const uint32_t ids[4] = {B2B_ID_LEGACY, B2B_ID_POSITION, B2B_ID_EVENTS,
+  B2B_ID_ADAPTIVE};
+  CANFD_message_t msg;
+  msg.len = CANBUS_LENGTH;
+  for (int frame = 0; frame < 20000; frame++) {
+    msg.id = ids[frame % 4];
+    for (int ind = 0; ind < CANBUS_LENGTH; ind++) {
+      msg.buf[ind] = rand() & 0xFF;
+    }
+    msg.buf[0] = (B2B_FORMAT_VERSION << 4) | (msg.buf[0] & 0x0F);
+    SetCrc(&msg);
+    for (int key = 0; key < NUM_CHANNELS; key++) {
+      out[key] = 0.0;
+    }
+    Deliver(msg, out);
+    for (int key = 0; key < NUM_CHANNELS; key++) {
+      CHECK(out[key] >= 0.0 && out[key] < 1.0);
+    }
+  }
+}
+
+// Host time per frame. Only useful to compare formats, or to see
+// that the time does not depend on how many keys moved.
+static void Bench(const char *name, int frame_format, float moving) {
+  Start(frame_format);
+  float in[NUM_CHANNELS], out[NUM_CHANNELS];
+  for (int key = 0; key < NUM_CHANNELS; key++) {
+    in[key] = Random(0.0, 1.0);
+  }
+  const int frames = 200000;
+  double pack_seconds = 0.0;
+  double unpack_seconds = 0.0;
+  for (int frame = 0; frame < frames; frame++) {
+    for (int key = 0; key < NUM_CHANNELS; key++) {
+      if (Random(0.0, 1.0) < moving) {
+        in[key] = Random(0.0, 1.0);
+      }
+    }
+    auto start = std::chrono::steady_clock::now();
+    Tx.SendDamperData(in);
+    auto packed = std::chrono::steady_clock::now();
+    Deliver(host_can_frame, out);
+    auto unpacked = std::chrono::steady_clock::now();
+    pack_seconds += std::chrono::duration<double>(packed - start).count();
+    unpack_seconds += std::chrono::duration<double>(unpacked - packed).count();
+  }
+  printf("%s, %3.0f%% of keys moving: pack %.0f ns, unpack %.0f ns per frame.\n",
+  name, 100.0 * moving, 1e9 * pack_seconds / frames,
+  1e9 * unpack_seconds / frames);
+}
+
+int main(int argc, char **argv) {
+  srand(1);
+  TestPositionRoundTrip();
+  TestRejectBadFrames();
+  TestSequenceWrap();
+  TestAdaptiveRoundTrip();
+  TestAdaptiveBudget();
+  TestAdaptiveNumKeys();
+  TestRandomFrames();
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    Bench("Position", B2B_FRAME_POSITION, 1.0);
+    Bench("Adaptive", B2B_FRAME_ADAPTIVE, 0.0);
+    Bench("Adaptive", B2B_FRAME_ADAPTIVE, 0.1);
+    Bench("Adaptive", B2B_FRAME_ADAPTIVE, 1.0);
+  }
+  return HostTestResult("test_board2board");
+}
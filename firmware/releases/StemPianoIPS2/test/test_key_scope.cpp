@@ -0,0 +1,161 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// test_key_scope.cpp
+//
+// Host test of KeyScope. Each sample the scoped key's position is the
+// sample number, so every captured sample shows where it came from.
+
+#include "key_scope.h"
+#include "host_test.h"
+
+static KeyScope Scope;
+
+static float position[NUM_CHANNELS];
+static bool hammer_event[NUM_CHANNELS];
+static float hammer_velocity[NUM_CHANNELS];
+static bool damper_event[NUM_CHANNELS];
+
+static const int key = 40;
+
+// Add sample number n, with a hammer event if event is true.
+static void Add(int n, bool event) {
+  for (int ind = 0; ind < NUM_CHANNELS; ind++) {
+    position[ind] = -1.0;
+    hammer_event[ind] = false;
+    hammer_velocity[ind] = 0.0;
+    damper_event[ind] = false;
+  }
+  position[key] = static_cast<float>(n);
+  hammer_event[key] = event;
+  hammer_velocity[key] = 0.001 * n;
+  damper_event[key] = (n % 10) == 0;
+  Scope.Add(position, hammer_event, hammer_velocity, damper_event);
+}
+
+// The capture holds samples trigger - KEY_SCOPE_PRETRIGGER onward,
+// oldest first.
+static void CheckCapture(int trigger) {
+  for (int sample = 0; sample < KEY_SCOPE_SAMPLES; sample++) {
+    float p, v;
+    int events;
+    Scope.Get(sample, &p, &v, &events);
+    int n = trigger - KEY_SCOPE_PRETRIGGER + sample;
+    CHECK(p == static_cast<float>(n));
+    if (n > 0) {
+      CHECK(v == 1.0);
+    }
+    CHECK(((events & KEY_SCOPE_DAMPER_EVENT) != 0) == ((n % 10) == 0));
+  }
+  float p, v;
+  int events;
+  Scope.Get(KEY_SCOPE_PRETRIGGER, &p, &v, &events);
+  CHECK((events & KEY_SCOPE_HAMMER_EVENT) != 0);
+  CHECK(Scope.TriggerVelocity() == static_cast<float>(0.001 * trigger));
+}
+
+// Add samples from next on. Ready exactly when the last sample after
+// the trigger is in.
+static void CheckReadyAfter(int trigger, int next) {
+  int last = trigger + KEY_SCOPE_SAMPLES - KEY_SCOPE_PRETRIGGER - 1;
+  for (int n = next; n <= last; n++) {
+    CHECK(Scope.Ready() == false);
+    Add(n, false);
+  }
+  CHECK(Scope.Ready() == true);
+}
+
+// A hammer event only triggers once there are KEY_SCOPE_PRETRIGGER
+// samples before it.
+static void TestPretrigger() {
+  Scope.Setup(DEBUG_NONE);
+  Scope.SelectKey(key);
+  for (int n = 0; n < KEY_SCOPE_PRETRIGGER; n++) {
+    Add(n, n == KEY_SCOPE_PRETRIGGER - 1);
+  }
+  CHECK(Scope.Ready() == false);
+  Add(KEY_SCOPE_PRETRIGGER, true);
+  CheckReadyAfter(KEY_SCOPE_PRETRIGGER, KEY_SCOPE_PRETRIGGER + 1);
+  CheckCapture(KEY_SCOPE_PRETRIGGER);
+}
+
+// After the ring wrapped many times, the capture is still in order.
+static void TestWrap() {
+  Scope.Setup(DEBUG_NONE);
+  Scope.SelectKey(key);
+  const int trigger = 10 * KEY_SCOPE_SAMPLES + 37;
+  for (int n = 0; n < trigger; n++) {
+    Add(n, false);
+  }
+  Add(trigger, true);
+  // Later hammer events are in the capture but do not trigger again.
+  Add(trigger + 1, true);
+  CheckReadyAfter(trigger, trigger + 2);
+  CheckCapture(trigger);
+}
+
+// A ready capture does not change until Rearm().
+static void TestFreeze() {
+  Scope.Setup(DEBUG_NONE);
+  Scope.SelectKey(key);
+  const int trigger = 500;
+  for (int n = 0; n < trigger; n++) {
+    Add(n, false);
+  }
+  Add(trigger, true);
+  CheckReadyAfter(trigger, trigger + 1);
+  for (int n = 0; n < 3 * KEY_SCOPE_SAMPLES; n++) {
+    Add(100000 + n, n % 7 == 0);
+  }
+  CHECK(Scope.Ready() == true);
+  CheckCapture(trigger);
+
+  Scope.Rearm();
+  CHECK(Scope.Ready() == false);
+  for (int n = 0; n < 2000; n++) {
+    Add(n, n == 1000);
+  }
+  CHECK(Scope.Ready() == true);
+  CheckCapture(1000);
+}
+
+// Other keys, and no key, never trigger.
+static void TestSelectKey() {
+  Scope.Setup(DEBUG_NONE);
+  CHECK(Scope.Key() == -1);
+  for (int n = 0; n < 1000; n++) {
+    Add(n, true);
+  }
+  CHECK(Scope.Ready() == false);
+  Scope.SelectKey(key + 1);
+  for (int n = 0; n < 1000; n++) {
+    Add(n, true);
+  }
+  CHECK(Scope.Ready() == false);
+  Scope.SelectKey(NUM_CHANNELS);
+  CHECK(Scope.Key() == -1);
+}
+
+int main() {
+  TestPretrigger();
+  TestWrap();
+  TestFreeze();
+  TestSelectKey();
+  return HostTestResult("test_key_scope");
+}
@@ -0,0 +1,313 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// test_midiout.cpp
+//
+// Host test of the MidiOut frame order and DIN output. Serial1 is a
+// model of the 31.25 kbaud UART that logs when each byte leaves the
+// wire, so the chord skew and wire delay are measured, not estimated.
+// The measured chord skew is checked against the estimate MidiOut
+// prints in its statistics.
+
+#include "midiout.h"
+#include "host_test.h"
+
+#include <unistd.h>
+
+static MIDI_NAMESPACE::SerialMIDI<HardwareSerial> SerialMidi(Serial1);
+static MY_MIDI_INTERFACE Mi(SerialMidi);
+static uint8_t Midi_Buffer[MIDI_BUFFER_SIZE];
+static MidiOut Midi;
+static AutoMute Mute;
+
+// One message decoded from the UART log.
+struct DinMessage {
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+  unsigned long wire_micros;  // Last byte off the wire.
+};
+
+static DinMessage Din[HOST_UART_LOG_BYTES / 2];
+
+// Decode the bytes on the wire, with running status.
+static int DecodeDin() {
+  int count = 0;
+  uint8_t status = 0;
+  int k = 0;
+  while (k < Serial1.bytes_) {
+    if ((Serial1.byte_[k] & 0x80) != 0) {
+      status = Serial1.byte_[k++];
+    }
+    CHECK(status != 0 && k + 1 < Serial1.bytes_);
+    Din[count].status = status;
+    Din[count].data1 = Serial1.byte_[k];
+    Din[count].data2 = Serial1.byte_[k + 1];
+    Din[count].wire_micros = Serial1.wire_micros_[k + 1];
+    count++;
+    k += 2;
+  }
+  return count;
+}
+
+static int StatusBytes() {
+  int count = 0;
+  for (int k = 0; k < Serial1.bytes_; k++) {
+    if ((Serial1.byte_[k] & 0x80) != 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// An idle wire, and MidiOut set up the same as the hammer board.
+static void Start(size_t extra_buffer, bool high_resolution, int debug_level) {
+  host_micros += 1000000;
+  Serial1.addMemoryForWrite(Midi_Buffer, extra_buffer);
+  Serial1.Clear();
+  usbMIDI.Clear();
+  Mute.Setup(127);
+  Midi.Setup(1, &Mi, &Serial1, 127, debug_level);
+  Midi.SetupVelocityCurve(VELOCITY_CURVE_LINEAR, 1.0, nullptr,
+  high_resolution);
+}
+
+// Key index and velocity for each note, 0.0 to 1.0.
+static void Chord(int count, const int *key, const float *velocity,
+bool note_on) {
+  bool event[NUM_NOTES] = {};
+  float key_velocity[NUM_NOTES] = {};
+  for (int k = 0; k < count; k++) {
+    event[key[k]] = true;
+    key_velocity[key[k]] = velocity[k];
+  }
+  if (note_on == true)
+    Midi.SendNoteOn(&Mute, event, key_velocity);
+  else
+    Midi.SendNoteOff(&Mute, event, key_velocity, false);
+}
+
+// Runs samples until the UART has written everything.
+static void Drain() {
+  for (int k = 0; k < 1000; k++) {
+    host_micros += 250;
+    Midi.SendFrame();
+  }
+}
+
+// At DEBUG_STATS MidiOut also prints every note, so everything it
+// prints goes to a file, and the statistic is read back from there.
+static FILE *Printed;
+static int Saved_Stdout;
+
+static void BeginCapture() {
+  fflush(stdout);
+  Saved_Stdout = dup(1);
+  Printed = tmpfile();
+  dup2(fileno(Printed), 1);
+}
+
+// The number after the label in what was printed.
+static int EndCapture(const char *label) {
+  fflush(stdout);
+  dup2(Saved_Stdout, 1);
+  close(Saved_Stdout);
+  static char text[65536];
+  rewind(Printed);
+  size_t length = fread(text, 1, sizeof(text) - 1, Printed);
+  text[length] = '\0';
+  fclose(Printed);
+  const char *found = strstr(text, label);
+  int value = -1;
+  if (found != nullptr) {
+    sscanf(found + strlen(label), " = %d", &value);
+  }
+  return value;
+}
+
+// Note off, pedal up, other controllers, note on loudest first with
+// equal velocities in key order, then aftertouch. USB and DIN agree,
+// except DIN skips the aftertouch behind a big frame.
+static void TestPriorityOrder() {
+  Start(MIDI_BUFFER_SIZE, false, DEBUG_NONE);
+
+  // Two switch pedals, no connected pin. Press the second.
+  PedalDescriptor pedals[2] = {
+    {0, -1, 64, false, 0.0, PEDAL_MODE_SWITCH},
+    {1, -1, 67, false, 0.0, PEDAL_MODE_SWITCH},
+  };
+  DspPedal Pedal;
+  Pedal.Setup(1000, 0.5, pedals, 2, DEBUG_NONE);
+  float position[NUM_CHANNELS] = {};
+  for (int k = 0; k < 10; k++) {
+    Pedal.UpdatePedalState(position);
+  }
+  position[1] = 1.0;
+  Pedal.UpdatePedalState(position);
+  Midi.SendPedal(&Pedal);
+  Midi.SendFrame();
+  Drain();
+  CHECK(DecodeDin() == 1 && Din[0].data1 == 67 && Din[0].data2 == 127);
+
+  // Press the first, release the second, play and release notes.
+  // The release is sent first, even though its pedal comes second.
+  Serial1.Clear();
+  usbMIDI.Clear();
+  const int on_key[4] = {10, 20, 30, 40};
+  const float on_velocity[4] = {0.2, 0.4, 0.4, 0.3};
+  Chord(4, on_key, on_velocity, true);
+  Midi.SendPolyPressure(50, 60);
+  position[0] = 1.0;
+  position[1] = 0.0;
+  Pedal.UpdatePedalState(position);
+  Midi.SendPedal(&Pedal);
+  const int off_key[2] = {5, 60};
+  const float off_velocity[2] = {0.1, 0.1};
+  Chord(2, off_key, off_velocity, false);
+  Midi.SendFrame();
+  Drain();
+
+  const uint8_t order[9][2] = {
+    {0x80, 26}, {0x80, 81}, {0xB0, 67}, {0xB0, 64},
+    {0x90, 41}, {0x90, 51}, {0x90, 61}, {0x90, 31}, {0xA0, 71},
+  };
+  CHECK(usbMIDI.messages_ == 9);
+  CHECK(usbMIDI.flushes_ == 1);
+  for (int k = 0; k < usbMIDI.messages_ && k < 9; k++) {
+    CHECK(usbMIDI.message_[k][0] == order[k][0]);
+    CHECK(usbMIDI.message_[k][1] == order[k][1]);
+  }
+  CHECK(usbMIDI.message_[2][2] == 0 && usbMIDI.message_[3][2] == 127);
+  CHECK(DecodeDin() == 8);
+  for (int k = 0; k < 8; k++) {
+    CHECK(Din[k].status == order[k][0] && Din[k].data1 == order[k][1]);
+  }
+
+  // Alone on an idle wire, aftertouch is sent on DIN.
+  Serial1.Clear();
+  Midi.SendPolyPressure(50, 61);
+  Midi.SendFrame();
+  CHECK(DecodeDin() == 1 && Din[0].status == 0xA0 && Din[0].data2 == 61);
+  CHECK(Serial1.blocked_writes_ == 0);
+}
+
+// A chord is one status byte and 2 bytes per note. CC88 before each
+// note on breaks running status, so every message is 3 bytes.
+static void TestRunningStatus() {
+  int key[10];
+  float velocity[10];
+  for (int k = 0; k < 10; k++) {
+    key[k] = 30 + 3*k;
+    velocity[k] = 0.1 + 0.03*k;
+  }
+
+  Start(MIDI_BUFFER_SIZE, false, DEBUG_NONE);
+  Chord(10, key, velocity, true);
+  Midi.SendFrame();
+  CHECK(Serial1.bytes_ == 3 + 2*9);
+  CHECK(StatusBytes() == 1);
+  Chord(10, key, velocity, false);
+  Midi.SendFrame();
+  CHECK(Serial1.bytes_ == 2*(3 + 2*9));
+  CHECK(StatusBytes() == 2);
+
+  // The next frame continues the running status of the last.
+  Chord(1, key, velocity, false);
+  Midi.SendFrame();
+  CHECK(Serial1.bytes_ == 2*(3 + 2*9) + 2);
+
+  Start(MIDI_BUFFER_SIZE, true, DEBUG_NONE);
+  Chord(10, key, velocity, true);
+  Midi.SendFrame();
+  CHECK(Serial1.bytes_ == 10*6);
+  CHECK(StatusBytes() == 20);
+  CHECK(DecodeDin() == 20);
+  for (int k = 0; k < 20; k += 2) {
+    CHECK(Din[k].status == 0xB0 && Din[k].data1 == 88);
+    CHECK(Din[k + 1].status == 0x90);
+  }
+  CHECK(Serial1.blocked_writes_ == 0);
+}
+
+// Chord skew is the time from the last byte of the first note on the
+// wire to the last byte of the last note. With running status it is
+// 640 us per note after the first, 960 us without.
+static void TestChordSkew() {
+  int key[16];
+  float velocity[16];
+  for (int notes = 2; notes <= 16; notes++) {
+    for (int k = 0; k < notes; k++) {
+      key[k] = 20 + 4*k;
+      velocity[k] = 0.45 - 0.02*k;
+    }
+    BeginCapture();
+    Start(MIDI_BUFFER_SIZE, false, DEBUG_STATS);
+    unsigned long start = host_micros;
+    Chord(notes, key, velocity, true);
+    Midi.SendFrame();
+    Drain();
+    Midi.PrintStatistics();
+    int printed = EndCapture("max chord skew");
+    CHECK(DecodeDin() == notes);
+    int measured = static_cast<int>(Din[notes - 1].wire_micros -
+    Din[0].wire_micros);
+    CHECK(measured == 640*(notes - 1));
+    CHECK(Din[0].wire_micros - start == 960);
+    CHECK(printed == measured);
+  }
+}
+
+// All 88 keys with only the 64 byte UART buffer. MidiOut never writes
+// into a full buffer, the rest go out in later samples, in order and
+// with no gap on the wire. A note off behind the backlog waits for it.
+static void TestDeferred() {
+  int key[NUM_NOTES];
+  float velocity[NUM_NOTES];
+  for (int k = 0; k < NUM_NOTES; k++) {
+    key[k] = k;
+    velocity[k] = 0.05 + 0.005*k;
+  }
+  Start(0, false, DEBUG_NONE);
+  unsigned long start = host_micros;
+  Chord(NUM_NOTES, key, velocity, true);
+  Midi.SendFrame();
+  CHECK(Serial1.bytes_ < 3 + 2*(NUM_NOTES - 1));
+  host_micros += 250;
+  Chord(1, key, velocity, false);
+  Midi.SendFrame();
+  Drain();
+
+  CHECK(Serial1.blocked_writes_ == 0);
+  CHECK(DecodeDin() == NUM_NOTES + 1);
+  CHECK(Serial1.bytes_ == 3 + 2*(NUM_NOTES - 1) + 3);
+  for (int k = 0; k < NUM_NOTES; k++) {
+    CHECK(Din[k].status == 0x90 && Din[k].data1 == 21 + NUM_NOTES - 1 - k);
+  }
+  CHECK(Din[NUM_NOTES].status == 0x80 && Din[NUM_NOTES].data1 == 21);
+  CHECK(Din[NUM_NOTES].wire_micros - start ==
+  static_cast<unsigned long>(320*Serial1.bytes_));
+}
+
+int main() {
+  TestPriorityOrder();
+  TestRunningStatus();
+  TestChordSkew();
+  TestDeferred();
+  return HostTestResult("test_midiout");
+}
@@ -0,0 +1,272 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// test_network.cpp
+//
+// Host test of the Network UDP destinations. The Teensy is 127.0.0.1
+// and the programs on the computer are sockets on other loopback
+// addresses, so every destination is a real receiver. Checks that
+// each receiver gets every stream packet exactly once, in order, and
+// that command replies go only to the sender of the command.
+
+#include "network.h"
+#include "host_test.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define TEST_PORT 47310
+#define TEST_PACKETS 20
+#define TEST_RECEIVERS 8
+
+// A program on the computer. A group member binds the group address,
+// so it only sees the group traffic, and joins on the loopback.
+struct Receiver {
+  int socket;
+  int packets;
+  int in_order;
+  int last_bytes;
+  uint8_t last[HOST_UDP_PACKET_BYTES];
+};
+
+static Receiver receiver[TEST_RECEIVERS];
+static int num_receivers = 0;
+
+static Receiver *Open(const char *ip, int port, bool group) {
+  Receiver *r = &receiver[num_receivers++];
+  r->socket = socket(AF_INET, SOCK_DGRAM, 0);
+  int on = 1;
+  setsockopt(r->socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  inet_pton(AF_INET, ip, &address.sin_addr);
+  CHECK(bind(r->socket, reinterpret_cast<struct sockaddr *>(&address),
+  sizeof(address)) == 0);
+  if (group == true) {
+    struct ip_mreq join;
+    join.imr_multiaddr = address.sin_addr;
+    inet_pton(AF_INET, "127.0.0.1", &join.imr_interface);
+    CHECK(setsockopt(r->socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &join,
+    sizeof(join)) == 0);
+  }
+  r->packets = 0;
+  r->in_order = 0;
+  r->last_bytes = 0;
+  return r;
+}
+
+static void CloseAll() {
+  for (int k = 0; k < num_receivers; k++) {
+    close(receiver[k].socket);
+  }
+  num_receivers = 0;
+}
+
+// Read everything that arrived. Packet n of the stream starts with n.
+static void Drain() {
+  for (int k = 0; k < num_receivers; k++) {
+    Receiver *r = &receiver[k];
+    struct pollfd wait = {r->socket, POLLIN, 0};
+    while (poll(&wait, 1, 20) > 0) {
+      int bytes = recv(r->socket, r->last, sizeof(r->last), MSG_DONTWAIT);
+      if (bytes <= 0) {
+        break;
+      }
+      if (r->last[0] == r->packets) {
+        r->in_order++;
+      }
+      r->packets++;
+      r->last_bytes = bytes;
+    }
+  }
+}
+
+// Stream packets with SendBytes().
+static void Stream(Network *Eth) {
+  uint8_t data[8] = {0, 'p', 'i', 'a', 'n', 'o', 0, 0};
+  for (int n = 0; n < TEST_PACKETS; n++) {
+    data[0] = n;
+    Eth->SendBytes(data, sizeof(data), true, false);
+  }
+  Drain();
+}
+
+static bool GotStream(const Receiver *r) {
+  return r->packets == TEST_PACKETS && r->in_order == TEST_PACKETS;
+}
+
+// UDP, Ethernet switch on, Teensy at 127.0.0.1, computer at 127.0.0.2.
+static void Start(Network *Eth) {
+  Eth->Setup(false, "127.0.0.2", "127.0.0.1", TEST_PORT, true, DEBUG_NONE);
+}
+
+// Without SetupDestinations(), only computer_ip.
+static void TestComputerOnly() {
+  Network Eth;
+  Receiver *computer = Open("127.0.0.2", TEST_PORT, false);
+  Receiver *other = Open("127.0.0.3", TEST_PORT, false);
+  Start(&Eth);
+  CHECK(Eth.EthernetStarted() == true);
+  Stream(&Eth);
+  CHECK(GotStream(computer) == true);
+  CHECK(other->packets == 0);
+
+  // A piano packet is two bytes per channel.
+  float hammer[NUM_CHANNELS], damper[NUM_CHANNELS];
+  for (int k = 0; k < NUM_CHANNELS; k++) {
+    hammer[k] = 0.5;
+    damper[k] = -0.25;
+  }
+  Eth.SendPianoPacket(hammer, damper, true, false, -1);
+  Drain();
+  CHECK(computer->last_bytes == 2*NUM_CHANNELS);
+  CHECK(computer->last[4] + 256*computer->last[5] == 16383);
+  CHECK(static_cast<int16_t>(computer->last[2] + 256*computer->last[3]) ==
+  -8191);
+
+  // Nothing with the Ethernet switch off.
+  Eth.SendBytes(computer->last, 4, false, false);
+  Drain();
+  CHECK(computer->packets == TEST_PACKETS + 1);
+  CloseAll();
+}
+
+// Extra destinations are in addition to computer_ip. Bad entries are
+// skipped, and at most NETWORK_MAX_DESTINATIONS are used.
+static void TestExtraDestinations() {
+  Network Eth;
+  Receiver *computer = Open("127.0.0.2", TEST_PORT, false);
+  Receiver *extra[5];
+  const char *ips[5] = {"127.0.0.3", "127.0.0.4", "127.0.0.5", "127.0.0.6",
+  "127.0.0.7"};
+  for (int k = 0; k < 5; k++) {
+    extra[k] = Open(ips[k], TEST_PORT, false);
+  }
+  Start(&Eth);
+  Eth.SetupDestinations("",
+  "127.0.0.3,,no address,127.0.0.4,127.0.0.5,127.0.0.6,127.0.0.7");
+  Stream(&Eth);
+  CHECK(GotStream(computer) == true);
+  for (int k = 0; k < NETWORK_MAX_DESTINATIONS; k++) {
+    CHECK(GotStream(extra[k]) == true);
+  }
+  CHECK(extra[4]->packets == 0);
+  CloseAll();
+}
+
+// With a group, the stream goes to the group instead of computer_ip.
+// Every member gets it, and extra destinations still do.
+static void TestMulticast() {
+  Network Eth;
+  Receiver *member[3];
+  for (int k = 0; k < 3; k++) {
+    member[k] = Open("239.1.2.3", TEST_PORT, true);
+  }
+  Receiver *computer = Open("127.0.0.2", TEST_PORT, false);
+  Receiver *extra = Open("127.0.0.3", TEST_PORT, false);
+  int joined = Ethernet.groups_joined_;
+  Start(&Eth);
+  Eth.SetupDestinations("239.1.2.3", "127.0.0.3");
+  CHECK(Ethernet.groups_joined_ == joined + 1);
+  CHECK(Ethernet.last_group_ == IPAddress(239, 1, 2, 3));
+  Stream(&Eth);
+  for (int k = 0; k < 3; k++) {
+    CHECK(GotStream(member[k]) == true);
+  }
+  CHECK(GotStream(extra) == true);
+  CHECK(computer->packets == 0);
+  CloseAll();
+
+  // Not a multicast address, back to computer_ip.
+  Network Eth2;
+  computer = Open("127.0.0.2", TEST_PORT, false);
+  Start(&Eth2);
+  Eth2.SetupDestinations("192.168.1.1", "");
+  Stream(&Eth2);
+  CHECK(GotStream(computer) == true);
+  CloseAll();
+}
+
+// Set up with the Ethernet switch off, the group is joined when the
+// switch goes on.
+static void TestJoinOnStart() {
+  Network Eth;
+  Receiver *member = Open("239.1.2.4", TEST_PORT, true);
+  int joined = Ethernet.groups_joined_;
+  Eth.Setup(false, "127.0.0.2", "127.0.0.1", TEST_PORT, false, DEBUG_NONE);
+  Eth.SetupDestinations("239.1.2.4", "");
+  CHECK(Ethernet.groups_joined_ == joined);
+  Eth.UpdateNetworkState(false, false);
+  Eth.UpdateNetworkState(true, false);
+  CHECK(Ethernet.groups_joined_ == joined + 1);
+  Stream(&Eth);
+  CHECK(GotStream(member) == true);
+  CloseAll();
+}
+
+// A reply goes to the address and port the command came from, and
+// not to the stream receivers.
+static void TestReply() {
+  Network Eth;
+  Receiver *member = Open("239.1.2.3", TEST_PORT, true);
+  Receiver *extra = Open("127.0.0.3", TEST_PORT, false);
+  Receiver *sender = Open("127.0.0.9", TEST_PORT + 7, false);
+  Start(&Eth);
+  Eth.SetupDestinations("239.1.2.3", "127.0.0.3");
+
+  struct sockaddr_in teensy = {};
+  teensy.sin_family = AF_INET;
+  teensy.sin_port = htons(TEST_PORT);
+  inet_pton(AF_INET, "127.0.0.1", &teensy.sin_addr);
+  sendto(sender->socket, "status", 6, 0,
+  reinterpret_cast<struct sockaddr *>(&teensy), sizeof(teensy));
+
+  uint8_t command[32];
+  int length = 0;
+  for (int tries = 0; tries < 100 && length == 0; tries++) {
+    length = Eth.ReadBytes(command, sizeof(command));
+    if (length == 0) {
+      usleep(1000);
+    }
+  }
+  CHECK(length == 7);
+  CHECK(memcmp(command, "status\n", 7) == 0);
+
+  uint8_t reply[4] = {0, 'o', 'k', '\n'};
+  Eth.SendReplyBytes(reply, sizeof(reply), true, false);
+  Drain();
+  CHECK(sender->packets == 1);
+  CHECK(sender->last_bytes == 4);
+  CHECK(member->packets == 0);
+  CHECK(extra->packets == 0);
+  CloseAll();
+}
+
+int main() {
+  TestComputerOnly();
+  TestExtraDestinations();
+  TestMulticast();
+  TestJoinOnStart();
+  TestReply();
+  return HostTestResult("test_network");
+}
@@ -0,0 +1,254 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// test_nonvolatile.cpp
+//
+// Host test of the Nonvolatile write-behind queue, with the EEPROM
+// latency model in host/EEPROM.h. Each sample, the processing takes
+// some time and the queue gets what is left before the deadline.
+
+#include "nonvolatile.h"
+#include "host_test.h"
+
+#define SAMPLE_MICROS 250
+#define PROCESSING_MICROS 150
+#define SLICE_MICROS 50
+
+static Nonvolatile Nv;
+
+// Returns true if the sample ended after its deadline.
+static bool Sample(int processing_micros) {
+  unsigned long deadline = host_micros + SAMPLE_MICROS;
+  host_micros += processing_micros;
+  Nv.WriteQueue(deadline);
+  if (static_cast<long>(host_micros - deadline) > 0) {
+    return true;
+  }
+  host_micros = deadline;
+  return false;
+}
+
+// Run samples until the queue is empty. Returns the late samples.
+static int RunQueue() {
+  int late = 0;
+  for (int sample = 0; sample < 100000 && Nv.QueueBusy() == true; sample++) {
+    late += Sample(PROCESSING_MICROS);
+  }
+  CHECK(Nv.QueueBusy() == false);
+  return late;
+}
+
+static void MakeCalibration(double *min, double *max, double offset) {
+  for (int note = 0; note < NUM_NOTES; note++) {
+    min[note] = -0.01 * note + offset;
+    max[note] = 1.0 + 0.001 * note + offset;
+  }
+}
+
+static void CheckCalibration(const double *min, const double *max) {
+  for (int note = 0; note < NUM_NOTES; note++) {
+    CHECK(Nv.ReadCalibrationPositionMin(note) == min[note]);
+    CHECK(Nv.ReadCalibrationPositionMax(note) == max[note]);
+  }
+}
+
+// All bytes are written, the flag and count last, and no sample is late.
+static void TestCalibration() {
+  EEPROM.Reset();
+  Nv.Setup(SLICE_MICROS, DEBUG_NONE);
+  double min[NUM_NOTES], max[NUM_NOTES];
+  MakeCalibration(min, max, 0.0);
+
+  int total_writes = Nv.ReadTotalWrites();
+  CHECK(Nv.QueueCalibrationPosition(min, max) == true);
+  unsigned long start_micros = host_micros;
+  int late = RunQueue();
+
+  CHECK(Nv.ReadCalibrationDoneFlag() == true);
+  CheckCalibration(min, max);
+  CHECK(Nv.ReadTotalWrites() == total_writes + 1);
+  CHECK(late == 0);
+  CHECK(Nv.QueueLateFrames() == 0);
+  printf("Calibration queue: %lu bytes changed in %lu ms, %d late samples.\n",
+  EEPROM.writes_, (host_micros - start_micros) / 1000, late);
+
+  // The same values again only read, so nothing is late.
+  CHECK(Nv.QueueCalibrationPosition(min, max) == true);
+  unsigned long writes = EEPROM.writes_;
+  CHECK(RunQueue() == 0);
+  CHECK(EEPROM.writes_ - writes <= 5);
+}
+
+// Queueing writes nothing, not even the flag clear, so a command
+// during a sample cannot start a flash erase. The first sample
+// clears the flag.
+static void TestQueueDoesNotWrite() {
+  EEPROM.Reset();
+  Nv.Setup(SLICE_MICROS, DEBUG_NONE);
+  double min[NUM_NOTES], max[NUM_NOTES];
+  MakeCalibration(min, max, 0.0);
+  CHECK(Nv.QueueCalibrationPosition(min, max) == true);
+  RunQueue();
+
+  // Every sector erases on its next write.
+  for (int sector = 0; sector < HOST_EEPROM_SECTORS; sector++) {
+    EEPROM.entries_[sector] = HOST_EEPROM_SECTOR_ENTRIES - 1;
+  }
+  MakeCalibration(min, max, 0.5);
+  unsigned long writes = EEPROM.writes_;
+  unsigned long start_micros = host_micros;
+  CHECK(Nv.QueueCalibrationPosition(min, max) == true);
+  CHECK(EEPROM.writes_ == writes);
+  CHECK(EEPROM.erases_ == 0);
+  CHECK(host_micros - start_micros < SAMPLE_MICROS);
+  CHECK(Nv.ReadCalibrationDoneFlag() == true);
+  Sample(PROCESSING_MICROS);
+  CHECK(Nv.ReadCalibrationDoneFlag() == false);
+  Nv.CancelQueue(NONVOLATILE_QUEUE_CALIBRATION);
+
+  double settings[NONVOLATILE_MAX_SETTINGS];
+  for (int index = 0; index < NONVOLATILE_MAX_SETTINGS; index++) {
+    settings[index] = 0.25 * index;
+  }
+  CHECK(Nv.QueueSettings(settings, NONVOLATILE_MAX_SETTINGS) == true);
+  RunQueue();
+  CHECK(Nv.ReadSettingsStoredFlag() == true);
+  writes = EEPROM.writes_;
+  settings[0] = 1.0;
+  CHECK(Nv.QueueSettings(settings, NONVOLATILE_MAX_SETTINGS) == true);
+  CHECK(EEPROM.writes_ == writes);
+  CHECK(Nv.ReadSettingsStoredFlag() == true);
+  RunQueue();
+  CHECK(Nv.ReadSetting(0) == 1.0);
+}
+
+// The limit of the queue. A flash erase is inside one byte write and
+// cannot be split, so it can make the sample with the erase late.
+// Only that sample, and the queue still finishes correctly.
+static void TestEraseLimit() {
+  EEPROM.Reset();
+  Nv.Setup(SLICE_MICROS, DEBUG_NONE);
+  double min[NUM_NOTES], max[NUM_NOTES];
+  MakeCalibration(min, max, 0.0);
+
+  // Most sectors erase during the queue.
+  for (int sector = 0; sector < HOST_EEPROM_SECTORS; sector++) {
+    EEPROM.entries_[sector] = HOST_EEPROM_SECTOR_ENTRIES - 40;
+  }
+  CHECK(Nv.QueueCalibrationPosition(min, max) == true);
+  int late = RunQueue();
+
+  CHECK(Nv.ReadCalibrationDoneFlag() == true);
+  CheckCalibration(min, max);
+  CHECK(EEPROM.erases_ > 0);
+  CHECK(late <= static_cast<int>(EEPROM.erases_));
+  CHECK(late == Nv.QueueLateFrames());
+  printf("With %d flash erases, %d late samples.\n",
+  static_cast<int>(EEPROM.erases_), late);
+}
+
+// Power lost before the queue finished leaves the flag clear.
+static void TestPowerLoss() {
+  EEPROM.Reset();
+  Nv.Setup(SLICE_MICROS, DEBUG_NONE);
+  double min[NUM_NOTES], max[NUM_NOTES];
+  MakeCalibration(min, max, 0.0);
+  CHECK(Nv.QueueCalibrationPosition(min, max) == true);
+  RunQueue();
+  CHECK(Nv.ReadCalibrationDoneFlag() == true);
+
+  MakeCalibration(min, max, 0.5);
+  CHECK(Nv.QueueCalibrationPosition(min, max) == true);
+  for (int sample = 0; sample < 100; sample++) {
+    Sample(PROCESSING_MICROS);
+  }
+  CHECK(Nv.QueueBusy() == true);
+  CHECK(Nv.QueuePercentWritten() > 0);
+  Nv.Setup(SLICE_MICROS, DEBUG_NONE);
+  CHECK(Nv.QueueBusy() == false);
+  CHECK(Nv.ReadCalibrationDoneFlag() == false);
+}
+
+// Only one kind of contents at a time, and canceling one kind does not
+// cancel the other.
+static void TestBusy() {
+  EEPROM.Reset();
+  Nv.Setup(SLICE_MICROS, DEBUG_NONE);
+  double min[NUM_NOTES], max[NUM_NOTES];
+  MakeCalibration(min, max, 0.0);
+  double settings[NONVOLATILE_MAX_SETTINGS];
+  for (int index = 0; index < NONVOLATILE_MAX_SETTINGS; index++) {
+    settings[index] = 0.25 * index;
+  }
+
+  CHECK(Nv.QueueCalibrationPosition(min, max) == true);
+  CHECK(Nv.QueueSettings(settings, NONVOLATILE_MAX_SETTINGS) == false);
+  Nv.CancelQueue(NONVOLATILE_QUEUE_SETTINGS);
+  CHECK(Nv.QueueBusy() == true);
+  Sample(PROCESSING_MICROS);
+  Nv.CancelQueue(NONVOLATILE_QUEUE_CALIBRATION);
+  CHECK(Nv.QueueBusy() == false);
+  CHECK(Nv.ReadCalibrationDoneFlag() == false);
+
+  CHECK(Nv.QueueSettings(settings, NONVOLATILE_MAX_SETTINGS) == true);
+  CHECK(Nv.ReadSettingsStoredFlag() == false);
+  RunQueue();
+  CHECK(Nv.ReadSettingsStoredFlag() == true);
+  for (int index = 0; index < NONVOLATILE_MAX_SETTINGS; index++) {
+    CHECK(Nv.ReadSetting(index) == settings[index]);
+  }
+}
+
+// No write starts without the margin before the deadline, and each
+// sample writes for about the slice.
+static void TestTiming() {
+  EEPROM.Reset();
+  Nv.Setup(SLICE_MICROS, DEBUG_NONE);
+  double min[NUM_NOTES], max[NUM_NOTES];
+  MakeCalibration(min, max, 0.0);
+  CHECK(Nv.QueueCalibrationPosition(min, max) == true);
+
+  unsigned long writes = EEPROM.writes_;
+  for (int sample = 0; sample < 100; sample++) {
+    CHECK(Sample(SAMPLE_MICROS - NONVOLATILE_QUEUE_MARGIN_MICROS) == false);
+  }
+  CHECK(EEPROM.writes_ == writes);
+  CHECK(Nv.QueuePercentWritten() == 0);
+
+  for (int sample = 0; sample < 100; sample++) {
+    unsigned long start = host_micros;
+    writes = EEPROM.writes_;
+    CHECK(Sample(0) == false);
+    CHECK(EEPROM.writes_ - writes <=
+    SLICE_MICROS / HOST_EEPROM_WRITE_MICROS + 1);
+    CHECK(EEPROM.writes_ > writes);
+    CHECK(host_micros - start == SAMPLE_MICROS);
+  }
+  CHECK(Nv.QueueLateFrames() == 0);
+}
+
+int main() {
+  TestCalibration();
+  TestQueueDoesNotWrite();
+  TestEraseLimit();
+  TestPowerLoss();
+  TestBusy();
+  TestTiming();
+  return HostTestResult("test_nonvolatile");
+}
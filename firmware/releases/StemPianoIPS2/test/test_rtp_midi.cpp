@@ -0,0 +1,489 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// test_rtp_midi.cpp
+//
+// Host test of RtpMidi against a stand-in for rtpmidid, the Linux
+// RTP-MIDI daemon. The stand-in is a session initiator on loopback
+// sockets. It invites the Teensy, runs a clock sync, and decodes each
+// MIDI packet and recovery journal from RFC 6295, written here from
+// the RFC and not from rtp_midi.cpp. When a packet is dropped, the
+// journal of the next packet must bring the stand-in's note and
+// controller state back to what the Teensy sent.
+
+#include "rtp_midi.h"
+#include "host_test.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define TEST_NETWORK_PORT 47410
+#define TEST_RTP_PORT 47420
+#define TEST_PEER_PORT 47430
+#define TEST_PEER_SSRC 0x12345678
+
+static Network Eth;
+static RtpMidi Rtp;
+
+static uint16_t Get16(const uint8_t *buffer) {
+  return (buffer[0] << 8) | buffer[1];
+}
+
+static uint32_t Get32(const uint8_t *buffer) {
+  return (static_cast<uint32_t>(Get16(buffer)) << 16) | Get16(buffer + 2);
+}
+
+static void Put32(uint8_t *buffer, uint32_t value) {
+  for (int k = 0; k < 4; k++) {
+    buffer[k] = (value >> (24 - 8*k)) & 0xFF;
+  }
+}
+
+// The computer. A control and a data socket, and the MIDI state the
+// received packets and journals describe.
+struct Peer {
+  int control;
+  int data;
+  uint32_t ssrc;
+  uint32_t teensy_ssrc;
+  bool have_sequence;
+  uint16_t sequence;
+  int note_velocity[128];  // 0 is off.
+  int control_value[128];  // -1 is never set.
+  int recoveries;
+  int journal_notes;
+  int journal_controls;
+  int bad_packets;
+};
+
+static int OpenSocket(int port) {
+  int s = socket(AF_INET, SOCK_DGRAM, 0);
+  int on = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.2", &address.sin_addr);
+  CHECK(bind(s, reinterpret_cast<struct sockaddr *>(&address),
+  sizeof(address)) == 0);
+  return s;
+}
+
+static void OpenPeer(Peer *peer, uint32_t ssrc, int port) {
+  peer->control = OpenSocket(port);
+  peer->data = OpenSocket(port + 1);
+  peer->ssrc = ssrc;
+  peer->teensy_ssrc = 0;
+  peer->have_sequence = false;
+  for (int k = 0; k < 128; k++) {
+    peer->note_velocity[k] = 0;
+    peer->control_value[k] = -1;
+  }
+  peer->recoveries = 0;
+  peer->journal_notes = 0;
+  peer->journal_controls = 0;
+  peer->bad_packets = 0;
+}
+
+static void ClosePeer(Peer *peer) {
+  close(peer->control);
+  close(peer->data);
+}
+
+static void SendTo(int s, int port, const uint8_t *data, int length) {
+  struct sockaddr_in teensy = {};
+  teensy.sin_family = AF_INET;
+  teensy.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &teensy.sin_addr);
+  sendto(s, data, length, 0, reinterpret_cast<struct sockaddr *>(&teensy),
+  sizeof(teensy));
+}
+
+// Returns the length, or 0 if nothing arrives.
+static int Receive(int s, uint8_t *buffer, int max_length) {
+  struct pollfd wait = {s, POLLIN, 0};
+  if (poll(&wait, 1, 20) <= 0) {
+    return 0;
+  }
+  int length = recv(s, buffer, max_length, MSG_DONTWAIT);
+  return length > 0 ? length : 0;
+}
+
+// AppleMIDI session command: IN, OK, NO, or BY.
+static void SendSession(Peer *peer, bool data_port, const char *command,
+uint32_t token) {
+  uint8_t packet[32] = {0xFF, 0xFF};
+  packet[2] = command[0];
+  packet[3] = command[1];
+  Put32(packet + 4, 2);
+  Put32(packet + 8, token);
+  Put32(packet + 12, peer->ssrc);
+  strcpy(reinterpret_cast<char *>(packet + 16), "rtpmidid");
+  SendTo(data_port ? peer->data : peer->control,
+  data_port ? TEST_RTP_PORT + 1 : TEST_RTP_PORT, packet, 25);
+  Rtp.Update(true);
+}
+
+// Returns the two letter reply, checks the rest of it.
+static const char *SessionReply(Peer *peer, bool data_port, uint32_t token) {
+  static char command[3];
+  uint8_t reply[64];
+  int length = Receive(data_port ? peer->data : peer->control, reply,
+  sizeof(reply));
+  if (length < 16) {
+    return "";
+  }
+  CHECK(reply[0] == 0xFF && reply[1] == 0xFF);
+  CHECK(Get32(reply + 4) == 2);
+  CHECK(Get32(reply + 8) == token);
+  peer->teensy_ssrc = Get32(reply + 12);
+  command[0] = reply[2];
+  command[1] = reply[3];
+  command[2] = '\0';
+  if (reply[2] == 'O') {
+    CHECK(length == 16 + static_cast<int>(strlen("stem piano")) + 1);
+    CHECK(strcmp(reinterpret_cast<char *>(reply + 16), "stem piano") == 0);
+  }
+  return command;
+}
+
+static bool Invite(Peer *peer) {
+  SendSession(peer, false, "IN", 0xA0);
+  bool ok = strcmp(SessionReply(peer, false, 0xA0), "OK") == 0;
+  SendSession(peer, true, "IN", 0xA0);
+  return ok && strcmp(SessionReply(peer, true, 0xA0), "OK") == 0;
+}
+
+// RFC 6295 recovery journal, one channel journal per channel, chapters
+// C and N applied, others skipped by length.
+static void ApplyJournal(Peer *peer, const uint8_t *journal, int length) {
+  CHECK((journal[0] & 0x40) == 0);  // No system journal.
+  CHECK((journal[0] & 0x20) != 0);  // Channel journals.
+  int channels = (journal[0] & 0x0F) + 1;
+  int ptr = 3;
+  for (int channel = 0; channel < channels && ptr + 3 <= length; channel++) {
+    int end = ptr + (((journal[ptr] & 0x03) << 8) | journal[ptr + 1]);
+    CHECK(((journal[ptr] >> 3) & 0x0F) == 0);  // MIDI channel 1.
+    CHECK(end <= length);
+    uint8_t toc = journal[ptr + 2];
+    int p = ptr + 3;
+    CHECK((toc & 0x80) == 0);  // No chapter P.
+    if ((toc & 0x40) != 0) {
+      int count = (journal[p++] & 0x7F) + 1;
+      for (int k = 0; k < count; k++) {
+        peer->control_value[journal[p] & 0x7F] = journal[p + 1] & 0x7F;
+        peer->journal_controls++;
+        p += 2;
+      }
+    }
+    CHECK((toc & 0x30) == 0);  // No chapters M or W.
+    if ((toc & 0x08) != 0) {
+      int count = journal[p] & 0x7F;
+      int low = journal[p + 1] >> 4;
+      int high = journal[p + 1] & 0x0F;
+      p += 2;
+      for (int k = 0; k < count; k++) {
+        CHECK((journal[p + 1] & 0x7F) > 0);
+        peer->note_velocity[journal[p] & 0x7F] = journal[p + 1] & 0x7F;
+        peer->journal_notes++;
+        p += 2;
+      }
+      for (int octet = low; octet <= high; octet++) {
+        for (int bit = 0; bit < 8; bit++) {
+          if ((journal[p] & (0x80 >> bit)) != 0) {
+            peer->note_velocity[8*octet + bit] = 0;
+            peer->journal_notes++;
+          }
+        }
+        p++;
+      }
+    }
+    CHECK(p == end);
+    ptr = end;
+  }
+  CHECK(ptr == length);
+}
+
+// Read one RTP-MIDI packet. Returns the number of MIDI commands, or -1
+// if there was no packet. A dropped packet is read and thrown away.
+static int ReceiveMidi(Peer *peer, bool drop) {
+  uint8_t packet[RTP_MIDI_PACKET_SIZE];
+  int length = Receive(peer->data, packet, sizeof(packet));
+  if (length == 0) {
+    return -1;
+  }
+  if (length < 13 || packet[0] != 0x80 || (packet[1] & 0x7F) != 97 ||
+  Get32(packet + 8) != peer->teensy_ssrc) {
+    peer->bad_packets++;
+    return -1;
+  }
+  if (drop == true) {
+    return 0;
+  }
+  uint16_t sequence = Get16(packet + 2);
+  bool lost = peer->have_sequence == true &&
+  sequence != static_cast<uint16_t>(peer->sequence + 1);
+  peer->have_sequence = true;
+  peer->sequence = sequence;
+
+  // MIDI command section header.
+  int ptr = 12;
+  bool journal = (packet[ptr] & 0x40) != 0;
+  bool z = (packet[ptr] & 0x20) != 0;
+  int list_length = packet[ptr] & 0x0F;
+  if ((packet[ptr] & 0x80) != 0) {
+    list_length = (list_length << 8) | packet[ptr + 1];
+    ptr++;
+  }
+  ptr++;
+  int list_end = ptr + list_length;
+
+  // Journal first, the commands in this packet are newer.
+  if (lost == true) {
+    CHECK(journal == true);
+    if (journal == true) {
+      ApplyJournal(peer, packet + list_end, length - list_end);
+      peer->recoveries++;
+    }
+  }
+  else if (journal == false) {
+    CHECK(list_end == length);
+  }
+
+  int commands = 0;
+  uint8_t running_status = 0;
+  bool first = true;
+  while (ptr < list_end) {
+    if (first == false || z == true) {
+      while ((packet[ptr++] & 0x80) != 0) {}  // Delta time.
+    }
+    first = false;
+    if ((packet[ptr] & 0x80) != 0) {
+      running_status = packet[ptr++];
+    }
+    uint8_t data1 = packet[ptr++];
+    uint8_t data2 = packet[ptr++];
+    switch (running_status & 0xF0) {
+      case 0x90:
+        peer->note_velocity[data1] = data2;
+        break;
+      case 0x80:
+        peer->note_velocity[data1] = 0;
+        break;
+      case 0xB0:
+        peer->control_value[data1] = data2;
+        break;
+    }
+    CHECK((running_status & 0x0F) == 0);
+    commands++;
+  }
+  CHECK(ptr == list_end);
+  return commands;
+}
+
+static void StartTeensy() {
+  Eth.Setup(false, "127.0.0.2", "127.0.0.1", TEST_NETWORK_PORT, true,
+  DEBUG_NONE);
+  Rtp.Setup(true, TEST_RTP_PORT, "stem piano", 1, &Eth, DEBUG_NONE);
+  Rtp.Update(true);
+}
+
+// Invitation on the control port, then the data port. A second
+// computer is turned away while the session is up, and BY ends it.
+static void TestSession() {
+  Peer peer, other;
+  OpenPeer(&peer, TEST_PEER_SSRC, TEST_PEER_PORT);
+  OpenPeer(&other, 0x0BADCAFE, TEST_PEER_PORT + 2);
+  StartTeensy();
+  CHECK(Rtp.Connected() == false);
+
+  SendSession(&peer, false, "IN", 0x1111);
+  CHECK(strcmp(SessionReply(&peer, false, 0x1111), "OK") == 0);
+  CHECK(Rtp.Connected() == false);
+  SendSession(&peer, true, "IN", 0x1111);
+  CHECK(strcmp(SessionReply(&peer, true, 0x1111), "OK") == 0);
+  CHECK(Rtp.Connected() == true);
+
+  SendSession(&other, false, "IN", 0x2222);
+  CHECK(strcmp(SessionReply(&other, false, 0x2222), "NO") == 0);
+  CHECK(Rtp.Connected() == true);
+
+  // BY from someone else does not end the session.
+  SendSession(&other, false, "BY", 0x2222);
+  CHECK(Rtp.Connected() == true);
+  SendSession(&peer, false, "BY", 0x1111);
+  CHECK(Rtp.Connected() == false);
+
+  // Nothing is sent without a session.
+  Rtp.NoteOn(60, 100);
+  Rtp.SendFrame();
+  CHECK(ReceiveMidi(&peer, false) == -1);
+
+  CHECK(Invite(&other) == true);
+  CHECK(Rtp.Connected() == true);
+  ClosePeer(&peer);
+  ClosePeer(&other);
+}
+
+// CK0 from the computer gets CK1 with the Teensy time in 100 us.
+static void TestClockSync() {
+  Peer peer;
+  OpenPeer(&peer, TEST_PEER_SSRC, TEST_PEER_PORT);
+  host_micros = 5000000;
+  StartTeensy();
+  CHECK(Invite(&peer) == true);
+
+  uint8_t sync[36] = {0xFF, 0xFF, 'C', 'K'};
+  Put32(sync + 4, peer.ssrc);
+  sync[8] = 0;
+  Put32(sync + 16, 123456);
+  host_micros = 7000000;
+  SendTo(peer.data, TEST_RTP_PORT + 1, sync, sizeof(sync));
+  Rtp.Update(true);
+
+  uint8_t reply[64];
+  CHECK(Receive(peer.data, reply, sizeof(reply)) == 36);
+  CHECK(memcmp(reply, "\xFF\xFF" "CK", 4) == 0);
+  CHECK(Get32(reply + 4) == peer.teensy_ssrc);
+  CHECK(reply[8] == 1);
+  CHECK(Get32(reply + 12) == 0 && Get32(reply + 16) == 123456);
+  CHECK(Get32(reply + 20) == 0 && Get32(reply + 24) == 70000);
+  ClosePeer(&peer);
+}
+
+// Chords go in one packet, with a delta time of 0 between commands,
+// and the stand-in ends with the same state the Teensy sent.
+static void TestCommands() {
+  Peer peer;
+  OpenPeer(&peer, TEST_PEER_SSRC, TEST_PEER_PORT);
+  StartTeensy();
+  CHECK(Invite(&peer) == true);
+
+  for (int note = 40; note < 50; note++) {
+    Rtp.NoteOn(note, note + 20);
+  }
+  Rtp.ControlChange(64, 127);
+  Rtp.PolyPressure(41, 33);
+  Rtp.SendFrame();
+  CHECK(ReceiveMidi(&peer, false) == 12);
+  for (int note = 40; note < 50; note++) {
+    CHECK(peer.note_velocity[note] == note + 20);
+  }
+  CHECK(peer.control_value[64] == 127);
+
+  Rtp.NoteOff(45, 0);
+  Rtp.SendFrame();
+  CHECK(ReceiveMidi(&peer, false) == 1);
+  CHECK(peer.note_velocity[45] == 0);
+  CHECK(peer.recoveries == 0);
+  CHECK(peer.bad_packets == 0);
+
+  // More than 15 bytes of commands use the long header. 150 note ons
+  // are more than the command buffer holds, the rest are dropped.
+  for (int k = 0; k < 150; k++) {
+    Rtp.NoteOn(k % 100, 1);
+  }
+  Rtp.SendFrame();
+  CHECK(ReceiveMidi(&peer, false) == RTP_MIDI_COMMAND_SIZE / 3);
+  ClosePeer(&peer);
+}
+
+// Drop packets. The journal of the next packet recovers the notes
+// and pedal that were in them, including note offs.
+static void TestJournal() {
+  Peer peer;
+  OpenPeer(&peer, TEST_PEER_SSRC, TEST_PEER_PORT);
+  host_micros = 1000000;
+  StartTeensy();
+  CHECK(Invite(&peer) == true);
+
+  Rtp.NoteOn(60, 100);
+  Rtp.NoteOn(64, 90);
+  Rtp.SendFrame();
+  CHECK(ReceiveMidi(&peer, false) == 2);
+
+  // Lost: note 60 off, pedal down, note 67 on.
+  Rtp.NoteOff(60, 64);
+  Rtp.ControlChange(64, 127);
+  Rtp.NoteOn(67, 80);
+  Rtp.SendFrame();
+  CHECK(ReceiveMidi(&peer, true) == 0);
+  CHECK(peer.note_velocity[60] == 100);
+
+  Rtp.NoteOn(72, 70);
+  Rtp.SendFrame();
+  CHECK(ReceiveMidi(&peer, false) == 1);
+  CHECK(peer.recoveries == 1);
+  CHECK(peer.note_velocity[60] == 0);
+  CHECK(peer.note_velocity[64] == 90);
+  CHECK(peer.note_velocity[67] == 80);
+  CHECK(peer.note_velocity[72] == 70);
+  CHECK(peer.control_value[64] == 127);
+
+  // RS feedback for everything so far empties the journal. A lost
+  // packet after that is recovered from a journal with only its notes.
+  uint8_t feedback[12] = {0xFF, 0xFF, 'R', 'S'};
+  Put32(feedback + 4, peer.ssrc);
+  feedback[8] = peer.sequence >> 8;
+  feedback[9] = peer.sequence & 0xFF;
+  SendTo(peer.data, TEST_RTP_PORT + 1, feedback, sizeof(feedback));
+  Rtp.Update(true);
+
+  Rtp.NoteOff(64, 0);
+  Rtp.ControlChange(64, 0);
+  Rtp.SendFrame();
+  CHECK(ReceiveMidi(&peer, true) == 0);
+
+  // The last packet before silence is lost. A guard packet, with only
+  // the journal, recovers it.
+  peer.journal_notes = 0;
+  peer.journal_controls = 0;
+  host_micros += 300000;
+  Rtp.SendFrame();
+  CHECK(ReceiveMidi(&peer, false) == 0);
+  CHECK(peer.recoveries == 2);
+  CHECK(peer.journal_notes == 1);
+  CHECK(peer.journal_controls == 1);
+  CHECK(peer.note_velocity[64] == 0);
+  CHECK(peer.control_value[64] == 0);
+
+  // At most four guard packets, then quiet.
+  int guards = 1;
+  for (int k = 0; k < 10; k++) {
+    host_micros += 300000;
+    Rtp.SendFrame();
+    if (ReceiveMidi(&peer, false) == 0) {
+      guards++;
+    }
+  }
+  CHECK(guards == 4);
+  CHECK(peer.bad_packets == 0);
+  ClosePeer(&peer);
+}
+
+int main() {
+  TestSession();
+  TestClockSync();
+  TestCommands();
+  TestJournal();
+  return HostTestResult("test_rtp_midi");
+}
@@ -0,0 +1,217 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// test_scheduler.cpp
+//
+// Host test of Scheduler. Runs the task tables sample by sample and
+// compares against (sample + phase) % period == 0 worked out here.
+
+#include "scheduler.h"
+#include "host_test.h"
+
+static Scheduler Sch;
+
+// Run frames of samples each. Count the runs of each task, and the
+// frames where more than one task ran.
+static int RunFrames(int num_tasks, int frames, int samples, int *runs) {
+  int shared = 0;
+  for (int task = 0; task < num_tasks; task++) {
+    runs[task] = 0;
+  }
+  for (int frame = 0; frame < frames; frame++) {
+    Sch.FrameStart(samples);
+    int ran = 0;
+    for (int task = 0; task < num_tasks; task++) {
+      if (Sch.Begin(task) == true) {
+        Sch.End(task);
+        runs[task]++;
+        ran++;
+      }
+    }
+    if (ran > 1) {
+      shared++;
+    }
+  }
+  return shared;
+}
+
+// One sample per frame. A task runs exactly in its samples.
+static void TestPeriodPhase() {
+  const SchedulerTask tasks[4] = {
+    {"every",  1, 0, 100},
+    {"four",   4, 1, 100},
+    {"ten",   10, 3, 100},
+    {"off",    0, 0, 100}
+  };
+  Sch.Setup(tasks, 4, DEBUG_NONE);
+  for (unsigned long sample = 1; sample <= 1000; sample++) {
+    Sch.FrameStart(1);
+    for (int task = 0; task < 3; task++) {
+      bool due = (sample + tasks[task].phase) % tasks[task].period == 0;
+      bool begin = Sch.Begin(task);
+      CHECK(begin == due);
+      if (begin == true) {
+        Sch.End(task);
+      }
+    }
+    CHECK(Sch.Begin(3) == false);
+    CHECK(Sch.Begin(4) == false);
+    CHECK(Sch.Begin(-1) == false);
+  }
+  CHECK(Sch.Runs(0) == 1000);
+  CHECK(Sch.Runs(1) == 250);
+  CHECK(Sch.Runs(2) == 100);
+  CHECK(Sch.Runs(3) == 0);
+}
+
+// While the TFT slows the sampling, a frame stands for several
+// samples. Tasks keep their rate in samples, and a task runs at most
+// once in a frame.
+static void TestSlowedFrames() {
+  const SchedulerTask tasks[3] = {
+    {"four",   4, 1, 100},
+    {"forty", 40, 10, 100},
+    {"slow", 12000, 4, 100}
+  };
+  int runs[3];
+  Sch.Setup(tasks, 3, DEBUG_NONE);
+  RunFrames(3, 3000, 8, runs);
+  CHECK(runs[0] == 3000);
+  CHECK(runs[1] == 600);
+  CHECK(runs[2] == 2);
+
+  // Back at the full rate, the tasks are in their own samples again.
+  Sch.Setup(tasks, 3, DEBUG_NONE);
+  RunFrames(3, 5, 8, runs);
+  for (unsigned long sample = 41; sample <= 200; sample++) {
+    Sch.FrameStart(1);
+    CHECK(Sch.Begin(1) == ((sample + 10) % 40 == 0));
+  }
+}
+
+// A run longer than the budget is an overrun. PrintStatistics() starts
+// the counts again.
+static void TestOverruns() {
+  const SchedulerTask tasks[2] = {
+    {"a", 2, 0, 20},
+    {"b", 2, 1, 50}
+  };
+  Sch.Setup(tasks, 2, DEBUG_NONE);
+  host_micros = 1000;
+  const unsigned long run_micros[6] = {10, 20, 21, 50, 51, 1000};
+  for (int run = 0; run < 6; run++) {
+    for (int task = 0; task < 2; task++) {
+      Sch.FrameStart(1);
+      if (Sch.Begin(task) == false) {
+        Sch.FrameStart(1);
+        CHECK(Sch.Begin(task) == true);
+      }
+      host_micros += run_micros[run];
+      Sch.End(task);
+      host_micros += 7;
+    }
+  }
+  CHECK(Sch.Runs(0) == 6);
+  CHECK(Sch.Overruns(0) == 4);
+  CHECK(Sch.Runs(1) == 6);
+  CHECK(Sch.Overruns(1) == 2);
+
+  Sch.PrintStatistics();
+  CHECK(Sch.Runs(0) == 0);
+  CHECK(Sch.Overruns(0) == 0);
+  CHECK(Sch.Runs(1) == 0);
+  CHECK(Sch.Overruns(1) == 0);
+}
+
+// Pairs of tasks, other than every sample tasks, that run in the same
+// sample somewhere in the first samples.
+static int MeetingPairs(const SchedulerTask *tasks, int num_tasks,
+unsigned long samples) {
+  int pairs = 0;
+  for (int a = 0; a < num_tasks; a++) {
+    for (int b = a + 1; b < num_tasks; b++) {
+      if (tasks[a].period <= 1 || tasks[b].period <= 1) {
+        continue;
+      }
+      for (unsigned long sample = 1; sample <= samples; sample++) {
+        if ((sample + tasks[a].phase) % tasks[a].period == 0 &&
+        (sample + tasks[b].phase) % tasks[b].period == 0) {
+          pairs++;
+          break;
+        }
+      }
+    }
+  }
+  return pairs;
+}
+
+// Setup() counts a pair if the two tasks meet in some sample, which
+// running the table for the lcm of the periods shows.
+static void TestCollisions() {
+  const SchedulerTask clash[5] = {
+    {"six",    6, 1, 100},
+    {"four",   4, 3, 100},  // Meets "six" in sample 5.
+    {"twenty", 20, 7, 100}, // Meets "four" in 13, "six" in 53.
+    {"ten",   10, 2, 100},  // Even samples, the others odd.
+    {"every",  1, 0, 100}   // Not checked.
+  };
+  int runs[7];
+  Sch.Setup(clash, 5, DEBUG_NONE);
+  CHECK(Sch.Collisions() == 3);
+  CHECK(MeetingPairs(clash, 5, 60) == 3);
+  CHECK(RunFrames(3, 60, 1, runs) > 0);
+
+  // The same layout as the hammer board table.
+  const SchedulerTask hammer[7] = {
+    {"lower_r_led",       40,    10,        20},
+    {"sca_led",           40,    22,        20},
+    {"ethernet_led",      40,    34,        20},
+    {"rtp_midi",           4,     1,        50},
+    {"pedals",             4,     3,        30},
+    {"cal_eeprom",     12000,     4,       100},
+    {"statistics",     40000,     8,      1000}
+  };
+  Sch.Setup(hammer, 7, DEBUG_NONE);
+  CHECK(Sch.Collisions() == 0);
+  CHECK(MeetingPairs(hammer, 7, 120000) == 0);
+  CHECK(RunFrames(7, 120000, 1, runs) == 0);
+  CHECK(runs[0] == 3000);
+  CHECK(runs[3] == 30000);
+  CHECK(runs[4] == 30000);
+  CHECK(runs[5] == 10);
+  CHECK(runs[6] == 3);
+
+  // Same periods, phase of pedals moved onto rtp_midi.
+  SchedulerTask moved[7];
+  for (int task = 0; task < 7; task++) {
+    moved[task] = hammer[task];
+  }
+  moved[4].phase = 1;
+  Sch.Setup(moved, 7, DEBUG_NONE);
+  CHECK(Sch.Collisions() == 1);
+  CHECK(RunFrames(7, 120000, 1, runs) == 30000);
+}
+
+int main() {
+  TestPeriodPhase();
+  TestSlowedFrames();
+  TestOverruns();
+  TestCollisions();
+  return HostTestResult("test_scheduler");
+}
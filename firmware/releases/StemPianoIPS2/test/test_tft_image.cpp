@@ -0,0 +1,212 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// test_tft_image.cpp
+//
+// Host test of TftImage, with the SD card latency model in
+// host/SdFat.h. Each sample, Draw() gets the budget TftDisplay gives
+// it, and must return before the next sample starts.
+
+#include "tft_image.h"
+#include "host_test.h"
+
+// Defaults in hammer_settings.cpp.
+#define SAMPLE_MICROS 250
+#define SLICE_MICROS 40
+#define SAMPLE_MICROS_DURING_TFT 100000
+#define SD_CLOCK_MHZ 10
+
+#define RAW_WIDTH 320
+#define RAW_HEIGHT 240
+#define BMP_WIDTH 7
+#define BMP_HEIGHT 5
+
+static Adafruit_ILI9341 Tft;
+static TftImage Image;
+
+static uint8_t raw_file[TFT_IMAGE_RAW_HEADER_BYTES + 2*RAW_WIDTH*RAW_HEIGHT];
+static uint8_t bmp_file[TFT_IMAGE_BMP_HEADER_BYTES + BMP_HEIGHT*(3*BMP_WIDTH + 3)];
+
+static uint16_t RawPixel(int x, int y) {
+  return static_cast<uint16_t>(x * 131 + y * 517);
+}
+
+// A .565 file, top row first.
+static void MakeRaw() {
+  raw_file[0] = RAW_WIDTH & 255;
+  raw_file[1] = RAW_WIDTH >> 8;
+  raw_file[2] = RAW_HEIGHT & 255;
+  raw_file[3] = RAW_HEIGHT >> 8;
+  uint8_t *p = &raw_file[TFT_IMAGE_RAW_HEADER_BYTES];
+  for (int y = 0; y < RAW_HEIGHT; y++) {
+    for (int x = 0; x < RAW_WIDTH; x++) {
+      *p++ = RawPixel(x, y) & 255;
+      *p++ = RawPixel(x, y) >> 8;
+    }
+  }
+  host_sd_add("/picture.565", raw_file, sizeof(raw_file));
+}
+
+static void Write32(uint8_t *b, long value) {
+  for (int shift = 0; shift < 4; shift++) {
+    b[shift] = (value >> (8*shift)) & 255;
+  }
+}
+
+// A 24-bit BMP, bottom row first, each row padded to 4 bytes.
+static void MakeBmp() {
+  memset(bmp_file, 0, sizeof(bmp_file));
+  bmp_file[0] = 'B';
+  bmp_file[1] = 'M';
+  Write32(&bmp_file[10], TFT_IMAGE_BMP_HEADER_BYTES);
+  Write32(&bmp_file[18], BMP_WIDTH);
+  Write32(&bmp_file[22], BMP_HEIGHT);
+  bmp_file[26] = 1;
+  bmp_file[28] = 24;
+  uint8_t *p = &bmp_file[TFT_IMAGE_BMP_HEADER_BYTES];
+  for (int row = 0; row < BMP_HEIGHT; row++) {
+    int y = BMP_HEIGHT - 1 - row;
+    for (int x = 0; x < BMP_WIDTH; x++) {
+      *p++ = 8 * x;        // Blue.
+      *p++ = 4 * y;        // Green.
+      *p++ = 8 * (x + y);  // Red.
+    }
+    p += 3;
+  }
+  host_sd_add("/picture.bmp", bmp_file, sizeof(bmp_file));
+}
+
+// One sample of sample_micros. The budget is the same as in
+// TftDisplay::DisplayPicture(). Returns true if Draw() returned
+// after the next sample started.
+static bool Sample(unsigned long sample_micros) {
+  unsigned long start = host_micros;
+  unsigned long deadline = start + sample_micros;
+  unsigned long budget = max(static_cast<unsigned long>(SLICE_MICROS),
+  sample_micros / 2);
+  Image.Draw(start, budget, deadline);
+  bool late = static_cast<long>(host_micros - deadline) > 0;
+  if (late == false) {
+    host_micros = deadline;
+  }
+  return late;
+}
+
+// Run samples until the picture is drawn or given up. Returns the
+// number of samples, and the late samples in *late.
+static int Run(unsigned long sample_micros, int *late) {
+  int samples = 0;
+  *late = 0;
+  while (Image.Active() == true && samples < 100000) {
+    *late += Sample(sample_micros);
+    samples++;
+  }
+  return samples;
+}
+
+// With the default settings, pictures draw in slow samples, as
+// TftDisplay::PictureDrawing() asks for. Every block read fits, no
+// sample is late, and the picture takes well under a second.
+static void TestSlowSamples() {
+  Image.Setup(&Tft, RAW_WIDTH, RAW_HEIGHT, SD_CLOCK_MHZ, DEBUG_NONE);
+  memset(Tft.pixels_, 0, sizeof(Tft.pixels_));
+  CHECK(Image.Open("/picture.565", 0, 0) == true);
+  int late;
+  int samples = Run(SAMPLE_MICROS_DURING_TFT, &late);
+  CHECK(Image.Active() == false);
+  CHECK(late == 0);
+  CHECK(samples * SAMPLE_MICROS_DURING_TFT <= 500000);
+  bool match = true;
+  for (int y = 0; y < RAW_HEIGHT; y++) {
+    for (int x = 0; x < RAW_WIDTH; x++) {
+      match = match && Tft.pixels_[y][x] == RawPixel(x, y);
+    }
+  }
+  CHECK(match == true);
+  printf("Picture drawn in %d samples of %d us.\n", samples,
+  SAMPLE_MICROS_DURING_TFT);
+}
+
+// At the full sample rate a block read never fits before the next
+// sample, so no sample is late, and the picture gives up instead.
+// This is why TftDisplay asks for slow samples.
+static void TestFullRate() {
+  Image.Setup(&Tft, RAW_WIDTH, RAW_HEIGHT, SD_CLOCK_MHZ, DEBUG_NONE);
+  CHECK(Image.Open("/picture.565", 0, 0) == true);
+  int late;
+  int samples = Run(SAMPLE_MICROS, &late);
+  CHECK(Image.Active() == false);
+  CHECK(late == 0);
+  CHECK(samples * SAMPLE_MICROS > TFT_IMAGE_GIVE_UP_MICROS);
+}
+
+// A slow sample right after the full rate ones, so the budget is
+// large but the picture still must not run past the deadline.
+static void TestDeadline() {
+  Image.Setup(&Tft, RAW_WIDTH, RAW_HEIGHT, SD_CLOCK_MHZ, DEBUG_NONE);
+  CHECK(Image.Open("/picture.565", 0, 0) == true);
+  int late = 0;
+  for (int sample = 0; sample < 1000; sample++) {
+    unsigned long start = host_micros;
+    unsigned long deadline = start + SAMPLE_MICROS;
+    Image.Draw(start, SAMPLE_MICROS_DURING_TFT / 2, deadline);
+    late += static_cast<long>(host_micros - deadline) > 0;
+    host_micros = max(host_micros, deadline);
+  }
+  CHECK(late == 0);
+  Image.Close();
+}
+
+// BMP rows are bottom up and padded, and pixels are converted to RGB565.
+static void TestBmp() {
+  Image.Setup(&Tft, RAW_WIDTH, RAW_HEIGHT, SD_CLOCK_MHZ, DEBUG_NONE);
+  memset(Tft.pixels_, 0, sizeof(Tft.pixels_));
+  CHECK(Image.Open("/picture.bmp", 10, 20) == true);
+  int late;
+  Run(SAMPLE_MICROS_DURING_TFT, &late);
+  CHECK(Image.Active() == false);
+  CHECK(late == 0);
+  for (int y = 0; y < BMP_HEIGHT; y++) {
+    for (int x = 0; x < BMP_WIDTH; x++) {
+      int red = 8 * (x + y), green = 4 * y, blue = 8 * x;
+      uint16_t pixel = ((red & 0xF8) << 8) | ((green & 0xFC) << 3) |
+      (blue >> 3);
+      CHECK(Tft.pixels_[20 + y][10 + x] == pixel);
+    }
+  }
+}
+
+// Too large, or not on the card.
+static void TestOpen() {
+  Image.Setup(&Tft, RAW_WIDTH, RAW_HEIGHT, SD_CLOCK_MHZ, DEBUG_NONE);
+  CHECK(Image.Open("/picture.565", 1, 0) == false);
+  CHECK(Image.Open("/missing.565", 0, 0) == false);
+  CHECK(Image.Active() == false);
+}
+
+int main() {
+  MakeRaw();
+  MakeBmp();
+  TestSlowSamples();
+  TestFullRate();
+  TestDeadline();
+  TestBmp();
+  TestOpen();
+  return HostTestResult("test_tft_image");
+}
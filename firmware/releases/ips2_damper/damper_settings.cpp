@@ -62,6 +62,19 @@ void DamperSettings::SetAllSettingValues() {
   // Because all functions are disabled, it is possible to set the sample
   // rate approximately 10x faster than during normal operation.
   test_index = -1;
+
+  // Raw ADC count streaming mode.
+  // If true, Ethernet sends the raw ADC counts (3 bytes per channel, full
+  // 18-bit resolution) for each raw_stream_channel set to true, instead of
+  // the normal calibrated positions. Piano functions keep running.
+  // Send one packet every raw_stream_decimation samples.
+  // Use for sensor characterization.
+  raw_stream_enable = false;
+  raw_stream_decimation = 1;
+  for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+    raw_stream_channel[channel] = false;
+  }
+  raw_stream_channel[0] = true;
   
   // Must be longer than the time to sample and collect all NUM_CHANNELS
   // data from the ADC plus the time for processing all of the data.
@@ -75,15 +88,36 @@ void DamperSettings::SetAllSettingValues() {
     Serial.println("The sample period value must match on hammer and damper boards.");
   }
 
+  // Start each sample period from a hardware timer, at exact deadlines.
+  // Otherwise the start of each period is polled, and the sample rate is
+  // a little slower than 1 / adc_sample_period_microseconds, which makes
+  // velocities a little high.
+  hardware_frame_clock = true;
+
   // When the TFT is running, slow everything down because the TFT
   // processing takes a long time.
   adc_sample_period_microseconds_during_tft = 100000;
 
+  // Keep sampling, DSP, and MIDI running normally while the TFT is on.
+  // The TFT draws a little each sample instead. When false, use
+  // adc_sample_period_microseconds_during_tft and turn off the DSP.
+  // The same happens while a TFT picture is read from the SD card.
+  tft_at_sample_rate = true;
+
+  // Time the TFT can draw each sample when tft_at_sample_rate is true.
+  tft_slice_microseconds = 40;
+
+  // SPI clock for the SD card on the TFT. Lower it if the card
+  // does not start.
+  tft_sd_clock_mhz = 10;
+
   // The analog circuitry in front of ADC is not differential.
   // Therefore, if using a differential ADC, lose a bit.
   adc_is_differential = true;
 
   // Presently support a 16-bit or 18-bit ADC.
+  // An 18-bit ADC clocks out 24 bits per channel instead of 16,
+  // which adds time to every sample period.
   using18bitadc = false;
 
   // Historically, ADC changes during development resulted in
@@ -120,6 +154,10 @@ void DamperSettings::SetAllSettingValues() {
   // Calibration Settings.
   calibration_threshold = 0.4;
 
+  // Time each sample can spend writing calibration values to EEPROM.
+  // The values are written a few bytes per sample. See nonvolatile.cpp.
+  eeprom_slice_microseconds = 20;
+
   
   ////////
   // Ethernet data.
@@ -130,6 +168,16 @@ void DamperSettings::SetAllSettingValues() {
   snprintf(computer_ip,16, "X.X.X.X");  // Get from ipconfig command on local computer
   // Recommend different UDP port for hammer and damper boards.
   network_port = X;  // Must match UDP port in receiver code
+  // UDP only. Optional. Send the data stream to a multicast group so
+  // several programs can receive it, for example "239.1.2.3".
+  // Use "" for no multicast.
+  multicast_ip[0] = '\0';
+  // UDP only. Optional. Also send the data stream to these computers.
+  // Comma separated, up to 4, for example "192.168.1.20,192.168.1.21".
+  // Use "" for none. Each adds one packet per sample.
+  // The data stream still goes to computer_ip, unless multicast_ip is
+  // set. Then computer_ip must join the group to receive it.
+  extra_computer_ips[0] = '\0';
   //
   ////////
 
@@ -140,6 +188,33 @@ void DamperSettings::SetAllSettingValues() {
   // damper position.
   canbus_enable = true;
 
+  // Board to board frame format (see board2board.cpp).
+  // B2B_FRAME_POSITION has a sequence number, timestamp, and CRC.
+  // B2B_FRAME_EVENTS sends damper events computed on this board
+  // instead, and needs a hammer board with the same firmware.
+  // B2B_FRAME_ADAPTIVE sends only the keys that moved, at up to 10 bits,
+  // for all NUM_CHANNELS inputs. Also needs the same firmware.
+  // B2B_FRAME_LEGACY is the original format, for a hammer board
+  // with older firmware.
+  canbus_frame_format = B2B_FRAME_POSITION;
+
+  // Line up the samples with the sample clock sent by the hammer board.
+  // Needs canbus_sync_interval > 0 on the hammer board.
+  canbus_sync_enable = true;
+
+  // Shortest time from the hammer board sending the sample clock to
+  // this board receiving it, for an 8 byte frame at the CAN Bus rates
+  // in board2board.cpp. An error here only shifts all samples.
+  canbus_sync_latency_micros = 80;
+
+  // Only used with B2B_FRAME_EVENTS. Same as on the hammer board.
+  // When the damper position crosses this percentage of max-min
+  // damper position, declare a damper event.
+  damper_threshold = 0.5;
+
+  // Magic value to get velocity in range [-1,0].
+  damper_velocity_scaling = 0.025;
+
   ////////
   // TFT display.
   using_display = true;
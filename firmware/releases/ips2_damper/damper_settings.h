@@ -28,6 +28,7 @@
 #define DAMPER_SETTINGS_H_
 
 #include "stem_piano_ips2.h"
+#include "board2board.h"
 
 #define IP_STRING_LENGTH 128
 
@@ -42,8 +43,15 @@ class DamperSettings
     int startup_counter_value;
     int adc_spi_clock_frequency;
     int test_index;
+    bool raw_stream_enable;
+    int raw_stream_decimation;
+    bool raw_stream_channel[NUM_CHANNELS];
     int adc_sample_period_microseconds;
+    bool hardware_frame_clock;
     int adc_sample_period_microseconds_during_tft;
+    bool tft_at_sample_rate;
+    int tft_slice_microseconds;
+    int tft_sd_clock_mhz;
     bool adc_is_differential;
     bool using18bitadc;
     float sensor_v_max;
@@ -59,11 +67,19 @@ class DamperSettings
     int switch21_sca_pin;
     int switch22_sca_pin;
     float calibration_threshold;
+    int eeprom_slice_microseconds;
     bool true_for_tcp_else_udp;
     char teensy_ip[IP_STRING_LENGTH];
     char computer_ip[IP_STRING_LENGTH];
+    char multicast_ip[IP_STRING_LENGTH];
+    char extra_computer_ips[IP_STRING_LENGTH];
     int network_port;
     bool canbus_enable;
+    int canbus_frame_format;
+    bool canbus_sync_enable;
+    int canbus_sync_latency_micros;
+    float damper_threshold;
+    float damper_velocity_scaling;
     bool using_display;
     bool connected_channel[NUM_CHANNELS];
     int reorder_list[NUM_CHANNELS];
@@ -109,10 +109,16 @@ float damper_threshold_high, int test_index) {
 
 // Flash lower right LED (under TFT) based on calibration status.
 // Also indicate if nonvolatile was written.
+// While queued nonvolatile writes are in progress, the LED is on
+// for the percent written of each second.
 void DamperStatus::LowerRightLed(bool all_notes_using_cal, 
-bool nonvolatile_was_written) {
+bool nonvolatile_was_written, int nonvolatile_percent_written) {
+  if (nonvolatile_percent_written < 100) {
+    testp_->SetLowerRightLED((int) (millis() % 1000) / 10 <
+    nonvolatile_percent_written);
+  }
   // If Nonvolatile memory was written, turn on LED for a long duration.
-  if (nonvolatile_was_written == true) {
+  else if (nonvolatile_was_written == true) {
     lower_r_led_in_nonvol_mode_ = true;
     lower_r_led_last_change_ = millis();
     testp_->SetLowerRightLED(true);
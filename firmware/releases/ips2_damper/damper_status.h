@@ -37,7 +37,7 @@ class DamperStatus
     DamperStatus();
     void Setup(TestpointLed *, int);
     void FrontLed(const float *, float, float, float, int);
-    void LowerRightLed(bool, bool);
+    void LowerRightLed(bool, bool, int);
     void SCALed();
     void EthernetLed();
     void SerialMonitor(const int *, const float *,
@@ -34,8 +34,10 @@
 #include "board2board.h"
 #include "calibration_position.h"
 #include "damper_status.h"
+#include "dsp_damper.h"
 #include "network.h"
 #include "nonvolatile.h"
+#include "scheduler.h"
 #include "switches.h"
 #include "testpoint_led.h"
 #include "timing.h"
@@ -46,8 +48,10 @@ SixChannelAnalog00 Adc;
 Board2Board B2B;
 CalibrationPosition CalP;
 DamperStatus DStat;
+DspDamper DspD;
 Network Eth;
 Nonvolatile Nonv;
+Scheduler Sch;
 Switches SwIPS1;
 Switches SwIPS2;
 Switches SwSCA1;
@@ -56,6 +60,26 @@ TestpointLed Tpl;
 Timing Tmg;
 TftDisplay Tft;
 
+// Work that does not need to run every sample. See scheduler.cpp.
+// Period and phase are in samples of adc_sample_period_microseconds,
+// 40 samples is 10 ms at 250 us. The same phases as the hammer board.
+// cal_eeprom checks the switches for a calibration write every 3 s,
+// which also limits EEPROM wear if a switch is noisy.
+#define TASK_LOWER_RIGHT_LED    0
+#define TASK_SCA_LED            1
+#define TASK_ETHERNET_LED       2
+#define TASK_CALIBRATION_EEPROM 3
+#define TASK_STATISTICS         4
+#define NUM_TASKS               5
+const SchedulerTask task_table[NUM_TASKS] = {
+  // name,          period, phase, budget us
+  {"lower_r_led",       40,    10,        20},
+  {"sca_led",           40,    22,        20},
+  {"ethernet_led",      40,    34,        20},
+  {"cal_eeprom",     12000,     4,       100},
+  {"statistics",     40000,     8,      1000}
+};
+
 void setup(void) {
 
   // Serial port setup.
@@ -85,12 +109,13 @@ void setup(void) {
   if (Set.debug_level >= DEBUG_INFO) {
     Serial.println("Beginning damper board initialization.");
   }
-  Tft.Setup(Set.using_display, Set.debug_level);
+  Tft.Setup(Set.using_display, Set.tft_slice_microseconds,
+  Set.tft_sd_clock_mhz, Set.debug_level);
   Tft.HelloWorld();
 
   // Initialize the nonvolatile memory.
   // Initialize early in case any setup() uses storage.
-  Nonv.Setup(Set.debug_level);
+  Nonv.Setup(Set.eeprom_slice_microseconds, Set.debug_level);
 
   // Setup reading the switches.
   SwIPS1.Setup(Set.switch_debounce_micro,
@@ -109,7 +134,15 @@ void setup(void) {
   Adc.Setup(Set.adc_spi_clock_frequency, Set.adc_is_differential,
   Set.using18bitadc, Set.sensor_v_max, Set.adc_reference,
   Set.adc_global_scale, Set.reorder_list, &Tpl);
-  B2B.Setup(Set.canbus_enable);
+  B2B.Setup(Set.canbus_enable, Set.debug_level);
+  B2B.SetupSend(Set.canbus_frame_format);
+  if (Set.canbus_sync_enable == true) {
+    B2B.SetupSyncReceive(Set.canbus_sync_latency_micros);
+  }
+
+  // Only used when sending damper events to the hammer board.
+  DspD.Setup(Set.damper_threshold, Set.damper_velocity_scaling,
+  Set.adc_sample_period_microseconds, Set.debug_level);
 
   // Diagnostics and status
   DStat.Setup(&Tpl, Set.debug_level);
@@ -118,8 +151,15 @@ void setup(void) {
   CalP.Setup(Set.calibration_threshold, Set.debug_level, &Nonv);
   Eth.Setup(Set.true_for_tcp_else_udp, Set.computer_ip, Set.teensy_ip,
     Set.network_port, SwIPS2.direct_read_switch_2(), Set.debug_level);
+  Eth.SetupDestinations(Set.multicast_ip, Set.extra_computer_ips);
+  if (Set.raw_stream_enable == true) {
+    Eth.SetupRawStream(Set.raw_stream_channel, Set.raw_stream_decimation);
+  }
   Tpl.Setup();
   Tmg.Setup(Set.adc_sample_period_microseconds, Set.debug_level);
+  Tmg.SetFixedGrid(Set.canbus_enable == true && Set.canbus_sync_enable == true);
+  Tmg.SetHardwareClock(Set.hardware_frame_clock);
+  Sch.Setup(task_table, NUM_TASKS, Set.debug_level);
 
   if (Set.test_index >= 0) {
     Serial.println("WARNING - In high-speed test mode.");
@@ -153,6 +193,8 @@ unsigned int raw_samples_reordered[NUM_CHANNELS];
 int position_adc_counts[NUM_CHANNELS];
 
 // Damper, hammer, and pedal data.
+bool damper_event[NUM_CHANNELS];
+float damper_velocity[NUM_CHANNELS];
 float damper_position[NUM_CHANNELS], calibrated_floats[NUM_CHANNELS],
 position_floats[NUM_CHANNELS];
 
@@ -191,16 +233,42 @@ void loop() {
   // sca_sw1_positon1 (DELETE_CAL_VALUES).
   switch_disable_and_reset_calibration = SwSCA1.read_switch_1();
 
-  // When the TFT is operational.
+  // Follow the hammer board sample period, which it may have tuned.
+  if (Set.canbus_sync_enable == true && B2B.HammerSamplePeriod() > 0 &&
+  B2B.HammerSamplePeriod() != Set.adc_sample_period_microseconds) {
+    Set.adc_sample_period_microseconds = B2B.HammerSamplePeriod();
+    DspD.SetSamplePeriod(Set.adc_sample_period_microseconds);
+    if (Set.debug_level >= DEBUG_INFO) {
+      Serial.printf("Following the hammer board sample period of %d us.\n",
+      Set.adc_sample_period_microseconds);
+    }
+  }
+
+  // When the TFT is operational and not drawing at the sample rate.
   // Slow down sampling because the TFT takes a long time for
   // processing. But, do keep the sampling going so that the TFT
   // can display things like maximum and minimum hammer positions.
+  // Also slow down while the TFT reads a picture from the SD card,
+  // which is too slow for the full sample rate.
   if (switch_tft_display == true) {
     switch_freeze_cal_values = true; // Ignore switch value.
+  }
+  bool tft_slow = switch_tft_display == true &&
+  (Set.tft_at_sample_rate == false || Tft.PictureDrawing() == true);
+  if (tft_slow == true) {
     Tmg.ResetInterval(Set.adc_sample_period_microseconds_during_tft);
+    DspD.Enable(false);
   }
   else {
     Tmg.ResetInterval(Set.adc_sample_period_microseconds);
+    DspD.Enable(true);
+  }
+
+  // Line up the samples with the hammer board samples.
+  int phase_error;
+  if (B2B.GetSyncPhaseError(Tmg.ProcessingStartMicros(),
+  Tmg.ProcessingInterval(), &phase_error) == true) {
+    Tmg.AdjustPhase(phase_error);
   }
 
   // This if statement determines the sample rate.
@@ -208,6 +276,13 @@ void loop() {
   if (Tmg.AllowProcessing() == true) {
 
     Tpl.SetTp8(true); // Front left test point asserts during processing.
+    Sch.FrameStart(tft_slow == true ?
+    Set.adc_sample_period_microseconds_during_tft /
+    Set.adc_sample_period_microseconds : 1);
+
+    // Connect or disconnect Ethernet once per sample, before sending.
+    Eth.UpdateNetworkState(switch_enable_ethernet,
+    switch_require_tcp_connection);
 
     // Get damper data from ADC.
     Adc.GetNewAdcValues(raw_samples, Set.test_index);
@@ -239,13 +314,27 @@ void loop() {
       }
     }
 
-    B2B.SendDamperData(calibrated_floats);
-    Eth.SendPianoPacket(calibrated_floats, calibrated_floats,
-      switch_enable_ethernet, switch_require_tcp_connection, Set.test_index);
+    if (Set.canbus_frame_format == B2B_FRAME_EVENTS) {
+      DspD.GetDamperEventData(damper_event, damper_velocity, calibrated_floats);
+      B2B.SendDamperEvents(damper_event, damper_velocity, calibrated_floats,
+      Set.damper_threshold);
+    }
+    else {
+      B2B.SendDamperData(calibrated_floats);
+    }
+    if (Set.raw_stream_enable == true) {
+      Eth.SendRawPacket(raw_samples_reordered, switch_enable_ethernet,
+        switch_require_tcp_connection);
+    }
+    else {
+      Eth.SendPianoPacket(calibrated_floats, calibrated_floats,
+        switch_enable_ethernet, switch_require_tcp_connection, Set.test_index);
+    }
 
     if (Set.test_index < 0) {
       // Run the TFT display.
-      Tft.Display(switch_tft_display, calibrated_floats, damper_position);
+      Tft.Display(switch_tft_display, calibrated_floats, damper_position,
+      Tmg.ProcessingStartMicros() + Tmg.ProcessingInterval());
     }
 
     // Debug and display information.
@@ -253,9 +342,19 @@ void loop() {
     damper_threshold_high, Set.test_index);
 
     if (Set.test_index < 0) {
-      DStat.LowerRightLed(all_notes_using_cal, Nonv.NonvolatileWasWritten());
-      DStat.SCALed();
-      DStat.EthernetLed();
+      if (Sch.Begin(TASK_LOWER_RIGHT_LED) == true) {
+        DStat.LowerRightLed(all_notes_using_cal, Nonv.NonvolatileWasWritten(),
+        Nonv.QueuePercentWritten());
+        Sch.End(TASK_LOWER_RIGHT_LED);
+      }
+      if (Sch.Begin(TASK_SCA_LED) == true) {
+        DStat.SCALed();
+        Sch.End(TASK_SCA_LED);
+      }
+      if (Sch.Begin(TASK_ETHERNET_LED) == true) {
+        DStat.EthernetLed();
+        Sch.End(TASK_ETHERNET_LED);
+      }
       DStat.SerialMonitor(position_adc_counts, calibrated_floats,
       calibrated_floats[0], position_floats[0],
       calibrated_floats[1], position_floats[1],
@@ -267,6 +366,24 @@ void loop() {
       calibrated_floats[7], position_floats[7]);
     }
 
+    // Save the calibration if a switch changed.
+    if (Sch.Begin(TASK_CALIBRATION_EEPROM) == true) {
+      CalP.WriteEeprom(switch_freeze_cal_values,
+      switch_disable_and_reset_calibration, all_notes_using_cal);
+      Sch.End(TASK_CALIBRATION_EEPROM);
+    }
+    if (Sch.Begin(TASK_STATISTICS) == true) {
+      Tmg.PrintStatistics();
+      B2B.PrintSendStatistics();
+      B2B.PrintSyncStatistics();
+      Tft.PrintStatistics();
+      Sch.PrintStatistics();
+      Sch.End(TASK_STATISTICS);
+    }
+
+    // Write a few bytes of any queued calibration values to EEPROM.
+    Nonv.WriteQueue(Tmg.ProcessingStartMicros() + Tmg.ProcessingInterval());
+
     Tpl.SetTp8(false);
 
   }
@@ -0,0 +1,308 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// hammer_config.cpp
+//
+// For ips pcb version 2.X
+// For sca pcb version 0.0
+//
+// Read and write settings while running, so a piano can be tuned
+// without a reflash and reboot for every change.
+//
+// Commands (serial monitor or Ethernet, see command_line.cpp):
+//   list               Display every setting, its value, and its range.
+//   get NAME           Display one setting.
+//   set NAME VALUE     Stage a new value. Range checked. Not used yet.
+//   apply              Use all staged values, starting at the next sample.
+//   save               Write the values in use to EEPROM, a few
+//                      bytes each sample. See nonvolatile.cpp.
+//   forget             Ignore the EEPROM values at the next startup.
+//
+// Values saved in EEPROM override hammer_settings.cpp at startup.
+// WARNING - The EEPROM index is the entry order in Setup(). Only add
+// new entries at the end, otherwise saved values load into the wrong
+// setting.
+
+#include "hammer_config.h"
+
+HammerConfig::HammerConfig() {}
+
+// Call after Set->SetAllSettingValues() and Nv->Setup(), and
+// before any other Setup() uses the settings.
+void HammerConfig::Setup(HammerSettings *Set, Nonvolatile *Nv, int debug_level) {
+
+  debug_level_ = debug_level;
+  Set_ = Set;
+  Nv_ = Nv;
+  apply_pending_ = false;
+  staged_ = *Set_;
+
+  // Same EEPROM safety as for calibration values.
+  min_write_interval_millis_ = 3000;
+  last_write_time_ = millis() - min_write_interval_millis_;
+
+  num_entries_ = 0;
+  AddFloat("strike_threshold", &staged_.strike_threshold,
+  &Set_->strike_threshold, 0.0, 1.0);
+  AddFloat("release_threshold", &staged_.release_threshold,
+  &Set_->release_threshold, 0.0, 1.5);
+  AddFloat("min_repetition_seconds", &staged_.min_repetition_seconds,
+  &Set_->min_repetition_seconds, 0.0, 1.0);
+  AddFloat("min_strike_velocity", &staged_.min_strike_velocity,
+  &Set_->min_strike_velocity, 0.0, 10.0);
+  AddFloat("damper_threshold", &staged_.damper_threshold,
+  &Set_->damper_threshold, 0.0, 1.0);
+  AddFloat("damper_velocity_scaling", &staged_.damper_velocity_scaling,
+  &Set_->damper_velocity_scaling, 0.0, 1.0);
+  AddFloat("velocity_scale", &staged_.velocity_scale,
+  &Set_->velocity_scale, 0.0, 10.0);
+  AddFloat("pedal_threshold", &staged_.pedal_threshold,
+  &Set_->pedal_threshold, 0.0, 1.0);
+  // Names are for the default pedal order in hammer_settings.cpp.
+  AddInt("sustain_pin", &staged_.pedal[0].pin,
+  &Set_->pedal[0].pin, 0, NUM_CHANNELS - 1);
+  AddInt("sustain_connected_pin", &staged_.pedal[0].connected_pin,
+  &Set_->pedal[0].connected_pin, -1, NUM_CHANNELS - 1);
+  AddInt("sostenuto_pin", &staged_.pedal[1].pin,
+  &Set_->pedal[1].pin, 0, NUM_CHANNELS - 1);
+  AddInt("sostenuto_connected_pin", &staged_.pedal[1].connected_pin,
+  &Set_->pedal[1].connected_pin, -1, NUM_CHANNELS - 1);
+  AddInt("una_corda_pin", &staged_.pedal[2].pin,
+  &Set_->pedal[2].pin, 0, NUM_CHANNELS - 1);
+  AddInt("una_corda_connected_pin", &staged_.pedal[2].connected_pin,
+  &Set_->pedal[2].connected_pin, -1, NUM_CHANNELS - 1);
+  AddInt("velocity_curve_type", &staged_.velocity_curve_type,
+  &Set_->velocity_curve_type, 0, 2);
+  AddFloat("velocity_curve_exponent", &staged_.velocity_curve_exponent,
+  &Set_->velocity_curve_exponent, 0.1, 10.0);
+
+  Load();
+}
+
+// Returns true if the command was a configuration command.
+bool HammerConfig::ParseCommand(const char *command, CommandLine *Cmd) {
+
+  char name[COMMAND_LINE_LENGTH];
+  char reply[COMMAND_LINE_LENGTH];
+  double value;
+  int entry;
+
+  if (strcmp(command, "list") == 0) {
+    for (entry = 0; entry < num_entries_; entry++) {
+      PrintEntry(entry, Cmd);
+    }
+  }
+  else if (sscanf(command, "get %127s", name) == 1) {
+    entry = FindEntry(name);
+    if (entry >= 0) {
+      PrintEntry(entry, Cmd);
+    }
+    else {
+      snprintf(reply, COMMAND_LINE_LENGTH, "Error - no setting %s.", name);
+      Cmd->Reply(reply);
+    }
+  }
+  else if (sscanf(command, "set %127s %lf", name, &value) == 2) {
+    entry = FindEntry(name);
+    if (entry < 0) {
+      snprintf(reply, COMMAND_LINE_LENGTH, "Error - no setting %s.", name);
+    }
+    else if (IsValid(entry, value) == false) {
+      snprintf(reply, COMMAND_LINE_LENGTH, "Error - %s must be %sin [%g, %g].",
+      name, entry_[entry].staged_int != nullptr ? "an integer " : "",
+      entry_[entry].min, entry_[entry].max);
+    }
+    else {
+      SetValue(entry, value, false);
+      snprintf(reply, COMMAND_LINE_LENGTH, "Staged %s = %g.",
+      name, GetValue(entry, false));
+    }
+    Cmd->Reply(reply);
+  }
+  else if (strcmp(command, "apply") == 0) {
+    if (StagedIsConsistent() == false) {
+      Cmd->Reply("Error - release_threshold must be below strike_threshold.");
+    }
+    else {
+      apply_pending_ = true;
+      Cmd->Reply("Applying staged settings at the next sample.");
+    }
+  }
+  else if (strcmp(command, "save") == 0) {
+    Save(Cmd);
+  }
+  else if (strcmp(command, "forget") == 0) {
+    Nv_->CancelQueue(NONVOLATILE_QUEUE_SETTINGS);
+    Nv_->WriteSettingsStoredFlag(false);
+    Cmd->Reply("Saved settings will be ignored at the next startup.");
+  }
+  else {
+    return false;
+  }
+  return true;
+}
+
+// Call once per sample, before any processing, so all staged
+// values change together at a frame boundary. Returns true if
+// the settings changed and must be passed to the other classes.
+bool HammerConfig::ApplyPending() {
+  if (apply_pending_ == false) {
+    return false;
+  }
+  apply_pending_ = false;
+  // Settings could be staged again after the apply command.
+  if (StagedIsConsistent() == false) {
+    if (debug_level_ >= DEBUG_INFO) {
+      Serial.println("Staged settings not applied, release_threshold must be below strike_threshold.");
+    }
+    return false;
+  }
+  for (int entry = 0; entry < num_entries_; entry++) {
+    SetValue(entry, GetValue(entry, false), true);
+  }
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.println("Applied staged settings.");
+  }
+  return true;
+}
+
+// Private methods. ////////
+
+void HammerConfig::AddFloat(const char *name, float *staged, float *live,
+float min, float max) {
+  if (num_entries_ < NONVOLATILE_MAX_SETTINGS) {
+    entry_[num_entries_] = {name, staged, live, nullptr, nullptr, min, max};
+    num_entries_++;
+  }
+}
+
+void HammerConfig::AddInt(const char *name, int *staged, int *live,
+int min, int max) {
+  if (num_entries_ < NONVOLATILE_MAX_SETTINGS) {
+    entry_[num_entries_] = {name, nullptr, nullptr, staged, live,
+    static_cast<float>(min), static_cast<float>(max)};
+    num_entries_++;
+  }
+}
+
+int HammerConfig::FindEntry(const char *name) {
+  for (int entry = 0; entry < num_entries_; entry++) {
+    if (strcmp(name, entry_[entry].name) == 0) {
+      return entry;
+    }
+  }
+  return -1;
+}
+
+double HammerConfig::GetValue(int entry, bool live) {
+  if (entry_[entry].staged_float != nullptr) {
+    return live ? *entry_[entry].live_float : *entry_[entry].staged_float;
+  }
+  else {
+    return live ? *entry_[entry].live_int : *entry_[entry].staged_int;
+  }
+}
+
+void HammerConfig::SetValue(int entry, double value, bool live) {
+  if (entry_[entry].staged_float != nullptr) {
+    if (live == true)
+      *entry_[entry].live_float = static_cast<float>(value);
+    else
+      *entry_[entry].staged_float = static_cast<float>(value);
+  }
+  else {
+    if (live == true)
+      *entry_[entry].live_int = static_cast<int>(value);
+    else
+      *entry_[entry].staged_int = static_cast<int>(value);
+  }
+}
+
+bool HammerConfig::IsValid(int entry, double value) {
+  if (value != value) {  // NaN, for example from a damaged EEPROM.
+    return false;
+  }
+  // Do not truncate a fraction for integer settings.
+  if (entry_[entry].staged_int != nullptr && value != floor(value)) {
+    return false;
+  }
+  return value >= entry_[entry].min && value <= entry_[entry].max;
+}
+
+// A key must go below release_threshold before it strikes again.
+bool HammerConfig::StagedIsConsistent() {
+  return staged_.release_threshold < staged_.strike_threshold;
+}
+
+void HammerConfig::PrintEntry(int entry, CommandLine *Cmd) {
+  char reply[COMMAND_LINE_LENGTH];
+  snprintf(reply, COMMAND_LINE_LENGTH, "%s = %g (staged %g) [%g, %g]",
+  entry_[entry].name, GetValue(entry, true), GetValue(entry, false),
+  entry_[entry].min, entry_[entry].max);
+  Cmd->Reply(reply);
+}
+
+// The EEPROM write endurance is approximately 100,000 cycles.
+// Only write on a command, and no faster than min_write_interval_millis_.
+// Writing every setting takes many samples, so the values are queued
+// and Nonvolatile writes them a few bytes each sample. The stored
+// flag is clear until the last value is written.
+void HammerConfig::Save(CommandLine *Cmd) {
+  if (millis() - last_write_time_ < min_write_interval_millis_) {
+    Cmd->Reply("Error - wait a few seconds between saves.");
+    return;
+  }
+  double values[NONVOLATILE_MAX_SETTINGS];
+  for (int entry = 0; entry < num_entries_; entry++) {
+    values[entry] = GetValue(entry, true);
+  }
+  if (Nv_->QueueSettings(values, num_entries_) == false) {
+    Cmd->Reply("Error - EEPROM is busy, try again.");
+    return;
+  }
+  last_write_time_ = millis();
+  char reply[COMMAND_LINE_LENGTH];
+  snprintf(reply, COMMAND_LINE_LENGTH,
+  "Saving %d settings to EEPROM over the next samples.", num_entries_);
+  Cmd->Reply(reply);
+}
+
+// Values that are out of range are ignored, in case of an
+// EEPROM failure or a range change in a newer firmware.
+void HammerConfig::Load() {
+  if (Nv_->ReadSettingsStoredFlag() == false) {
+    return;
+  }
+  double value;
+  for (int entry = 0; entry < num_entries_; entry++) {
+    value = Nv_->ReadSetting(entry);
+    if (IsValid(entry, value) == true) {
+      SetValue(entry, value, true);
+      SetValue(entry, value, false);
+    }
+    else if (debug_level_ >= DEBUG_INFO) {
+      Serial.printf("EEPROM value for %s is out of range, ignored.\n",
+      entry_[entry].name);
+    }
+  }
+  if (debug_level_ >= DEBUG_INFO) {
+    Serial.println("Settings were loaded from EEPROM.");
+    Serial.println("They override values in hammer_settings.cpp.");
+  }
+}
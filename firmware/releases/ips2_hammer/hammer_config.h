@@ -0,0 +1,80 @@
+// Copyright (C) 2025 Greg C. Zweigle
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+// Location of documentation, code, and design:
+// https://github.com/gzweigle/open-hybrid-piano
+// https://github.com/stem-piano
+//
+// hammer_config.h
+//
+// For ips pcb version 2.X
+// For sca pcb version 0.0
+//
+// Read and write settings while running.
+
+#ifndef HAMMER_CONFIG_H_
+#define HAMMER_CONFIG_H_
+
+#include "stem_piano_ips2.h"
+
+#include "command_line.h"
+#include "hammer_settings.h"
+#include "nonvolatile.h"
+
+class HammerConfig
+{
+  public:
+    HammerConfig();
+    void Setup(HammerSettings *, Nonvolatile *, int);
+    bool ParseCommand(const char *, CommandLine *);
+    bool ApplyPending();
+
+  private:
+    struct Entry {
+      const char *name;
+      float *staged_float;
+      float *live_float;
+      int *staged_int;
+      int *live_int;
+      float min;
+      float max;
+    };
+
+    void AddFloat(const char *, float *, float *, float, float);
+    void AddInt(const char *, int *, int *, int, int);
+    int FindEntry(const char *);
+    double GetValue(int, bool);
+    void SetValue(int, double, bool);
+    bool IsValid(int, double);
+    bool StagedIsConsistent();
+    void PrintEntry(int, CommandLine *);
+    void Save(CommandLine *);
+    void Load();
+
+    int debug_level_;
+    HammerSettings *Set_;
+    HammerSettings staged_;
+    Nonvolatile *Nv_;
+
+    Entry entry_[NONVOLATILE_MAX_SETTINGS];
+    int num_entries_;
+    bool apply_pending_;
+
+    unsigned long last_write_time_;
+    unsigned long min_write_interval_millis_;
+
+};
+
+#endif
@@ -62,6 +62,49 @@ void HammerSettings::SetAllSettingValues() {
   // Because all functions are disabled, it is possible to set the sample
   // rate approximately 10x faster than during normal operation.
   test_index = -1;
+
+  // Raw ADC count streaming mode.
+  // If true, Ethernet sends the raw ADC counts (3 bytes per channel, full
+  // 18-bit resolution) for each raw_stream_channel set to true, instead of
+  // the normal calibrated positions. Piano functions keep running.
+  // Send one packet every raw_stream_decimation samples.
+  // Use for sensor characterization.
+  raw_stream_enable = false;
+  raw_stream_decimation = 1;
+  for (int channel = 0; channel < NUM_CHANNELS; channel++) {
+    raw_stream_channel[channel] = false;
+  }
+  raw_stream_channel[0] = true;
+
+  // Multi-channel high-speed capture mode.
+  // Generalizes test_index to a list of up to CAPTURE_MAX_CHANNELS keys.
+  // Only the listed keys are sampled and all piano functions are disabled.
+  // Can also be started, stopped, or changed while running with the
+  // "capture" command from the serial monitor or Ethernet.
+  // Key numbers are the same as for connected_channel (0 = A0).
+  capture_enable = false;
+  capture_num_channels = 2;
+  capture_channel_list[0] = 39;
+  capture_channel_list[1] = 40;
+
+  // Capture sample period is:
+  // capture_overhead_microseconds +
+  //   number of keys * capture_microseconds_per_channel.
+  // Verify with an oscilloscope on TP8 when changing these.
+  capture_microseconds_per_channel = 2;
+  capture_overhead_microseconds = 20;
+
+  // Black-box recorder of all raw frames and events into PSRAM.
+  // Needs the 8 MB PSRAM chip on the Teensy. Freezes on the
+  // "blackbox freeze" command or when AutoMute activates, after
+  // recording black_box_post_trigger_frames more frames.
+  // Get the recording with software/releases/ips2_black_box.
+  black_box_enable = true;
+  black_box_post_trigger_frames = 4000;
+
+  // Telemetry, see telemetry.cpp. When turned on with the
+  // "telemetry on" command, send statistics at this interval.
+  telemetry_interval_millis = 1000;
   
   // Must be longer than the time to sample and collect all NUM_CHANNELS
   // data from the ADC plus the time for processing all of the data.
@@ -75,15 +118,62 @@ void HammerSettings::SetAllSettingValues() {
     Serial.println("The sample period value must match on hammer and damper boards.");
   }
 
+  // Start each sample period from a hardware timer, at exact deadlines.
+  // Otherwise the start of each period is polled, and the sample rate is
+  // a little slower than 1 / adc_sample_period_microseconds, which makes
+  // velocities a little high.
+  hardware_frame_clock = true;
+
+  // Measure the ADC and DSP time at boot and shorten the sample period
+  // to fit, but never longer than adc_sample_period_microseconds. If
+  // frames then take too long, the period backs off. A damper board
+  // follows the new period if it has canbus_sync_enable set. A damper
+  // board with older firmware does not, so this is off by default.
+  auto_sample_period = false;
+
+  // Shortest sample period that auto_sample_period can pick.
+  auto_sample_period_min_microseconds = 150;
+
+  // Fraction added to the measured time, for the MIDI, Ethernet, and
+  // status work that is not measured at boot.
+  auto_sample_period_margin = 0.5;
+
   // When the TFT is running, slow everything down because the TFT
   // processing takes a long time.
   adc_sample_period_microseconds_during_tft = 100000;
 
+  // Keep sampling, DSP, and MIDI running normally while the TFT is on.
+  // The TFT draws a little each sample instead. When false, use
+  // adc_sample_period_microseconds_during_tft and turn off the DSP.
+  // The same happens while a TFT picture is read from the SD card.
+  tft_at_sample_rate = true;
+
+  // Time the TFT can draw each sample when tft_at_sample_rate is true.
+  tft_slice_microseconds = 40;
+
+  // SPI clock for the SD card on the TFT. Lower it if the card
+  // does not start. For sd_log_enable at the full sample rate,
+  // raise it to 40. A 512 byte sector then takes about
+  // 110 microseconds instead of 420, and fits in the idle time after
+  // each frame.
+  tft_sd_clock_mhz = 10;
+
+  // Log all raw frames and events to the SD card on the TFT, from
+  // startup. See sd_log.cpp. Needs using_display, and tft_sd_clock_mhz
+  // raised to 40 at the full sample rate. Also started and
+  // stopped with the "sdlog" command. The log file is allocated at
+  // startup with sd_log_megabytes, up to 4095. Uses about 250 kB per
+  // second, depending on the sensor noise.
+  sd_log_enable = false;
+  sd_log_megabytes = 2048;
+
   // The analog circuitry in front of ADC is not differential.
   // Therefore, if using a differential ADC, lose a bit.
   adc_is_differential = true;
 
   // Presently support a 16-bit or 18-bit ADC.
+  // An 18-bit ADC clocks out 24 bits per channel instead of 16,
+  // which adds time to every sample period.
   using18bitadc = false;
 
   // Historically, ADC changes during development resulted in
@@ -119,6 +209,22 @@ void HammerSettings::SetAllSettingValues() {
   // To disable, set >= max MIDI velocity (128 most likely).
   maximum_midi_velocity = 127;
 
+  // Velocity curve, from scaled velocity to MIDI velocity.
+  // See velocity_curve.cpp.
+  // 0 = linear, the same as 128 * velocity.
+  // 1 = velocity ^ velocity_curve_exponent.
+  // 2 = straight lines between the velocity_curve_table values.
+  velocity_curve_type = 0;
+  velocity_curve_exponent = 1.0;
+  for (int point = 0; point < VELOCITY_CURVE_POINTS; point++) {
+    velocity_curve_table[point] =
+    static_cast<float>(point) / (VELOCITY_CURVE_POINTS - 1);
+  }
+
+  // If true, send CC88 (high resolution velocity prefix) before each
+  // note on, for 14-bit velocity. Only if the receiver supports it.
+  high_resolution_velocity = false;
+
   ////////
   // Switch settings.
   switch_debounce_micro = 500000; // Read DIP switches at this interval, microseconds.
@@ -135,6 +241,10 @@ void HammerSettings::SetAllSettingValues() {
   // Calibration Settings.
   calibration_threshold = 0.5;
 
+  // Time each sample can spend writing calibration values to EEPROM.
+  // The values are written a few bytes per sample. See nonvolatile.cpp.
+  eeprom_slice_microseconds = 20;
+
   ////////
   // Damper Settings.
 
@@ -145,6 +255,19 @@ void HammerSettings::SetAllSettingValues() {
   // Magic value to get velocity in range [-1,0].
   damper_velocity_scaling = 0.025;
 
+  // Optional continuous damper height per key, 0 to 127, for synths that
+  // model partial damping. MIDI is polyphonic aftertouch. Ethernet is a
+  // small UDP packet on the data stream (see damper_stream.cpp).
+  // A key is sent when it changed by damper_stream_delta, at most once per
+  // damper_stream_key_interval_millis. All keys together send at most
+  // damper_stream_midi_per_second MIDI messages. On DIN each is 3 bytes,
+  // and DIN carries about 3000 bytes per second.
+  damper_stream_midi_enable = false;
+  damper_stream_network_enable = false;
+  damper_stream_delta = 4;
+  damper_stream_key_interval_millis = 20;
+  damper_stream_midi_per_second = 200;
+
   ////////
   // Hammer Settings.
 
@@ -204,21 +327,45 @@ void HammerSettings::SetAllSettingValues() {
   ////////
   // Pedal Settings.
 
-  // Run pedal sampling slower otherwise get noise around the threshold crossing.
-  // Also, this reduces unnecessary processor burden because pedal processing
-  // does not need to happen as quickly as for hammers.
-  pedal_sample_interval_microseconds = 1000;
+  // Pedals are sampled by the pedals task in ips2_hammer.ino, slower
+  // than the hammers.
   pedal_threshold = 0.4;
-  sustain_connected_pin = 95;
-  sustain_pin = 94;
-  sostenuto_connected_pin = 93;
-  sostenuto_pin = 92;
-  una_corda_connected_pin = 91;
-  una_corda_pin = 90;
+
+  // One descriptor per pedal. To add a pedal, add a descriptor
+  // and increase num_pedals (up to MAX_PEDALS).
+  //   pin           - ADC channel of the pedal signal.
+  //   connected_pin - ADC channel of the jack connected signal.
+  //                   -1 if none, then the pedal is never unplugged.
+  //   midi_cc       - MIDI control change number.
+  //   inverted      - true if pressing the pedal lowers the ADC value.
+  //   threshold     - fraction of travel for on/off, 0.0 = pedal_threshold.
+  //   mode          - PEDAL_MODE_SWITCH sends 0 or 127 at the threshold.
+  //                   PEDAL_MODE_CONTINUOUS sends 0 to 127 (half-pedal).
+  num_pedals = 3;
+  pedal[0] = {94, 95, 64, false, 0.0, PEDAL_MODE_SWITCH};  // Sustain.
+  pedal[1] = {92, 93, 66, false, 0.0, PEDAL_MODE_SWITCH};  // Sostenuto.
+  pedal[2] = {90, 91, 67, false, 0.0, PEDAL_MODE_SWITCH};  // Una corda.
+
+  // Continuous (half-pedal) mode.
+  // Send a new value only if it changed by pedal_continuous_hysteresis,
+  // and at most once per pedal_continuous_interval_millis.
+  // pedal_continuous_deadband is the fraction of travel at each end
+  // that is treated as fully up or fully down.
+  pedal_continuous_hysteresis = 2;
+  pedal_continuous_interval_millis = 10;
+  pedal_continuous_deadband = 0.1;
 
   ////////
   // MIDI
   midi_channel = 2;
+
+  // Network MIDI (RTP-MIDI, also called AppleMIDI). Requires Ethernet.
+  // Connect from the computer's network MIDI session to the Teensy IP
+  // at rtp_midi_port. Uses rtp_midi_port and rtp_midi_port + 1.
+  // Must not be the same as network_port.
+  rtp_midi_enable = false;
+  rtp_midi_port = 5004;
+  snprintf(rtp_midi_name, IP_STRING_LENGTH, "stem piano");
   
   ////////
   // Ethernet data.
@@ -228,6 +375,16 @@ void HammerSettings::SetAllSettingValues() {
   snprintf(teensy_ip, 16, "X.X.X.X");   // Arbitrary assigned Teensy IP
   snprintf(computer_ip,16, "X.X.X.X");  // Get from ipconfig command on local computer
   network_port = X;  // Must match UDP port in receiver code
+  // UDP only. Optional. Send the data stream to a multicast group so
+  // several programs can receive it, for example "239.1.2.3".
+  // Use "" for no multicast.
+  multicast_ip[0] = '\0';
+  // UDP only. Optional. Also send the data stream to these computers.
+  // Comma separated, up to 4, for example "192.168.1.20,192.168.1.21".
+  // Use "" for none. Each adds one packet per sample.
+  // The data stream still goes to computer_ip, unless multicast_ip is
+  // set. Then computer_ip must join the group to receive it.
+  extra_computer_ips[0] = '\0';
   //
 
   ////////
@@ -237,6 +394,15 @@ void HammerSettings::SetAllSettingValues() {
   // damper position.
   canbus_enable = false;
 
+  // If no good damper frame arrives for this long, use the hammer
+  // position as the damper estimate until the link recovers.
+  canbus_stale_millis = 100;
+
+  // Send the sample clock to the damper board every this many samples,
+  // so both boards sample at the same time. 0 turns this off.
+  // Every 40 samples is every 10 ms at the normal sample period.
+  canbus_sync_interval = 40;
+
   ////////
   // TFT display.
   using_display = true;
@@ -28,6 +28,7 @@
 #define HAMMER_SETTINGS_H_
 
 #include "stem_piano_ips2.h"
+#include "dsp_pedal.h"
 
 #define IP_STRING_LENGTH 128
 
@@ -42,8 +43,28 @@ class HammerSettings
     int startup_counter_value;
     int adc_spi_clock_frequency;
     int test_index;
+    bool raw_stream_enable;
+    int raw_stream_decimation;
+    bool raw_stream_channel[NUM_CHANNELS];
+    bool capture_enable;
+    int capture_num_channels;
+    int capture_channel_list[CAPTURE_MAX_CHANNELS];
+    int capture_microseconds_per_channel;
+    int capture_overhead_microseconds;
+    bool black_box_enable;
+    int black_box_post_trigger_frames;
+    int telemetry_interval_millis;
     int adc_sample_period_microseconds;
+    bool hardware_frame_clock;
+    bool auto_sample_period;
+    int auto_sample_period_min_microseconds;
+    float auto_sample_period_margin;
     int adc_sample_period_microseconds_during_tft;
+    bool tft_at_sample_rate;
+    int tft_slice_microseconds;
+    int tft_sd_clock_mhz;
+    bool sd_log_enable;
+    int sd_log_megabytes;
     bool adc_is_differential;
     bool using18bitadc;
     float sensor_v_max;
@@ -51,6 +72,10 @@ class HammerSettings
     float adc_global_scale;
     float velocity_scale;
     int maximum_midi_velocity;
+    int velocity_curve_type;
+    float velocity_curve_exponent;
+    float velocity_curve_table[VELOCITY_CURVE_POINTS];
+    bool high_resolution_velocity;
     int switch_debounce_micro;
     int switch11_ips_pin;
     int switch12_ips_pin;
@@ -61,28 +86,39 @@ class HammerSettings
     int switch21_sca_pin;
     int switch22_sca_pin;
     float calibration_threshold;
+    int eeprom_slice_microseconds;
     float damper_threshold;
     float damper_velocity_scaling;
+    bool damper_stream_midi_enable;
+    bool damper_stream_network_enable;
+    int damper_stream_delta;
+    int damper_stream_key_interval_millis;
+    int damper_stream_midi_per_second;
     int hammer_strike_algorithm;
     float strike_threshold;
     float release_threshold;
     float min_repetition_seconds;
     float min_strike_velocity;
     float hammer_travel_meters;
-    int pedal_sample_interval_microseconds;
     float pedal_threshold;
-    int sustain_pin;
-    int sustain_connected_pin;
-    int sostenuto_pin;
-    int sostenuto_connected_pin;
-    int una_corda_pin;
-    int una_corda_connected_pin;
+    int num_pedals;
+    PedalDescriptor pedal[MAX_PEDALS];
+    int pedal_continuous_hysteresis;
+    int pedal_continuous_interval_millis;
+    float pedal_continuous_deadband;
     int midi_channel;
+    bool rtp_midi_enable;
+    int rtp_midi_port;
+    char rtp_midi_name[IP_STRING_LENGTH];
     bool true_for_tcp_else_udp;
     char teensy_ip[IP_STRING_LENGTH];
     char computer_ip[IP_STRING_LENGTH];
+    char multicast_ip[IP_STRING_LENGTH];
+    char extra_computer_ips[IP_STRING_LENGTH];
     int network_port;
     bool canbus_enable;
+    int canbus_stale_millis;
+    int canbus_sync_interval;
     bool using_display;
     bool connected_channel[NUM_CHANNELS];
     int reorder_list[NUM_CHANNELS];
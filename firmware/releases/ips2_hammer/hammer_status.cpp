@@ -92,14 +92,16 @@ float damper_threshold, float strike_threshold, int test_index) {
 
   if (test_index < 0) {
     // Turn on LED if any pedal input is above its threshold.
-    if (dspp_->GetSustainCrossedUpThreshold() || 
-    dspp_->GetSostenutoCrossedUpThreshold() ||
-    dspp_->GetUnaCordaCrossedUpThreshold()) {
+    bool crossed_up = false;
+    bool crossed_down = false;
+    for (int ind = 0; ind < dspp_->NumPedals(); ind++) {
+      crossed_up |= dspp_->GetCrossedUpThreshold(ind);
+      crossed_down |= dspp_->GetCrossedDownThreshold(ind);
+    }
+    if (crossed_up) {
       testp_->SetTp11(false);
     }
-    else if (dspp_->GetSustainCrossedDownThreshold() || 
-    dspp_->GetSostenutoCrossedDownThreshold() ||
-    dspp_->GetUnaCordaCrossedDownThreshold()) {
+    else if (crossed_down) {
       testp_->SetTp11(true);
     }
   }
@@ -111,10 +113,16 @@ float damper_threshold, float strike_threshold, int test_index) {
 
 // Flash lower right LED (under TFT) based on calibration status.
 // Also indicate if nonvolatile was written.
+// While queued nonvolatile writes are in progress, the LED is on
+// for the percent written of each second.
 void HammerStatus::LowerRightLed(bool all_notes_using_cal, 
-bool nonvolatile_was_written) {
+bool nonvolatile_was_written, int nonvolatile_percent_written) {
+  if (nonvolatile_percent_written < 100) {
+    testp_->SetLowerRightLED((int) (millis() % 1000) / 10 <
+    nonvolatile_percent_written);
+  }
   // If Nonvolatile memory was written, turn on LED for a long duration.
-  if (nonvolatile_was_written == true) {
+  else if (nonvolatile_was_written == true) {
     lower_r_led_in_nonvol_mode_ = true;
     lower_r_led_last_change_ = millis();
     testp_->SetLowerRightLED(true);
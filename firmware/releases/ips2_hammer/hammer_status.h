@@ -37,7 +37,7 @@ class HammerStatus
     HammerStatus();
     void Setup(DspPedal *, TestpointLed *, int);
     void FrontLed(const float *, float, float, int);
-    void LowerRightLed(bool, bool);
+    void LowerRightLed(bool, bool, int);
     void SCALed();
     void EthernetLed();
     void SerialMonitor(const int *, const float *, const bool *, bool, bool);
@@ -32,17 +32,28 @@
 #include "hammer_settings.h"
 #include "six_channel_analog_00.h"
 #include "auto_mute.h"
+#include "black_box.h"
 #include "board2board.h"
 #include "calibration_position.h"
 #include "calibration_velocity.h"
+#include "capture.h"
+#include "command_line.h"
+#include "damper_stream.h"
 #include "dsp_damper.h"
 #include "dsp_hammer.h"
 #include "dsp_pedal.h"
+#include "hammer_config.h"
 #include "hammer_status.h"
+#include "key_scope.h"
 #include "midiout.h"
 #include "network.h"
 #include "nonvolatile.h"
+#include "period_tuner.h"
+#include "rtp_midi.h"
+#include "scheduler.h"
+#include "sd_log.h"
 #include "switches.h"
+#include "telemetry.h"
 #include "testpoint_led.h"
 #include "timing.h"
 #include "tft_display.h"
@@ -50,27 +61,73 @@
 HammerSettings Set;
 SixChannelAnalog00 Adc;
 AutoMute Mute;
+BlackBox Box;
 Board2Board B2B;
 CalibrationPosition CalP;
 CalibrationVelocity CalV;
+Capture Cap;
+CommandLine Cmd;
+DamperStream DStr;
 DspDamper DspD;
 DspHammer DspH;
 DspPedal DspP;
+HammerConfig Config;
 HammerStatus HStat;
+KeyScope Scope;
 MidiOut Midi;
 Network Eth;
 Nonvolatile Nonv;
+PeriodTuner Tune;
+RtpMidi Rtp;
+Scheduler Sch;
+SdLog Log;
 Switches SwIPS1;
 Switches SwIPS2;
 Switches SwSCA1;
 Switches SwSCA2;
+Telemetry Tel;
 TestpointLed Tpl;
 Timing Tmg;
 TftDisplay Tft;
 
-MIDI_CREATE_INSTANCE(HardwareSerial, Serial1, mi);
+MIDI_CREATE_CUSTOM_INSTANCE(HardwareSerial, Serial1, mi, MidiOutSettings);
 uint8_t Midi_Buffer[MIDI_BUFFER_SIZE];
 
+// Velocity curve in use. Building the curve takes a powf() per
+// table entry, too slow for a sample, so only rebuild on a change.
+int velocity_curve_type;
+float velocity_curve_exponent;
+
+// Work that does not need to run every sample. See scheduler.cpp.
+// Period and phase are in samples of adc_sample_period_microseconds,
+// 40 samples is 10 ms at 250 us. RTP-MIDI is 1 mod 4, pedals 3 mod 4,
+// the LEDs 2 mod 4, and the slow tasks 0 mod 4 at phases the LEDs do
+// not use mod 40, so no two tasks run in the same sample.
+//   pedals      - Sampled slower than the hammers, otherwise get noise
+//                 around the threshold crossing.
+//   cal_eeprom  - Calibration is written on a switch change. Checking
+//                 only every 3 s means switch noise or a bug cannot
+//                 wear out the EEPROM (about 100,000 writes).
+//   statistics  - Serial monitor statistics at DEBUG_STATS, every 10 s.
+#define TASK_LOWER_RIGHT_LED    0
+#define TASK_SCA_LED            1
+#define TASK_ETHERNET_LED       2
+#define TASK_RTP_MIDI           3
+#define TASK_PEDALS             4
+#define TASK_CALIBRATION_EEPROM 5
+#define TASK_STATISTICS         6
+#define NUM_TASKS               7
+const SchedulerTask task_table[NUM_TASKS] = {
+  // name,          period, phase, budget us
+  {"lower_r_led",       40,    10,        20},
+  {"sca_led",           40,    22,        20},
+  {"ethernet_led",      40,    34,        20},
+  {"rtp_midi",           4,     1,        50},
+  {"pedals",             4,     3,        30},
+  {"cal_eeprom",     12000,     4,       100},
+  {"statistics",     40000,     8,      1000}
+};
+
 void setup(void) {
 
   // Serial port setup.
@@ -100,12 +157,17 @@ void setup(void) {
   if (Set.debug_level >= DEBUG_INFO) {
     Serial.println("Beginning hammer board initialization.");
   }
-  Tft.Setup(Set.using_display, Set.debug_level);
+  Tft.Setup(Set.using_display, Set.tft_slice_microseconds,
+  Set.tft_sd_clock_mhz, Set.debug_level);
   Tft.HelloWorld();
 
   // Initialize the nonvolatile memory.
   // Initialize early in case any setup() uses storage.
-  Nonv.Setup(Set.debug_level);
+  Nonv.Setup(Set.eeprom_slice_microseconds, Set.debug_level);
+
+  // Settings saved with the "save" command override hammer_settings.cpp.
+  // Must be before any setup() that uses these settings.
+  Config.Setup(&Set, &Nonv, Set.debug_level);
 
   // Setup reading the switches.
   SwIPS1.Setup(Set.switch_debounce_micro,
@@ -126,35 +188,72 @@ void setup(void) {
   Adc.Setup(Set.adc_spi_clock_frequency, Set.adc_is_differential,
   Set.using18bitadc, Set.sensor_v_max, Set.adc_reference,
   Set.adc_global_scale, Set.reorder_list, &Tpl);
-  B2B.Setup(Set.canbus_enable);
+  B2B.Setup(Set.canbus_enable, Set.debug_level);
+  B2B.SetupReceive(Set.canbus_stale_millis);
+  B2B.SetupSyncSend(Set.canbus_sync_interval);
 
   // Diagnostics and status
   HStat.Setup(&DspP, &Tpl, Set.debug_level);
 
   // Setup the dampers, hammers, and pedals on hammer board.
-  DspD.Setup( Set.damper_threshold, Set.damper_velocity_scaling,
-  Set.adc_sample_period_microseconds, Set.debug_level);
-  DspH.Setup(Set.hammer_strike_algorithm, Set.adc_sample_period_microseconds,
-  Set.strike_threshold, Set.release_threshold, Set.min_repetition_seconds,
-  Set.min_strike_velocity, Set.hammer_travel_meters, Set.debug_level);
-  DspP.Setup(Set.pedal_sample_interval_microseconds, Set.pedal_threshold,
-  Set.sustain_pin, Set.sustain_connected_pin, Set.sostenuto_pin,
-  Set.sostenuto_connected_pin, Set.una_corda_pin, Set.una_corda_connected_pin,
+  SetupDsp();
+
+  // Shorten the sample period if the processor is fast enough.
+  // Must be after SetupDsp() and before anything else that
+  // uses adc_sample_period_microseconds.
+  Tune.Setup(Set.auto_sample_period, Set.adc_sample_period_microseconds,
+  Set.auto_sample_period_min_microseconds, Set.auto_sample_period_margin,
   Set.debug_level);
+  if (Set.auto_sample_period == true) {
+    TuneSamplePeriod();
+  }
 
   // Adjust velocity based on the physical structure.
   CalV.Setup(Set.velocity_scale, Set.debug_level, &Nonv);
 
   // Setup sending damper, hammer, and pedal data over MIDI.
-  Midi.Setup(Set.midi_channel, &mi, Set.maximum_midi_velocity, Set.debug_level);
   Serial1.addMemoryForWrite(Midi_Buffer, sizeof(Midi_Buffer));
+  Midi.Setup(Set.midi_channel, &mi, &Serial1, Set.maximum_midi_velocity,
+  Set.debug_level);
+  Midi.SetupVelocityCurve(Set.velocity_curve_type, Set.velocity_curve_exponent,
+  Set.velocity_curve_table, Set.high_resolution_velocity);
+  velocity_curve_type = Set.velocity_curve_type;
+  velocity_curve_exponent = Set.velocity_curve_exponent;
 
   // Common on hammer and pedal board: Ethernet, test points, TFT display, etc.
   CalP.Setup(Set.calibration_threshold, Set.debug_level, &Nonv);
   Eth.Setup(Set.true_for_tcp_else_udp, Set.computer_ip, Set.teensy_ip, Set.network_port,
   SwIPS2.direct_read_switch_2(), Set.debug_level);
+  Eth.SetupDestinations(Set.multicast_ip, Set.extra_computer_ips);
+  if (Set.raw_stream_enable == true) {
+    Eth.SetupRawStream(Set.raw_stream_channel, Set.raw_stream_decimation);
+  }
+  Rtp.Setup(Set.rtp_midi_enable, Set.rtp_midi_port, Set.rtp_midi_name,
+  Set.midi_channel, &Eth, Set.debug_level);
+  Midi.SetupRtpMidi(&Rtp);
+  DStr.Setup(Set.damper_stream_midi_enable, Set.damper_stream_network_enable,
+  Set.damper_stream_delta, Set.damper_stream_key_interval_millis,
+  Set.damper_stream_midi_per_second, Set.debug_level);
   Tpl.Setup();
   Tmg.Setup(Set.adc_sample_period_microseconds, Set.debug_level);
+  Tmg.SetFixedGrid(Set.canbus_enable == true && Set.canbus_sync_interval > 0);
+  Tmg.SetHardwareClock(Set.hardware_frame_clock);
+
+  // Commands from serial monitor or Ethernet, and high-speed capture.
+  Cmd.Setup(&Eth, Set.debug_level);
+  Cap.Setup(Set.capture_enable, Set.capture_channel_list,
+  Set.capture_num_channels, Set.capture_microseconds_per_channel,
+  Set.capture_overhead_microseconds, &Adc, Set.debug_level);
+  Tel.Setup(Set.telemetry_interval_millis, Set.adc_sample_period_microseconds,
+  Set.debug_level);
+  Sch.Setup(task_table, NUM_TASKS, Set.debug_level);
+  Scope.Setup(Set.debug_level);
+  Scope.SetThresholds(Set.strike_threshold, Set.release_threshold);
+  Box.Setup(Set.black_box_enable, Set.black_box_post_trigger_frames,
+  Set.adc_sample_period_microseconds, Set.debug_level);
+  Log.Setup(Set.sd_log_enable, Set.sd_log_megabytes,
+  Set.adc_sample_period_microseconds, Set.tft_sd_clock_mhz, &Tft,
+  Set.debug_level);
 
   if (Set.test_index >= 0) {
     Serial.println("WARNING - In high-speed test mode.");
@@ -170,6 +269,63 @@ void setup(void) {
 
 }
 
+// Also called again after TuneSamplePeriod(), which
+// runs the DSP on synthetic data and may change the sample period.
+void SetupDsp() {
+  DspD.Setup( Set.damper_threshold, Set.damper_velocity_scaling,
+  Set.adc_sample_period_microseconds, Set.debug_level);
+  DspH.Setup(Set.hammer_strike_algorithm, Set.adc_sample_period_microseconds,
+  Set.strike_threshold, Set.release_threshold, Set.min_repetition_seconds,
+  Set.min_strike_velocity, Set.hammer_travel_meters, Set.debug_level);
+  DspP.Setup(task_table[TASK_PEDALS].period * Set.adc_sample_period_microseconds,
+  Set.pedal_threshold,
+  Set.pedal, Set.num_pedals, Set.debug_level);
+  DspP.SetupContinuous(Set.pedal_continuous_hysteresis, Set.pedal_continuous_interval_millis,
+  Set.pedal_continuous_deadband);
+}
+
+// Measure ADC and DSP time on worst case input and pick the sample
+// period. Nothing is sent to MIDI. See period_tuner.cpp.
+void TuneSamplePeriod() {
+  unsigned int raw[NUM_CHANNELS], reordered[NUM_CHANNELS];
+  int counts[NUM_CHANNELS];
+  bool h_event[NUM_CHANNELS], d_event[NUM_CHANNELS];
+  float h_position[NUM_CHANNELS], d_position[NUM_CHANNELS];
+  float h_velocity[NUM_CHANNELS], d_velocity[NUM_CHANNELS];
+  for (int run = 0; run < PERIOD_TUNER_RUNS; run++) {
+    Tune.MeasureStart();
+    Adc.GetNewAdcValues(raw, -1);
+    Adc.ReorderAdcValues(reordered, raw);
+    Adc.NormalizeAdcValues(counts, h_position, reordered);
+    Tune.AcquisitionEnd();
+    Tune.SyntheticInput(h_position, d_position, run);
+    DspH.GetHammerEventData(h_event, h_velocity, h_position);
+    DspD.GetDamperEventData(d_event, d_velocity, d_position);
+    DspD.CheckHammerDamperSync(d_event, d_velocity, d_position, h_event);
+    DspP.UpdatePedalState(h_position);
+    Tune.ProcessingEnd();
+  }
+  Set.adc_sample_period_microseconds = Tune.ChoosePeriod();
+  SetupDsp();
+}
+
+// Pass settings changed by the "apply" command to each class.
+void ApplySettings() {
+  DspH.SetThresholds(Set.strike_threshold, Set.release_threshold,
+  Set.min_repetition_seconds, Set.min_strike_velocity);
+  DspD.SetThreshold(Set.damper_threshold, Set.damper_velocity_scaling);
+  Scope.SetThresholds(Set.strike_threshold, Set.release_threshold);
+  DspP.SetPedalSettings(Set.pedal_threshold, Set.pedal, Set.num_pedals);
+  CalV.SetFixedScale(Set.velocity_scale);
+  if (Set.velocity_curve_type != velocity_curve_type ||
+  Set.velocity_curve_exponent != velocity_curve_exponent) {
+    Midi.SetupVelocityCurve(Set.velocity_curve_type, Set.velocity_curve_exponent,
+    Set.velocity_curve_table, Set.high_resolution_velocity);
+    velocity_curve_type = Set.velocity_curve_type;
+    velocity_curve_exponent = Set.velocity_curve_exponent;
+  }
+}
+
 // After startup, wait before sending anything to MIDI
 // in order to avoid any potential startup transients.
 int startup_counter = 0;
@@ -183,8 +339,13 @@ bool switch_enable_dynamic_velocity;
 bool switch_freeze_cal_values;
 bool switch_disable_and_reset_calibration;
 
+// Commands and high-speed capture.
+char command[COMMAND_LINE_LENGTH];
+bool capture_active_last = false;
+
 // Data from ADC.
 unsigned int raw_samples[NUM_CHANNELS];
+unsigned int capture_samples[CAPTURE_MAX_CHANNELS];
 unsigned int raw_samples_reordered[NUM_CHANNELS];
 int hammer_adc_counts[NUM_CHANNELS];
 
@@ -230,30 +391,102 @@ void loop() {
   // sca_sw1_positon1 (DELETE_CAL_VALUES).
   switch_disable_and_reset_calibration = SwSCA1.read_switch_1();
 
-  // When the TFT is operational, turn off the alorithms that
-  // could generate MIDI output and slow down the sampling.
+  // Commands can arrive from the serial monitor or Ethernet.
+  if (Cmd.GetCommand(command, switch_enable_ethernet,
+  switch_require_tcp_connection) == true) {
+    if (Cap.ParseCommand(command, &Cmd) == false &&
+    Config.ParseCommand(command, &Cmd) == false &&
+    Tel.ParseCommand(command, &Cmd) == false &&
+    Box.ParseCommand(command, &Cmd) == false &&
+    Log.ParseCommand(command, &Cmd) == false) {
+      Cmd.Reply("Unknown command.");
+    }
+  }
+
+  // After a capture, the DSP history is stale. Wait before
+  // sending anything to MIDI, the same as at startup.
+  if (Cap.Active() == false && capture_active_last == true) {
+    startup_counter = 0;
+  }
+  capture_active_last = Cap.Active();
+
+  // When the TFT is operational and not drawing at the sample rate,
+  // turn off the alorithms that could generate MIDI output and slow
+  // down the sampling.
   // Slow down sampling because the TFT takes a long time for
   // processing. But, do keep the sampling going so that the TFT
   // can display things like maximum and minimum hammer positions.
-  if (switch_tft_display == true) {
+  // Also slow down while the TFT reads a picture from the SD card,
+  // which is too slow for the full sample rate.
+  bool tft_slow = switch_tft_display == true &&
+  (Set.tft_at_sample_rate == false || Tft.PictureDrawing() == true);
+  if (Cap.Active() == true) {
+    // Multi-channel high-speed capture mode.
     DspD.Enable(false);
     DspH.Enable(false);
     DspP.Enable(false);
+    DStr.Enable(false);
+    Tmg.ResetInterval(Cap.SamplePeriod());
+  }
+  else if (tft_slow == true) {
+    DspD.Enable(false);
+    DspH.Enable(false);
+    DspP.Enable(false);
+    DStr.Enable(false);
     switch_freeze_cal_values = true; // Ignore switch value.
     Tmg.ResetInterval(Set.adc_sample_period_microseconds_during_tft);
+    Tel.ResetInterval(Set.adc_sample_period_microseconds_during_tft);
   }
   else {
+    if (switch_tft_display == true) {
+      switch_freeze_cal_values = true; // Ignore switch value.
+    }
     DspD.Enable(true);
     DspH.Enable(true);
     DspP.Enable(true);
+    DStr.Enable(true);
     Tmg.ResetInterval(Set.adc_sample_period_microseconds);
+    Tel.ResetInterval(Set.adc_sample_period_microseconds);
   }
 
-  // This if statement determines the sample rate.
+  // This statement determines the sample rate.
   // Everything below in this file runs at the sample rate.
-  if (Tmg.AllowProcessing() == true) {
+  bool allow_processing = Tmg.AllowProcessing();
+
+  // Connect or disconnect Ethernet once per sample, before sending.
+  if (allow_processing == true) {
+    Eth.UpdateNetworkState(switch_enable_ethernet,
+    switch_require_tcp_connection);
+  }
+
+  // Send the sample clock to the damper board.
+  if (allow_processing == true && switch_external_damper_board == true) {
+    B2B.SendSync(Tmg.ProcessingStartMicros(), Tmg.ProcessingInterval(),
+    Set.adc_sample_period_microseconds);
+  }
+
+  if (allow_processing == true && Cap.Active() == true) {
+    Tpl.SetTp8(true);
+    Adc.GetCaptureAdcValues(capture_samples, Cap.AdcChannels(),
+    Cap.NumChannels());
+    Cap.AddFrame(capture_samples, &Eth, switch_enable_ethernet,
+    switch_require_tcp_connection);
+    Tpl.SetTp8(false);
+  }
+
+  if (allow_processing == true && Cap.Active() == false) {
 
     Tpl.SetTp8(true); // Front left test point asserts during processing.
+    Tel.FrameStart();
+    Sch.FrameStart(tft_slow == true ?
+    Set.adc_sample_period_microseconds_during_tft /
+    Set.adc_sample_period_microseconds : 1);
+    Tune.FrameStart();
+
+    // New settings take effect together, at a sample boundary.
+    if (Config.ApplyPending() == true) {
+      ApplySettings();
+    }
 
     // Get hammer and pedal data from ADC.
     Adc.GetNewAdcValues(raw_samples, Set.test_index);
@@ -263,6 +496,7 @@ void loop() {
 
     // Normalize the ADC values.
     Adc.NormalizeAdcValues(hammer_adc_counts, hammer_position_uncal, raw_samples_reordered);
+    Tel.StageEnd(TELEMETRY_ADC);
 
     // Undo the position errors due to physical tolerances.
     bool all_notes_using_cal = CalP.Calibration(switch_freeze_cal_values,
@@ -276,16 +510,19 @@ void loop() {
         hammer_position[k] = 0.0;
       }
     }
+    Tel.StageEnd(TELEMETRY_CAL);
 
     if (Set.test_index < 0) {
 
       // Select source for damper signals.
+      bool use_damper_board = false;
       if (switch_external_damper_board == true) {
         // There exists a damper board so use remote data from the damper board.
         B2B.GetDamperData(damper_position);
+        use_damper_board = B2B.LinkStale() == false;
       }
-      else {
-        // No external damper board.
+      if (use_damper_board == false) {
+        // No external damper board, or its data stopped arriving.
         // Use the hammer position as an estimate of the damper position.
         for (int k = 0; k < NUM_CHANNELS; k++)
           damper_position[k] = hammer_position[k];
@@ -294,17 +531,41 @@ void loop() {
       // Process hammer, damper, and pedal data.
       // For hammer and damper get an event boolean flag and velocity.
       // For pedal get the state of the pedal.
+      // When the damper board sends events, it already ran DspDamper
+      // on the full resolution damper positions.
       DspH.GetHammerEventData(hammer_event, hammer_velocity, hammer_position);
-      DspD.GetDamperEventData(damper_event, damper_velocity, damper_position);
+      if (use_damper_board == true && B2B.RemoteEvents() == true) {
+        B2B.GetDamperEvents(damper_event, damper_velocity);
+      }
+      else {
+        DspD.GetDamperEventData(damper_event, damper_velocity, damper_position);
+      }
       DspD.CheckHammerDamperSync(damper_event, damper_velocity, damper_position,
       hammer_event);
-      DspP.UpdatePedalState(hammer_position);
+      if (Sch.Begin(TASK_PEDALS) == true) {
+        DspP.UpdatePedalState(hammer_position);
+        Sch.End(TASK_PEDALS);
+      }
+      else {
+        DspP.ClearPedalChanges();
+      }
 
       // Adjust velocity because each physical setup is different.
       CalV.DamperVelocityScale(damper_velocity, damper_event);
       CalV.HammerVelocityScale(hammer_velocity, hammer_event,
       switch_enable_dynamic_velocity, switch_freeze_cal_values,
       switch_disable_and_reset_calibration, all_notes_using_cal); 
+      Tel.StageEnd(TELEMETRY_DSP);
+      Tel.CountEvents(hammer_event, damper_event);
+
+      // Capture the key selected on the TFT, if any.
+      Scope.Add(hammer_position, hammer_event, hammer_velocity, damper_event);
+
+      // Record the raw frame and events for a post-mortem dump.
+      Box.AddFrame(raw_samples_reordered, hammer_event, hammer_velocity,
+      damper_event);
+      Log.AddFrame(raw_samples_reordered, hammer_event, hammer_velocity,
+      damper_event);
 
       // Sending data over MIDI.
       if (startup_counter < Set.startup_counter_value) {
@@ -315,16 +576,48 @@ void loop() {
         Midi.SendNoteOff(&Mute, damper_event, damper_velocity,
           switch_external_damper_board);
         Midi.SendPedal(&DspP);
+        DStr.Update(damper_position, &Midi, &Eth, switch_enable_ethernet,
+        switch_require_tcp_connection);
+      }
+      // Send in priority order. Also sends any DIN messages that did
+      // not fit in the UART buffer last sample.
+      Midi.SendFrame();
+      if (Mute.Activated() == true) {
+        Box.Freeze("automute");
       }
+      Tel.StageEnd(TELEMETRY_MIDI);
     }
 
-    Eth.SendPianoPacket(hammer_position, damper_position,
-      switch_enable_ethernet, switch_require_tcp_connection,
-      Set.test_index);
+    // Save the calibration if a switch changed.
+    if (Sch.Begin(TASK_CALIBRATION_EEPROM) == true) {
+      CalP.WriteEeprom(switch_freeze_cal_values,
+      switch_disable_and_reset_calibration, all_notes_using_cal);
+      CalV.WriteEeprom(switch_freeze_cal_values,
+      switch_disable_and_reset_calibration);
+      Sch.End(TASK_CALIBRATION_EEPROM);
+    }
+
+    if (Set.raw_stream_enable == true) {
+      Eth.SendRawPacket(raw_samples_reordered, switch_enable_ethernet,
+        switch_require_tcp_connection);
+    }
+    else {
+      Eth.SendPianoPacket(hammer_position, damper_position,
+        switch_enable_ethernet, switch_require_tcp_connection,
+        Set.test_index);
+    }
+    Box.SendDump(&Eth, switch_enable_ethernet, switch_require_tcp_connection);
+    if (Sch.Begin(TASK_RTP_MIDI) == true) {
+      Rtp.Update(switch_enable_ethernet);
+      Sch.End(TASK_RTP_MIDI);
+    }
+    Tel.StageEnd(TELEMETRY_NETWORK);
 
     if (Set.test_index < 0) {
       // Run the TFT display.
-      Tft.Display(switch_tft_display, hammer_position, damper_position);
+      Tft.KeyEvents(hammer_event, &DspP, &Scope);
+      Tft.Display(switch_tft_display, hammer_position, damper_position,
+      Tmg.ProcessingStartMicros() + Tmg.ProcessingInterval());
     }
 
     // Debug and display information.
@@ -332,15 +625,57 @@ void loop() {
     Set.strike_threshold, Set.test_index);
 
     if (Set.test_index < 0) {
-      HStat.LowerRightLed(all_notes_using_cal, Nonv.NonvolatileWasWritten());
-      HStat.SCALed();
-      HStat.EthernetLed();
+      if (Sch.Begin(TASK_LOWER_RIGHT_LED) == true) {
+        HStat.LowerRightLed(all_notes_using_cal, Nonv.NonvolatileWasWritten(),
+        Nonv.QueuePercentWritten());
+        Sch.End(TASK_LOWER_RIGHT_LED);
+      }
+      if (Sch.Begin(TASK_SCA_LED) == true) {
+        HStat.SCALed();
+        Sch.End(TASK_SCA_LED);
+      }
+      if (Sch.Begin(TASK_ETHERNET_LED) == true) {
+        HStat.EthernetLed();
+        Sch.End(TASK_ETHERNET_LED);
+      }
       HStat.SerialMonitor(hammer_adc_counts, hammer_position, hammer_event,
       Set.canbus_enable, switch_external_damper_board);
     }
+    if (Sch.Begin(TASK_STATISTICS) == true) {
+      Tmg.PrintStatistics();
+      Midi.PrintStatistics();
+      DStr.PrintStatistics();
+      if (switch_external_damper_board == true) {
+        B2B.PrintStatistics();
+      }
+      Box.PrintStatistics();
+      Log.PrintStatistics();
+      Tft.PrintStatistics();
+      Sch.PrintStatistics();
+      Sch.End(TASK_STATISTICS);
+    }
+    Tel.StageEnd(TELEMETRY_STATUS);
+    Tel.Update(&Cmd);
+
+    // Frames take too long at the tuned sample period, so back off.
+    // Timing and Telemetry pick up the new period in the next loop().
+    // Not while the TFT slows frames on purpose.
+    if (tft_slow == false && Tune.FrameEnd() == true) {
+      Set.adc_sample_period_microseconds = Tune.SamplePeriod();
+      DspH.SetSamplePeriod(Set.adc_sample_period_microseconds);
+      DspD.SetSamplePeriod(Set.adc_sample_period_microseconds);
+      Box.SetSamplePeriod(Set.adc_sample_period_microseconds);
+      Log.SetSamplePeriod(Set.adc_sample_period_microseconds);
+    }
+
+    // Write a few bytes of any queued calibration values to EEPROM.
+    Nonv.WriteQueue(Tmg.ProcessingStartMicros() + Tmg.ProcessingInterval());
 
     Tpl.SetTp8(false);
   }
 
   HStat.DisplayProcessingIntervalEnd();
+
+  // Write the SD log in the time left before the next sample.
+  Log.Write(Tmg.ProcessingStartMicros() + Tmg.ProcessingInterval());
 }
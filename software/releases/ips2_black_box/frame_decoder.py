@@ -0,0 +1,83 @@
+# Copyright (C) 2025 Greg C. Zweigle
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+#
+# Location of documentation, code, and design:
+# https://github.com/gzweigle/open-hybrid-piano
+# https://github.com/stem-piano
+#
+#
+#
+# frame_decoder.py
+#
+# Decode one block of frames compressed by frame_coder.cpp.
+# Used by get_black_box.py and read_sd_log.py.
+
+# Must match frame_coder.h.
+escape = 16
+escape_bits = 25
+
+def decode_block(data, num_channels):
+    # Returns a list of frames, each a list of raw ADC counts, a list of
+    # events, each (frame in block, type, key, velocity), and the number
+    # of bytes used. Type is 1 for hammer and 0 for damper.
+    bits = ''.join(format(byte, '08b') for byte in data)
+    ptr = 0
+    frames = []
+    events = []
+    previous = [0] * num_channels
+    mean = [16 << 4] * num_channels
+    while bits[ptr] == '1':
+        ptr += 1
+        frame = len(frames)
+        values = []
+        for channel in range(0, num_channels):
+            if frame == 0:
+                value = int(bits[ptr:ptr+24], 2)
+                ptr += 24
+            else:
+                m = mean[channel] >> 4
+                k = m.bit_length() - 1 if m > 0 else 0
+                zero = bits.find('0', ptr, ptr + escape)
+                if zero < 0:
+                    ptr += escape
+                    mapped = int(bits[ptr:ptr+escape_bits], 2)
+                    ptr += escape_bits
+                else:
+                    quotient = zero - ptr
+                    ptr = zero + 1
+                    remainder = int(bits[ptr:ptr+k], 2) if k > 0 else 0
+                    ptr += k
+                    mapped = (quotient << k) | remainder
+                mean[channel] += mapped - (mean[channel] >> 4)
+                if mapped & 1:
+                    value = previous[channel] - (mapped + 1) // 2
+                else:
+                    value = previous[channel] + mapped // 2
+            previous[channel] = value
+            values.append(value)
+        frames.append(values)
+        if bits[ptr] == '1':
+            num_events = int(bits[ptr+1:ptr+5], 2)
+            ptr += 5
+            for event in range(0, num_events):
+                key = int(bits[ptr:ptr+7], 2)
+                event_type = int(bits[ptr+7], 2)
+                velocity = int(bits[ptr+8:ptr+16], 2)
+                ptr += 16
+                events.append((frame, event_type, key, velocity))
+        else:
+            ptr += 1
+    # Skip the end bit and the padding.
+    return frames, events, (ptr + 1 + 7) // 8
@@ -0,0 +1,173 @@
+# Copyright (C) 2025 Greg C. Zweigle
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+#
+# Location of documentation, code, and design:
+# https://github.com/gzweigle/open-hybrid-piano
+# https://github.com/stem-piano
+#
+#
+#
+# get_black_box.py
+#
+# Get the black-box recording from the hammer board and decode it.
+# See black_box.cpp for the packet format and frame_coder.cpp for
+# the compression.
+#
+# Over Ethernet, set stem piano (IPS 2.X) to UDP with Ethernet enabled.
+# This program sends "blackbox dump" and receives the recording:
+#   python get_black_box.py --teensy-ip 192.168.1.100 --computer-ip 192.168.1.101 --port 5000
+#
+# Over USB, type "blackbox dump" in the serial monitor, wait for
+# "Black box dump done", and save the serial monitor text to a file:
+#   python get_black_box.py --serial-log monitor.txt
+#
+# Writes two text files:
+#   black_box_raw.txt      One line per frame. The frame number relative
+#                          to the freeze trigger, then the raw ADC counts
+#                          of all channels.
+#   black_box_events.txt   One line per event. Frame number relative to
+#                          the trigger, 1 for hammer or 0 for damper,
+#                          key, and velocity (0 to 255).
+#
+# To view data, install Octave.
+# Type: x=load("black_box_raw.txt");plot(x(:,1),x(:,41));
+
+import argparse
+import socket
+import time
+from frame_decoder import decode_block
+
+max_packet_size = 1400
+
+def get_value(data, ptr, num_bytes):
+    x = 0
+    for shift in range(0, num_bytes):
+        x |= data[ptr + shift] << (8*shift)
+    return x
+
+def receive_network(teensy_ip, computer_ip, port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((computer_ip, port))
+    sock.sendto('blackbox dump\n'.encode('ascii'), (teensy_ip, port))
+    packets = []
+    last_time = time.perf_counter()
+    while True:
+        sock.settimeout(5.0)
+        try:
+            data, addr = sock.recvfrom(max_packet_size)
+        except socket.timeout:
+            print('Timeout, the dump did not finish.')
+            break
+        if len(data) < 5 or data[0] != ord('B') or data[1] != ord('B'):
+            # Text replies to the command.
+            try:
+                print(data.decode('ascii').strip())
+            except UnicodeDecodeError:
+                pass
+            continue
+        packets.append(data)
+        if data[2] == ord('E'):
+            break
+        if time.perf_counter() - last_time > 0.5:
+            last_time = time.perf_counter()
+            print('packets={0}'.format(len(packets)))
+    return packets
+
+def read_serial_log(file_name):
+    packets = []
+    for line in open(file_name):
+        line = line.strip()
+        if line.startswith('bb '):
+            packets.append(bytes.fromhex(line[3:]))
+    return packets
+
+parser = argparse.ArgumentParser(description='stem piano black box')
+parser.add_argument('--teensy-ip')
+parser.add_argument('--computer-ip')
+parser.add_argument('--port', type=int)
+parser.add_argument('--serial-log', help='saved serial monitor text')
+args = parser.parse_args()
+
+if args.serial_log is not None:
+    packets = read_serial_log(args.serial_log)
+elif args.teensy_ip is not None and args.computer_ip is not None and \
+    args.port is not None:
+    packets = receive_network(args.teensy_ip, args.computer_ip, args.port)
+else:
+    parser.print_help()
+    exit()
+
+header = None
+blocks = []
+last_sequence = -1
+lost_packets = 0
+for data in packets:
+    sequence = get_value(data, 3, 2)
+    if last_sequence >= 0 and sequence != ((last_sequence + 1) & 0xFFFF):
+        lost_packets += (sequence - last_sequence - 1) & 0xFFFF
+    last_sequence = sequence
+    if data[2] == ord('H'):
+        header = data
+    elif data[2] == ord('K'):
+        blocks.append({'first_frame': get_value(data, 5, 4),
+            'micros': get_value(data, 9, 4),
+            'frames': get_value(data, 13, 4),
+            'length': get_value(data, 17, 4),
+            'data': bytearray()})
+    elif data[2] == ord('D') and len(blocks) > 0:
+        blocks[-1]['data'] += data[5:]
+
+if header is None:
+    print('No black box header received.')
+    exit()
+
+sample_period = get_value(header, 5, 4)
+num_channels = header[9]
+trigger_frame = get_value(header, 16, 4)
+events_dropped = get_value(header, 20, 4)
+escapes = get_value(header, 24, 4)
+reason = header[28:].split(b'\0')[0].decode('ascii')
+print('Frozen by {0}, {1} blocks, sample period {2} us.'.format(reason,
+    len(blocks), sample_period))
+print('Lost packets={0} events dropped={1} escapes={2}'.format(
+    lost_packets, events_dropped, escapes))
+
+raw_file = open('black_box_raw.txt', 'w')
+event_file = open('black_box_events.txt', 'w')
+frames_written = 0
+for block in blocks:
+    # A block with lost data cannot be decoded.
+    if len(block['data']) != block['length']:
+        print('Skipped block at frame {0}, missing data.'.format(
+            block['first_frame'] - trigger_frame))
+        continue
+    frames, events, used = decode_block(block['data'], num_channels)
+    for frame in range(0, len(frames)):
+        number = (block['first_frame'] + frame - trigger_frame) & 0xFFFFFFFF
+        if number >= 0x80000000:
+            number -= 0x100000000
+        raw_file.write(str(number) + ' ' +
+            ' '.join(str(x) for x in frames[frame]) + '\n')
+    for event in events:
+        number = (block['first_frame'] + event[0] - trigger_frame) & 0xFFFFFFFF
+        if number >= 0x80000000:
+            number -= 0x100000000
+        event_file.write('{0} {1} {2} {3}\n'.format(number, event[1],
+            event[2], event[3]))
+    frames_written += len(frames)
+raw_file.close()
+event_file.close()
+print('Wrote {0} frames, {1:.1f} seconds.'.format(frames_written,
+    frames_written * sample_period * 1.0e-6))
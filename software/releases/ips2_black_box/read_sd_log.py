@@ -0,0 +1,166 @@
+# Copyright (C) 2025 Greg C. Zweigle
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+#
+# Location of documentation, code, and design:
+# https://github.com/gzweigle/open-hybrid-piano
+# https://github.com/stem-piano
+#
+#
+#
+# read_sd_log.py
+#
+# Decode a log file written to the TFT SD card by the hammer board.
+# See sd_log.cpp for the file format and frame_coder.cpp for the
+# compression.
+#
+# Copy /logNNN.bin from the SD card, then from a command line type:
+#   python read_sd_log.py log000.bin
+# Or only part of the log, for example 30 seconds from 10 minutes:
+#   python read_sd_log.py log000.bin --start 600 --seconds 30
+#
+# Writes two text files:
+#   sd_log_raw.txt      One line per frame. The frame number, then the
+#                       raw ADC counts of all channels.
+#   sd_log_events.txt   One line per event. Frame number, 1 for hammer
+#                       or 0 for damper, key, and velocity (0 to 255).
+# Frame numbers count samples from the start of the log, including
+# frames that were not logged because of an overflow.
+#
+# To view data, install Octave.
+# Type: x=load("sd_log_raw.txt");plot(x(:,1),x(:,41));
+
+import argparse
+from frame_decoder import decode_block
+
+sector_bytes = 512
+block_header_bytes = 12
+# Larger than any block, see frame_coder.h.
+max_block_bytes = 140000
+
+def get_value(data, ptr, num_bytes):
+    x = 0
+    for shift in range(0, num_bytes):
+        x |= data[ptr + shift] << (8*shift)
+    return x
+
+parser = argparse.ArgumentParser(description='stem piano SD card log')
+parser.add_argument('file', help='logNNN.bin from the SD card')
+parser.add_argument('--start', type=float, default=0.0,
+    help='seconds from the start of the log')
+parser.add_argument('--seconds', type=float, default=0.0,
+    help='seconds to decode, default is all')
+parser.add_argument('--sample-period', type=int, default=250,
+    help='microseconds, only used if the log has no header')
+args = parser.parse_args()
+
+log = open(args.file, 'rb')
+header = log.read(sector_bytes)
+
+index_sectors = 64
+if header[0:8] == b'STEMLOG1':
+    file_number = get_value(header, 8, 2)
+    num_channels = header[10]
+    sample_period = get_value(header, 12, 4)
+    index_sectors = get_value(header, 18, 2)
+    index_entries = get_value(header, 24, 4)
+    data_bytes = get_value(header, 28, 4)
+    print('Log {0}: {1:.1f} minutes, {2} overflow frames, {3} events '
+        'dropped, longest write {4} us, stopped by {5}.'.format(file_number,
+        get_value(header, 32, 4) * sample_period / 60.0e6,
+        get_value(header, 40, 4), get_value(header, 44, 4),
+        get_value(header, 52, 4),
+        header[60:92].split(b'\0')[0].decode('ascii')))
+else:
+    # Logging did not stop, for example power was lost. Read blocks
+    # until one does not match the first.
+    print('No header, reading until the end of the blocks.')
+    file_number = None
+    num_channels = 96
+    sample_period = args.sample_period
+    index_entries = 0
+    data_bytes = None
+
+data_start = (1 + index_sectors) * sector_bytes
+start_frame = int(args.start * 1.0e6 / sample_period)
+end_frame = None
+if args.seconds > 0:
+    end_frame = start_frame + int(args.seconds * 1.0e6 / sample_period)
+
+# Use the time index to skip to the start.
+position = 0
+if index_entries > 0:
+    log.seek(sector_bytes)
+    index = log.read(index_sectors * sector_bytes)
+    per_sector = sector_bytes // 12
+    for entry in range(0, index_entries):
+        ptr = (entry // per_sector) * sector_bytes + (entry % per_sector) * 12
+        if get_value(index, ptr + 4, 4) > start_frame:
+            break
+        position = get_value(index, ptr, 4)
+
+raw_file = open('sd_log_raw.txt', 'w')
+event_file = open('sd_log_events.txt', 'w')
+frames_written = 0
+while data_bytes is None or position < data_bytes:
+    log.seek(data_start + position)
+    data = log.read(block_header_bytes + max_block_bytes)
+    if len(data) < block_header_bytes:
+        break
+    if data[0] != ord('S') or data[1] != ord('L') or (file_number is not None
+        and get_value(data, 2, 2) != file_number):
+        if data_bytes is not None:
+            # Zeros at the end of a sector when logging stopped.
+            next_sector = (position // sector_bytes + 1) * sector_bytes
+            if next_sector < data_bytes and data[0] == 0:
+                position = next_sector
+                continue
+        break
+    if file_number is None:
+        file_number = get_value(data, 2, 2)
+    first_frame = get_value(data, 4, 4)
+    if end_frame is not None and first_frame >= end_frame:
+        break
+    # Most blocks are short, so try with less data first.
+    try:
+        frames, events, used = decode_block(
+            data[block_header_bytes:block_header_bytes + 32768], num_channels)
+    except IndexError:
+        try:
+            frames, events, used = decode_block(data[block_header_bytes:],
+                num_channels)
+        except (IndexError, ValueError):
+            print('Could not decode the block at frame {0}.'.format(
+                first_frame))
+            break
+    position += block_header_bytes + used
+    for frame in range(0, len(frames)):
+        number = first_frame + frame
+        if number < start_frame or (end_frame is not None and
+            number >= end_frame):
+            continue
+        raw_file.write(str(number) + ' ' +
+            ' '.join(str(x) for x in frames[frame]) + '\n')
+        frames_written += 1
+    for event in events:
+        number = first_frame + event[0]
+        if number < start_frame or (end_frame is not None and
+            number >= end_frame):
+            continue
+        event_file.write('{0} {1} {2} {3}\n'.format(number, event[1],
+            event[2], event[3]))
+raw_file.close()
+event_file.close()
+print('Wrote {0} frames, {1:.1f} seconds.'.format(frames_written,
+    frames_written * sample_period * 1.0e-6))
@@ -0,0 +1,102 @@
+# Copyright (C) 2025 Greg C. Zweigle
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+#
+# Location of documentation, code, and design:
+# https://github.com/gzweigle/open-hybrid-piano
+# https://github.com/stem-piano
+#
+#
+# get_capture_data.py
+#
+# Receive multi-channel high-speed capture data sent by the hammer board.
+# See capture.cpp for the packet format.
+#
+# To run this code, install Python.
+# Set stem piano (IPS 2.X) to UDP, then start capture with a serial
+# monitor command such as: capture 39 40
+# Open a command prompt or terminal (depending on OS).
+# Type: python get_capture_data.py
+#
+# The data is stored in a text file, one column per captured key,
+# as raw ADC counts.
+#
+# To view data, install Octave.
+# Type: x=load("capture_data.txt");plot(x);
+
+import socket
+import time
+
+# Settings values.
+file_length = 100000    # Total number of frames to receive.
+
+# Fixed values.
+max_packet_size = 1400
+header_bytes = 10
+
+# This computer's IP address. Must match value in Teensy.
+UDP_IP = FILL IN BEFORE RUNNING
+# Port number must match value in Teensy.
+UDP_PORT = FILL IN BEFORE RUNNING
+
+client = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+client.bind((UDP_IP, UDP_PORT))
+print("Client socket is setup to take measurements.")
+
+file = open('capture_data.txt', 'w')
+last_time = time.perf_counter()
+last_sequence = -1
+lost_packets = 0
+frames = 0
+
+while frames < file_length:
+
+    data, addr = client.recvfrom(max_packet_size)
+
+    # Skip anything that is not a capture packet, for example
+    # text replies to commands.
+    if len(data) < header_bytes or data[0] != ord('C'):
+        continue
+
+    num_channels = data[1]
+    num_frames = data[2] | (data[3]<<8)
+    rate = data[4] | (data[5]<<8) | (data[6]<<16) | (data[7]<<24)
+    sequence = data[8] | (data[9]<<8)
+    keys = list(data[header_bytes:header_bytes+num_channels])
+
+    if last_sequence >= 0 and sequence != ((last_sequence + 1) & 0xFFFF):
+        lost_packets += (sequence - last_sequence - 1) & 0xFFFF
+    last_sequence = sequence
+
+    # Each value is three bytes, least significant first.
+    ptr = header_bytes + num_channels
+    for frame in range(0, num_frames):
+        write_string = ''
+        for channel in range(0, num_channels):
+            x  = data[ptr]
+            x |= data[ptr+1]<<8
+            x |= data[ptr+2]<<16
+            ptr += 3
+            write_string += str(x) + ' '
+        write_string += '\n'
+        file.write(write_string)
+    frames += num_frames
+
+    # Put something on screen to track progress.
+    if time.perf_counter() - last_time > 0.5:
+        last_time = time.perf_counter()
+        print("frames={0} keys={1} rate={2} Hz lost packets={3}".format(
+            frames, keys, rate, lost_packets))
+
+file.close()
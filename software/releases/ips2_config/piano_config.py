@@ -0,0 +1,135 @@
+# Copyright (C) 2025 Greg C. Zweigle
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+#
+# Location of documentation, code, and design:
+# https://github.com/gzweigle/open-hybrid-piano
+# https://github.com/stem-piano
+#
+#
+# piano_config.py
+#
+# Read and write hammer board settings while the piano is running,
+# and collect telemetry. See hammer_config.cpp and telemetry.cpp.
+#
+# Set stem piano (IPS 2.X) to UDP with Ethernet enabled.
+# The board replies to the port a command was sent from. This program
+# uses any free port, so it can run next to a program receiving the
+# data stream at network_port.
+#
+# Send one command:
+#   python piano_config.py --teensy-ip 192.168.1.100 --computer-ip 192.168.1.101 --port 5000 list
+#   python piano_config.py ... set strike_threshold 0.1
+#   python piano_config.py ... apply
+#
+# Run a script of commands (see example_sweep.txt):
+#   python piano_config.py ... --sweep example_sweep.txt
+#
+# Script lines:
+#   # comment
+#   wait SECONDS
+#   sweep NAME START STOP STEP SECONDS
+#   any other line is sent to the board as a command.
+# A sweep sets and applies each value, then logs all telemetry received
+# during SECONDS. The log is written to sweep_log.txt, one line per
+# telemetry report, starting with the setting name and value.
+
+import argparse
+import socket
+import time
+
+max_packet_size = 1400
+
+def receive_lines(sock, seconds):
+    # Return all text lines received within seconds.
+    # Skips binary data such as capture packets.
+    lines = []
+    end_time = time.perf_counter() + seconds
+    while True:
+        remaining = end_time - time.perf_counter()
+        if remaining <= 0:
+            break
+        sock.settimeout(remaining)
+        try:
+            data, addr = sock.recvfrom(max_packet_size)
+        except socket.timeout:
+            break
+        try:
+            text = data.decode('ascii')
+        except UnicodeDecodeError:
+            continue
+        for line in text.splitlines():
+            if line.strip() != '':
+                lines.append(line.strip())
+    return lines
+
+def send_command(sock, teensy, command, seconds=0.5, show=True):
+    sock.sendto((command + '\n').encode('ascii'), teensy)
+    lines = receive_lines(sock, seconds)
+    if show:
+        for line in lines:
+            print(line)
+    return lines
+
+def run_sweep(sock, teensy, name, start, stop, step, seconds, log):
+    # Compute each value from start so float error does not add up.
+    num_values = int((stop - start) / step + 0.5) + 1
+    for index in range(0, num_values):
+        value = round(start + index*step, 9)
+        send_command(sock, teensy, 'set {0} {1}'.format(name, value))
+        send_command(sock, teensy, 'apply')
+        lines = receive_lines(sock, seconds)
+        for line in lines:
+            if line.startswith('telemetry'):
+                log.write('{0} {1} {2}\n'.format(name, value, line))
+        print('{0} = {1}: {2} telemetry reports'.format(name, value,
+            sum(1 for line in lines if line.startswith('telemetry'))))
+
+def run_script(sock, teensy, file_name):
+    log = open('sweep_log.txt', 'w')
+    send_command(sock, teensy, 'telemetry on')
+    for line in open(file_name):
+        line = line.strip()
+        if line == '' or line.startswith('#'):
+            continue
+        words = line.split()
+        if words[0] == 'wait':
+            time.sleep(float(words[1]))
+        elif words[0] == 'sweep':
+            run_sweep(sock, teensy, words[1], float(words[2]),
+                float(words[3]), float(words[4]), float(words[5]), log)
+        else:
+            print('> ' + line)
+            send_command(sock, teensy, line)
+    send_command(sock, teensy, 'telemetry off')
+    log.close()
+
+parser = argparse.ArgumentParser(description='stem piano runtime settings')
+parser.add_argument('--teensy-ip', required=True)
+parser.add_argument('--computer-ip', required=True)
+parser.add_argument('--port', type=int, required=True)
+parser.add_argument('--sweep', help='file with a script of commands')
+parser.add_argument('command', nargs='*', help='command to send')
+args = parser.parse_args()
+
+sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+sock.bind((args.computer_ip, 0))
+teensy = (args.teensy_ip, args.port)
+
+if args.sweep is not None:
+    run_script(sock, teensy, args.sweep)
+elif len(args.command) > 0:
+    send_command(sock, teensy, ' '.join(args.command))
+else:
+    parser.print_help()
@@ -0,0 +1,64 @@
+# Copyright (C) 2025 Greg C. Zweigle
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+#
+# Location of documentation, code, and design:
+# https://github.com/gzweigle/open-hybrid-piano
+# https://github.com/stem-piano
+#
+#
+#
+# bmp_to_565.py
+#
+# Convert 24-bit BMP images to the .565 format that the TFT display
+# draws without any conversion. See tft_image.cpp for the format.
+#
+# To run this code, install Python.
+# Open a command prompt or terminal (depending on OS).
+# Type: python bmp_to_565.py diy_16_thumbnail.bmp diy_19_thumbnail.bmp
+# Each .bmp file is written as a .565 file with the same name.
+# Copy the .565 files onto the microSD card next to the .bmp files.
+
+import struct
+import sys
+
+for bmp_name in sys.argv[1:]:
+    data = open(bmp_name, 'rb').read()
+    if data[0:2] != b'BM':
+        print(bmp_name + " is not a BMP file.")
+        continue
+    offset, = struct.unpack('<I', data[10:14])
+    width, height, planes, bits, compression = \
+        struct.unpack('<iiHHI', data[18:34])
+    if planes != 1 or bits != 24 or compression != 0:
+        print(bmp_name + " is not a 24-bit uncompressed BMP file.")
+        continue
+
+    # Rows are bottom up unless the height is negative.
+    # Each row is padded to a multiple of 4 bytes.
+    row_bytes = (3 * width + 3) // 4 * 4
+    rows = range(height - 1, -1, -1) if height > 0 else range(-height)
+
+    out = bytearray(struct.pack('<HH', width, abs(height)))
+    for row in rows:
+        start = offset + row * row_bytes
+        for x in range(width):
+            blue, green, red = data[start + 3*x:start + 3*x + 3]
+            pixel = ((red & 0xF8) << 8) | ((green & 0xFC) << 3) | (blue >> 3)
+            out += struct.pack('<H', pixel)
+
+    name = bmp_name[:-4] + '.565' if bmp_name.lower().endswith('.bmp') \
+        else bmp_name + '.565'
+    open(name, 'wb').write(out)
+    print("Wrote " + name)
@@ -36,6 +36,7 @@ def convert_to_float(a, b):
     return y
 
 import socket
+import struct
 import time
 
 # Settings values.
@@ -51,9 +52,20 @@ max_packet_size = 2*96
 UDP_IP = FILL IN BEFORE RUNNING
 # Port number must match value in Teensy.
 UDP_PORT = FILL IN BEFORE RUNNING
+# Optional. If the Teensy multicast_ip is set, use the same value here,
+# for example '239.1.2.3'. Any number of programs can receive at once.
+MCAST_GRP = ''
 
 client = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-client.bind((UDP_IP, UDP_PORT))
+if MCAST_GRP == '':
+    client.bind((UDP_IP, UDP_PORT))
+else:
+    # Allow several receivers on this computer, then IGMP join the group.
+    client.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    client.bind(('', UDP_PORT))
+    mreq = struct.pack("4s4s", socket.inet_aton(MCAST_GRP),
+        socket.inet_aton(UDP_IP))
+    client.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
 print("Client socket is setup to take measurements.")
 
 file = open('hammer_position.txt', 'w')
@@ -66,6 +78,10 @@ for ind in range(0,file_length):
     except socket.timeout as e:
         data = [0] * max_packet_size
 
+    # Skip damper stream packets, they start with 'DS'.
+    if data[0:2] == b'DS':
+        continue
+
     # Data is sent as two 8-bit integers. Convert to [-1, ..., 1].
     data_float = []
     for k in range(note_number_min,note_number_max+1):